@@ -1,11 +1,19 @@
 #!/usr/bin/env bash
 HERE="$(dirname "${0}")"
 
+# CO2_SQLITE=1 for the sqlite: targets, with the SQLite library
+SQLITE_FLAGS=()
+if [[ -n "${CO2_SQLITE}" ]]; then SQLITE_FLAGS=(-DCO2_SQLITE -lsqlite3); fi
+
+# CO2_COUNT_ALLOCATIONS=1 to count the heap allocations, see --arena
+COUNT_FLAGS=()
+if [[ -n "${CO2_COUNT_ALLOCATIONS}" ]]; then COUNT_FLAGS=(-DCO2_COUNT_ALLOCATIONS); fi
+
 CC=${CC:-cc}
 (O="${HERE}"/co2
  "${CC}" "${HERE}"/src/co2_unit.c -g -o "${O}" -I"${HERE}"/deps/hidapi/hidapi \
     "${HERE}"/deps/hidapi/linux/hid.c \
-    -DLINUX_FREEBSD -DHIDAPI=hidraw -ludev \
+    -DLINUX_FREEBSD -DHIDAPI=hidraw -ludev -pthread -lm "${SQLITE_FLAGS[@]}" "${COUNT_FLAGS[@]}" \
     && printf "PROGRAM\t%s\n" "${O}") || exit 1
 
 exit 0
@@ -1,10 +1,14 @@
 #!/usr/bin/env bash
 HERE="$(dirname "${0}")"
 
+# CO2_SQLITE=1 for the sqlite: targets, with the SQLite library
+SQLITE_FLAGS=()
+if [[ -n "${CO2_SQLITE}" ]]; then SQLITE_FLAGS=(-DCO2_SQLITE -lsqlite3); fi
+
 (O="${HERE}"/co2
  cc "${HERE}"/src/co2_unit.c -g -o "${O}" -I"${HERE}"/deps/hidapi/hidapi \
     "${HERE}"/deps/hidapi/mac/hid.c \
     -std=c11 \
-    -DAPPLE -framework IOKit -framework CoreFoundation \
+    -DAPPLE -framework IOKit -framework CoreFoundation "${SQLITE_FLAGS[@]}" \
     && printf "PROGRAM\t%s\n" "${O}") || exit 1
 
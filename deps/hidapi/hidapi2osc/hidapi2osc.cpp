@@ -37,16 +37,23 @@
 
 #include <hidapi.h>
 #include <hidapi_parser.h>
+#include <hid_usage_tables.h>
 
-// Headers needed for sleeping.
+// Headers needed for waiting on the device event handles.
 #ifdef _WIN32
 	#include <windows.h>
 #else
 	#include <unistd.h>
+	#include <poll.h>
+	#include <pthread.h>
+	#include <fcntl.h>
+	#include <time.h>
 #endif
 
 
 #include <map>
+#include <vector>
+#include <algorithm>
 
 typedef std::map<int, hid_dev_desc* > hid_map_t;
 
@@ -62,6 +69,107 @@ lo_address t;
 lo_server s;
 lo_server_thread st;
 
+// bundle collecting all the element updates of the input report currently
+// being parsed, so that one report becomes one UDP packet.
+// NULL outside of send_input_report.
+lo_bundle report_bundle = NULL;
+int report_bundle_count = 0;
+
+// wakes up the read loop when the OSC server thread posts a device request
+// (or on quit)
+#ifdef _WIN32
+HANDLE wakeup_event = NULL;
+#else
+int wakeup_pipe[2] = { -1, -1 };
+#endif
+
+void init_wakeup(){
+#ifdef _WIN32
+  wakeup_event = CreateEvent( NULL, FALSE, FALSE, NULL );
+#else
+  if ( pipe( wakeup_pipe ) == 0 ){
+    fcntl( wakeup_pipe[0], F_SETFL, O_NONBLOCK );
+    fcntl( wakeup_pipe[1], F_SETFL, O_NONBLOCK );
+  }
+#endif
+}
+
+void wakeup_read_loop(){
+#ifdef _WIN32
+  if ( wakeup_event != NULL ){
+    SetEvent( wakeup_event );
+  }
+#else
+  if ( wakeup_pipe[1] != -1 ){
+    char c = 0;
+    ssize_t res = write( wakeup_pipe[1], &c, 1 ); // a full pipe already means "wake up"
+    (void) res;
+  }
+#endif
+}
+
+void drain_wakeup(){
+#ifndef _WIN32
+  char buf[64];
+  while ( read( wakeup_pipe[0], buf, sizeof(buf) ) > 0 ){
+  }
+#endif
+}
+
+// the OSC server thread posts what it is asked to do with the devices, and
+// the read loop does it when it wakes up: only the read loop opens, uses and
+// closes devices, so none is closed while it reads from it
+enum device_request_kind {
+  DEVICE_REQUEST_OPEN,
+  DEVICE_REQUEST_CLOSE,
+  DEVICE_REQUEST_INFO,
+  DEVICE_REQUEST_ELEMENT_INFO,
+  DEVICE_REQUEST_ELEMENT_OUTPUT,
+  DEVICE_REQUEST_OUTPUT
+};
+
+struct device_request {
+  device_request_kind kind;
+  int args[3];
+};
+
+std::vector<struct device_request> device_requests; // under device_requests_lock
+#ifdef _WIN32
+CRITICAL_SECTION device_requests_lock;
+#else
+pthread_mutex_t device_requests_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void init_device_requests(){
+#ifdef _WIN32
+  InitializeCriticalSection( &device_requests_lock );
+#endif
+}
+
+void post_device_request( device_request_kind kind, int arg0, int arg1=0, int arg2=0 ){
+  struct device_request request;
+  request.kind = kind;
+  request.args[0] = arg0;
+  request.args[1] = arg1;
+  request.args[2] = arg2;
+#ifdef _WIN32
+  EnterCriticalSection( &device_requests_lock );
+  device_requests.push_back( request );
+  LeaveCriticalSection( &device_requests_lock );
+#else
+  pthread_mutex_lock( &device_requests_lock );
+  device_requests.push_back( request );
+  pthread_mutex_unlock( &device_requests_lock );
+#endif
+  wakeup_read_loop();
+}
+
+// the open device with that index, or NULL
+struct hid_dev_desc * find_device( int joy_idx ){
+  hid_map_t::const_iterator it = hiddevices.find( joy_idx );
+  return it != hiddevices.end() ? it->second : NULL;
+}
+
 static void osc_element_cb( struct hid_device_element *el, void *data)
 {
   lo_message m1 = lo_message_new();
@@ -73,8 +181,30 @@ static void osc_element_cb( struct hid_device_element *el, void *data)
   lo_message_add_float( m1, hid_element_map_logical( el ) );
   lo_message_add_float( m1, hid_element_map_physical( el ) );
   lo_message_add_int32( m1, el->array_value );
-  lo_send_message_from( t, s, "/hid/element/data", m1 );
-  lo_message_free(m1);
+  if ( report_bundle != NULL ){
+    lo_bundle_add_message( report_bundle, "/hid/element/data", m1 );
+    report_bundle_count++;
+  } else {
+    lo_send_message_from( t, s, "/hid/element/data", m1 );
+    lo_message_free(m1);
+  }
+}
+
+// parse one input report and send all its element changes as a single bundle
+int send_input_report( unsigned char *buf, int size, struct hid_dev_desc *devdesc ){
+  report_bundle = lo_bundle_new( LO_TT_IMMEDIATE );
+  report_bundle_count = 0;
+  hid_parse_input_report( buf, size, devdesc );
+  int res = 0;
+  if ( report_bundle_count > 0 ){
+    res = lo_send_bundle_from( t, s, report_bundle );
+    if ( res == -1 ){
+      printf("hidapi2osc/element/data: OSC error %d: %s\n", lo_address_errno(t), lo_address_errstr(t));
+    }
+  }
+  lo_bundle_free_messages( report_bundle );
+  report_bundle = NULL;
+  return res;
 }
 
 static void osc_descriptor_cb( struct hid_dev_desc *dd, void *data)
@@ -126,7 +256,7 @@ void open_device( unsigned short vendor, unsigned short product, const wchar_t *
 
 void close_device( int joy_idx ){
 //   hid_map_t::const_iterator it = ;
-  struct hid_dev_desc * hidtoclose = hiddevices.find( joy_idx )->second;
+  struct hid_dev_desc * hidtoclose = find_device( joy_idx );
   if ( hidtoclose == NULL ){    
     lo_send_from( t, s, LO_TT_IMMEDIATE, "/hid/close/error", "i", joy_idx );
   } else {
@@ -138,12 +268,14 @@ void close_device( int joy_idx ){
 
 
 void send_output_to_hid( int joy_idx, int reportid ){ 
-  struct hid_dev_desc * hidtosendoutput = hiddevices.find( joy_idx )->second;
-  hid_send_output_report( hidtosendoutput, reportid );
+  struct hid_dev_desc * hidtosendoutput = find_device( joy_idx );
+  if ( hidtosendoutput != NULL ){
+    hid_send_output_report( hidtosendoutput, reportid );
+  }
 }
 
 void set_element_output( int joy_idx, int elementid, int value ){ 
-  struct hid_dev_desc * devd = hiddevices.find( joy_idx )->second;
+  struct hid_dev_desc * devd = find_device( joy_idx );
   
   if ( devd != NULL ){
     // find the right output element
@@ -354,6 +486,7 @@ int quit_handler(const char *path, const char *types, lo_arg **argv, int argc,
 		 void *data, void *user_data)
 {
     done = 1;
+    wakeup_read_loop();
     printf("hidapi2osc: allright, that's it, I quit\n");
     fflush(stdout);
 
@@ -362,7 +495,7 @@ int quit_handler(const char *path, const char *types, lo_arg **argv, int argc,
 
 void send_elements_hid_info(int joy_idx)
 {
-  hid_dev_desc * hid = hiddevices.find( joy_idx )->second;
+  hid_dev_desc * hid = find_device( joy_idx );
   if ( hid == NULL ){
       lo_send_from( t, s, LO_TT_IMMEDIATE, "/hid/element/info/error", "i", joy_idx );
       return;
@@ -390,7 +523,7 @@ void send_elements_hid_info(int joy_idx)
 
 void send_hid_info(int joy_idx)
 {
-  hid_dev_desc * hid = hiddevices.find( joy_idx )->second;
+  hid_dev_desc * hid = find_device( joy_idx );
   if ( hid != NULL ){
     lo_message m1 = get_hid_info_msg( hid->info );   
     lo_send_message_from( t, s, "/hid/info", m1 );
@@ -405,7 +538,7 @@ int hid_info_handler(const char *path, const char *types, lo_arg **argv, int arg
 {
   printf("hidapi2osc: joystick info handler\n");
 
-  send_hid_info( argv[0]->i );
+  post_device_request( DEVICE_REQUEST_INFO, argv[0]->i );
   return 0;
 }
 
@@ -414,7 +547,7 @@ int hid_element_info_handler(const char *path, const char *types, lo_arg **argv,
 {
   printf("hidapi2osc: joystick elements info handler\n");
 
-  send_elements_hid_info( argv[0]->i );
+  post_device_request( DEVICE_REQUEST_ELEMENT_INFO, argv[0]->i );
   return 0;
 }
 
@@ -422,7 +555,7 @@ int hid_element_output_handler(const char *path, const char *types, lo_arg **arg
 		 void *data, void *user_data)
 {
   printf("hidapi2osc: joystick elements output handler\n");
-  set_element_output( argv[0]->i, argv[1]->i, argv[2]->i );
+  post_device_request( DEVICE_REQUEST_ELEMENT_OUTPUT, argv[0]->i, argv[1]->i, argv[2]->i );
   return 0;
 }
 
@@ -430,7 +563,7 @@ int hid_output_handler(const char *path, const char *types, lo_arg **argv, int a
 		 void *data, void *user_data)
 {
   printf("hidapi2osc: joystick output handler\n");
-  send_output_to_hid( argv[0]->i, argv[1]->i );
+  post_device_request( DEVICE_REQUEST_OUTPUT, argv[0]->i, argv[1]->i );
   return 0;
 }
 
@@ -438,7 +571,7 @@ int hid_open_handler(const char *path, const char *types, lo_arg **argv, int arg
 		 void *data, void *user_data)
 {
 //   printf("hidapi2osc: joystick open handler\n");
-  open_device( argv[0]->i, argv[1]->i, NULL );
+  post_device_request( DEVICE_REQUEST_OPEN, argv[0]->i, argv[1]->i );
   return 0;
 }
 
@@ -446,7 +579,7 @@ int hid_close_handler(const char *path, const char *types, lo_arg **argv, int ar
 		 void *data, void *user_data)
 {
   printf("hidapi2osc: joystick close handler, %i\n", argv[0]->i );
-  close_device( argv[0]->i );
+  post_device_request( DEVICE_REQUEST_CLOSE, argv[0]->i );
   return 0;
 }
 
@@ -519,12 +652,238 @@ void list_devices( void ){
 		printf("  Product:      %ls\n", cur_dev->product_string);
 		printf("  Release:      %hx\n", cur_dev->release_number);
 		printf("  Interface:    %d\n",  cur_dev->interface_number);
+		if (cur_dev->usage_page != 0) {
+			const char *page_name = hid_usage_page_name(cur_dev->usage_page);
+			const char *usage_name = hid_usage_name(cur_dev->usage_page, cur_dev->usage);
+			printf("  Usage:        %04hx %04hx (%s: %s)\n", cur_dev->usage_page, cur_dev->usage,
+			       page_name ? page_name : "?", usage_name ? usage_name : "?");
+		}
 		printf("\n");
 		cur_dev = cur_dev->next;
 	}
 	hid_free_enumeration(devs);
 }
 
+// does what the OSC server thread posted since the last time
+void apply_device_requests(){
+  std::vector<struct device_request> requests;
+#ifdef _WIN32
+  EnterCriticalSection( &device_requests_lock );
+  requests.swap( device_requests );
+  LeaveCriticalSection( &device_requests_lock );
+#else
+  pthread_mutex_lock( &device_requests_lock );
+  requests.swap( device_requests );
+  pthread_mutex_unlock( &device_requests_lock );
+#endif
+  for ( size_t i = 0; i < requests.size(); i++ ){
+    int *args = requests[i].args;
+    switch ( requests[i].kind ){
+    case DEVICE_REQUEST_OPEN: open_device( args[0], args[1], NULL ); break;
+    case DEVICE_REQUEST_CLOSE: close_device( args[0] ); break;
+    case DEVICE_REQUEST_INFO: send_hid_info( args[0] ); break;
+    case DEVICE_REQUEST_ELEMENT_INFO: send_elements_hid_info( args[0] ); break;
+    case DEVICE_REQUEST_ELEMENT_OUTPUT: set_element_output( args[0], args[1], args[2] ); break;
+    case DEVICE_REQUEST_OUTPUT: send_output_to_hid( args[0], args[1] ); break;
+    }
+  }
+}
+
+// wait on the event handles of all open devices and forward every pending
+// input report as soon as it arrives, instead of polling on a timer
+void read_loop(){
+  unsigned char buf[256];
+  std::vector<struct hid_dev_desc *> devs;
+  std::vector<int> failed;
+#ifdef _WIN32
+  std::vector<HANDLE> handles;
+  bool warned_shards = false;
+#else
+  std::vector<struct pollfd> fds;
+#endif
+  while(!done){
+    apply_device_requests();
+    devs.clear();
+    hid_map_t::const_iterator it;
+    for(it=hiddevices.begin(); it!=hiddevices.end(); ++it){
+      devs.push_back( it->second );
+    }
+
+    // drain whatever is pending. On windows this also re-arms the overlapped
+    // read that signals the device event handle.
+    failed.clear();
+    for ( size_t i = 0; i < devs.size(); i++ ){
+      int res;
+      while ( (res = hid_read( devs[i]->device, buf, sizeof(buf) )) > 0 ){
+	send_input_report( buf, res, devs[i] );
+      }
+      if ( res < 0 ){
+	failed.push_back( devs[i]->index );
+      }
+    }
+    // a device that fails to read has been disconnected, and would otherwise
+    // keep its handle signalled forever
+    for ( size_t i = 0; i < failed.size(); i++ ){
+      fprintf(stderr, "Unable to read from device %d, closing it\n", failed[i] );
+      close_device( failed[i] );
+    }
+    if ( !failed.empty() ){
+      continue;
+    }
+
+#ifdef _WIN32
+    // WaitForMultipleObjects takes at most MAXIMUM_WAIT_OBJECTS handles, the
+    // wakeup event and shard devices. With more devices, the first shard is
+    // waited on for at most SHARD_WAIT_MS and the others only checked, so that
+    // every device is still read within SHARD_WAIT_MS.
+    const size_t shard = MAXIMUM_WAIT_OBJECTS - 1;
+    const DWORD SHARD_WAIT_MS = 10;
+    if ( devs.size() > shard && !warned_shards ){
+      fprintf(stderr, "Warning: %d devices, more than the %d waited on at once: devices", (int) devs.size(), (int) shard );
+      for ( size_t i = shard; i < devs.size(); i++ ){
+	fprintf(stderr, " %d", devs[i]->index );
+      }
+      fprintf(stderr, " are checked every %d ms instead\n", (int) SHARD_WAIT_MS );
+      warned_shards = true;
+    }
+    bool signalled = false;
+    for ( size_t first = 0; !signalled && ( first == 0 || first < devs.size() ); first += shard ){
+      handles.clear();
+      handles.push_back( wakeup_event );
+      for ( size_t i = first; i < devs.size() && i < first + shard; i++ ){
+	handles.push_back( (HANDLE) hid_get_event_handle( devs[i]->device ) );
+      }
+      DWORD timeout = devs.size() <= shard ? INFINITE : first == 0 ? SHARD_WAIT_MS : 0;
+      DWORD res = WaitForMultipleObjects( (DWORD) handles.size(), &handles[0], FALSE, timeout );
+      signalled = res < WAIT_OBJECT_0 + handles.size();
+    }
+#else
+    fds.clear();
+    struct pollfd pfd;
+    pfd.fd = wakeup_pipe[0];
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    fds.push_back( pfd );
+    for ( size_t i = 0; i < devs.size(); i++ ){
+      pfd.fd = (int) (intptr_t) hid_get_event_handle( devs[i]->device );
+      fds.push_back( pfd );
+    }
+    if ( poll( &fds[0], fds.size(), -1 ) > 0 && fds[0].revents != 0 ){
+      drain_wakeup();
+    }
+#endif
+  }
+}
+
+#ifdef LINUX_FREEBSD
+
+// a gamepad with 8 buttons and 4 8-bit axes: 12 elements in a 5 byte report
+static unsigned char bench_descriptor[] = {
+  0x05, 0x01,       // usage page (generic desktop)
+  0x09, 0x05,       // usage (game pad)
+  0xA1, 0x01,       // collection (application)
+  0x05, 0x09,       //   usage page (button)
+  0x19, 0x01,       //   usage minimum (1)
+  0x29, 0x08,       //   usage maximum (8)
+  0x15, 0x00,       //   logical minimum (0)
+  0x25, 0x01,       //   logical maximum (1)
+  0x75, 0x01,       //   report size (1)
+  0x95, 0x08,       //   report count (8)
+  0x81, 0x02,       //   input (data, variable, absolute)
+  0x05, 0x01,       //   usage page (generic desktop)
+  0x09, 0x30,       //   usage (x)
+  0x09, 0x31,       //   usage (y)
+  0x09, 0x32,       //   usage (z)
+  0x09, 0x35,       //   usage (rz)
+  0x15, 0x00,       //   logical minimum (0)
+  0x26, 0xFF, 0x00, //   logical maximum (255)
+  0x75, 0x08,       //   report size (8)
+  0x95, 0x04,       //   report count (4)
+  0x81, 0x02,       //   input (data, variable, absolute)
+  0xC0              // end collection
+};
+
+int bench_received = 0;
+
+int bench_handler(const char *path, const char *types, lo_arg **argv, int argc,
+		 void *data, void *user_data)
+{
+  bench_received++;
+  return 0;
+}
+
+static double now_in_us(){
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// measures the time from an input report entering the parser to its bundle
+// being received by a local OSC server
+int run_latency_benchmark( int iterations ){
+  lo_server receiver = lo_server_new( NULL, error );
+  if ( receiver == NULL ){
+    fprintf(stderr, "Unable to create local OSC receiver\n");
+    return 1;
+  }
+  lo_server_add_method( receiver, "/hid/element/data", NULL, bench_handler, NULL );
+  char port[16];
+  snprintf( port, sizeof(port), "%d", lo_server_get_port( receiver ) );
+  t = lo_address_new( "127.0.0.1", port );
+  s = lo_server_new( NULL, error );
+
+  struct hid_dev_desc devdesc;
+  memset( &devdesc, 0, sizeof(devdesc) );
+  hid_parse_report_descriptor( bench_descriptor, sizeof(bench_descriptor), &devdesc );
+  hid_set_element_callback( &devdesc, (hid_element_callback) osc_element_cb, &devdesc.index );
+
+  std::vector<double> latencies;
+  latencies.reserve( iterations );
+  int messages = 0;
+  int lost = 0;
+  unsigned char report[5];
+  for ( int i = 0; i < iterations; i++ ){
+    // change every element so that each report carries a full bundle
+    report[0] = (i & 1) ? 0xFF : 0x00;
+    for ( int j = 1; j < 5; j++ ){
+      report[j] = (unsigned char) (i + j);
+    }
+    bench_received = 0;
+    double start = now_in_us();
+    send_input_report( report, sizeof(report), &devdesc );
+    if ( lo_server_recv_noblock( receiver, 1000 ) == 0 ){
+      lost++;
+      continue;
+    }
+    latencies.push_back( now_in_us() - start );
+    messages += bench_received;
+  }
+
+  if ( latencies.empty() ){
+    fprintf(stderr, "No report was received\n");
+  } else {
+    std::sort( latencies.begin(), latencies.end() );
+    size_t n = latencies.size();
+    printf("reports\t%d\n", iterations);
+    printf("lost\t%d\n", lost);
+    printf("messages/bundle\t%.1f\n", (double) messages / n);
+    printf("latency_min_us\t%.1f\n", latencies[0]);
+    printf("latency_median_us\t%.1f\n", latencies[n / 2]);
+    printf("latency_p99_us\t%.1f\n", latencies[(n * 99) / 100]);
+    printf("latency_max_us\t%.1f\n", latencies[n - 1]);
+  }
+
+  hid_free_collection( devdesc.device_collection );
+  free( devdesc.report_ids );
+  free( devdesc.report_lengths );
+  lo_server_free( s );
+  lo_server_free( receiver );
+  lo_address_free( t );
+  return latencies.empty() ? 1 : 0;
+}
+
+#endif
+
 void print_help(const char* prg)
 {
   printf("Usage: %s [OPTION]\n", prg);
@@ -538,6 +897,9 @@ void print_help(const char* prg)
   printf("  --list             Search for available joysticks and list their properties\n");
 //   printf("  --event JOYNUM     Display the events that are received from the joystick\n");
   printf("  --osc     	       Send the events that are received from the joystick\n");
+#ifdef LINUX_FREEBSD
+  printf("  --bench [N]        Measure input report to OSC packet latency over N reports\n");
+#endif
   printf("\n");
   printf("Examples:\n");
   printf("  %s --list\n", prg);
@@ -609,6 +971,8 @@ int main(int argc, char** argv)
 	outport = argv[2];
 	}
   
+      init_wakeup();
+      init_device_requests();
       init_osc( ip, outport, port );
 
       if (hid_init())
@@ -616,28 +980,25 @@ int main(int argc, char** argv)
     
       printf("Entering hid read loop, press Ctrl-c to exit\n");
 
-      int res = 0;
-      hid_map_t::const_iterator it;
-      unsigned char buf[256];
-      while(!done){
-	for(it=hiddevices.begin(); it!=hiddevices.end(); ++it){
-	  res = hid_read( it->second->device, buf, sizeof(buf));
-	  if ( res > 0 ) {
-	    hid_parse_input_report( buf, res, it->second );
-	  }
-	}
-	#ifdef WIN32
-	Sleep(50);
-	#else
-	usleep(500*10);
-	#endif
-      }
+      read_loop();
       close_all_devices();
 	  
       lo_send_from( t, s, LO_TT_IMMEDIATE, "/hidapi2osc/quit", "s", "nothing more to do, quitting" );
       lo_server_thread_free( st );
       lo_address_free( t );
     }
+#ifdef LINUX_FREEBSD
+    else if ((argc == 2 || argc == 3) && strcmp(argv[1], "--bench") == 0)
+    {
+      int iterations = 10000;
+      if (argc == 3 && (!str2int(argv[2], &iterations) || iterations <= 0))
+      {
+        fprintf(stderr, "Error: N argument must be a positive number, but was '%s'\n", argv[2]);
+        exit(1);
+      }
+      return run_latency_benchmark( iterations );
+    }
+#endif
     else
     {
       fprintf(stderr, "%s: unknown arguments\n", argv[0]);
@@ -0,0 +1,66 @@
+/* hidapi_parser $
+ *
+ * Lookup of usage names and types in the tables generated from the hut/ yaml files.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stddef.h>
+
+#include "hid_usage_tables.h"
+
+struct hid_usage_entry {
+  uint32_t key; // usage_page << 16 | usage, 0xFFFFFFFF for empty slots
+  uint16_t name; // offset in hid_usage_strings
+  uint16_t type;
+};
+
+#include "hid_usage_tables_data.h"
+
+static const struct hid_usage_entry * hid_find_usage( int usage_page, int usage ){
+  if ( usage_page < 0 || usage_page > 0xFFFF || usage < 0 || usage > 0xFFFF ){
+    return NULL;
+  }
+  uint32_t key = ((uint32_t) usage_page << 16) | (uint32_t) usage;
+  uint32_t bucket = hid_usage_hash( key ) % HID_USAGE_NUM_BUCKETS;
+  uint32_t slot = hid_usage_slot( key, hid_usage_displacements[ bucket ] ) & (HID_USAGE_NUM_SLOTS - 1);
+  const struct hid_usage_entry * entry = &hid_usage_entries[ slot ];
+  return entry->key == key ? entry : NULL;
+}
+
+const char * hid_usage_page_name( int usage_page ){
+  // the tables only hold the standard pages below 0x100
+  if ( usage_page >= 0xFF00 && usage_page <= 0xFFFF ){
+    return "Vendor-defined";
+  }
+  if ( usage_page < 0 || usage_page > 255 || hid_usage_page_names[ usage_page ] == 0 ){
+    return NULL;
+  }
+  return &hid_usage_strings[ hid_usage_page_names[ usage_page ] ];
+}
+
+const char * hid_usage_name( int usage_page, int usage ){
+  const struct hid_usage_entry * entry = hid_find_usage( usage_page, usage );
+  if ( entry == NULL || entry->name == 0 ){
+    return NULL;
+  }
+  return &hid_usage_strings[ entry->name ];
+}
+
+enum hid_usage_type hid_usage_type( int usage_page, int usage ){
+  const struct hid_usage_entry * entry = hid_find_usage( usage_page, usage );
+  return entry == NULL ? HID_USAGE_TYPE_UNKNOWN : (enum hid_usage_type) entry->type;
+}
+
+const char * hid_usage_type_name( enum hid_usage_type type ){
+  static const char names[][5] = {
+    "", "LC", "OOC", "MC", "OSC", "RTC", "Sel", "SV", "SF", "DV", "DF", "NAry", "CA", "CL", "CP", "US", "UM"
+  };
+  if ( (int) type <= 0 || (int) type >= (int) (sizeof(names) / sizeof(names[0])) ){
+    return NULL;
+  }
+  return names[ type ];
+}
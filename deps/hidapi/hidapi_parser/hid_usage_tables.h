@@ -0,0 +1,68 @@
+/* hidapi_parser $
+ *
+ * Names and types of the usages from the HID Usage Tables (hut/ directory),
+ * compiled into read-only tables by hid_usage_tables_gen.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef HID_USAGE_TABLES_H__
+#define HID_USAGE_TABLES_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus /* If this is a C++ compiler, use C linkage */
+extern "C" {
+#endif
+
+// usage types from HID Usage Tables 1.12 Section 3.4
+enum hid_usage_type {
+  HID_USAGE_TYPE_UNKNOWN = 0,
+  HID_USAGE_TYPE_LC,   // linear control
+  HID_USAGE_TYPE_OOC,  // on/off control
+  HID_USAGE_TYPE_MC,   // momentary control
+  HID_USAGE_TYPE_OSC,  // one shot control
+  HID_USAGE_TYPE_RTC,  // re-trigger control
+  HID_USAGE_TYPE_Sel,  // selector
+  HID_USAGE_TYPE_SV,   // static value
+  HID_USAGE_TYPE_SF,   // static flag
+  HID_USAGE_TYPE_DV,   // dynamic value
+  HID_USAGE_TYPE_DF,   // dynamic flag
+  HID_USAGE_TYPE_NAry, // named array
+  HID_USAGE_TYPE_CA,   // application collection
+  HID_USAGE_TYPE_CL,   // logical collection
+  HID_USAGE_TYPE_CP,   // physical collection
+  HID_USAGE_TYPE_US,   // usage switch
+  HID_USAGE_TYPE_UM,   // usage modifier
+};
+
+// all of these return NULL (resp. HID_USAGE_TYPE_UNKNOWN) for unknown usages,
+// and never allocate. The pages 0xFF00 to 0xFFFF are named "Vendor-defined",
+// their usages are unknown.
+const char * hid_usage_page_name( int usage_page );
+const char * hid_usage_name( int usage_page, int usage );
+enum hid_usage_type hid_usage_type( int usage_page, int usage );
+const char * hid_usage_type_name( enum hid_usage_type type );
+
+// the perfect hash, shared between the lookup and the generator
+static inline uint32_t hid_usage_hash( uint32_t key ){
+  key ^= key >> 16;
+  key *= 0x85ebca6bU;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35U;
+  key ^= key >> 16;
+  return key;
+}
+
+static inline uint32_t hid_usage_slot( uint32_t key, uint32_t displacement ){
+  return hid_usage_hash( key ^ (displacement * 0x9e3779b9U) ^ 0x5bd1e995U );
+}
+
+#ifdef __cplusplus /* If this is a C++ compiler, end C linkage */
+}
+#endif
+
+#endif
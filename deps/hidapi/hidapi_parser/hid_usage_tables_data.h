@@ -0,0 +1,1938 @@
+/* generated by hid_usage_tables_gen.c from the hut/ yaml files, do not edit */
+
+#define HID_USAGE_NUM_BUCKETS 214
+#define HID_USAGE_NUM_SLOTS 1024
+
+static const char hid_usage_strings[12028] =
+  "\0"
+  "Unassigned\0"
+  "Phone\0"
+  "Answering Machine\0"
+  "Message Controls\0"
+  "Handset\0"
+  "Headset\0"
+  "Telephony Key Pad\0"
+  "Programmable Button\0"
+  "Hook Switch\0"
+  "Flash\0"
+  "Feature\0"
+  "Hold\0"
+  "Redial\0"
+  "Transfer\0"
+  "Drop\0"
+  "Park\0"
+  "Forward Calls\0"
+  "Alternate Function\0"
+  "Line\0"
+  "Speaker Phone\0"
+  "Conference\0"
+  "Ring Enable\0"
+  "Ring Select\0"
+  "Phone Mute\0"
+  "Caller ID\0"
+  "Speed Dial\0"
+  "Store Number\0"
+  "Recall Number\0"
+  "Phone Directory\0"
+  "Voice Mail\0"
+  "Screen Calls\0"
+  "Do Not Disturb\0"
+  "Message\0"
+  "Answer On/Off\0"
+  "Inside Dial Tone\0"
+  "Outside Dial Tone\0"
+  "Inside Ring Tone\0"
+  "Outside Ring Tone\0"
+  "Priority Ring Tone\0"
+  "Inside Ringback\0"
+  "Priority Ringback\0"
+  "Line Busy Tone\0"
+  "Reorder Tone\0"
+  "Call Waiting Tone\0"
+  "Confirmation Tone 1\0"
+  "Confirmation Tone 2\0"
+  "Tones Off\0"
+  "Phone Key 0\0"
+  "Phone Key 1\0"
+  "Phone Key 2\0"
+  "Phone Key 3\0"
+  "Phone Key 4\0"
+  "Phone Key 5\0"
+  "Phone Key 6\0"
+  "Phone Key 7\0"
+  "Phone Key 8\0"
+  "Phone Key 9\0"
+  "Phone Key Star\0"
+  "Phone Key Pound\0"
+  "Phone Key A\0"
+  "Phone Key B\0"
+  "Phone Key C\0"
+  "Phone Key D\0"
+  "Telephony\0"
+  "Consumer Control\0"
+  "Numeric Key Pad\0"
+  "Programmable Buttons\0"
+  "Microphone\0"
+  "Headphone\0"
+  "Graphic Equalizer\0"
+  "+10\0"
+  "+100\0"
+  "AM/PM\0"
+  "Power\0"
+  "Reset\0"
+  "Sleep\0"
+  "Sleep After\0"
+  "Sleep Mode\0"
+  "Illumination\0"
+  "Function Buttons\0"
+  "Menu\0"
+  "Menu  Pick\0"
+  "Menu Up\0"
+  "Menu Down\0"
+  "Menu Left\0"
+  "Menu Right\0"
+  "Menu Escape\0"
+  "Menu Value Increase\0"
+  "Menu Value Decrease\0"
+  "Data On Screen\0"
+  "Closed Caption\0"
+  "Closed Caption Select\0"
+  "VCR/TV\0"
+  "Broadcast Mode\0"
+  "Snapshot\0"
+  "Still\0"
+  "Selection\0"
+  "Assign Selection\0"
+  "Mode Step\0"
+  "Recall Last\0"
+  "Enter Channel\0"
+  "Order Movie\0"
+  "Channel\0"
+  "Media Selection\0"
+  "Media Select Computer\0"
+  "Media Select TV\0"
+  "Media Select WWW\0"
+  "Media Select DVD\0"
+  "Media Select Telephone\0"
+  "Media Select Program Guide\0"
+  "Media Select Video Phone\0"
+  "Media Select Games\0"
+  "Media Select Messages\0"
+  "Media Select CD\0"
+  "Media Select VCR\0"
+  "Media Select Tuner\0"
+  "Quit\0"
+  "Help\0"
+  "Media Select Tape\0"
+  "Media Select Cable\0"
+  "Media Select Satellite\0"
+  "Media Select Security\0"
+  "Media Select Home\0"
+  "Media Select Call\0"
+  "Channel Increment\0"
+  "Channel Decrement\0"
+  "Media Select SAP\0"
+  "VCR Plus\0"
+  "Once\0"
+  "Daily\0"
+  "Weekly\0"
+  "Monthly\0"
+  "Play\0"
+  "Pause\0"
+  "Record\0"
+  "Fast Forward\0"
+  "Rewind\0"
+  "Scan Next Track\0"
+  "Scan Previous Track\0"
+  "Stop\0"
+  "Eject\0"
+  "Random Play\0"
+  "Select DisC\0"
+  "Enter Disc\0"
+  "Repeat\0"
+  "Tracking\0"
+  "Track Normal\0"
+  "Slow Tracking\0"
+  "Frame Forward\0"
+  "Frame Back\0"
+  "Mark\0"
+  "Clear Mark\0"
+  "Repeat From Mark\0"
+  "Return To Mark\0"
+  "Search Mark Forward\0"
+  "Search Mark Backwards\0"
+  "Counter Reset\0"
+  "Show Counter\0"
+  "Tracking Increment\0"
+  "Tracking Decrement\0"
+  "Volume\0"
+  "Balance\0"
+  "Mute\0"
+  "Bass\0"
+  "Treble\0"
+  "Bass Boost\0"
+  "Surround Mode\0"
+  "Loudness\0"
+  "MPX\0"
+  "Volume Up\0"
+  "Volume Down\0"
+  "Speed Select\0"
+  "Playback Speed\0"
+  "Standard Play\0"
+  "Long Play\0"
+  "Extended Play\0"
+  "Slow\0"
+  "Fan Enable\0"
+  "Fan Speed\0"
+  "Light\0"
+  "Light Illumination Level\0"
+  "Climate Control Enable\0"
+  "Room Temperature\0"
+  "Security Enable\0"
+  "Fire Alarm\0"
+  "Police Alarm\0"
+  "Balance Right\0"
+  "Balance Left\0"
+  "Bass Increment\0"
+  "Bass Decrement\0"
+  "Treble Increment\0"
+  "Treble Decrement\0"
+  "Speaker System\0"
+  "Channel Left\0"
+  "Channel Right\0"
+  "Channel Center\0"
+  "Channel Front\0"
+  "Channel Center Front\0"
+  "Channel Side\0"
+  "Channel Surround\0"
+  "Channel Low Frequency Enhancement\0"
+  "Channel Top\0"
+  "Channel Unknown\0"
+  "Sub-channel\0"
+  "Sub-channel Increment\0"
+  "Sub-channel Decrement\0"
+  "Alternate Audio Increment\0"
+  "Alternate Audio Decrement\0"
+  "Application Launch Buttons\0"
+  "AL Launch Button Configuration Tool\0"
+  "AL Programmable Button Configuration\0"
+  "AL Consumer Control Configuration\0"
+  "AL Word Processor\0"
+  "AL Text Editor\0"
+  "AL Spreadsheet\0"
+  "AL Graphics Editor\0"
+  "AL Presentation App\0"
+  "AL Database App\0"
+  "AL Email Reader\0"
+  "AL Newsreader\0"
+  "AL Voicemail\0"
+  "AL Contacts/Address Book\0"
+  "AL Calendar/Schedule\0"
+  "AL Task/Project Manager\0"
+  "AL Log/Journal/Timecard\0"
+  "AL Checkbook/Finance\0"
+  "AL Calculator\0"
+  "AL A/V Capture/Playback\0"
+  "AL Local Machine Browser\0"
+  "AL LAN/WAN Browser\0"
+  "AL Internet Browser\0"
+  "AL Remote Networking/ISP Connect\0"
+  "AL Network Conference\0"
+  "AL Network Chat\0"
+  "AL Telephony/Dialer\0"
+  "AL Logon\0"
+  "AL Logoff\0"
+  "AL Logon/Logoff\0"
+  "AL Terminal Lock/Screensaver\0"
+  "AL Control Panel\0"
+  "AL Command Line Processor/Run\0"
+  "AL Process/Task Manager\0"
+  "AL Select Tast/Application\0"
+  "AL Next Task/Application\0"
+  "AL Previous Task/Application\0"
+  "AL Preemptive Halt Task/Application\0"
+  "Generic GUI Application Controls\0"
+  "AC New\0"
+  "AC Open\0"
+  "AC Close\0"
+  "AC Exit\0"
+  "AC Maximize\0"
+  "AC Minimize\0"
+  "AC Save\0"
+  "AC Print\0"
+  "AC Properties\0"
+  "AC Undo\0"
+  "AC Copy\0"
+  "AC Cut\0"
+  "AC Paste\0"
+  "AC Select All\0"
+  "AC Find\0"
+  "AC Find and Replace\0"
+  "AC Search\0"
+  "AC Go To\0"
+  "AC Home\0"
+  "AC Back\0"
+  "AC Forward\0"
+  "AC Stop\0"
+  "AC Refresh\0"
+  "AC Previous Link\0"
+  "AC Next Link\0"
+  "AC Bookmarks\0"
+  "AC History\0"
+  "AC Subscriptions\0"
+  "AC Zoom In\0"
+  "AC Zoom Out\0"
+  "AC Zoom\0"
+  "AC Full Screen View\0"
+  "AC Normal View\0"
+  "AC View Toggle\0"
+  "AC Scroll Up\0"
+  "AC Scroll Down\0"
+  "AC Scroll\0"
+  "AC Pan Left\0"
+  "AC Pan Right\0"
+  "AC Pan\0"
+  "AC New Window\0"
+  "AC Tile Horizontally\0"
+  "AC Tile Vertically\0"
+  "AC Format\0"
+  "Consumer\0"
+  "Digitizer\0"
+  "Pen\0"
+  "Light_Pen\0"
+  "Touch_Screen\0"
+  "Touch_Pad\0"
+  "White_Board\0"
+  "Coordinate_Measuring\0"
+  "Machine\0"
+  "3D_Digitizer\0"
+  "Stereo_Plotter\0"
+  "Articulated_Arm\0"
+  "Armature\0"
+  "Multiple_Point_Digitizer\0"
+  "Stylus\0"
+  "Puck\0"
+  "Finger\0"
+  "Tip_Pressure\0"
+  "Barrel_Pressure\0"
+  "In_Range\0"
+  "Touch\0"
+  "Untouch\0"
+  "Tap\0"
+  "Quality\0"
+  "Data_Valid\0"
+  "Transducer_Index\0"
+  "Tablet_Function_Keys\0"
+  "Program_Change_Keys\0"
+  "Battery_Strength\0"
+  "Invert\0"
+  "X_Tilt\0"
+  "Y_Tilt\0"
+  "Azimuth\0"
+  "Altitude\0"
+  "Twist\0"
+  "Tip_Switch\0"
+  "Secondary_Tip_Switch\0"
+  "Barrel_Switch\0"
+  "Eraser\0"
+  "Tablet_Pick\0"
+  "Digitizers\0"
+  "Pointer\0"
+  "Mouse\0"
+  "Joystick\0"
+  "GamePad\0"
+  "Keyboard\0"
+  "Keypad\0"
+  "MultiAxis_Controller\0"
+  "X\0"
+  "Y\0"
+  "Z\0"
+  "Rx\0"
+  "Ry\0"
+  "Rz\0"
+  "Slider\0"
+  "Dial\0"
+  "Wheel\0"
+  "Hat_switch\0"
+  "Counted_Buffer\0"
+  "Byte_Count\0"
+  "Motion_Wakeup\0"
+  "Start\0"
+  "Select\0"
+  "Vx\0"
+  "Vy\0"
+  "Vz\0"
+  "Vbrx\0"
+  "Vbry\0"
+  "Vbrz\0"
+  "Vno\0"
+  "Feature_Notification\0"
+  "System_Control\0"
+  "System_Power_Down\0"
+  "System_Sleep\0"
+  "System_Wake_Up\0"
+  "System_Context_Menu\0"
+  "System_Main_Menu\0"
+  "System_App_Menu\0"
+  "System_Menu_Help\0"
+  "System_Menu_Exit\0"
+  "System_Menu_Select\0"
+  "System_Menu_Right\0"
+  "System_Menu_Left\0"
+  "System_Menu_Up\0"
+  "System_Menu_Down\0"
+  "System_Cold_Restart\0"
+  "System_Warm_Restart\0"
+  "D-pad_Up\0"
+  "D-pad_Down\0"
+  "D-pad_Right\0"
+  "D-pad_Left\0"
+  "System_Dock\0"
+  "System_Undock\0"
+  "System_Setup\0"
+  "System_Break\0"
+  "System_Debugger_Break\0"
+  "Application_Break\0"
+  "Application_Debugger_Break\0"
+  "System_Speaker_Mute\0"
+  "System_Hibernate\0"
+  "System_Display_Invert\0"
+  "System_Display_Internal\0"
+  "System_Display_External\0"
+  "System_Display_Both\0"
+  "System_Display_Dual\0"
+  "System_Display_Toggle_IntExt\0"
+  "System_Display_Swap_Primary_Secundary\0"
+  "System_Display_LCD_Autoscale\0"
+  "Generic Desktop\0"
+  "Undefined\0"
+  "Alphanumeric Display\0"
+  "Display Attributes Report\0"
+  "ASCII Character Set\0"
+  "Data Read Back\0"
+  "Font Read Back\0"
+  "Display Control Report\0"
+  "Clear Display\0"
+  "Display Enable\0"
+  "Screen Saver Delay\0"
+  "Screen Saver Enable\0"
+  "Vertical Scroll\0"
+  "Horizontal Scroll\0"
+  "Character Report\0"
+  "Display Data\0"
+  "Display Status\0"
+  "Stat Not Ready\0"
+  "Stat Ready\0"
+  "Err Not a loadable character\0"
+  "Err Font data cannot be read\0"
+  "Cursor Position Report\0"
+  "Row\0"
+  "Column\0"
+  "Rows\0"
+  "Columns\0"
+  "Cursor Pixel Positioning\0"
+  "Cursor Mode\0"
+  "Cursor Enable\0"
+  "Cursor Blink\0"
+  "Font Report\0"
+  "Font Data\0"
+  "Character Width\0"
+  "Character Height\0"
+  "Character Spacing Horizontal\0"
+  "Character Spacing Vertical\0"
+  "Unicode Character Set\0"
+  "Alphanumeric Display\0"
+  "Flight_Simulation_Device\0"
+  "Automobile_Simulation_Device\0"
+  "Tank_Simulation_Device\0"
+  "Spaceship_Simulation_Device\0"
+  "Submarine_Simulation_Device\0"
+  "Sailing_Simulation_Device\0"
+  "Motorcycle_Simulation_Device\0"
+  "Sports_Simulation_Device\0"
+  "Airplane_Simulation_Device\0"
+  "Helicopter_Simulation_Device\0"
+  "Magic_Carpet_Simulation_Device\0"
+  "Bicycle_Simulation_Device\0"
+  "Flight_Control_Stick\0"
+  "Flight_Stick\0"
+  "Cyclic_Control\0"
+  "Cyclic_Trim\0"
+  "Flight_Yoke\0"
+  "Track_Control\0"
+  "Aileron\0"
+  "Aileron_Trim\0"
+  "Anti-Torque_Control\0"
+  "Autopilot_Enable\0"
+  "Chaff_Release\0"
+  "Collective_Control\0"
+  "Dive_Brake\0"
+  "Electronic_Countermeasures\0"
+  "Elevator\0"
+  "Elevator_Trim\0"
+  "Rudder\0"
+  "Throttle\0"
+  "Flight_Communications\0"
+  "Flare_Release\0"
+  "Landing_Gear\0"
+  "Toe_Brake\0"
+  "Trigger\0"
+  "Weapons_Arm\0"
+  "Weapons_Select\0"
+  "Wing_Flaps\0"
+  "Accelerator\0"
+  "Brake\0"
+  "Clutch\0"
+  "Shifter\0"
+  "Steering\0"
+  "Turret_Direction\0"
+  "Barrel_Elevation\0"
+  "Dive_Plane\0"
+  "Ballast\0"
+  "Bicycle_Rank\0"
+  "Handle_Bars\0"
+  "Front_Brake\0"
+  "Rear_Brake\0"
+  "Simulation Controls\0"
+  "Belt\0"
+  "Body_Suit\0"
+  "Flexor\0"
+  "Glove\0"
+  "Head_Tracker\0"
+  "Head_Mounted_Display\0"
+  "Hand_Tracker\0"
+  "Oculometer\0"
+  "Vest\0"
+  "Animatronic_Device\0"
+  "Stereo_Enable\0"
+  "Display_Enable\0"
+  "VR Controls\0"
+  "Baseball_Bat\0"
+  "Golf_Club\0"
+  "Rowing_Machine\0"
+  "Treadmill\0"
+  "Oar\0"
+  "Slope\0"
+  "Rate\0"
+  "Stick_Speed\0"
+  "Stick_Face_Angle\0"
+  "Stick_Heel/Toe\0"
+  "Stick_Follow_Through\0"
+  "Stick_Tempo\0"
+  "Stick_Type\0"
+  "Stick_Height\0"
+  "Putter\0"
+  "1_Iron\0"
+  "2_Iron\0"
+  "3_Iron\0"
+  "4_Iron\0"
+  "5_Iron\0"
+  "6_Iron\0"
+  "7_Iron\0"
+  "8_Iron\0"
+  "9_Iron\0"
+  "10_Iron\0"
+  "11_Iron\0"
+  "Sand_Wedge\0"
+  "Loft_Wedge\0"
+  "Power_Wedge\0"
+  "1_Wood\0"
+  "3_Wood\0"
+  "5_Wood\0"
+  "7_Wood\0"
+  "9_Wood\0"
+  "Sport Controls\0"
+  "3D_Game_Controller\0"
+  "Pinball_Device\0"
+  "Gun_Device\0"
+  "Point_of_View\0"
+  "Turn_Right_Left\0"
+  "Pitch_Forward_Backward\0"
+  "Roll_Right_Left\0"
+  "Move_Right_Left\0"
+  "Move_Forward_Backward\0"
+  "Move_Up_Down\0"
+  "Lean_Right_Left\0"
+  "Lean_Forward_Backward\0"
+  "Height_of_POV\0"
+  "Flipper\0"
+  "Secondary_Flipper\0"
+  "Bump\0"
+  "New_Game\0"
+  "Shoot_Ball\0"
+  "Player\0"
+  "Gun_Bolt\0"
+  "Gun_Clip\0"
+  "Gun_Selector\0"
+  "Gun_Single_Shot\0"
+  "Gun_Burst\0"
+  "Gun_Automatic\0"
+  "Gun_Safety\0"
+  "Gamepad_Fire_Jump\0"
+  "Gamepad_Trigger\0"
+  "Games Page\0"
+  "Medical instrument\0"
+  "Battery_Strength\0"
+  "Wireless_Channel\0"
+  "Wireless_ID\0"
+  "Generic Device\0"
+  "Keyboard_ErrorRollOver\0"
+  "Keyboard_POSTFail\0"
+  "Keyboard_ErrorUndefined\0"
+  "Keyboard_a\0"
+  "Keyboard_b\0"
+  "Keyboard_c\0"
+  "Keyboard_d\0"
+  "Keyboard_e\0"
+  "Keyboard_f\0"
+  "Keyboard_g\0"
+  "Keyboard_h\0"
+  "Keyboard_i\0"
+  "Keyboard_j\0"
+  "Keyboard_k\0"
+  "Keyboard_l\0"
+  "Keyboard_m\0"
+  "Keyboard_n\0"
+  "Keyboard_o\0"
+  "Keyboard_p\0"
+  "Keyboard_q\0"
+  "Keyboard_r\0"
+  "Keyboard_s\0"
+  "Keyboard_t\0"
+  "Keyboard_u\0"
+  "Keyboard_v\0"
+  "Keyboard_w\0"
+  "Keyboard_x\0"
+  "Keyboard_y\0"
+  "Keyboard_z\0"
+  "Keyboard_1\0"
+  "Keyboard_2\0"
+  "Keyboard_3\0"
+  "Keyboard_4\0"
+  "Keyboard_5\0"
+  "Keyboard_6\0"
+  "Keyboard_7\0"
+  "Keyboard_8\0"
+  "Keyboard_9\0"
+  "Keyboard_0\0"
+  "Keyboard_Return_Enter\0"
+  "Keyboard_ESCAPE\0"
+  "Keyboard_DELETE_Backspace\0"
+  "Keyboard_Tab\0"
+  "Keyboard_Spacebar\0"
+  "Keyboard_-\0"
+  "Keyboard_=\0"
+  "Keyboard_[\0"
+  "Keyboard_]\0"
+  "Keyboard_\\\0"
+  "Keyboard_#\0"
+  "Keyboard_;\0"
+  "Keyboard_'\0"
+  "Keyboard_Grave_Accent\0"
+  "Keyboard_,\0"
+  "Keyboard_.\0"
+  "Keyboard_/\0"
+  "Keyboard_CapsLock\0"
+  "Keyboard_F1\0"
+  "Keyboard_F2\0"
+  "Keyboard_F3\0"
+  "Keyboard_F4\0"
+  "Keyboard_F5\0"
+  "Keyboard_F6\0"
+  "Keyboard_F7\0"
+  "Keyboard_F8\0"
+  "Keyboard_F9\0"
+  "Keyboard_F10\0"
+  "Keyboard_F11\0"
+  "Keyboard_F12\0"
+  "Keyboard_PrintScreen\0"
+  "Keyboard_ScrollLock\0"
+  "Keyboard_Pause\0"
+  "Keyboard_Insert\0"
+  "Keyboard_Home\0"
+  "Keyboard_PageUp\0"
+  "Keyboard_Delete_Forward\0"
+  "Keyboard_End\0"
+  "Keyboard_PageDown\0"
+  "Keyboard_RightArrow\0"
+  "Keyboard_LeftArrow\0"
+  "Keyboard_DownArrow\0"
+  "Keyboard_UpArrow\0"
+  "Keyboard_NumLock\0"
+  "Keypad_/\0"
+  "Keypad_*\0"
+  "Keypad_-\0"
+  "Keypad_+\0"
+  "Keypad_ENTER\0"
+  "Keypad_1\0"
+  "Keypad_2\0"
+  "Keypad_3\0"
+  "Keypad_4\0"
+  "Keypad_5\0"
+  "Keypad_6\0"
+  "Keypad_7\0"
+  "Keypad_8\0"
+  "Keypad_9\0"
+  "Keypad_0\0"
+  "Keypad_.\0"
+  "Keypad_\\\0"
+  "Keyboard_Application\0"
+  "Keyboard_Power\0"
+  "Keypad_=\0"
+  "Keyboard_F13\0"
+  "Keyboard_F14\0"
+  "Keyboard_F15\0"
+  "Keyboard_F16\0"
+  "Keyboard_F17\0"
+  "Keyboard_F18\0"
+  "Keyboard_F19\0"
+  "Keyboard_F20\0"
+  "Keyboard_F21\0"
+  "Keyboard_F22\0"
+  "Keyboard_F23\0"
+  "Keyboard_F24\0"
+  "Keyboard_Execute\0"
+  "Keyboard_Help\0"
+  "Keyboard_Menu\0"
+  "Keyboard_Select\0"
+  "Keyboard_Stop\0"
+  "Keyboard_Again\0"
+  "Keyboard_Undo\0"
+  "Keyboard_Cut\0"
+  "Keyboard_Copy\0"
+  "Keyboard_Paste\0"
+  "Keyboard_Find\0"
+  "Keyboard_Mute\0"
+  "Keyboard_VolumeUp\0"
+  "Keyboard_VolumeDown\0"
+  "Keyboard_Locking_CapsLock\0"
+  "Keyboard_Locking_NumLock\0"
+  "Keyboard_Locking_ScrollLock\0"
+  "Keypad_Comma\0"
+  "Keypad_EqualSign\0"
+  "Keyboard_International1\0"
+  "Keyboard_International2\0"
+  "Keyboard_International3\0"
+  "Keyboard_International4\0"
+  "Keyboard_International5\0"
+  "Keyboard_International6\0"
+  "Keyboard_International7\0"
+  "Keyboard_International8\0"
+  "Keyboard_International9\0"
+  "Keyboard_LANG1\0"
+  "Keyboard_LANG2\0"
+  "Keyboard_LANG3\0"
+  "Keyboard_LANG4\0"
+  "Keyboard_LANG5\0"
+  "Keyboard_LANG6\0"
+  "Keyboard_LANG7\0"
+  "Keyboard_LANG8\0"
+  "Keyboard_LANG9\0"
+  "Keyboard_Alternate_Erase\0"
+  "Keyboard_SysReq_Attention\0"
+  "Keyboard_Cancel\0"
+  "Keyboard_Clear\0"
+  "Keyboard_Prior\0"
+  "Keyboard_Return\0"
+  "Keyboard_Separator\0"
+  "Keyboard_Out\0"
+  "Keyboard_Oper\0"
+  "Keyboard_Clear_Again\0"
+  "Keyboard_CrSel_Props\0"
+  "Keyboard_ExSel\0"
+  "Keypad_00\0"
+  "Keypad_000\0"
+  "Thousands_Separator\0"
+  "Decimal_Separator\0"
+  "Currency_Unit\0"
+  "Currency_Subunit\0"
+  "Keypad_(\0"
+  "Keypad_)\0"
+  "Keypad_{\0"
+  "Keypad_}\0"
+  "Keypad_Tab\0"
+  "Keypad_Backspace\0"
+  "Keypad_A\0"
+  "Keypad_B\0"
+  "Keypad_C\0"
+  "Keypad_D\0"
+  "Keypad_E\0"
+  "Keypad_F\0"
+  "Keypad_XOR\0"
+  "Keypad_^\0"
+  "Keypad_%\0"
+  "Keypad_<\0"
+  "Keypad_>\0"
+  "Keypad_&\0"
+  "Keypad_&&\0"
+  "Keypad_|\0"
+  "Keypad_||\0"
+  "Keypad_:\0"
+  "Keypad_#\0"
+  "Keypad_Space\0"
+  "Keypad_@\0"
+  "Keypad_!\0"
+  "Keypad_MemoryStore\0"
+  "Keypad_MemoryRecall\0"
+  "Keypad_MemoryClear\0"
+  "Keypad_MemoryAdd\0"
+  "Keypad_MemorySubtract\0"
+  "Keypad_MemoryMultiply\0"
+  "Keypad_MemoryDivide\0"
+  "Keypad_+/-\0"
+  "Keypad_Clear\0"
+  "Keypad_ClearEntry\0"
+  "Keypad_Binary\0"
+  "Keypad_Octal\0"
+  "Keypad_Decimal\0"
+  "Keypad_Hexadecimal\0"
+  "Keyboard_LeftControl\0"
+  "Keyboard_LeftShift\0"
+  "Keyboard_LeftAlt\0"
+  "Keyboard_LeftGUI\0"
+  "Keyboard_RightControl\0"
+  "Keyboard_RightShift\0"
+  "Keyboard_RightAlt\0"
+  "Keyboard_RightGUI\0"
+  "Keyboard - Keypad\0"
+  "Undefined\0"
+  "Num_Lock\0"
+  "Caps_Lock\0"
+  "Scroll_Lock\0"
+  "Compose\0"
+  "Kana\0"
+  "Power\0"
+  "Shift\0"
+  "Do_Not_Disturb\0"
+  "Mute\0"
+  "Tone_Enable\0"
+  "High_Cut_Filter\0"
+  "Low_Cut_Filter\0"
+  "Equalizer_Enable\0"
+  "Sound_Field_On\0"
+  "Surround_On\0"
+  "Repeat\0"
+  "Stereo\0"
+  "Sampling_Rate_Detect\0"
+  "Spinning\0"
+  "CAV\0"
+  "CLV\0"
+  "Recording_Format_Detect\0"
+  "Off-Hook\0"
+  "Ring\0"
+  "Message_Waiting\0"
+  "Data_Mode\0"
+  "Battery_Operation\0"
+  "Battery_OK\0"
+  "Battery_Low\0"
+  "Speaker\0"
+  "Head_Set\0"
+  "Microphone\0"
+  "Coverage\0"
+  "Night_Mode\0"
+  "Send_Calls\0"
+  "Call_Pickup\0"
+  "Conference\0"
+  "Stand-by\0"
+  "Camera_On\0"
+  "Camera_Off\0"
+  "On-Line\0"
+  "Off-Line\0"
+  "Busy\0"
+  "Ready\0"
+  "Paper-Out\0"
+  "Paper-Jam\0"
+  "Remote\0"
+  "Forward\0"
+  "Reverse\0"
+  "Stop\0"
+  "Rewind\0"
+  "Fast_Forward\0"
+  "Play\0"
+  "Pause\0"
+  "Record\0"
+  "Error\0"
+  "Usage_Selected_Indicator\0"
+  "Usage_In_Use_Indicator\0"
+  "Usage_Multi_Mode_Indicator\0"
+  "Indicator_On\0"
+  "Indicator_Flash\0"
+  "Indicator_Slow_Blink\0"
+  "Indicator_Fast_Blink\0"
+  "Indicator_Off\0"
+  "Flash_On_Time\0"
+  "Slow_Blink_On_Time\0"
+  "Slow_Blink_Off_Time\0"
+  "Fast_Blink_On_Time\0"
+  "Fast_Blink_Off_Time\0"
+  "Usage_Indicator_Color\0"
+  "Indicator_Red\0"
+  "Indicator_Green\0"
+  "Indicator_Amber\0"
+  "Generic_Indicator\0"
+  "System_Suspend\0"
+  "External_Power_Connected\0"
+  "LED page\0";
+
+static const uint16_t hid_usage_page_names[256] = {
+  0, 5508, 6979, 7138, 7469, 7875, 7951, 11061, 12019, 0, 0, 805, 4151, 4604, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  6129, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 7886, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const uint16_t hid_usage_displacements[HID_USAGE_NUM_BUCKETS] = {
+  0, 7, 44, 8, 16, 2, 13, 6, 3, 1, 8, 3, 0, 0, 3, 1,
+  3, 2, 25, 24, 1, 4, 7, 6, 2, 31, 1, 6, 1, 21, 16, 36,
+  5, 0, 36, 4, 32, 17, 28, 2, 6, 8, 18, 0, 13, 23, 5, 2,
+  9, 0, 11, 25, 0, 8, 3, 5, 10, 1, 23, 0, 8, 14, 0, 1,
+  15, 0, 3, 1, 28, 4, 2, 56, 9, 13, 1, 2, 0, 60, 19, 1,
+  4, 7, 1, 24, 14, 1, 2, 3, 14, 3, 9, 56, 7, 29, 0, 6,
+  0, 16, 22, 3, 15, 13, 31, 18, 40, 64, 9, 7, 6, 3, 17, 18,
+  72, 12, 111, 12, 61, 3, 16, 0, 14, 28, 7, 69, 15, 25, 20, 43,
+  6, 5, 1, 32, 7, 53, 11, 66, 47, 2, 4, 23, 38, 33, 0, 57,
+  57, 11, 2, 18, 43, 18, 43, 1, 0, 3, 42, 4, 15, 127, 6, 0,
+  18, 20, 6, 2, 2, 12, 32, 5, 1, 7, 3, 41, 34, 1, 0, 32,
+  4, 6, 0, 103, 35, 27, 3, 36, 33, 6, 27, 7, 214, 29, 3, 46,
+  23, 3, 39, 18, 4, 112, 50, 2, 5, 3, 19, 0, 27, 5, 14, 17,
+  53, 1, 0, 5, 0, 5,
+};
+
+static const struct hid_usage_entry hid_usage_entries[HID_USAGE_NUM_SLOTS] = {
+  { 0x00050027, 7649, HID_USAGE_TYPE_DV },
+  { 0x000700E4, 10983, HID_USAGE_TYPE_DV },
+  { 0x000C00C3, 1938, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0035, 4397, HID_USAGE_TYPE_OSC },
+  { 0x00070036, 8632, HID_USAGE_TYPE_Sel },
+  { 0x000C0003, 848, HID_USAGE_TYPE_NAry },
+  { 0x000700B2, 10346, HID_USAGE_TYPE_Sel },
+  { 0x00200030, 5827, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040039, 7301, HID_USAGE_TYPE_DV },
+  { 0x000700BF, 10506, HID_USAGE_TYPE_Sel },
+  { 0x000C0087, 1273, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070051, 9026, HID_USAGE_TYPE_Sel },
+  { 0x00050001, 7484, HID_USAGE_TYPE_CA },
+  { 0x0007004B, 8916, HID_USAGE_TYPE_Sel },
+  { 0x0020002D, 5786, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070061, 9200, HID_USAGE_TYPE_Sel },
+  { 0x00030006, 7040, HID_USAGE_TYPE_CA },
+  { 0x00070038, 8654, HID_USAGE_TYPE_Sel },
+  { 0x000D000D, 4301, HID_USAGE_TYPE_CA },
+  { 0x00040060, 7441, HID_USAGE_TYPE_Sel },
+  { 0x000C0092, 1493, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010086, 4927, HID_USAGE_TYPE_OSC },
+  { 0x000700B3, 10366, HID_USAGE_TYPE_Sel },
+  { 0x000B002C, 216, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080039, 11635, HID_USAGE_TYPE_OOC },
+  { 0x000D0020, 4326, HID_USAGE_TYPE_CL },
+  { 0x00080008, 11139, HID_USAGE_TYPE_OOC },
+  { 0x00070035, 8610, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0199, 3318, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080028, 11500, HID_USAGE_TYPE_OOC },
+  { 0x00080017, 11304, HID_USAGE_TYPE_OOC },
+  { 0x0008001F, 11409, HID_USAGE_TYPE_OOC },
+  { 0x000C0194, 3199, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070086, 9741, HID_USAGE_TYPE_Sel },
+  { 0x000C023B, 4122, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008004B, 11961, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0001008B, 5014, HID_USAGE_TYPE_RTC },
+  { 0x000C0236, 4055, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080002, 11089, HID_USAGE_TYPE_OOC },
+  { 0x00040050, 7314, HID_USAGE_TYPE_Sel },
+  { 0x0020003E, 6034, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00200041, 6107, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700C2, 10533, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007002D, 8522, HID_USAGE_TYPE_Sel },
+  { 0x0007004A, 8902, HID_USAGE_TYPE_Sel },
+  { 0x000D0040, 4524, HID_USAGE_TYPE_DV },
+  { 0x000700C0, 10515, HID_USAGE_TYPE_Sel },
+  { 0x00070085, 9728, HID_USAGE_TYPE_Sel },
+  { 0x00010089, 4977, HID_USAGE_TYPE_OSC },
+  { 0x000D0022, 4338, HID_USAGE_TYPE_CL },
+  { 0x000700B8, 10433, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040037, 7278, HID_USAGE_TYPE_DV },
+  { 0x00030004, 7021, HID_USAGE_TYPE_CA },
+  { 0x000100A6, 5238, HID_USAGE_TYPE_OSC },
+  { 0x000C0096, 1539, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00A1, 1719, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700DB, 10862, HID_USAGE_TYPE_Sel },
+  { 0x000C0187, 2948, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00C8, 2023, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700D1, 10686, HID_USAGE_TYPE_Sel },
+  { 0x000D000C, 4292, HID_USAGE_TYPE_CA },
+  { 0x000C021D, 3749, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0071, 337, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007008F, 9950, HID_USAGE_TYPE_Sel },
+  { 0x00010092, 5123, HID_USAGE_TYPE_OOC },
+  { 0x000100B2, 5348, HID_USAGE_TYPE_OSC },
+  { 0x000700E6, 11025, HID_USAGE_TYPE_DV },
+  { 0x00050025, 7614, HID_USAGE_TYPE_DV },
+  { 0x0001008C, 5031, HID_USAGE_TYPE_RTC },
+  { 0x00200029, 5722, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00F3, 2222, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B0003, 36, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070080, 9611, HID_USAGE_TYPE_Sel },
+  { 0x00030021, 7123, HID_USAGE_TYPE_OOC },
+  { 0x000C01A0, 3435, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0169, 2630, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B00B5, 666, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010080, 4829, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0022, 917, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0005002E, 7741, HID_USAGE_TYPE_OSC },
+  { 0x000C0063, 1153, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0101, 2262, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00B7, 1819, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700E7, 11043, HID_USAGE_TYPE_DV },
+  { 0x0005002A, 7701, HID_USAGE_TYPE_MC },
+  { 0x000C016A, 2642, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0174, 2740, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0238, 4080, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700E3, 10966, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200B3, 6604, HID_USAGE_TYPE_OOC },
+  { 0x00010085, 4910, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0004005C, 7400, HID_USAGE_TYPE_Sel },
+  { 0x00080038, 11628, HID_USAGE_TYPE_OOC },
+  { 0x0007008E, 9926, HID_USAGE_TYPE_Sel },
+  { 0x0007007F, 9597, HID_USAGE_TYPE_Sel },
+  { 0x00010035, 4695, HID_USAGE_TYPE_DV },
+  { 0x00010008, 4662, HID_USAGE_TYPE_CA },
+  { 0x000C0048, 1081, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0004005E, 7422, HID_USAGE_TYPE_Sel },
+  { 0x00070057, 9106, HID_USAGE_TYPE_Sel },
+  { 0x0020003F, 6051, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00200028, 5702, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000200C0, 6790, HID_USAGE_TYPE_MC },
+  { 0x000B0025, 145, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0172, 2692, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007009C, 10176, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D0044, 4571, HID_USAGE_TYPE_MC },
+  { 0x000C0207, 3695, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00F5, 2246, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0191, 3140, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008000C, 11177, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007007D, 9568, HID_USAGE_TYPE_Sel },
+  { 0x000200CB, 6912, HID_USAGE_TYPE_DV },
+  { 0x0020003B, 5996, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0091, 404, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070033, 8588, HID_USAGE_TYPE_Sel },
+  { 0x0008001A, 11342, HID_USAGE_TYPE_OOC },
+  { 0x000700CB, 10618, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0225, 3835, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C009A, 1621, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C009B, 1639, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0074, 373, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200C6, 6854, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D003D, 4502, HID_USAGE_TYPE_DV },
+  { 0x0007001B, 8284, HID_USAGE_TYPE_Sel },
+  { 0x000700C1, 10524, HID_USAGE_TYPE_Sel },
+  { 0x0007008D, 9902, HID_USAGE_TYPE_Sel },
+  { 0x0008001B, 11358, HID_USAGE_TYPE_OOC },
+  { 0x000C018C, 3033, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007000A, 8097, HID_USAGE_TYPE_Sel },
+  { 0x00070093, 10019, HID_USAGE_TYPE_Sel },
+  { 0x000C0195, 3224, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D0031, 4358, HID_USAGE_TYPE_DV },
+  { 0x000C00B1, 1750, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070072, 9411, HID_USAGE_TYPE_Sel },
+  { 0x000C0091, 1477, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0229, 3882, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070099, 10109, HID_USAGE_TYPE_Sel },
+  { 0x000C0083, 1227, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010007, 4655, HID_USAGE_TYPE_CA },
+  { 0x00070013, 8196, HID_USAGE_TYPE_Sel },
+  { 0x000C022A, 3895, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010047, 4808, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0008002B, 11529, HID_USAGE_TYPE_OOC },
+  { 0x000C0045, 1038, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080010, 11240, HID_USAGE_TYPE_OOC },
+  { 0x00010033, 4689, HID_USAGE_TYPE_DV },
+  { 0x00050037, 7841, HID_USAGE_TYPE_CL },
+  { 0x00070020, 8339, HID_USAGE_TYPE_Sel },
+  { 0x000C00CA, 2050, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00020025, 6549, HID_USAGE_TYPE_CP },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0001003A, 4727, HID_USAGE_TYPE_CL },
+  { 0x000C0154, 2440, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00B5, 1783, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00200027, 5683, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C019B, 3354, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0165, 2545, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C009C, 1657, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00030005, 7027, HID_USAGE_TYPE_CP },
+  { 0x000100B7, 5479, HID_USAGE_TYPE_OSC },
+  { 0x000B0053, 310, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700BD, 10488, HID_USAGE_TYPE_Sel },
+  { 0x00030009, 7085, HID_USAGE_TYPE_CA },
+  { 0x0007001C, 8295, HID_USAGE_TYPE_Sel },
+  { 0x000C0189, 2987, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0022, 125, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0001, 4160, HID_USAGE_TYPE_CA },
+  { 0x00040051, 7321, HID_USAGE_TYPE_Sel },
+  { 0x000C00CB, 2069, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0221, 3800, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070029, 8449, HID_USAGE_TYPE_Sel },
+  { 0x0007003E, 8731, HID_USAGE_TYPE_Sel },
+  { 0x000C0204, 3663, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0043, 1018, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070075, 9454, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700D5, 10764, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040061, 7448, HID_USAGE_TYPE_Sel },
+  { 0x000B0028, 164, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070015, 8218, HID_USAGE_TYPE_Sel },
+  { 0x00010040, 4780, HID_USAGE_TYPE_DV },
+  { 0x00070041, 8767, HID_USAGE_TYPE_Sel },
+  { 0x0007004C, 8932, HID_USAGE_TYPE_Sel },
+  { 0x000700C8, 10589, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0108, 2370, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0163, 2516, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0005, 4197, HID_USAGE_TYPE_CA },
+  { 0x000100B4, 5392, HID_USAGE_TYPE_OSC },
+  { 0x000B002F, 251, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00A0, 1710, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00020024, 6537, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007008B, 9854, HID_USAGE_TYPE_Sel },
+  { 0x000C00EA, 2168, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070004, 8031, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007003D, 8719, HID_USAGE_TYPE_Sel },
+  { 0x00070056, 9097, HID_USAGE_TYPE_Sel },
+  { 0x00050033, 7790, HID_USAGE_TYPE_Sel },
+  { 0x000C0046, 1049, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700CF, 10658, HID_USAGE_TYPE_Sel },
+  { 0x000C00B2, 1756, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010031, 4685, HID_USAGE_TYPE_DV },
+  { 0x000C0184, 2900, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00B8, 1824, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0051, 283, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0001003B, 4742, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B0070, 326, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C022E, 3947, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007008A, 9830, HID_USAGE_TYPE_Sel },
+  { 0x000100B0, 5302, HID_USAGE_TYPE_OSC },
+  { 0x000700C5, 10562, HID_USAGE_TYPE_Sel },
+  { 0x000700DD, 10890, HID_USAGE_TYPE_Sel },
+  { 0x000200B6, 6654, HID_USAGE_TYPE_DV },
+  { 0x000C009E, 1693, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0222, 3810, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0005002C, 7727, HID_USAGE_TYPE_MC },
+  { 0x000700B6, 10415, HID_USAGE_TYPE_Sel },
+  { 0x000C0209, 3712, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D003F, 4516, HID_USAGE_TYPE_DV },
+  { 0x000D0036, 4401, HID_USAGE_TYPE_DV },
+  { 0x000B00B0, 606, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008001D, 11386, HID_USAGE_TYPE_OOC },
+  { 0x000C0201, 3639, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080020, 11417, HID_USAGE_TYPE_OOC },
+  { 0x000C018F, 3092, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700D2, 10706, HID_USAGE_TYPE_Sel },
+  { 0x00070003, 8007, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0237, 4067, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0030, 4345, HID_USAGE_TYPE_DV },
+  { 0x00070037, 8643, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00B9, 1830, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007005E, 9173, HID_USAGE_TYPE_Sel },
+  { 0x00070016, 8229, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700C7, 10580, HID_USAGE_TYPE_Sel },
+  { 0x000B00B4, 654, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000100A2, 5172, HID_USAGE_TYPE_OSC },
+  { 0x0008000A, 11160, HID_USAGE_TYPE_OOC },
+  { 0x00050038, 7859, HID_USAGE_TYPE_CL },
+  { 0x00030020, 7109, HID_USAGE_TYPE_OOC },
+  { 0x0008003B, 11666, HID_USAGE_TYPE_US },
+  { 0x00020008, 6338, HID_USAGE_TYPE_CA },
+  { 0x00080030, 11569, HID_USAGE_TYPE_OOC },
+  { 0x000700D3, 10725, HID_USAGE_TYPE_Sel },
+  { 0x00080029, 11510, HID_USAGE_TYPE_OOC },
+  { 0x000100A8, 5285, HID_USAGE_TYPE_OSC },
+  { 0x000D0033, 4383, HID_USAGE_TYPE_MC },
+  { 0x000700C4, 10553, HID_USAGE_TYPE_Sel },
+  { 0x0008002E, 11549, HID_USAGE_TYPE_OOC },
+  { 0x000B00B1, 618, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070066, 9257, HID_USAGE_TYPE_Sel },
+  { 0x0007003A, 8683, HID_USAGE_TYPE_Sel },
+  { 0x000C00E5, 2120, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040001, 7150, HID_USAGE_TYPE_CA },
+  { 0x000B0093, 439, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B00BB, 741, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00050023, 7582, HID_USAGE_TYPE_DV },
+  { 0x000C019E, 3389, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000200BC, 6731, HID_USAGE_TYPE_OOC },
+  { 0x000700A0, 10241, HID_USAGE_TYPE_Sel },
+  { 0x000D0037, 4409, HID_USAGE_TYPE_MC },
+  { 0x00070028, 8427, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0160, 2474, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010090, 5103, HID_USAGE_TYPE_OOC },
+  { 0x00200026, 5668, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008000B, 11165, HID_USAGE_TYPE_OOC },
+  { 0x0007009E, 10206, HID_USAGE_TYPE_Sel },
+  { 0x0002000C, 6450, HID_USAGE_TYPE_CA },
+  { 0x000C0164, 2531, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008004C, 11979, HID_USAGE_TYPE_OOC },
+  { 0x000C021C, 3742, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000100A5, 5220, HID_USAGE_TYPE_OSC },
+  { 0x000200C4, 6836, HID_USAGE_TYPE_DV },
+  { 0x000D003C, 4495, HID_USAGE_TYPE_MC },
+  { 0x000B00B6, 678, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0223, 3819, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0190, 3116, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080013, 11266, HID_USAGE_TYPE_OOC },
+  { 0x00080033, 11592, HID_USAGE_TYPE_OOC },
+  { 0x00070014, 8207, HID_USAGE_TYPE_Sel },
+  { 0x000B0026, 154, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C021B, 3734, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070006, 8053, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070098, 10094, HID_USAGE_TYPE_Sel },
+  { 0x000C00B4, 1776, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0004, 53, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0224, 3827, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700E2, 10949, HID_USAGE_TYPE_DV },
+  { 0x0002000A, 6390, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070054, 9079, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0170, 2658, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070046, 8830, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0008000E, 11208, HID_USAGE_TYPE_OOC },
+  { 0x000200CF, 6956, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00050032, 7777, HID_USAGE_TYPE_NAry },
+  { 0x000B0096, 492, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700CE, 10649, HID_USAGE_TYPE_Sel },
+  { 0x00070017, 8240, HID_USAGE_TYPE_Sel },
+  { 0x0007006E, 9359, HID_USAGE_TYPE_Sel },
+  { 0x0007004F, 8987, HID_USAGE_TYPE_Sel },
+  { 0x00010042, 4786, HID_USAGE_TYPE_DV },
+  { 0x0008001E, 11397, HID_USAGE_TYPE_OOC },
+  { 0x0020002E, 5801, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040059, 7377, HID_USAGE_TYPE_Sel },
+  { 0x000B00B8, 702, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0042, 4539, HID_USAGE_TYPE_MC },
+  { 0x00080007, 11133, HID_USAGE_TYPE_OOC },
+  { 0x00010081, 4844, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070097, 10079, HID_USAGE_TYPE_Sel },
+  { 0x000100B3, 5372, HID_USAGE_TYPE_OSC },
+  { 0x0007000C, 8119, HID_USAGE_TYPE_Sel },
+  { 0x000700C9, 10599, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007001D, 8306, HID_USAGE_TYPE_Sel },
+  { 0x00010030, 4683, HID_USAGE_TYPE_DV },
+  { 0x000D0032, 4374, HID_USAGE_TYPE_MC },
+  { 0x000C0033, 941, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00BB, 1854, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070040, 8755, HID_USAGE_TYPE_Sel },
+  { 0x0007002A, 8465, HID_USAGE_TYPE_Sel },
+  { 0x00020006, 6283, HID_USAGE_TYPE_CA },
+  { 0x00040036, 7257, HID_USAGE_TYPE_DV },
+  { 0x00010087, 4943, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007006D, 9346, HID_USAGE_TYPE_Sel },
+  { 0x0001003D, 4767, HID_USAGE_TYPE_OOC },
+  { 0x000B0007, 87, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00BF, 1894, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0047, 1061, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070018, 8251, HID_USAGE_TYPE_Sel },
+  { 0x000C00C0, 1908, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010043, 4789, HID_USAGE_TYPE_DV },
+  { 0x000B0090, 387, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040055, 7349, HID_USAGE_TYPE_Sel },
+  { 0x0007007E, 9583, HID_USAGE_TYPE_Sel },
+  { 0x00070083, 9675, HID_USAGE_TYPE_Sel },
+  { 0x00200031, 5856, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000100A4, 5198, HID_USAGE_TYPE_OSC },
+  { 0x00010002, 4623, HID_USAGE_TYPE_CA },
+  { 0x00050003, 7518, HID_USAGE_TYPE_CA },
+  { 0x000C00F4, 2232, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0185, 2918, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00020004, 6227, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200020, 5555, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0090, 1455, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0171, 2670, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007007C, 9554, HID_USAGE_TYPE_Sel },
+  { 0x00080026, 11480, HID_USAGE_TYPE_OOC },
+  { 0x000B0023, 133, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070011, 8174, HID_USAGE_TYPE_Sel },
+  { 0x0007005B, 9146, HID_USAGE_TYPE_Sel },
+  { 0x00040003, 7173, HID_USAGE_TYPE_CA },
+  { 0x00010044, 4794, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070050, 9007, HID_USAGE_TYPE_Sel },
+  { 0x000C00E2, 2103, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700E0, 10909, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00010001, 4615, HID_USAGE_TYPE_CP },
+  { 0x000C009D, 1675, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070012, 8185, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700B9, 10442, HID_USAGE_TYPE_Sel },
+  { 0x00070069, 9294, HID_USAGE_TYPE_Sel },
+  { 0x00020023, 6525, HID_USAGE_TYPE_CP },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070070, 9385, HID_USAGE_TYPE_Sel },
+  { 0x000200B8, 6692, HID_USAGE_TYPE_DV },
+  { 0x000100A7, 5265, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0008003C, 11689, HID_USAGE_TYPE_UM },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200039, 5969, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080035, 11604, HID_USAGE_TYPE_OOC },
+  { 0x00050028, 7665, HID_USAGE_TYPE_DV },
+  { 0x00070021, 8350, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0155, 2457, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080009, 11145, HID_USAGE_TYPE_OOC },
+  { 0x000200B2, 6584, HID_USAGE_TYPE_DV },
+  { 0x0007008C, 9878, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C019F, 3418, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00050034, 7806, HID_USAGE_TYPE_Sel },
+  { 0x0005002D, 7732, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200022, 5601, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0001008E, 5063, HID_USAGE_TYPE_OSC },
+  { 0x000C0089, 1311, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0001008D, 5046, HID_USAGE_TYPE_RTC },
+  { 0x000B0073, 365, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200BB, 6722, HID_USAGE_TYPE_DV },
+  { 0x0008001C, 11368, HID_USAGE_TYPE_OOC },
+  { 0x000C00F0, 2180, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00B6, 1799, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00030002, 7004, HID_USAGE_TYPE_CA },
+  { 0x0003000A, 7090, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0004005B, 7392, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070032, 8577, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0004005F, 7434, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B0027, 159, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C021E, 3758, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0233, 4017, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0198, 3296, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010045, 4799, HID_USAGE_TYPE_DV },
+  { 0x000C019A, 3334, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C023A, 4101, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0042, 1010, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007006F, 9372, HID_USAGE_TYPE_Sel },
+  { 0x0008003A, 11641, HID_USAGE_TYPE_US },
+  { 0x000B00B3, 642, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B009A, 556, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C022B, 3908, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700D6, 10786, HID_USAGE_TYPE_Sel },
+  { 0x00070091, 9989, HID_USAGE_TYPE_Sel },
+  { 0x000C00E6, 2131, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00E9, 2158, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0021, 119, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070049, 8886, HID_USAGE_TYPE_Sel },
+  { 0x000200C1, 6798, HID_USAGE_TYPE_OOC },
+  { 0x00080021, 11426, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0162, 2502, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008004A, 11945, HID_USAGE_TYPE_Sel },
+  { 0x00070090, 9974, HID_USAGE_TYPE_Sel },
+  { 0x00070071, 9398, HID_USAGE_TYPE_Sel },
+  { 0x000100A1, 5158, HID_USAGE_TYPE_OSC },
+  { 0x0007001A, 8273, HID_USAGE_TYPE_Sel },
+  { 0x000D0008, 4240, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200B9, 6701, HID_USAGE_TYPE_DV },
+  { 0x00040031, 7202, HID_USAGE_TYPE_DV },
+  { 0x00010006, 4646, HID_USAGE_TYPE_CA },
+  { 0x00050022, 7559, HID_USAGE_TYPE_DV },
+  { 0x000B00BD, 769, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0004, 869, HID_USAGE_TYPE_CA },
+  { 0x000200CD, 6931, HID_USAGE_TYPE_DV },
+  { 0x0020003A, 5983, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080043, 11815, HID_USAGE_TYPE_DV },
+  { 0x00040054, 7342, HID_USAGE_TYPE_Sel },
+  { 0x00020020, 6476, HID_USAGE_TYPE_CA },
+  { 0x000C0183, 2866, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007001E, 8317, HID_USAGE_TYPE_Sel },
+  { 0x000B0052, 296, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0040, 994, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0228, 3865, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007003C, 8707, HID_USAGE_TYPE_Sel },
+  { 0x00080048, 11915, HID_USAGE_TYPE_Sel },
+  { 0x00070060, 9191, HID_USAGE_TYPE_Sel },
+  { 0x000C0098, 1576, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007007B, 9541, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200037, 5932, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00020002, 6175, HID_USAGE_TYPE_CA },
+  { 0x000C0085, 1253, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007003B, 8695, HID_USAGE_TYPE_Sel },
+  { 0x00010093, 5135, HID_USAGE_TYPE_OOC },
+  { 0x000C0151, 2397, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070025, 8394, HID_USAGE_TYPE_Sel },
+  { 0x00200000, 5524, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0001, 12, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200B1, 6571, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070034, 8599, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070010, 8163, HID_USAGE_TYPE_Sel },
+  { 0x00070068, 9281, HID_USAGE_TYPE_Sel },
+  { 0x000700BA, 10451, HID_USAGE_TYPE_Sel },
+  { 0x00010038, 4710, HID_USAGE_TYPE_DV },
+  { 0x0020003C, 6008, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0006, 69, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0072, 350, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000200B4, 6621, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200036, 5924, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00020005, 6255, HID_USAGE_TYPE_CA },
+  { 0x000C0030, 923, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000200B0, 6563, HID_USAGE_TYPE_DV },
+  { 0x00070044, 8804, HID_USAGE_TYPE_Sel },
+  { 0x000C00BE, 1881, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D000B, 4276, HID_USAGE_TYPE_CA },
+  { 0x00080032, 11584, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700DC, 10875, HID_USAGE_TYPE_Sel },
+  { 0x000C0105, 2326, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0005, 880, HID_USAGE_TYPE_CA },
+  { 0x0008002F, 11559, HID_USAGE_TYPE_OOC },
+  { 0x0008004D, 11994, HID_USAGE_TYPE_OOC },
+  { 0x000D0002, 4170, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0035, 964, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0031, 929, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00E7, 2145, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000100B5, 5412, HID_USAGE_TYPE_OSC },
+  { 0x000C0188, 2967, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040035, 7242, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B002B, 202, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0150, 2383, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0020002B, 5756, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C01A1, 3465, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0002, 832, HID_USAGE_TYPE_NAry },
+  { 0x00010082, 4862, HID_USAGE_TYPE_OSC },
+  { 0x0007000E, 8141, HID_USAGE_TYPE_Sel },
+  { 0x00060022, 7939, HID_USAGE_TYPE_DV },
+  { 0x000C008B, 1344, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0045, 4585, HID_USAGE_TYPE_MC },
+  { 0x000C018A, 3003, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070077, 9482, HID_USAGE_TYPE_Sel },
+  { 0x000C0173, 2714, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0097, 510, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0094, 457, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000100A3, 5185, HID_USAGE_TYPE_OSC },
+  { 0x00070082, 9649, HID_USAGE_TYPE_Sel },
+  { 0x000B0002, 18, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00200025, 5654, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010039, 4716, HID_USAGE_TYPE_DV },
+  { 0x000C0102, 2272, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0005, 61, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700E1, 10930, HID_USAGE_TYPE_DV },
+  { 0x000B00BA, 726, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C008D, 1384, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B00B9, 714, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010037, 4705, HID_USAGE_TYPE_DV },
+  { 0x000C008F, 1436, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0104, 2303, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00010041, 4783, HID_USAGE_TYPE_DV },
+  { 0x000C00F1, 2193, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700B7, 10424, HID_USAGE_TYPE_Sel },
+  { 0x000700B5, 10398, HID_USAGE_TYPE_Sel },
+  { 0x00070052, 9045, HID_USAGE_TYPE_Sel },
+  { 0x000C0166, 2566, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200040, 6080, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700DA, 10848, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080023, 11446, HID_USAGE_TYPE_OOC },
+  { 0x00050020, 7529, HID_USAGE_TYPE_CP },
+  { 0x000200BD, 6753, HID_USAGE_TYPE_OSC },
+  { 0x000C0205, 3671, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040030, 7198, HID_USAGE_TYPE_DV },
+  { 0x00080025, 11468, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200D0, 6968, HID_USAGE_TYPE_DV },
+  { 0x000C0235, 4045, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080006, 11128, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00020003, 6204, HID_USAGE_TYPE_CA },
+  { 0x00080041, 11787, HID_USAGE_TYPE_Sel },
+  { 0x00050029, 7687, HID_USAGE_TYPE_DV },
+  { 0x00080042, 11801, HID_USAGE_TYPE_DV },
+  { 0x000B0095, 476, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B00BE, 781, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080037, 11622, HID_USAGE_TYPE_OOC },
+  { 0x00010091, 5112, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070042, 8779, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070022, 8361, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080027, 11491, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00C2, 1933, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00030003, 7014, HID_USAGE_TYPE_CP },
+  { 0x000B009C, 596, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700A1, 10254, HID_USAGE_TYPE_Sel },
+  { 0x000200CC, 6923, HID_USAGE_TYPE_DV },
+  { 0x00070084, 9700, HID_USAGE_TYPE_Sel },
+  { 0x0007003F, 8743, HID_USAGE_TYPE_Sel },
+  { 0x00070053, 9062, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070094, 10034, HID_USAGE_TYPE_Sel },
+  { 0x00070023, 8372, HID_USAGE_TYPE_Sel },
+  { 0x000700CC, 10627, HID_USAGE_TYPE_Sel },
+  { 0x00200033, 5908, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0099, 538, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D0046, 4592, HID_USAGE_TYPE_MC },
+  { 0x000700CD, 10636, HID_USAGE_TYPE_Sel },
+  { 0x00200038, 5957, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070039, 8665, HID_USAGE_TYPE_Sel },
+  { 0x000B002A, 197, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0004005A, 7384, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0001003C, 4753, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D0041, 4533, HID_USAGE_TYPE_DV },
+  { 0x00050031, 7768, HID_USAGE_TYPE_OOC },
+  { 0x00070079, 9512, HID_USAGE_TYPE_Sel },
+  { 0x00200032, 5885, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080045, 11854, HID_USAGE_TYPE_DV },
+  { 0x000B009B, 576, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B00B2, 630, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B002E, 239, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070078, 9498, HID_USAGE_TYPE_Sel },
+  { 0x000C0167, 2579, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200C5, 6848, HID_USAGE_TYPE_DV },
+  { 0x0007006A, 9307, HID_USAGE_TYPE_Sel },
+  { 0x00020021, 6497, HID_USAGE_TYPE_CA },
+  { 0x00010032, 4687, HID_USAGE_TYPE_DV },
+  { 0x000700A3, 10289, HID_USAGE_TYPE_Sel },
+  { 0x000C0081, 1200, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C019C, 3363, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0029, 178, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700A4, 10310, HID_USAGE_TYPE_Sel },
+  { 0x00080024, 11457, HID_USAGE_TYPE_OOC },
+  { 0x00080016, 11300, HID_USAGE_TYPE_OOC },
+  { 0x000C0239, 4087, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070096, 10064, HID_USAGE_TYPE_Sel },
+  { 0x000C018E, 3071, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080004, 11108, HID_USAGE_TYPE_OOC },
+  { 0x00080014, 11287, HID_USAGE_TYPE_OOC },
+  { 0x00070065, 9236, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700D9, 10830, HID_USAGE_TYPE_Sel },
+  { 0x00070058, 9115, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C01A5, 3570, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0020002C, 5773, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0182, 2829, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080034, 11597, HID_USAGE_TYPE_OOC },
+  { 0x000100B6, 5441, HID_USAGE_TYPE_OSC },
+  { 0x000C0062, 1131, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000100A0, 5146, HID_USAGE_TYPE_OSC },
+  { 0x000100B1, 5324, HID_USAGE_TYPE_OSC },
+  { 0x000200B5, 6635, HID_USAGE_TYPE_DV },
+  { 0x000C008E, 1411, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0200, 3606, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0093, 1510, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070031, 8566, HID_USAGE_TYPE_Sel },
+  { 0x00040002, 7163, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0064, 1160, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700C6, 10571, HID_USAGE_TYPE_Sel },
+  { 0x000C0196, 3243, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070026, 8405, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B0024, 138, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0008000F, 11225, HID_USAGE_TYPE_OOC },
+  { 0x0020002A, 5738, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0009, 4248, HID_USAGE_TYPE_CA },
+  { 0x000C0061, 1116, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040057, 7363, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00010084, 4890, HID_USAGE_TYPE_OSC },
+  { 0x00060020, 7905, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0008000D, 11193, HID_USAGE_TYPE_OOC },
+  { 0x000D0003, 4174, HID_USAGE_TYPE_CA },
+  { 0x000200B7, 6665, HID_USAGE_TYPE_OOC },
+  { 0x000200C3, 6825, HID_USAGE_TYPE_DV },
+  { 0x000700C3, 10544, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080022, 11437, HID_USAGE_TYPE_OOC },
+  { 0x000700D7, 10806, HID_USAGE_TYPE_Sel },
+  { 0x0007006B, 9320, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700D0, 10667, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00F2, 2208, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070007, 8064, HID_USAGE_TYPE_Sel },
+  { 0x000D0021, 4333, HID_USAGE_TYPE_CL },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0103, 2278, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070088, 9782, HID_USAGE_TYPE_Sel },
+  { 0x00070076, 9468, HID_USAGE_TYPE_Sel },
+  { 0x00080040, 11766, HID_USAGE_TYPE_Sel },
+  { 0x000C0041, 999, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070092, 10004, HID_USAGE_TYPE_Sel },
+  { 0x0007009F, 10222, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C021A, 3726, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00B3, 1763, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007000D, 8130, HID_USAGE_TYPE_Sel },
+  { 0x000200BF, 6780, HID_USAGE_TYPE_DV },
+  { 0x0007004D, 8956, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070087, 9758, HID_USAGE_TYPE_Sel },
+  { 0x000C01A2, 3489, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080001, 11079, HID_USAGE_TYPE_OOC },
+  { 0x00020001, 6150, HID_USAGE_TYPE_CA },
+  { 0x00020009, 6363, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200CE, 6944, HID_USAGE_TYPE_DV },
+  { 0x00050036, 7830, HID_USAGE_TYPE_OOC },
+  { 0x000700BC, 10479, HID_USAGE_TYPE_Sel },
+  { 0x000200C9, 6878, HID_USAGE_TYPE_DV },
+  { 0x000C00BA, 1842, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000200C2, 6810, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0193, 3175, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0065, 1175, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00E1, 2095, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070008, 8075, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200001, 5534, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007000B, 8108, HID_USAGE_TYPE_Sel },
+  { 0x000B00BF, 793, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C008A, 1327, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D0034, 4389, HID_USAGE_TYPE_OSC },
+  { 0x00080018, 11328, HID_USAGE_TYPE_OOC },
+  { 0x000C00E4, 2113, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040063, 7462, HID_USAGE_TYPE_Sel },
+  { 0x000D0007, 4219, HID_USAGE_TYPE_CA },
+  { 0x000C0208, 3703, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007009D, 10191, HID_USAGE_TYPE_Sel },
+  { 0x000C022F, 3959, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010005, 4638, HID_USAGE_TYPE_CA },
+  { 0x000C00E0, 2088, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0220, 3780, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D0004, 4184, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0161, 2489, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0152, 2410, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00200035, 5919, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0034, 953, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070064, 9227, HID_USAGE_TYPE_Sel },
+  { 0x00020007, 6309, HID_USAGE_TYPE_CA },
+  { 0x00040032, 7208, HID_USAGE_TYPE_DV },
+  { 0x00010083, 4875, HID_USAGE_TYPE_OSC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000D0043, 4550, HID_USAGE_TYPE_MC },
+  { 0x00080012, 11259, HID_USAGE_TYPE_OOC },
+  { 0x00070030, 8555, HID_USAGE_TYPE_Sel },
+  { 0x000C0060, 1101, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040062, 7455, HID_USAGE_TYPE_Sel },
+  { 0x000C0036, 977, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00050035, 7816, HID_USAGE_TYPE_Sel },
+  { 0x00080044, 11834, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00050021, 7543, HID_USAGE_TYPE_DV },
+  { 0x00080011, 11252, HID_USAGE_TYPE_OOC },
+  { 0x000C0226, 3846, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008002A, 11521, HID_USAGE_TYPE_OOC },
+  { 0x0007009A, 10134, HID_USAGE_TYPE_Sel },
+  { 0x000B0098, 525, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040053, 7335, HID_USAGE_TYPE_Sel },
+  { 0x000700D8, 10817, HID_USAGE_TYPE_Sel },
+  { 0x000B0020, 107, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070089, 9806, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0106, 2343, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700B4, 10384, HID_USAGE_TYPE_Sel },
+  { 0x0001003E, 4773, HID_USAGE_TYPE_OOC },
+  { 0x000C0088, 1289, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080049, 11929, HID_USAGE_TYPE_Sel },
+  { 0x000C0099, 1599, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0021, 912, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008002D, 11543, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040038, 7290, HID_USAGE_TYPE_NAry },
+  { 0x0001008F, 5083, HID_USAGE_TYPE_OSC },
+  { 0x0007005F, 9182, HID_USAGE_TYPE_Sel },
+  { 0x00070059, 9128, HID_USAGE_TYPE_Sel },
+  { 0x000B0000, 1, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0008003F, 11745, HID_USAGE_TYPE_Sel },
+  { 0x000C0197, 3263, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007001F, 8328, HID_USAGE_TYPE_Sel },
+  { 0x000B00B7, 690, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000700CA, 10608, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040033, 7213, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200C8, 6869, HID_USAGE_TYPE_DV },
+  { 0x00070081, 9629, HID_USAGE_TYPE_Sel },
+  { 0x000C0202, 3646, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0234, 4030, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040056, 7356, HID_USAGE_TYPE_Sel },
+  { 0x000C0203, 3654, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00200023, 5616, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010036, 4698, HID_USAGE_TYPE_DV },
+  { 0x000C0006, 890, HID_USAGE_TYPE_CA },
+  { 0x00070045, 8817, HID_USAGE_TYPE_Sel },
+  { 0x0007009B, 10160, HID_USAGE_TYPE_Sel },
+  { 0x00070062, 9209, HID_USAGE_TYPE_Sel },
+  { 0x000C00A3, 1730, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070043, 8791, HID_USAGE_TYPE_Sel },
+  { 0x00200024, 5631, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0186, 2933, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000200BE, 6767, HID_USAGE_TYPE_OOC },
+  { 0x000700A2, 10268, HID_USAGE_TYPE_Sel },
+  { 0x000D0038, 4420, HID_USAGE_TYPE_DV },
+  { 0x000C019D, 3373, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C018B, 3019, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0097, 1557, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0231, 3987, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00200034, 5912, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0020, 908, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00060021, 7922, HID_USAGE_TYPE_DV },
+  { 0x000C00C7, 2001, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007002C, 8504, HID_USAGE_TYPE_Sel },
+  { 0x000C0181, 2793, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070005, 8042, HID_USAGE_TYPE_Sel },
+  { 0x0007005C, 9155, HID_USAGE_TYPE_Sel },
+  { 0x0008003E, 11729, HID_USAGE_TYPE_Sel },
+  { 0x000C023C, 4141, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0032, 935, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080015, 11296, HID_USAGE_TYPE_OOC },
+  { 0x000C00C1, 1922, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00E3, 2108, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00C6, 1981, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00050026, 7636, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00070073, 9424, HID_USAGE_TYPE_Sel },
+  { 0x000C0168, 2596, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0084, 1239, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070067, 9272, HID_USAGE_TYPE_Sel },
+  { 0x000700B1, 10335, HID_USAGE_TYPE_Sel },
+  { 0x00070055, 9088, HID_USAGE_TYPE_Sel },
+  { 0x00070048, 8871, HID_USAGE_TYPE_Sel },
+  { 0x00070001, 7966, HID_USAGE_TYPE_Sel },
+  { 0x0002000B, 6419, HID_USAGE_TYPE_CA },
+  { 0x000C00C4, 1949, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000B0092, 422, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0232, 4002, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080036, 11617, HID_USAGE_TYPE_OOC },
+  { 0x000C022C, 3919, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C01A4, 3541, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700D4, 10742, HID_USAGE_TYPE_Sel },
+  { 0x000C0192, 3161, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00A4, 1737, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00BD, 1872, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070095, 10049, HID_USAGE_TYPE_Sel },
+  { 0x00200021, 5581, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B0050, 272, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007006C, 9333, HID_USAGE_TYPE_Sel },
+  { 0x000C0044, 1028, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00030008, 7074, HID_USAGE_TYPE_CA },
+  { 0x000700B0, 10325, HID_USAGE_TYPE_Sel },
+  { 0x00070019, 8262, HID_USAGE_TYPE_Sel },
+  { 0x00050030, 7759, HID_USAGE_TYPE_OOC },
+  { 0x000200C7, 6861, HID_USAGE_TYPE_DV },
+  { 0x000C018D, 3046, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0094, 1529, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C021F, 3772, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0005002F, 7752, HID_USAGE_TYPE_OSC },
+  { 0x000B002D, 227, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007002F, 8544, HID_USAGE_TYPE_Sel },
+  { 0x000D003A, 4458, HID_USAGE_TYPE_CL },
+  { 0x00050002, 7503, HID_USAGE_TYPE_CA },
+  { 0x000C0227, 3854, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00010004, 4629, HID_USAGE_TYPE_CA },
+  { 0x000200BA, 6715, HID_USAGE_TYPE_DV },
+  { 0x000700BB, 10462, HID_USAGE_TYPE_Sel },
+  { 0x00040058, 7370, HID_USAGE_TYPE_Sel },
+  { 0x000C0230, 3967, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080031, 11576, HID_USAGE_TYPE_OOC },
+  { 0x000D0039, 4437, HID_USAGE_TYPE_CL },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C00C9, 2037, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0100, 2251, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00040052, 7328, HID_USAGE_TYPE_Sel },
+  { 0x00040034, 7225, HID_USAGE_TYPE_DV },
+  { 0x00030007, 7061, HID_USAGE_TYPE_CA },
+  { 0x000C00E8, 2154, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00080019, 11337, HID_USAGE_TYPE_OOC },
+  { 0x0004005D, 7411, HID_USAGE_TYPE_Sel },
+  { 0x000C022D, 3936, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080047, 11893, HID_USAGE_TYPE_UM },
+  { 0x000C0066, 1184, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007002E, 8533, HID_USAGE_TYPE_Sel },
+  { 0x000C00C5, 1966, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0095, 1534, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007004E, 8969, HID_USAGE_TYPE_Sel },
+  { 0x000D000A, 4261, HID_USAGE_TYPE_CA },
+  { 0x000C0180, 2766, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00080005, 11120, HID_USAGE_TYPE_OOC },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0008003D, 11716, HID_USAGE_TYPE_Sel },
+  { 0x000C0107, 2359, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00070002, 7989, HID_USAGE_TYPE_Sel },
+  { 0x00070047, 8851, HID_USAGE_TYPE_Sel },
+  { 0x00070027, 8416, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00040004, 7188, HID_USAGE_TYPE_CA },
+  { 0x00070074, 9437, HID_USAGE_TYPE_Sel },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000200CA, 6895, HID_USAGE_TYPE_DV },
+  { 0x0007005A, 9137, HID_USAGE_TYPE_Sel },
+  { 0x00010046, 4804, HID_USAGE_TYPE_DV },
+  { 0x0020003D, 6018, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C008C, 1361, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000B00BC, 757, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000C0086, 1265, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0082, 1217, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C00B0, 1745, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C01A3, 3516, HID_USAGE_TYPE_UNKNOWN },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x000700E5, 11005, HID_USAGE_TYPE_DV },
+  { 0x00010088, 4960, HID_USAGE_TYPE_OSC },
+  { 0x00080003, 11098, HID_USAGE_TYPE_OOC },
+  { 0x000C00BC, 1865, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0153, 2425, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00020022, 6510, HID_USAGE_TYPE_CP },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007005D, 9164, HID_USAGE_TYPE_Sel },
+  { 0x0001008A, 4996, HID_USAGE_TYPE_RTC },
+  { 0x000D0006, 4207, HID_USAGE_TYPE_CA },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x00010034, 4692, HID_USAGE_TYPE_DV },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0xFFFFFFFF, 0, 0 },
+  { 0x0007007A, 9527, HID_USAGE_TYPE_Sel },
+  { 0x000B0030, 262, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000D003E, 4509, HID_USAGE_TYPE_DV },
+  { 0x0007000F, 8152, HID_USAGE_TYPE_Sel },
+  { 0x000D003B, 4478, HID_USAGE_TYPE_DV },
+  { 0x000C00A2, 1724, HID_USAGE_TYPE_UNKNOWN },
+  { 0x00050024, 7598, HID_USAGE_TYPE_DV },
+  { 0x000700BE, 10497, HID_USAGE_TYPE_Sel },
+  { 0x0008002C, 11538, HID_USAGE_TYPE_OOC },
+  { 0x00070024, 8383, HID_USAGE_TYPE_Sel },
+  { 0x00070063, 9218, HID_USAGE_TYPE_Sel },
+  { 0x00070009, 8086, HID_USAGE_TYPE_Sel },
+  { 0x000C0001, 815, HID_USAGE_TYPE_CA },
+  { 0x0005002B, 7709, HID_USAGE_TYPE_MC },
+  { 0x00080046, 11873, HID_USAGE_TYPE_DV },
+  { 0x0020002F, 5816, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0206, 3683, HID_USAGE_TYPE_UNKNOWN },
+  { 0x000C0080, 1190, HID_USAGE_TYPE_UNKNOWN },
+  { 0x0007002B, 8491, HID_USAGE_TYPE_Sel },
+  { 0x00030001, 6999, HID_USAGE_TYPE_CA },
+};
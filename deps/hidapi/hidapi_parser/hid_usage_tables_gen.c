@@ -0,0 +1,341 @@
+/* hidapi_parser $
+ *
+ * Generates hid_usage_tables_data.h from the HID usage tables in hut/:
+ *
+ *   hid_usage_tables_gen -o hid_usage_tables_data.h ../hut/hut_*.yaml
+ *
+ * The usages are stored in an open-addressed table indexed by a perfect hash
+ * of (usage_page << 16 | usage), built with the hash-and-displace method:
+ * the keys are split into buckets by a first hash, and each bucket gets a
+ * displacement that sends all its keys to free slots. A lookup is then two
+ * table reads, see hid_usage_tables.c (which must use the same hash).
+ *
+ * Only the small subset of yaml used by the hut files is understood: one
+ * "0xNNNN:" line per usage followed by indented "name:" and "type:" lines,
+ * and "# page: 0xNN" plus a "# Page Name" comment line in the header.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#include "hid_usage_tables.h"
+
+#define MAX_USAGES 8192
+#define MAX_STRINGS (64*1024)
+#define MAX_DISPLACEMENT 65535
+
+struct usage {
+  uint32_t key;
+  int name;
+  int type;
+};
+
+static struct usage usages[MAX_USAGES];
+static int num_usages = 0;
+
+static char strings[MAX_STRINGS];
+static int strings_size = 1; // offset 0 is the empty string, i.e. no name
+
+static int page_names[256];
+
+static const char * type_names[] = {
+  "", "LC", "OOC", "MC", "OSC", "RTC", "Sel", "SV", "SF", "DV", "DF", "NAry", "CA", "CL", "CP", "US", "UM"
+};
+
+static void fail( const char * file, int line, const char * msg ){
+  fprintf( stderr, "%s:%d: %s\n", file, line, msg );
+  exit( 1 );
+}
+
+static int add_string( const char * str ){
+  int len = strlen( str ) + 1;
+  if ( strings_size + len > MAX_STRINGS ){
+    fprintf( stderr, "too many names\n" );
+    exit( 1 );
+  }
+  memcpy( &strings[ strings_size ], str, len );
+  strings_size += len;
+  return strings_size - len;
+}
+
+static char * trim( char * str ){
+  while ( isspace( (unsigned char) *str ) ){
+    str++;
+  }
+  char * end = str + strlen( str );
+  while ( end > str && isspace( (unsigned char) end[-1] ) ){
+    *--end = 0;
+  }
+  return str;
+}
+
+// yaml scalar: plain, or double quoted with \" and \\ escapes
+static char * unquote( char * str ){
+  if ( str[0] != '"' ){
+    return str;
+  }
+  char * src = str + 1;
+  char * dst = str;
+  while ( *src && *src != '"' ){
+    if ( src[0] == '\\' && src[1] ){
+      src++;
+    }
+    *dst++ = *src++;
+  }
+  *dst = 0;
+  return str;
+}
+
+static int parse_type( const char * str ){
+  int i;
+  for ( i = 1; i < (int) (sizeof(type_names) / sizeof(type_names[0])); i++ ){
+    if ( strcmp( str, type_names[i] ) == 0 ){
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void parse_file( const char * file ){
+  FILE * in = fopen( file, "r" );
+  if ( in == NULL ){
+    fail( file, 0, "cannot open" );
+  }
+  char buf[1024];
+  int line = 0;
+  int page = -1;
+  char page_name[256] = "";
+  struct usage * cur = NULL;
+  while ( fgets( buf, sizeof(buf), in ) ){
+    line++;
+    char * str = trim( buf );
+    if ( str[0] == 0 || strcmp( str, "---" ) == 0 ){
+      continue;
+    }
+    if ( str[0] == '#' ){
+      char * comment = trim( str + 1 );
+      if ( strncmp( comment, "page:", 5 ) == 0 ){
+	page = strtol( comment + 5, NULL, 0 );
+	if ( page < 0 || page > 255 ){
+	  fail( file, line, "usage page out of range" );
+	}
+      } else if ( page_name[0] == 0 && page == -1 ){
+	snprintf( page_name, sizeof(page_name), "%s", comment );
+      }
+      continue;
+    }
+    if ( buf[0] == '0' ){
+      if ( page == -1 ){
+	fail( file, line, "usage before the page comment" );
+      }
+      if ( num_usages == MAX_USAGES ){
+	fail( file, line, "too many usages" );
+      }
+      char * end;
+      long usage = strtol( str, &end, 0 );
+      if ( *end != ':' || usage < 0 || usage > 0xFFFF ){
+	fail( file, line, "expected a usage (0xNN:)" );
+      }
+      cur = &usages[ num_usages++ ];
+      cur->key = ((uint32_t) page << 16) | (uint32_t) usage;
+      cur->name = 0;
+      cur->type = 0;
+      continue;
+    }
+    if ( cur == NULL ){
+      fail( file, line, "unexpected line" );
+    }
+    if ( strncmp( str, "name:", 5 ) == 0 ){
+      cur->name = add_string( unquote( trim( str + 5 ) ) );
+    } else if ( strncmp( str, "type:", 5 ) == 0 ){
+      cur->type = parse_type( trim( str + 5 ) );
+      if ( cur->type < 0 ){
+	fail( file, line, "unknown usage type" );
+      }
+    } else {
+      fail( file, line, "unexpected line" );
+    }
+  }
+  fclose( in );
+  if ( page == -1 ){
+    fail( file, line, "missing page comment" );
+  }
+  if ( page_name[0] ){
+    page_names[ page ] = add_string( page_name );
+  }
+}
+
+struct bucket {
+  int first; // index into bucket_keys
+  int size;
+  int index;
+};
+
+static int compare_buckets( const void * a, const void * b ){
+  const struct bucket * ba = (const struct bucket *) a;
+  const struct bucket * bb = (const struct bucket *) b;
+  if ( ba->size != bb->size ){
+    return bb->size - ba->size;
+  }
+  return ba->index - bb->index;
+}
+
+static void print_string( FILE * out, const char * str ){
+  fputc( '"', out );
+  for ( ; *str; str++ ){
+    if ( *str == '"' || *str == '\\' ){
+      fputc( '\\', out );
+    }
+    fputc( *str, out );
+  }
+  fputs( "\\0\"", out );
+}
+
+int main( int argc, char ** argv ){
+  const char * output = NULL;
+  int i, j;
+  for ( i = 1; i < argc; i++ ){
+    if ( strcmp( argv[i], "-o" ) == 0 && i + 1 < argc ){
+      output = argv[++i];
+    } else {
+      parse_file( argv[i] );
+    }
+  }
+  if ( output == NULL || num_usages == 0 ){
+    fprintf( stderr, "Usage: %s -o hid_usage_tables_data.h hut/*.yaml\n", argv[0] );
+    return 1;
+  }
+  for ( i = 0; i < num_usages; i++ ){
+    for ( j = i + 1; j < num_usages; j++ ){
+      if ( usages[i].key == usages[j].key ){
+	fprintf( stderr, "duplicate usage 0x%02x 0x%04x\n", usages[i].key >> 16, usages[i].key & 0xFFFF );
+	return 1;
+      }
+    }
+  }
+
+  int num_slots = 1;
+  while ( num_slots < num_usages ){
+    num_slots *= 2;
+  }
+  int num_buckets = num_usages / 4 + 1;
+
+  // split the keys into buckets, biggest buckets are placed first
+  struct bucket * buckets = (struct bucket *) calloc( num_buckets, sizeof( struct bucket ) );
+  int * bucket_keys = (int *) malloc( num_usages * sizeof( int ) );
+  for ( i = 0; i < num_buckets; i++ ){
+    buckets[i].index = i;
+  }
+  for ( i = 0; i < num_usages; i++ ){
+    buckets[ hid_usage_hash( usages[i].key ) % num_buckets ].size++;
+  }
+  int first = 0;
+  for ( i = 0; i < num_buckets; i++ ){
+    buckets[i].first = first;
+    first += buckets[i].size;
+    buckets[i].size = 0;
+  }
+  for ( i = 0; i < num_usages; i++ ){
+    struct bucket * b = &buckets[ hid_usage_hash( usages[i].key ) % num_buckets ];
+    bucket_keys[ b->first + b->size++ ] = i;
+  }
+  qsort( buckets, num_buckets, sizeof( struct bucket ), compare_buckets );
+
+  int * slots = (int *) malloc( num_slots * sizeof( int ) );
+  for ( i = 0; i < num_slots; i++ ){
+    slots[i] = -1;
+  }
+  int * displacements = (int *) calloc( num_buckets, sizeof( int ) );
+  int placed[64];
+  for ( i = 0; i < num_buckets && buckets[i].size > 0; i++ ){
+    struct bucket * b = &buckets[i];
+    if ( b->size > (int) (sizeof(placed) / sizeof(placed[0])) ){
+      fprintf( stderr, "bucket too large\n" );
+      return 1;
+    }
+    int d;
+    for ( d = 0; d <= MAX_DISPLACEMENT; d++ ){
+      int k;
+      for ( k = 0; k < b->size; k++ ){
+	uint32_t key = usages[ bucket_keys[ b->first + k ] ].key;
+	int slot = hid_usage_slot( key, d ) & (num_slots - 1);
+	int m;
+	if ( slots[ slot ] != -1 ){
+	  break;
+	}
+	for ( m = 0; m < k && placed[m] != slot; m++ ){
+	}
+	if ( m < k ){
+	  break;
+	}
+	placed[k] = slot;
+      }
+      if ( k == b->size ){
+	break;
+      }
+    }
+    if ( d > MAX_DISPLACEMENT ){
+      fprintf( stderr, "could not find a perfect hash, increase the number of buckets\n" );
+      return 1;
+    }
+    for ( j = 0; j < b->size; j++ ){
+      slots[ placed[j] ] = bucket_keys[ b->first + j ];
+    }
+    displacements[ b->index ] = d;
+  }
+
+  FILE * out = fopen( output, "w" );
+  if ( out == NULL ){
+    fprintf( stderr, "cannot open %s for writing\n", output );
+    return 1;
+  }
+  fprintf( out, "/* generated by hid_usage_tables_gen.c from the hut/ yaml files, do not edit */\n\n" );
+  fprintf( out, "#define HID_USAGE_NUM_BUCKETS %d\n", num_buckets );
+  fprintf( out, "#define HID_USAGE_NUM_SLOTS %d\n\n", num_slots );
+
+  fprintf( out, "static const char hid_usage_strings[%d] =\n", strings_size );
+  int offset = 1;
+  fprintf( out, "  \"\\0\"" );
+  while ( offset < strings_size ){
+    fprintf( out, "\n  " );
+    print_string( out, &strings[ offset ] );
+    offset += strlen( &strings[ offset ] ) + 1;
+  }
+  fprintf( out, ";\n\n" );
+
+  fprintf( out, "static const uint16_t hid_usage_page_names[256] = {" );
+  for ( i = 0; i < 256; i++ ){
+    fprintf( out, "%s%d,", (i % 16) == 0 ? "\n  " : " ", page_names[i] );
+  }
+  fprintf( out, "\n};\n\n" );
+
+  fprintf( out, "static const uint16_t hid_usage_displacements[HID_USAGE_NUM_BUCKETS] = {" );
+  for ( i = 0; i < num_buckets; i++ ){
+    fprintf( out, "%s%d,", (i % 16) == 0 ? "\n  " : " ", displacements[i] );
+  }
+  fprintf( out, "\n};\n\n" );
+
+  fprintf( out, "static const struct hid_usage_entry hid_usage_entries[HID_USAGE_NUM_SLOTS] = {\n" );
+  for ( i = 0; i < num_slots; i++ ){
+    if ( slots[i] == -1 ){
+      fprintf( out, "  { 0xFFFFFFFF, 0, 0 },\n" );
+    } else {
+      struct usage * u = &usages[ slots[i] ];
+      fprintf( out, "  { 0x%08X, %d, HID_USAGE_TYPE_%s },\n", u->key, u->name,
+	       u->type ? type_names[ u->type ] : "UNKNOWN" );
+    }
+  }
+  fprintf( out, "};\n" );
+  fclose( out );
+
+  fprintf( stderr, "%d usages, %d buckets, %d slots, %d bytes of names\n", num_usages, num_buckets, num_slots, strings_size );
+  return 0;
+}
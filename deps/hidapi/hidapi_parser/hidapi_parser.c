@@ -27,6 +27,14 @@
 #include <string.h>
 #include <math.h>
 
+#ifdef LINUX_FREEBSD
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #ifdef _WIN32
 #include <windows.h>
 // for MinGW < 5.3 include locally provided "../windows hidsdi.h" rather
@@ -36,12 +44,24 @@
 #endif
 
 #include "hidapi_parser.h"
+#include "hid_usage_tables.h"
 
 
 
 // SET IN CMAKE
 // #define DEBUG_PARSER
 
+// name of a usage for debug output, never NULL
+static const char * hid_debug_usage_name( int usage_page, int usage ){
+  const char * name = hid_usage_name( usage_page, usage );
+  return name != NULL ? name : "?";
+}
+
+static const char * hid_debug_usage_page_name( int usage_page ){
+  const char * name = hid_usage_page_name( usage_page );
+  return name != NULL ? name : "?";
+}
+
 //// ---------- HID descriptor parser
 
 // main items
@@ -338,7 +358,7 @@ int hid_parse_report_descriptor( unsigned char* descr_buf, int size, struct hid_
 		  case HID_USAGE_PAGE:
 		    making_element->usage_page = next_val;
 #ifdef DEBUG_PARSER
-		    printf("\n\tusage page: 0x%02hhx", making_element->usage_page);
+		    printf("\n\tusage page: 0x%02hhx (%s)", making_element->usage_page, hid_debug_usage_page_name( making_element->usage_page ) );
 #endif
 		    break;
 		  case HID_USAGE:
@@ -347,7 +367,7 @@ int hid_parse_report_descriptor( unsigned char* descr_buf, int size, struct hid_
 		    current_usage_max = -1;
 		    current_usages[ current_usage_index ] = next_val;
 #ifdef DEBUG_PARSER
-		    printf("\n\tusage: 0x%02hhx, %i", current_usages[ current_usage_index ], current_usage_index );
+		    printf("\n\tusage: 0x%02hhx (%s), %i", current_usages[ current_usage_index ], hid_debug_usage_name( making_element->usage_page, next_val ), current_usage_index );
 #endif
 		    current_usage_index++;
 		    break;
@@ -378,7 +398,7 @@ int hid_parse_report_descriptor( unsigned char* descr_buf, int size, struct hid_
 		    prev_collection = new_collection;
 		    collection_nesting++;
 #ifdef DEBUG_PARSER
-		    printf("\n\tcollection: %i, %i", collection_nesting, next_val );
+		    printf("\n\tcollection: %i, %i (%s)", collection_nesting, next_val, hid_debug_usage_name( new_collection->usage_page, new_collection->usage_index ) );
 #endif
 		    break;
 		  }
@@ -1130,6 +1150,372 @@ int hid_send_output_report_old( struct hid_dev_desc * devd, int reportid ){
 }
 
 
+//// ---------- descriptor parse cache
+
+// The compiled collection/element tables of a parsed descriptor are stored in
+// <cache_dir>/<hash>.hidc, keyed by the hash of the raw descriptor bytes.
+// The file only holds fixed-size integer records that refer to each other by
+// table index, so it can be mapped anywhere and validated in place; loading
+// then copies the tables into the same collection and element lists the
+// parser builds, and the mapping is released.
+//
+// layout: header, collections[num_collections] (the device collection first),
+// elements[num_elements], report_ids[num_reports], report_lengths[num_reports],
+// raw descriptor bytes (to rule out hash collisions)
+
+static char * hid_descriptor_cache_dir = NULL;
+
+void hid_set_descriptor_cache_dir( const char * path ){
+  free( hid_descriptor_cache_dir );
+  hid_descriptor_cache_dir = NULL;
+  if ( path != NULL ){
+    hid_descriptor_cache_dir = strdup( path );
+  }
+}
+
+#ifdef LINUX_FREEBSD
+
+#define HID_CACHE_MAGIC "HIDPCACH"
+#define HID_CACHE_VERSION 1
+
+struct hid_cache_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t descriptor_size;
+  uint64_t descriptor_hash;
+  uint32_t num_collections;
+  uint32_t num_elements;
+  uint32_t num_reports;
+  uint32_t reserved;
+};
+
+struct hid_cache_collection {
+  int32_t index;
+  int32_t type;
+  int32_t usage_page;
+  int32_t usage_index;
+  int32_t usage_min;
+  int32_t usage_max;
+  int32_t num_elements;
+  int32_t num_collections;
+  int32_t parent_collection; // table index, -1 for none
+  int32_t first_collection; // table index, -1 for none
+  int32_t first_element; // table index, -1 for none
+};
+
+struct hid_cache_element {
+  int32_t index;
+  int32_t io_type;
+  int32_t type;
+  int32_t usage_page;
+  int32_t usage;
+  int32_t usage_min;
+  int32_t usage_max;
+  int32_t isvariable;
+  int32_t isarray;
+  int32_t isrelative;
+  int32_t logical_min;
+  int32_t logical_max;
+  int32_t phys_min;
+  int32_t phys_max;
+  int32_t unit_exponent;
+  int32_t unit;
+  int32_t report_size;
+  int32_t report_id;
+  int32_t report_index;
+  int32_t parent_collection; // table index
+};
+
+// FNV-1a
+static uint64_t hid_descriptor_hash( unsigned char* descr_buf, int size ){
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  int i;
+  for ( i = 0; i < size; i++ ){
+    hash ^= descr_buf[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static size_t hid_cache_file_size( uint32_t num_collections, uint32_t num_elements, uint32_t num_reports, uint32_t descriptor_size ){
+  return sizeof( struct hid_cache_header )
+    + num_collections * sizeof( struct hid_cache_collection )
+    + num_elements * sizeof( struct hid_cache_element )
+    + 2 * num_reports * sizeof( int32_t )
+    + descriptor_size;
+}
+
+static int hid_cache_path( char * path, size_t path_size, uint64_t hash ){
+  int res = snprintf( path, path_size, "%s/%016llx.hidc", hid_descriptor_cache_dir, (unsigned long long) hash );
+  return res > 0 && (size_t) res < path_size;
+}
+
+// collection tables are indexed by collection->index + 1, the device
+// collection (index -1) being at 0
+static int32_t hid_cache_collection_ref( struct hid_device_collection * coll ){
+  return coll == NULL ? -1 : coll->index + 1;
+}
+
+static int32_t hid_cache_element_ref( struct hid_device_element * el ){
+  return el == NULL ? -1 : el->index;
+}
+
+int hid_load_cached_descriptor( unsigned char* descr_buf, int size, struct hid_dev_desc * device_desc ){
+  if ( hid_descriptor_cache_dir == NULL ){
+    return -1;
+  }
+  uint64_t hash = hid_descriptor_hash( descr_buf, size );
+  char path[4096];
+  if ( !hid_cache_path( path, sizeof(path), hash ) ){
+    return -1;
+  }
+  int fd = open( path, O_RDONLY );
+  if ( fd < 0 ){
+    return -1;
+  }
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || (size_t) st.st_size < sizeof( struct hid_cache_header ) ){
+    close( fd );
+    return -1;
+  }
+  size_t file_size = (size_t) st.st_size;
+  unsigned char * map = (unsigned char *) mmap( NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( map == MAP_FAILED ){
+    return -1;
+  }
+
+  int res = -1;
+  const struct hid_cache_header * header = (const struct hid_cache_header *) map;
+  if ( memcmp( header->magic, HID_CACHE_MAGIC, sizeof( header->magic ) ) != 0
+       || header->version != HID_CACHE_VERSION
+       || header->descriptor_hash != hash
+       || header->descriptor_size != (uint32_t) size
+       || header->num_collections < 1
+       || header->num_reports < 1 || header->num_reports > 256
+       || file_size != hid_cache_file_size( header->num_collections, header->num_elements, header->num_reports, header->descriptor_size ) ){
+    goto done;
+  }
+
+  const struct hid_cache_collection * ccolls = (const struct hid_cache_collection *) (header + 1);
+  const struct hid_cache_element * cels = (const struct hid_cache_element *) (ccolls + header->num_collections);
+  const int32_t * creport_ids = (const int32_t *) (cels + header->num_elements);
+  const int32_t * creport_lengths = creport_ids + header->num_reports;
+  const unsigned char * cdescr = (const unsigned char *) (creport_lengths + header->num_reports);
+  if ( memcmp( cdescr, descr_buf, size ) != 0 ){
+    goto done;
+  }
+
+  uint32_t ncolls = header->num_collections;
+  uint32_t nels = header->num_elements;
+  uint32_t i;
+  // validate all references before building anything
+  for ( i = 0; i < ncolls; i++ ){
+    if ( ccolls[i].parent_collection < -1 || ccolls[i].parent_collection >= (int32_t) ncolls
+         || ccolls[i].first_collection < -1 || ccolls[i].first_collection >= (int32_t) ncolls
+         || ccolls[i].first_element < -1 || ccolls[i].first_element >= (int32_t) nels ){
+      goto done;
+    }
+  }
+  for ( i = 0; i < nels; i++ ){
+    if ( cels[i].parent_collection < 0 || cels[i].parent_collection >= (int32_t) ncolls ){
+      goto done;
+    }
+  }
+
+  // any failed allocation makes the caller parse the descriptor instead
+  struct hid_device_collection ** colls = (struct hid_device_collection **) calloc( ncolls, sizeof( *colls ) );
+  struct hid_device_element ** els = (struct hid_device_element **) calloc( nels ? nels : 1, sizeof( *els ) );
+  int * report_lengths = (int*) malloc( sizeof( int ) * header->num_reports );
+  int * report_ids = (int*) malloc( sizeof( int ) * header->num_reports );
+  int allocated = colls != NULL && els != NULL && report_lengths != NULL && report_ids != NULL;
+  for ( i = 0; allocated && i < ncolls; i++ ){
+    colls[i] = (struct hid_device_collection *) calloc( 1, sizeof( struct hid_device_collection ) );
+    allocated = colls[i] != NULL;
+  }
+  for ( i = 0; allocated && i < nels; i++ ){
+    els[i] = (struct hid_device_element *) calloc( 1, sizeof( struct hid_device_element ) );
+    allocated = els[i] != NULL;
+  }
+  if ( !allocated ){
+    for ( i = 0; colls != NULL && i < ncolls; i++ ){
+      free( colls[i] );
+    }
+    for ( i = 0; els != NULL && i < nels; i++ ){
+      free( els[i] );
+    }
+    free( colls );
+    free( els );
+    free( report_lengths );
+    free( report_ids );
+    goto done;
+  }
+  for ( i = 0; i < ncolls; i++ ){
+    struct hid_device_collection * coll = colls[i];
+    const struct hid_cache_collection * cc = &ccolls[i];
+    coll->index = cc->index;
+    coll->type = cc->type;
+    coll->usage_page = cc->usage_page;
+    coll->usage_index = cc->usage_index;
+    coll->usage_min = cc->usage_min;
+    coll->usage_max = cc->usage_max;
+    coll->num_elements = cc->num_elements;
+    coll->num_collections = cc->num_collections;
+    coll->parent_collection = cc->parent_collection < 0 ? NULL : colls[ cc->parent_collection ];
+    coll->first_collection = cc->first_collection < 0 ? NULL : colls[ cc->first_collection ];
+    coll->first_element = cc->first_element < 0 ? NULL : els[ cc->first_element ];
+    // all collections are chained in creation order, starting from the device one's first_collection
+    coll->next_collection = ( i > 0 && i + 1 < ncolls ) ? colls[ i + 1 ] : NULL;
+  }
+  for ( i = 0; i < nels; i++ ){
+    struct hid_device_element * el = els[i];
+    const struct hid_cache_element * ce = &cels[i];
+    el->index = ce->index;
+    el->io_type = ce->io_type;
+    el->type = ce->type;
+    el->usage_page = ce->usage_page;
+    el->usage = ce->usage;
+    el->usage_min = ce->usage_min;
+    el->usage_max = ce->usage_max;
+    el->isvariable = ce->isvariable;
+    el->isarray = ce->isarray;
+    el->isrelative = ce->isrelative;
+    el->logical_min = ce->logical_min;
+    el->logical_max = ce->logical_max;
+    el->phys_min = ce->phys_min;
+    el->phys_max = ce->phys_max;
+    el->unit_exponent = ce->unit_exponent;
+    el->unit = ce->unit;
+    el->report_size = ce->report_size;
+    el->report_id = ce->report_id;
+    el->report_index = ce->report_index;
+    el->value = 0;
+    el->array_value = 0;
+    el->parent_collection = colls[ ce->parent_collection ];
+    el->next = ( i + 1 < nels ) ? els[ i + 1 ] : NULL;
+  }
+
+  device_desc->device_collection = colls[0];
+  device_desc->number_of_reports = header->num_reports;
+  device_desc->report_lengths = report_lengths;
+  device_desc->report_ids = report_ids;
+  for ( i = 0; i < header->num_reports; i++ ){
+    device_desc->report_lengths[i] = creport_lengths[i];
+    device_desc->report_ids[i] = creport_ids[i];
+  }
+  free( colls );
+  free( els );
+  res = 0;
+
+done:
+  munmap( map, file_size );
+  return res;
+}
+
+int hid_store_cached_descriptor( unsigned char* descr_buf, int size, struct hid_dev_desc * device_desc ){
+  if ( hid_descriptor_cache_dir == NULL ){
+    return -1;
+  }
+  struct hid_device_collection * device_collection = device_desc->device_collection;
+  uint32_t ncolls = device_collection->num_collections + 1;
+  uint32_t nels = device_collection->num_elements;
+  uint32_t nreports = device_desc->number_of_reports;
+  size_t file_size = hid_cache_file_size( ncolls, nels, nreports, size );
+  unsigned char * data = (unsigned char *) calloc( 1, file_size );
+  if ( data == NULL ){
+    return -1;
+  }
+
+  struct hid_cache_header * header = (struct hid_cache_header *) data;
+  memcpy( header->magic, HID_CACHE_MAGIC, sizeof( header->magic ) );
+  header->version = HID_CACHE_VERSION;
+  header->descriptor_size = size;
+  header->descriptor_hash = hid_descriptor_hash( descr_buf, size );
+  header->num_collections = ncolls;
+  header->num_elements = nels;
+  header->num_reports = nreports;
+
+  struct hid_cache_collection * ccolls = (struct hid_cache_collection *) (header + 1);
+  struct hid_cache_element * cels = (struct hid_cache_element *) (ccolls + ncolls);
+  int32_t * creport_ids = (int32_t *) (cels + nels);
+  int32_t * creport_lengths = creport_ids + nreports;
+  unsigned char * cdescr = (unsigned char *) (creport_lengths + nreports);
+
+  struct hid_device_collection * coll = device_collection;
+  uint32_t i = 0;
+  while ( coll != NULL && i < ncolls ){
+    struct hid_cache_collection * cc = &ccolls[i];
+    cc->index = coll->index;
+    cc->type = coll->type;
+    cc->usage_page = coll->usage_page;
+    cc->usage_index = coll->usage_index;
+    cc->usage_min = coll->usage_min;
+    cc->usage_max = coll->usage_max;
+    cc->num_elements = coll->num_elements;
+    cc->num_collections = coll->num_collections;
+    cc->parent_collection = hid_cache_collection_ref( coll->parent_collection );
+    cc->first_collection = hid_cache_collection_ref( coll->first_collection );
+    cc->first_element = hid_cache_element_ref( coll->first_element );
+    coll = ( i == 0 ) ? device_collection->first_collection : coll->next_collection;
+    i++;
+  }
+  struct hid_device_element * el = device_collection->first_element;
+  uint32_t j = 0;
+  while ( el != NULL && j < nels ){
+    struct hid_cache_element * ce = &cels[j];
+    ce->index = el->index;
+    ce->io_type = el->io_type;
+    ce->type = el->type;
+    ce->usage_page = el->usage_page;
+    ce->usage = el->usage;
+    ce->usage_min = el->usage_min;
+    ce->usage_max = el->usage_max;
+    ce->isvariable = el->isvariable;
+    ce->isarray = el->isarray;
+    ce->isrelative = el->isrelative;
+    ce->logical_min = el->logical_min;
+    ce->logical_max = el->logical_max;
+    ce->phys_min = el->phys_min;
+    ce->phys_max = el->phys_max;
+    ce->unit_exponent = el->unit_exponent;
+    ce->unit = el->unit;
+    ce->report_size = el->report_size;
+    ce->report_id = el->report_id;
+    ce->report_index = el->report_index;
+    ce->parent_collection = hid_cache_collection_ref( el->parent_collection );
+    el = el->next;
+    j++;
+  }
+  uint32_t k;
+  for ( k = 0; k < nreports; k++ ){
+    creport_ids[k] = device_desc->report_ids[k];
+    creport_lengths[k] = device_desc->report_lengths[k];
+  }
+  memcpy( cdescr, descr_buf, size );
+
+  int res = -1;
+  char path[4096];
+  char tmp_path[4096 + 16];
+  if ( i == ncolls && j == nels && hid_cache_path( path, sizeof(path), header->descriptor_hash ) ){
+    // write then rename, so that concurrent readers never see a partial file
+    snprintf( tmp_path, sizeof(tmp_path), "%s.%d", path, (int) getpid() );
+    int fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if ( fd >= 0 ){
+      ssize_t written = write( fd, data, file_size );
+      close( fd );
+      if ( written == (ssize_t) file_size && rename( tmp_path, path ) == 0 ){
+	res = 0;
+      } else {
+	unlink( tmp_path );
+      }
+    }
+  }
+  free( data );
+  return res;
+}
+
+#endif
+
 struct hid_dev_desc * hid_read_descriptor( hid_device * devd ){
   struct hid_dev_desc * desc;
 
@@ -1155,7 +1541,10 @@ struct hid_dev_desc * hid_read_descriptor( hid_device * devd ){
   } else {
     desc = (struct hid_dev_desc *) malloc( sizeof( struct hid_dev_desc ) );
     desc->device = devd;
-    hid_parse_report_descriptor( descr_buf, res, desc );
+    if ( hid_load_cached_descriptor( descr_buf, res, desc ) != 0 ){
+      hid_parse_report_descriptor( descr_buf, res, desc );
+      hid_store_cached_descriptor( descr_buf, res, desc );
+    }
     return desc;
   }
 #endif
@@ -1254,10 +1643,10 @@ void debug_element(struct hid_device_element *element)
     printf("index: %d\n", element->index);
     printf("parent_collection: %p\n", element->parent_collection);
     printf("io_type: %d\n", element->io_type);
-    printf("usage_page: %d\n", element->usage_page);
+    printf("usage_page: %d (%s)\n", element->usage_page, hid_debug_usage_page_name( element->usage_page ));
     printf("usage_min: %d\n", element->usage_min);
     printf("usage_max: %d\n", element->usage_max);
-    printf("usage: %d\n", element->usage);
+    printf("usage: %d (%s)\n", element->usage, hid_debug_usage_name( element->usage_page, element->usage ));
     printf("type: %d\n", element->type);
     printf("isarray: %d\n", element->isarray);
     printf("isrelative: %d\n", element->isrelative);
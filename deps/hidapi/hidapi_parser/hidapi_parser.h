@@ -153,6 +153,16 @@ void hid_set_element_callback(  struct hid_dev_desc * devd, hid_element_callback
 
 int hid_parse_report_descriptor( unsigned char* descr_buf, int size, struct hid_dev_desc * device_desc );
 
+// descriptor parse cache: when a directory is set, hid_read_descriptor stores
+// the parsed element tables there keyed by the hash of the raw descriptor, and
+// reloads them instead of parsing on the next open. NULL (the default) disables it.
+void hid_set_descriptor_cache_dir( const char * path );
+#ifdef LINUX_FREEBSD
+// return 0 on success, -1 when not cached (or caching is disabled)
+int hid_load_cached_descriptor( unsigned char* descr_buf, int size, struct hid_dev_desc * device_desc );
+int hid_store_cached_descriptor( unsigned char* descr_buf, int size, struct hid_dev_desc * device_desc );
+#endif
+
 struct hid_device_element * hid_get_next_input_element( struct hid_device_element * curel );
 struct hid_device_element * hid_get_next_input_element_with_reportid( struct hid_device_element * curel, int reportid );
 struct hid_device_element * hid_get_next_output_element( struct hid_device_element * curel );
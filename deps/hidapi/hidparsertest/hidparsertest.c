@@ -30,6 +30,7 @@
 
 #include <hidapi.h>
 #include "hidapi_parser.h"
+#include "hid_usage_tables.h"
 
 
 // Headers needed for sleeping.
@@ -37,6 +38,7 @@
 	#include <windows.h>
 #else
 	#include <unistd.h>
+	#include <time.h>
 #endif
 
 void list_devices( void ){
@@ -64,7 +66,10 @@ void list_devices( void ){
 #define MAX_STR 255
 
 void print_element_info( struct hid_device_element *element ){
-  
+  const char * page_name = hid_usage_page_name( element->usage_page );
+  const char * usage_name = hid_usage_name( element->usage_page, element->usage );
+  const char * type_name = hid_usage_type_name( hid_usage_type( element->usage_page, element->usage ) );
+  printf( "%s: %s (%s)\n", page_name ? page_name : "?", usage_name ? usage_name : "?", type_name ? type_name : "?" );
   printf( "index: %i, usage_page: %i, usage: %i, iotype: %i, type: %i, \n \
 	  \tusage_min: %i, usage_max: %i, \n \
 	  \tlogical_min: %i, logical_max: %i, \n \
@@ -155,6 +160,86 @@ static void my_descriptor_cb(const struct hid_dev_desc *dd, void *data)
     printf("user_data: %s\n", (const char *)data);
 }
 
+#ifdef LINUX_FREEBSD
+
+static double now_in_us(){
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void free_descriptor_tables( struct hid_dev_desc * desc ){
+  hid_free_collection( desc->device_collection );
+  free( desc->report_ids );
+  free( desc->report_lengths );
+}
+
+// compare device startup (open + descriptor) and descriptor parse/load times
+// without and with the descriptor parse cache
+int measure_startup( int vendor_id, int product_id, const char * cache_dir, int iterations ){
+  int i;
+  double start;
+  struct hid_dev_desc * devdesc;
+
+  hid_device * handle = hid_open( vendor_id, product_id, NULL );
+  if ( handle == NULL ){
+    fprintf(stderr, "Unable to open device %d, %d\n", vendor_id, product_id );
+    return 1;
+  }
+  unsigned char descr_buf[HIDAPI_MAX_DESCRIPTOR_SIZE];
+  int size = hid_get_report_descriptor( handle, descr_buf, HIDAPI_MAX_DESCRIPTOR_SIZE );
+  hid_close( handle );
+  if ( size < 0 ){
+    fprintf(stderr, "Unable to read report descriptor\n");
+    return 1;
+  }
+  printf( "descriptor size: %i bytes\n", size );
+
+  struct hid_dev_desc desc;
+  hid_set_descriptor_cache_dir( NULL );
+  start = now_in_us();
+  for ( i = 0; i < iterations; i++ ){
+    hid_parse_report_descriptor( descr_buf, size, &desc );
+    free_descriptor_tables( &desc );
+  }
+  printf( "parse descriptor:\t%.2f us\n", (now_in_us() - start) / iterations );
+
+  hid_set_descriptor_cache_dir( cache_dir );
+  hid_parse_report_descriptor( descr_buf, size, &desc );
+  if ( hid_store_cached_descriptor( descr_buf, size, &desc ) != 0 ){
+    fprintf(stderr, "Unable to write to descriptor cache %s\n", cache_dir );
+    return 1;
+  }
+  free_descriptor_tables( &desc );
+  start = now_in_us();
+  for ( i = 0; i < iterations; i++ ){
+    hid_load_cached_descriptor( descr_buf, size, &desc );
+    free_descriptor_tables( &desc );
+  }
+  printf( "load cached descriptor:\t%.2f us\n", (now_in_us() - start) / iterations );
+
+  const char * modes[2] = { "open device (no cache)", "open device (cache)" };
+  int mode;
+  for ( mode = 0; mode < 2; mode++ ){
+    hid_set_descriptor_cache_dir( mode == 0 ? NULL : cache_dir );
+    start = now_in_us();
+    for ( i = 0; i < iterations; i++ ){
+      devdesc = hid_open_device( vendor_id, product_id, NULL );
+      if ( devdesc == NULL ){
+	fprintf(stderr, "Unable to open device %d, %d\n", vendor_id, product_id );
+	return 1;
+      }
+      hid_close_device( devdesc );
+      free( devdesc );
+    }
+    printf( "%s:\t%.2f us\n", modes[mode], (now_in_us() - start) / iterations );
+  }
+  hid_set_descriptor_cache_dir( NULL );
+  return 0;
+}
+
+#endif
+
 int main(int argc, char* argv[]){
 
   int res;
@@ -172,6 +257,19 @@ int main(int argc, char* argv[]){
 
   if (hid_init())
     return -1;
+
+#ifdef LINUX_FREEBSD
+  if ( argc >= 5 && strcmp( argv[1], "--startup" ) == 0 ){
+    int iterations = argc >= 6 ? atoi( argv[5] ) : 100;
+    if ( iterations <= 0 ){
+      iterations = 100;
+    }
+    res = measure_startup( strtol( argv[2], NULL, 0 ), strtol( argv[3], NULL, 0 ), argv[4], iterations );
+    hid_exit();
+    return res;
+  }
+#endif
+
   list_devices();
   
   int vendor_id;
@@ -182,6 +280,9 @@ int main(int argc, char* argv[]){
     product_id = atoi( argv[2] );
   } else {
     printf( "please run again with vendor and product id to open specified device, e.g. hidparsertest 0x044f 0xd003\n" );
+#ifdef LINUX_FREEBSD
+    printf( "or measure startup time with the descriptor cache, e.g. hidparsertest --startup 0x044f 0xd003 /tmp/hidcache [iterations]\n" );
+#endif
       return 0;
   }
   printf( "vendor %i, product %i", vendor_id, product_id );
@@ -116,6 +116,7 @@ struct hid_device_ {
 	int num_queued_reports;
 	struct input_report *input_reports;
         struct input_report **last_input_report;
+	struct input_report *free_reports; /* MAX_QUEUE_LEN + 1 slots, allocated at open */
 
 	pthread_t thread;
 	pthread_mutex_t mutex; /* Protects input_reports */
@@ -140,6 +141,7 @@ static hid_device *new_hid_device(void)
 	dev->input_report_buf = NULL;
 	dev->input_reports = NULL;
 	dev->last_input_report = &dev->input_reports;
+	dev->free_reports = NULL;
 	dev->num_queued_reports = 0;
 	dev->shutdown_thread = 0;
 
@@ -159,13 +161,19 @@ static void free_hid_device(hid_device *dev)
 	if (!dev)
 		return;
 
-	/* Delete any input reports still left over. */
+	/* Delete any input reports still left over, and the free slots. */
 	struct input_report *rpt = dev->input_reports;
 	while (rpt) {
 		struct input_report *next = rpt->next;
 		free(rpt);
 		rpt = next;
 	}
+	rpt = dev->free_reports;
+	while (rpt) {
+		struct input_report *next = rpt->next;
+		free(rpt);
+		rpt = next;
+	}
 
 	/* Free the string and the report buffer. The check for NULL
 	   is necessary here as CFRelease() doesn't handle NULL like
@@ -586,12 +594,6 @@ static void hid_report_callback(void *context, IOReturn result, void *sender,
 	struct input_report *rpt;
 	hid_device *dev = context;
 
-	/* Make a new Input Report object */
-	rpt = calloc(1, sizeof(struct input_report)+report_length);
-	memcpy(rpt->data, report, report_length);
-	rpt->len = report_length;
-	rpt->next = NULL;
-
 //	fprintf(stderr, "report: qlen=%d queue=%p report=%p size=%ld\r\n", 
 //		dev->num_queued_reports, dev->input_reports,
 //		report, report_length);
@@ -599,6 +601,21 @@ static void hid_report_callback(void *context, IOReturn result, void *sender,
 	/* Lock this section */
 	pthread_mutex_lock(&dev->mutex);
 
+	/* Take a free Input Report slot: there is always one, since the
+	   queue holds at most MAX_QUEUE_LEN reports, so that receiving a
+	   report never allocates. */
+	rpt = dev->free_reports;
+	if (!rpt) {
+		pthread_mutex_unlock(&dev->mutex);
+		return;
+	}
+	dev->free_reports = rpt->next;
+	if (report_length > dev->max_input_report_len)
+		report_length = dev->max_input_report_len;
+	memcpy(rpt->data, report, report_length);
+	rpt->len = report_length;
+	rpt->next = NULL;
+
 	*dev->last_input_report = rpt;
 	dev->last_input_report = &(rpt->next);
 	dev->num_queued_reports++;
@@ -735,6 +752,13 @@ hid_device * HID_API_EXPORT hid_open_path(const char *path)
 				/* Create the buffers for receiving data */
 				dev->max_input_report_len = (CFIndex) get_max_report_length(os_dev);
 				dev->input_report_buf = calloc(dev->max_input_report_len, sizeof(uint8_t));
+				for (int slot = 0; slot < MAX_QUEUE_LEN + 1; slot++) {
+					struct input_report *free_rpt = calloc(1, sizeof(struct input_report) + dev->max_input_report_len);
+					if (!free_rpt)
+						break;
+					free_rpt->next = dev->free_reports;
+					dev->free_reports = free_rpt;
+				}
 
 				/* Create the Run Loop Mode for this device.
 				   printing the reference seems to work. */
@@ -851,7 +875,8 @@ static int return_data(hid_device *dev, unsigned char *data, size_t length)
 
 	    if ((dev->input_reports = rpt->next) == NULL) /* empty */
 		dev->last_input_report = &dev->input_reports;
-	    free(rpt);
+	    rpt->next = dev->free_reports;
+	    dev->free_reports = rpt;
 	    return len;
 	}
 	return 0;
@@ -864,7 +889,8 @@ static int drop_data(hid_device *dev)
 	    dev->num_queued_reports--;
 	    if ((dev->input_reports = rpt->next) == NULL) /* empty */
 		dev->last_input_report = &dev->input_reports;
-	    free(rpt);
+	    rpt->next = dev->free_reports;
+	    dev->free_reports = rpt;
 	    return 1;
 	}
 	return 0;
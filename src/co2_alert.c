@@ -0,0 +1,785 @@
+// Threshold alerts
+//
+// Rules are evaluated by the reader on every decoded CO2 and temperature
+// report. When a rule turns on or off, an event is queued for the action
+// thread, which runs the rule's action, so the read loop never waits for a
+// command, a FIFO or a socket.
+//
+// Rule syntax, one per --alert or per line of an --alerts file:
+//
+//   name: channel [rate] (>|<) threshold [clear level] [over duration] [for duration] action target
+//
+// - channel: co2 (ppm) or temperature (Celsius)
+// - rate: compare the rate of change, per minute, measured over the last
+//   "over" duration (default 1m), instead of the value
+// - clear: hysteresis, the rule turns off only once past this level
+//   (default: the threshold)
+// - for: the condition must hold that long before the rule turns on
+// - action, run when the rule turns on and when it turns off:
+//   - exec 'command': runs command with the shell, with CO2_ALERT,
+//     CO2_ALERT_STATE (on/off) and CO2_ALERT_VALUE in its environment. The
+//     commands of a rule run one after the other, those of different rules
+//     at the same time. At exit, they get 2 seconds, then are killed.
+//   - fifo path: writes an event line to a FIFO, if someone reads it
+//   - udp host:port: sends an event line as a datagram
+//
+// Event line: time, rule name, on/off, value, separated by tabs.
+//
+// Example: ventilate: co2 > 1200 clear 1000 for 30s exec 'ventilation on'
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32)
+#include <process.h>
+#else
+#include <netdb.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+enum { ALERT_MAX_RULES = 32 };
+enum { ALERT_QUEUE_CAPACITY = 256 };
+enum { ALERT_MAX_HELD = 16 }; // per rule, commands waiting for the running one
+enum { ALERT_REAP_INTERVAL_MS = 10 };
+enum { ALERT_STOP_TIMEOUT_MS = 2000 };
+enum { ALERT_LATENCY_SAMPLES = 1024 };
+
+typedef enum AlertActionKind
+{
+     AlertActionKind_Exec,
+     AlertActionKind_Fifo,
+     AlertActionKind_Udp,
+     NumAlertActionKinds,
+} AlertActionKind;
+
+static char const *ALERT_ACTION_NAMES[NumAlertActionKinds] = {
+     [AlertActionKind_Exec] = "exec",
+     [AlertActionKind_Fifo] = "fifo",
+     [AlertActionKind_Udp] = "udp",
+};
+
+typedef struct AlertSample
+{
+     int64_t second;
+     float value;
+} AlertSample;
+
+typedef struct AlertRule
+{
+     char name[64];
+     ReadingKind channel;
+     int is_rate;
+     int is_above;
+     float threshold;
+     float clear;
+     int64_t over_seconds;
+     int64_t for_seconds;
+     AlertActionKind action;
+     char target[512];
+#if !defined(WIN32)
+     struct sockaddr_storage udp_address;
+     socklen_t udp_address_size;
+#endif
+
+     // state, owned by the reader
+     int active;
+     int64_t holding_since; // second the condition started to hold, or -1
+     AlertSample *history; // for rates, one sample per second, over_seconds + 1 of them
+     int64_t history_head;
+     int64_t history_count;
+} AlertRule;
+
+typedef struct AlertEvent
+{
+     AlertRule const *rule;
+     int active;
+     float value;
+     int64_t time_unix_ns;
+     int64_t received_ns; // uu_monotonic_ns when the report was read
+} AlertEvent;
+
+typedef struct AlertEngine
+{
+     AlertRule rules[ALERT_MAX_RULES];
+     int num_rules;
+
+     UU_Mutex mutex;
+     UU_CondVar not_empty;
+     AlertEvent queue[ALERT_QUEUE_CAPACITY];
+     int queue_head;
+     int queue_count;
+     int closing;
+
+     // stats, under the mutex
+     uint64_t events;
+     uint64_t dropped_events;
+     uint64_t action_errors;
+     int64_t latencies_ns[ALERT_LATENCY_SAMPLES]; // the latest ones
+     uint64_t num_latencies;
+     int64_t latency_ns_max;
+
+     // owned by the action thread
+     int num_children; // of the ones below, none on Windows
+#if defined(WIN32)
+     int udp_socket;
+#else
+     pid_t children[ALERT_MAX_RULES]; // the running command of each rule, or 0
+     AlertEvent held[ALERT_MAX_RULES][ALERT_MAX_HELD];
+     int held_head[ALERT_MAX_RULES];
+     int held_count[ALERT_MAX_RULES];
+     int udp_socket;
+#endif
+     UU_Thread thread;
+} AlertEngine;
+
+//
+// Parsing
+//
+
+// Splits the next token off text, in place. Single or double quotes group
+// words.
+static char *alert_next_token(char **text)
+{
+     char *p = *text;
+     while (*p == ' ' || *p == '\t') p++;
+     if (!*p) {
+          *text = p;
+          return NULL;
+     }
+     char *token = p;
+     if (*p == '\'' || *p == '"') {
+          char quote = *p++;
+          token = p;
+          while (*p && *p != quote) p++;
+     } else {
+          while (*p && *p != ' ' && *p != '\t') p++;
+     }
+     if (*p) *p++ = 0;
+     *text = p;
+     return token;
+}
+
+static int alert_parse_float(char const *text, float *result)
+{
+     char *end;
+     *result = strtof(text, &end);
+     return end != text && !*end ? 0 : -1;
+}
+
+// Parses a rule, see the syntax above. Returns an error message or NULL.
+char const *alert_rule_parse(AlertRule *rule, char const *text)
+{
+     char buffer[1024];
+     if (strlen(text) >= sizeof buffer) return "rule too long";
+     strcpy(buffer, text);
+     char *rest = buffer;
+     memset(rule, 0, sizeof *rule);
+     rule->over_seconds = 60;
+     rule->holding_since = -1;
+
+     char *token = alert_next_token(&rest);
+     size_t len = token ? strlen(token) : 0;
+     if (!len || token[len - 1] != ':' || len > sizeof rule->name) return "expected a name followed by ':'";
+     memcpy(rule->name, token, len - 1);
+
+     token = alert_next_token(&rest);
+     if (token && 0 == strcmp(token, "co2")) {
+          rule->channel = ReadingKind_CO2;
+     } else if (token && 0 == strcmp(token, "temperature")) {
+          rule->channel = ReadingKind_Temperature;
+     } else {
+          return "expected co2 or temperature";
+     }
+     token = alert_next_token(&rest);
+     if (token && 0 == strcmp(token, "rate")) {
+          rule->is_rate = 1;
+          token = alert_next_token(&rest);
+     }
+     if (token && 0 == strcmp(token, ">")) {
+          rule->is_above = 1;
+     } else if (!token || 0 != strcmp(token, "<")) {
+          return "expected > or <";
+     }
+     token = alert_next_token(&rest);
+     if (!token || alert_parse_float(token, &rule->threshold) != 0) return "expected a threshold";
+     rule->clear = rule->threshold;
+
+     for (;;) {
+          token = alert_next_token(&rest);
+          if (!token) return "expected an action: exec, fifo or udp";
+          char *value = alert_next_token(&rest);
+          if (!value) return "expected an argument";
+          if (0 == strcmp(token, "clear")) {
+               if (alert_parse_float(value, &rule->clear) != 0) return "expected a level after clear";
+               if (rule->is_above ? rule->clear > rule->threshold : rule->clear < rule->threshold) {
+                    return "the clear level must be on the other side of the threshold";
+               }
+          } else if (0 == strcmp(token, "over")) {
+               rule->over_seconds = window_parse_duration(value);
+               if (rule->over_seconds <= 0 || rule->over_seconds > WINDOW_MAX_SECONDS) return "expected a duration after over";
+          } else if (0 == strcmp(token, "for")) {
+               rule->for_seconds = window_parse_duration(value);
+               if (rule->for_seconds <= 0) return "expected a duration after for";
+          } else {
+               int action = -1;
+               for (int i = 0; i < NumAlertActionKinds; i++) {
+                    if (0 == strcmp(token, ALERT_ACTION_NAMES[i])) action = i;
+               }
+               if (action < 0) return "expected clear, over, for, or an action: exec, fifo or udp";
+               if (strlen(value) >= sizeof rule->target) return "action argument too long";
+               rule->action = action;
+               strcpy(rule->target, value);
+               break;
+          }
+     }
+     if (alert_next_token(&rest)) return "unexpected text after the action";
+#if defined(WIN32)
+     if (rule->action != AlertActionKind_Exec) return "only exec actions are supported on Windows";
+#else
+     if (rule->action == AlertActionKind_Udp) {
+          char host[256];
+          char const *colon = strrchr(rule->target, ':');
+          if (!colon || colon == rule->target || (size_t)(colon - rule->target) >= sizeof host) return "expected host:port after udp";
+          memcpy(host, rule->target, colon - rule->target);
+          host[colon - rule->target] = 0;
+          struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM };
+          struct addrinfo *addresses;
+          if (getaddrinfo(host, colon + 1, &hints, &addresses) != 0) return "could not resolve the udp address";
+          memcpy(&rule->udp_address, addresses->ai_addr, addresses->ai_addrlen);
+          rule->udp_address_size = addresses->ai_addrlen;
+          freeaddrinfo(addresses);
+     }
+#endif
+     if (rule->is_rate) {
+          rule->history = memory_calloc(rule->over_seconds + 1, sizeof *rule->history);
+          if (!rule->history) return "out of memory";
+     }
+     return NULL;
+}
+
+// Returns an error message or NULL
+char const *alert_engine_add_rule(AlertEngine *engine, char const *text)
+{
+     if (engine->num_rules == ALERT_MAX_RULES) return "too many rules";
+     char const *error = alert_rule_parse(&engine->rules[engine->num_rules], text);
+     if (!error) engine->num_rules++;
+     return error;
+}
+
+// One rule per line, empty lines and lines starting with # are skipped.
+// Errors are reported on standard error.
+int alert_engine_load_rules(AlertEngine *engine, char const *path)
+{
+     FILE *file = fopen(path, "r");
+     if (!file) {
+          fprintf(stderr, "ERROR: could not open %s\n", path);
+          return -1;
+     }
+     char line[1024];
+     int line_number = 0;
+     int rc = 0;
+     while (rc == 0 && fgets(line, sizeof line, file)) {
+          line_number++;
+          line[strcspn(line, "\r\n")] = 0;
+          char const *start = line + strspn(line, " \t");
+          if (!*start || *start == '#') continue;
+          char const *error = alert_engine_add_rule(engine, start);
+          if (error) {
+               fprintf(stderr, "%s:%d: ERROR: %s\n", path, line_number, error);
+               rc = -1;
+          }
+     }
+     fclose(file);
+     return rc;
+}
+
+//
+// Evaluation, in the reader
+//
+
+// Rate of change per minute between the oldest sample of the last
+// over_seconds and this one. Returns 0 until there are two seconds.
+static int alert_rule_rate(AlertRule *rule, int64_t second, float value, float *rate)
+{
+     int64_t capacity = rule->over_seconds + 1;
+     if (rule->history_count) {
+          AlertSample *latest = &rule->history[(rule->history_head + rule->history_count - 1) % capacity];
+          if (second < latest->second) second = latest->second;
+          if (latest->second == second) {
+               latest->value = value;
+          } else {
+               if (rule->history_count == capacity) {
+                    rule->history_head = (rule->history_head + 1) % capacity;
+                    rule->history_count--;
+               }
+               rule->history[(rule->history_head + rule->history_count) % capacity] = (AlertSample){ second, value };
+               rule->history_count++;
+          }
+     } else {
+          rule->history[rule->history_head] = (AlertSample){ second, value };
+          rule->history_count = 1;
+     }
+     while (rule->history[rule->history_head].second < second - rule->over_seconds) {
+          rule->history_head = (rule->history_head + 1) % capacity;
+          rule->history_count--;
+     }
+     AlertSample const *oldest = &rule->history[rule->history_head];
+     if (oldest->second == second) return 0;
+     *rate = (value - oldest->value) * 60.0f / (float)(second - oldest->second);
+     return 1;
+}
+
+static void alert_engine_queue(AlertEngine *engine, AlertRule const *rule, float value, Reading const *reading, int64_t received_ns)
+{
+     uu_mutex_lock(&engine->mutex);
+     engine->events++;
+     if (engine->queue_count == ALERT_QUEUE_CAPACITY) {
+          engine->dropped_events++;
+     } else {
+          engine->queue[(engine->queue_head + engine->queue_count) % ALERT_QUEUE_CAPACITY] = (AlertEvent){
+               .rule = rule,
+               .active = rule->active,
+               .value = value,
+               .time_unix_ns = reading->time_unix_ns,
+               .received_ns = received_ns,
+          };
+          engine->queue_count++;
+          uu_condvar_signal(&engine->not_empty);
+     }
+     uu_mutex_unlock(&engine->mutex);
+}
+
+// Called with every decoded report of a channel, whether or not it is output.
+// received_ns is uu_monotonic_ns at the time the report was read.
+void alert_engine_evaluate(AlertEngine *engine, Reading const *reading, int64_t received_ns)
+{
+     if (reading->kind != ReadingKind_CO2 && reading->kind != ReadingKind_Temperature) return;
+     int64_t second = reading->time_unix_ns / NS_PER_SECOND;
+     float value = reading->kind == ReadingKind_CO2 ? (float)reading->co2_in_ppm : reading->temperature_in_C;
+     for (int i = 0; i < engine->num_rules; i++) {
+          AlertRule *rule = &engine->rules[i];
+          if (rule->channel != reading->kind) continue;
+          float x = value;
+          if (rule->is_rate && !alert_rule_rate(rule, second, value, &x)) continue;
+          if (!rule->active) {
+               int holds = rule->is_above ? x > rule->threshold : x < rule->threshold;
+               if (!holds) {
+                    rule->holding_since = -1;
+                    continue;
+               }
+               if (rule->holding_since < 0) rule->holding_since = second;
+               if (second - rule->holding_since < rule->for_seconds) continue;
+               rule->active = 1;
+          } else {
+               int cleared = rule->is_above ? x < rule->clear : x > rule->clear;
+               if (!cleared) continue;
+               rule->active = 0;
+               rule->holding_since = -1;
+          }
+          alert_engine_queue(engine, rule, x, reading, received_ns);
+     }
+}
+
+//
+// Actions, in the action thread
+//
+
+// Counts an action that ran, or failed to
+static void alert_engine_done(AlertEngine *engine, AlertEvent const *event, int failed)
+{
+     int64_t latency_ns = uu_monotonic_ns() - event->received_ns;
+     uu_mutex_lock(&engine->mutex);
+     if (failed) engine->action_errors++;
+     engine->latencies_ns[engine->num_latencies % ALERT_LATENCY_SAMPLES] = latency_ns;
+     engine->num_latencies++;
+     if (latency_ns > engine->latency_ns_max) engine->latency_ns_max = latency_ns;
+     uu_mutex_unlock(&engine->mutex);
+}
+
+#if !defined(WIN32)
+static int alert_engine_spawn(AlertEngine *engine, AlertEvent const *event)
+{
+     char value[32];
+     snprintf(value, sizeof value, "%f", event->value);
+     enum { MAX_ENVIRONMENT = 256 };
+     char alert[128], state[64], value_variable[64];
+     snprintf(alert, sizeof alert, "CO2_ALERT=%s", event->rule->name);
+     snprintf(state, sizeof state, "CO2_ALERT_STATE=%s", event->active ? "on" : "off");
+     snprintf(value_variable, sizeof value_variable, "CO2_ALERT_VALUE=%s", value);
+     char *environment[MAX_ENVIRONMENT + 4];
+     int n = 0;
+     for (char **variable = environ; *variable && n < MAX_ENVIRONMENT; variable++) {
+          if (strncmp(*variable, "CO2_ALERT", 9) != 0) environment[n++] = *variable;
+     }
+     environment[n++] = alert;
+     environment[n++] = state;
+     environment[n++] = value_variable;
+     environment[n] = NULL;
+
+     char *argv[] = { "/bin/sh", "-c", (char *)event->rule->target, NULL };
+     // in a process group of its own, so that the shell and what it started
+     // can be killed at exit
+     posix_spawnattr_t attributes;
+     posix_spawnattr_init(&attributes);
+     posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+     posix_spawnattr_setpgroup(&attributes, 0);
+     pid_t pid;
+     int rc = posix_spawn(&pid, "/bin/sh", NULL, &attributes, argv, environment);
+     posix_spawnattr_destroy(&attributes);
+     if (rc != 0) return -1;
+     engine->children[event->rule - engine->rules] = pid;
+     engine->num_children++;
+     return 0;
+}
+
+// Reaps the commands that are done, without waiting for any, and starts the
+// commands their rules held back meanwhile.
+static void alert_engine_reap_children(AlertEngine *engine)
+{
+     for (int r = 0; r < engine->num_rules && engine->num_children; r++) {
+          if (!engine->children[r] || waitpid(engine->children[r], NULL, WNOHANG) == 0) continue;
+          engine->children[r] = 0;
+          engine->num_children--;
+          while (engine->held_count[r] && !engine->children[r]) {
+               AlertEvent event = engine->held[r][engine->held_head[r]];
+               engine->held_head[r] = (engine->held_head[r] + 1) % ALERT_MAX_HELD;
+               engine->held_count[r]--;
+               alert_engine_done(engine, &event, alert_engine_spawn(engine, &event) != 0);
+          }
+     }
+}
+#endif
+
+// Returns 1 when the command is held back until the rule's previous command
+// is done, so that its on and off commands never run out of order.
+static int alert_engine_exec(AlertEngine *engine, AlertEvent const *event)
+{
+#if defined(WIN32)
+     char value[32];
+     snprintf(value, sizeof value, "%f", event->value);
+     (void)engine;
+     _putenv_s("CO2_ALERT", event->rule->name);
+     _putenv_s("CO2_ALERT_STATE", event->active ? "on" : "off");
+     _putenv_s("CO2_ALERT_VALUE", value);
+     return _spawnlp(_P_NOWAIT, "cmd.exe", "cmd.exe", "/c", event->rule->target, NULL) == -1 ? -1 : 0;
+#else
+     int r = (int)(event->rule - engine->rules);
+     if (!engine->children[r]) return alert_engine_spawn(engine, event);
+     if (engine->held_count[r] == ALERT_MAX_HELD) return -1;
+     engine->held[r][(engine->held_head[r] + engine->held_count[r]) % ALERT_MAX_HELD] = *event;
+     engine->held_count[r]++;
+     return 1;
+#endif
+}
+
+static int alert_engine_run_action(AlertEngine *engine, AlertEvent const *event)
+{
+     if (event->rule->action == AlertActionKind_Exec) return alert_engine_exec(engine, event);
+#if defined(WIN32)
+     return -1;
+#else
+     char line[256];
+     OutputTimeCache time_cache = {0};
+     Reading reading = { .time_unix_ns = event->time_unix_ns };
+     char *dst = output_append_time(line, &time_cache, &reading);
+     dst += snprintf(dst, line + sizeof line - dst, "\t%s\t%s\t%f\n", event->rule->name, event->active ? "on" : "off", event->value);
+     size_t size = dst < line + sizeof line ? (size_t)(dst - line) : sizeof line - 1;
+     if (event->rule->action == AlertActionKind_Fifo) {
+          // without a reader, opening fails rather than blocks
+          int fd = open(event->rule->target, O_WRONLY | O_NONBLOCK);
+          if (fd < 0) return -1;
+          int rc = uu_write_all(fd, line, size);
+          close(fd);
+          return rc;
+     }
+     ssize_t sent = sendto(engine->udp_socket, line, size, 0, (struct sockaddr const *)&event->rule->udp_address, event->rule->udp_address_size);
+     return sent == (ssize_t)size ? 0 : -1;
+#endif
+}
+
+static void alert_engine_run(void *arg)
+{
+     AlertEngine *engine = arg;
+     for (;;) {
+#if !defined(WIN32)
+          alert_engine_reap_children(engine);
+#endif
+          uu_mutex_lock(&engine->mutex);
+          if (!engine->queue_count && !engine->closing) {
+               // while commands run, wakes up to reap them
+               if (engine->num_children) {
+                    uu_condvar_wait_timeout(&engine->not_empty, &engine->mutex, (int64_t)ALERT_REAP_INTERVAL_MS * 1000000);
+               } else {
+                    uu_condvar_wait(&engine->not_empty, &engine->mutex);
+               }
+          }
+          if (!engine->queue_count) {
+               int closing = engine->closing;
+               uu_mutex_unlock(&engine->mutex);
+               if (closing) break;
+               continue;
+          }
+          AlertEvent event = engine->queue[engine->queue_head];
+          engine->queue_head = (engine->queue_head + 1) % ALERT_QUEUE_CAPACITY;
+          engine->queue_count--;
+          uu_mutex_unlock(&engine->mutex);
+
+          int rc = alert_engine_run_action(engine, &event);
+          if (rc != 1) alert_engine_done(engine, &event, rc != 0);
+     }
+}
+
+//
+// Set up, stats and tear down
+//
+
+int alert_engine_start(AlertEngine *engine)
+{
+     uu_mutex_init(&engine->mutex);
+     uu_condvar_init(&engine->not_empty);
+     engine->udp_socket = -1;
+#if !defined(WIN32)
+     for (int i = 0; i < engine->num_rules; i++) {
+          if (engine->rules[i].action == AlertActionKind_Udp && engine->udp_socket < 0) {
+               engine->udp_socket = socket(engine->rules[i].udp_address.ss_family, SOCK_DGRAM, 0);
+               if (engine->udp_socket < 0) {
+                    fprintf(stderr, "ERROR: could not create the udp socket of the alerts\n");
+                    return -1;
+               }
+          }
+     }
+#endif
+     if (uu_thread_start(&engine->thread, alert_engine_run, engine) != 0) {
+          fprintf(stderr, "ERROR: could not start the alert thread\n");
+          return -1;
+     }
+     return 0;
+}
+
+static int alert_compare_int64(void const *a, void const *b)
+{
+     int64_t x = *(int64_t const *)a, y = *(int64_t const *)b;
+     return x < y ? -1 : x > y;
+}
+
+// Report to action latencies, over the latest ALERT_LATENCY_SAMPLES actions
+void alert_engine_print_stats(AlertEngine *engine, FILE *out)
+{
+     static int64_t sorted[ALERT_LATENCY_SAMPLES];
+     uu_mutex_lock(&engine->mutex);
+     int n = engine->num_latencies < ALERT_LATENCY_SAMPLES ? (int)engine->num_latencies : ALERT_LATENCY_SAMPLES;
+     memcpy(sorted, engine->latencies_ns, n * sizeof sorted[0]);
+     uint64_t events = engine->events, dropped = engine->dropped_events, errors = engine->action_errors;
+     int64_t max_ns = engine->latency_ns_max;
+     uu_mutex_unlock(&engine->mutex);
+     qsort(sorted, n, sizeof sorted[0], alert_compare_int64);
+     fprintf(out, "alerts\tevents=%llu dropped=%llu action_errors=%llu latency_us p50=%.0f p99=%.0f max=%.0f\n",
+             (unsigned long long)events, (unsigned long long)dropped, (unsigned long long)errors,
+             n ? sorted[n / 2] / 1e3 : 0.0, n ? sorted[(n * 99) / 100] / 1e3 : 0.0, max_ns / 1e3);
+}
+
+void alert_engine_stop(AlertEngine *engine)
+{
+     uu_mutex_lock(&engine->mutex);
+     engine->closing = 1;
+     uu_condvar_signal(&engine->not_empty);
+     uu_mutex_unlock(&engine->mutex);
+     uu_thread_join(&engine->thread);
+#if !defined(WIN32)
+     // the running commands, and those held back behind them, get
+     // ALERT_STOP_TIMEOUT_MS to finish, then the running ones are killed
+     int64_t deadline_ns = uu_monotonic_ns() + (int64_t)ALERT_STOP_TIMEOUT_MS * 1000000;
+     while (engine->num_children && uu_monotonic_ns() < deadline_ns) {
+          uu_sleep_ms(ALERT_REAP_INTERVAL_MS);
+          alert_engine_reap_children(engine);
+     }
+     for (int r = 0; r < engine->num_rules; r++) {
+          if (!engine->children[r]) continue;
+          fprintf(stderr, "WARNING: killed the command of alert %s, still running at exit\n", engine->rules[r].name);
+          kill(-engine->children[r], SIGKILL);
+          waitpid(engine->children[r], NULL, 0);
+          engine->action_errors += engine->held_count[r];
+     }
+     if (engine->udp_socket >= 0) close(engine->udp_socket);
+#endif
+     for (int i = 0; i < engine->num_rules; i++) memory_free(engine->rules[i].history);
+     uu_condvar_destroy(&engine->not_empty);
+     uu_mutex_destroy(&engine->mutex);
+}
+
+//
+// Self-check, against a brute-force model of the rules
+//
+
+enum { ALERT_CHECK_STEPS = 50000 };
+
+static char const *const ALERT_CHECK_RULES[] = {
+     "plain: temperature > 25 exec true",
+     "cold: temperature < 17 clear 18 for 5s exec true",
+     "high: co2 > 1200 clear 1000 exec true",
+     "ventilate: co2 > 1200 clear 1000 for 30s exec true",
+     "rising: co2 rate > 200 over 2m exec true",
+     "surge: co2 rate > 100 clear 0 over 30s for 10s exec true",
+};
+
+enum { ALERT_CHECK_NUM_RULES = sizeof ALERT_CHECK_RULES / sizeof ALERT_CHECK_RULES[0] };
+
+typedef struct AlertCheckModel
+{
+     int active;
+     int num_evaluated;
+     int64_t *seconds; // of the reports the rule was evaluated on
+     int *holds; // whether the condition held on each of them
+} AlertCheckModel;
+
+// The rate of a rule, recomputed from the last CO2 value of every second:
+// between the oldest second of the last over_seconds and this one
+static int alert_check_rate(AlertSample const *co2, int num_co2, int64_t over_seconds, float *rate)
+{
+     AlertSample const *latest = &co2[num_co2 - 1];
+     int oldest = num_co2 - 1;
+     while (oldest > 0 && co2[oldest - 1].second >= latest->second - over_seconds) oldest--;
+     if (co2[oldest].second == latest->second) return 0;
+     *rate = (latest->value - co2[oldest].value) * 60.0f / (float)(latest->second - co2[oldest].second);
+     return 1;
+}
+
+// Feeds the rules above random CO2 and temperature reports, crossing their
+// thresholds and clear levels often, with gaps. The events they queue must be
+// those of the model: on once the condition held on every report for the
+// rule's for duration, off only once past the clear level. Returns the
+// number of wrong events.
+static uint64_t alert_check_run(AlertEngine *engine, AlertCheckModel *models, AlertSample *co2)
+{
+     uint32_t random = 1;
+     int64_t second = 1700000000;
+     int ppm = 800, num_co2 = 0;
+     float temperature = 20;
+     uint64_t num_on = 0, num_off = 0, wrong = 0;
+     for (int step = 0; step < ALERT_CHECK_STEPS; step++) {
+          random = random * 1664525 + 1013904223;
+          uint32_t r = random >> 8;
+          switch (r % 50) {
+          case 0: second += 60 + r / 50 % 140; break; // a gap
+          case 1: case 2: case 3: second += 2 + r / 50 % 4; break;
+          default: if (r % 3) second++;
+          }
+          Reading reading = { .time_unix_ns = second * NS_PER_SECOND };
+          if (r / 7 % 2) {
+               reading.kind = ReadingKind_CO2;
+               ppm = r / 14 % 40 ? ppm + (int)(r / 14 / 40 % 121) - 60 : 300 + (int)(r / 14 / 40 % 2200);
+               if (ppm < 300) ppm = 300;
+               reading.co2_in_ppm = ppm;
+               if (num_co2 && co2[num_co2 - 1].second == second) {
+                    co2[num_co2 - 1].value = (float)ppm;
+               } else {
+                    co2[num_co2++] = (AlertSample){ second, (float)ppm };
+               }
+          } else {
+               reading.kind = ReadingKind_Temperature;
+               temperature += (float)((int)(r / 14 % 9) - 4) / 8;
+               if (temperature < 10 || temperature > 30) temperature = 20;
+               reading.temperature_in_C = temperature;
+          }
+          alert_engine_evaluate(engine, &reading, 0);
+
+          for (int i = 0; i < engine->num_rules; i++) {
+               AlertRule const *rule = &engine->rules[i];
+               AlertCheckModel *model = &models[i];
+               if (rule->channel != reading.kind) continue;
+               float x = reading.kind == ReadingKind_CO2 ? (float)ppm : temperature;
+               if (rule->is_rate && !alert_check_rate(co2, num_co2, rule->over_seconds, &x)) continue;
+               int holds = rule->is_above ? x > rule->threshold : x < rule->threshold;
+               model->seconds[model->num_evaluated] = second;
+               model->holds[model->num_evaluated] = holds;
+               model->num_evaluated++;
+               int expected = 0; // no event
+               if (!model->active) {
+                    // the first report of the run of those the condition held on
+                    int first = model->num_evaluated - 1;
+                    while (first > 0 && model->holds[first - 1]) first--;
+                    if (holds && second - model->seconds[first] >= rule->for_seconds) expected = 1;
+               } else {
+                    if (rule->is_above ? x < rule->clear : x > rule->clear) expected = -1;
+               }
+               if (expected) model->active = expected > 0;
+               num_on += expected > 0;
+               num_off += expected < 0;
+
+               // the events of this report, in the order of the rules
+               AlertEvent event = {0};
+               int has_event = 0;
+               uu_mutex_lock(&engine->mutex);
+               if (engine->queue_count && engine->queue[engine->queue_head].rule == rule) {
+                    event = engine->queue[engine->queue_head];
+                    engine->queue_head = (engine->queue_head + 1) % ALERT_QUEUE_CAPACITY;
+                    engine->queue_count--;
+                    has_event = 1;
+               }
+               uu_mutex_unlock(&engine->mutex);
+               int ok = has_event == (expected != 0) && (!has_event || (event.active == model->active && event.value == x));
+               if (!ok && !wrong) {
+                    fprintf(stderr, "ERROR: alert %s at report %d: %s, expected %s\n", rule->name, step,
+                            !has_event ? "no event" : event.active ? "on" : "off",
+                            !expected ? "no event" : expected > 0 ? "on" : "off");
+               }
+               wrong += !ok;
+          }
+          uu_mutex_lock(&engine->mutex);
+          wrong += engine->queue_count; // events of no rule
+          engine->queue_count = 0;
+          uu_mutex_unlock(&engine->mutex);
+     }
+     fprintf(stderr, "check\talert\t%d reports, %llu turned on, %llu turned off, %llu wrong\n", ALERT_CHECK_STEPS,
+             (unsigned long long)num_on, (unsigned long long)num_off, (unsigned long long)wrong);
+     return wrong;
+}
+
+// Runs the check on an engine without its action thread, dir is not used.
+// Returns 0 when it passes.
+int alert_check(char const *dir)
+{
+     (void)dir;
+     AlertEngine *engine = calloc(1, sizeof *engine);
+     AlertCheckModel models[ALERT_CHECK_NUM_RULES] = {{0}};
+     AlertSample *co2 = malloc(ALERT_CHECK_STEPS * sizeof *co2);
+     int rc = engine && co2 ? 0 : -1;
+     for (int r = 0; r < ALERT_CHECK_NUM_RULES; r++) {
+          models[r].seconds = malloc(ALERT_CHECK_STEPS * sizeof *models[r].seconds);
+          models[r].holds = malloc(ALERT_CHECK_STEPS * sizeof *models[r].holds);
+          if (!models[r].seconds || !models[r].holds) rc = -1;
+     }
+     if (rc != 0) fprintf(stderr, "ERROR: out of memory\n");
+     for (int r = 0; rc == 0 && r < ALERT_CHECK_NUM_RULES; r++) {
+          char const *error = alert_engine_add_rule(engine, ALERT_CHECK_RULES[r]);
+          if (error) {
+               fprintf(stderr, "ERROR: %s: %s\n", ALERT_CHECK_RULES[r], error);
+               rc = -1;
+          }
+     }
+     if (rc == 0) {
+          uu_mutex_init(&engine->mutex);
+          uu_condvar_init(&engine->not_empty);
+          if (alert_check_run(engine, models, co2)) rc = -1;
+          uu_condvar_destroy(&engine->not_empty);
+          uu_mutex_destroy(&engine->mutex);
+     }
+     for (int r = 0; r < ALERT_CHECK_NUM_RULES; r++) {
+          free(models[r].seconds);
+          free(models[r].holds);
+     }
+     if (engine) {
+          for (int i = 0; i < engine->num_rules; i++) memory_free(engine->rules[i].history);
+     }
+     free(co2);
+     free(engine);
+     return rc;
+}
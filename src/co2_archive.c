@@ -0,0 +1,355 @@
+// Archives: outputs compacted into one compressed, indexed file
+//
+// co2 compact (see co2_compact.c) merges closed outputs, e.g. a month of
+// daily files, into an archive, which merge, report and extract read like
+// any output, so that a long range takes a handful of files rather than
+// thousands. Layout, little-endian:
+//
+//   magic CO2ARC1\n
+//   blocks: frames of the forwarder (see co2_forward.c), each of up to
+//      FORWARD_MAX_FRAME_READINGS readings in time order, 3 to 8 bytes a
+//      reading, with their own base time so each decodes alone
+//   index: per block, 32 bytes: i64 min time_unix_ns, i64 max time_unix_ns,
+//      u64 offset, u32 number of readings, u32 size
+//   sources: per output compacted into the archive: u64 size, u64 number of
+//      readings, u64 checksum, u16 path length, path
+//   footer, 48 bytes: u64 index offset, u64 sources offset, u32 number of
+//      blocks, u32 number of sources, u64 number of readings, u64 checksum,
+//      magic CO2AEND\n
+//
+// The checksum of a set of readings is the sum of archive_reading_hash of
+// each, whatever their order, so that the readings of outputs can be checked
+// against the archive they were merged into. The footer is written last: an
+// archive without one is torn, and is not read.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char const ARCHIVE_MAGIC[8] = { 'C', 'O', '2', 'A', 'R', 'C', '1', '\n' };
+static char const ARCHIVE_END_MAGIC[8] = { 'C', 'O', '2', 'A', 'E', 'N', 'D', '\n' };
+enum { ARCHIVE_INDEX_ENTRY_SIZE = 32 };
+enum { ARCHIVE_FOOTER_SIZE = 48 };
+enum { ARCHIVE_MAX_PATH = 1024 };
+
+typedef struct ArchiveBlock
+{
+     int64_t min_ns;
+     int64_t max_ns;
+     int64_t offset;
+     int num_readings;
+     int size;
+} ArchiveBlock;
+
+typedef struct ArchiveSource
+{
+     char path[ARCHIVE_MAX_PATH];
+     int64_t size;
+     uint64_t num_readings;
+     uint64_t checksum;
+} ArchiveSource;
+
+typedef struct Archive
+{
+     UU_FileMapping mapping; // data NULL when parsed from a caller's mapping
+     uint8_t const *data;
+     int64_t size;
+     uint8_t const *index;
+     int num_blocks;
+     uint8_t const *sources;
+     uint8_t const *sources_end;
+     int num_sources;
+     uint64_t num_readings;
+     uint64_t checksum;
+} Archive;
+
+typedef struct ArchiveWriter
+{
+     int fd;
+     int64_t offset; // of the next block
+     uint8_t *frame;
+     size_t frame_size;
+     int frame_readings;
+     ForwardCodec codec;
+     int64_t frame_min_ns;
+     int64_t frame_max_ns;
+     uint8_t *index;
+     size_t index_size;
+     size_t index_capacity;
+     uint8_t *sources;
+     size_t sources_size;
+     size_t sources_capacity;
+     int num_blocks;
+     int num_sources;
+     uint64_t num_readings;
+     uint64_t checksum;
+     int error;
+} ArchiveWriter;
+
+static uint64_t archive_mix(uint64_t value)
+{
+     value ^= value >> 30;
+     value *= 0xbf58476d1ce4e5b9ull;
+     value ^= value >> 27;
+     value *= 0x94d049bb133111ebull;
+     return value ^ (value >> 31);
+}
+
+uint64_t archive_reading_hash(Reading const *reading)
+{
+     uint32_t value;
+     memcpy(&value, &reading->co2_in_ppm, sizeof value);
+     uint64_t fields = (uint64_t)reading->kind << 56 | (uint64_t)reading->opcode << 48 | (uint64_t)reading->raw_value << 32 | value;
+     return archive_mix((uint64_t)reading->time_unix_ns + archive_mix(fields));
+}
+
+int archive_is_archive(void const *data, int64_t size)
+{
+     return size >= (int64_t)sizeof ARCHIVE_MAGIC && 0 == memcmp(data, ARCHIVE_MAGIC, sizeof ARCHIVE_MAGIC);
+}
+
+//
+// Writing
+//
+
+static int archive_append(uint8_t **buffer, size_t *size, size_t *capacity, void const *data, size_t n)
+{
+     if (*size + n > *capacity) {
+          size_t new_capacity = *capacity ? 2 * *capacity : 4096;
+          while (new_capacity < *size + n) new_capacity *= 2;
+          uint8_t *grown = realloc(*buffer, new_capacity);
+          if (!grown) return -1;
+          *buffer = grown;
+          *capacity = new_capacity;
+     }
+     memcpy(*buffer + *size, data, n);
+     *size += n;
+     return 0;
+}
+
+// Errors are reported on standard error.
+int archive_writer_open(ArchiveWriter *writer, char const *path)
+{
+     memset(writer, 0, sizeof *writer);
+     writer->frame = malloc(FORWARD_MAX_FRAME_SIZE);
+     writer->fd = uu_open_for_writing(path);
+     if (!writer->frame || writer->fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for writing.\n", path);
+          if (writer->fd >= 0) uu_close(writer->fd);
+          free(writer->frame);
+          return -1;
+     }
+     if (uu_write_all(writer->fd, ARCHIVE_MAGIC, sizeof ARCHIVE_MAGIC) != 0) writer->error = 1;
+     writer->offset = sizeof ARCHIVE_MAGIC;
+     return 0;
+}
+
+static void archive_writer_end_block(ArchiveWriter *writer)
+{
+     if (!writer->frame_readings) return;
+     memcpy(writer->frame, FORWARD_MAGIC, sizeof FORWARD_MAGIC);
+     binary_put_u32(writer->frame + 4, (uint32_t)writer->frame_readings);
+     binary_put_u32(writer->frame + 8, (uint32_t)(writer->frame_size - FORWARD_HEADER_SIZE));
+     uint8_t entry[ARCHIVE_INDEX_ENTRY_SIZE];
+     binary_put_u64(entry, (uint64_t)writer->frame_min_ns);
+     binary_put_u64(entry + 8, (uint64_t)writer->frame_max_ns);
+     binary_put_u64(entry + 16, (uint64_t)writer->offset);
+     binary_put_u32(entry + 24, (uint32_t)writer->frame_readings);
+     binary_put_u32(entry + 28, (uint32_t)writer->frame_size);
+     if (uu_write_all(writer->fd, writer->frame, writer->frame_size) != 0
+         || archive_append(&writer->index, &writer->index_size, &writer->index_capacity, entry, sizeof entry) != 0) {
+          writer->error = 1;
+     }
+     writer->offset += (int64_t)writer->frame_size;
+     writer->num_blocks++;
+     writer->frame_readings = 0;
+}
+
+void archive_writer_add(ArchiveWriter *writer, Reading const *reading)
+{
+     if (!writer->frame_readings) {
+          memset(&writer->codec, 0, sizeof writer->codec);
+          writer->codec.time_unix_ns = reading->time_unix_ns;
+          binary_put_u64(writer->frame + 12, (uint64_t)reading->time_unix_ns);
+          writer->frame_size = FORWARD_HEADER_SIZE;
+          writer->frame_min_ns = writer->frame_max_ns = reading->time_unix_ns;
+     }
+     writer->frame_size = forward_encode_reading(writer->frame + writer->frame_size, &writer->codec, reading) - writer->frame;
+     if (reading->time_unix_ns < writer->frame_min_ns) writer->frame_min_ns = reading->time_unix_ns;
+     if (reading->time_unix_ns > writer->frame_max_ns) writer->frame_max_ns = reading->time_unix_ns;
+     writer->num_readings++;
+     writer->checksum += archive_reading_hash(reading);
+     if (++writer->frame_readings == FORWARD_MAX_FRAME_READINGS) archive_writer_end_block(writer);
+}
+
+void archive_writer_add_source(ArchiveWriter *writer, ArchiveSource const *source)
+{
+     size_t length = strlen(source->path);
+     uint8_t header[26];
+     binary_put_u64(header, (uint64_t)source->size);
+     binary_put_u64(header + 8, source->num_readings);
+     binary_put_u64(header + 16, source->checksum);
+     binary_put_u16(header + 24, (uint16_t)length);
+     if (archive_append(&writer->sources, &writer->sources_size, &writer->sources_capacity, header, sizeof header) != 0
+         || archive_append(&writer->sources, &writer->sources_size, &writer->sources_capacity, source->path, length) != 0) {
+          writer->error = 1;
+     }
+     writer->num_sources++;
+}
+
+// Writes the last block, the index, the sources and the footer, and syncs
+// the file. Returns -1 when anything failed.
+int archive_writer_finish(ArchiveWriter *writer)
+{
+     archive_writer_end_block(writer);
+     uint8_t footer[ARCHIVE_FOOTER_SIZE];
+     int64_t index_offset = writer->offset;
+     int64_t sources_offset = index_offset + (int64_t)writer->index_size;
+     binary_put_u64(footer, (uint64_t)index_offset);
+     binary_put_u64(footer + 8, (uint64_t)sources_offset);
+     binary_put_u32(footer + 16, (uint32_t)writer->num_blocks);
+     binary_put_u32(footer + 20, (uint32_t)writer->num_sources);
+     binary_put_u64(footer + 24, writer->num_readings);
+     binary_put_u64(footer + 32, writer->checksum);
+     memcpy(footer + 40, ARCHIVE_END_MAGIC, sizeof ARCHIVE_END_MAGIC);
+     if (writer->error
+         || uu_write_all(writer->fd, writer->index, writer->index_size) != 0
+         || uu_write_all(writer->fd, writer->sources, writer->sources_size) != 0
+         || uu_write_all(writer->fd, footer, sizeof footer) != 0
+         || uu_sync_data(writer->fd) != 0) {
+          writer->error = 1;
+     }
+     uu_close(writer->fd);
+     free(writer->frame);
+     free(writer->index);
+     free(writer->sources);
+     return writer->error ? -1 : 0;
+}
+
+//
+// Reading
+//
+
+void archive_get_block(Archive const *archive, int i, ArchiveBlock *block)
+{
+     uint8_t const *entry = archive->index + (size_t)i * ARCHIVE_INDEX_ENTRY_SIZE;
+     block->min_ns = (int64_t)binary_get_u64(entry);
+     block->max_ns = (int64_t)binary_get_u64(entry + 8);
+     block->offset = (int64_t)binary_get_u64(entry + 16);
+     block->num_readings = (int)binary_get_u32(entry + 24);
+     block->size = (int)binary_get_u32(entry + 28);
+}
+
+// Checks the footer, the index and the sources of an archive in memory.
+// Errors are reported on standard error.
+int archive_parse(Archive *archive, void const *data, int64_t size, char const *path)
+{
+     memset(archive, 0, sizeof *archive);
+     archive->data = data;
+     archive->size = size;
+     uint8_t const *footer = archive->data + size - ARCHIVE_FOOTER_SIZE;
+     if (!archive_is_archive(data, size) || size < (int64_t)sizeof ARCHIVE_MAGIC + ARCHIVE_FOOTER_SIZE
+         || memcmp(footer + 40, ARCHIVE_END_MAGIC, sizeof ARCHIVE_END_MAGIC) != 0) {
+          fprintf(stderr, "ERROR: %s is not an archive, or a torn one\n", path);
+          return -1;
+     }
+     uint64_t index_offset = binary_get_u64(footer);
+     uint64_t sources_offset = binary_get_u64(footer + 8);
+     archive->num_blocks = (int)binary_get_u32(footer + 16);
+     archive->num_sources = (int)binary_get_u32(footer + 20);
+     archive->num_readings = binary_get_u64(footer + 24);
+     archive->checksum = binary_get_u64(footer + 32);
+     uint64_t footer_offset = (uint64_t)(size - ARCHIVE_FOOTER_SIZE);
+     if (archive->num_blocks < 0 || index_offset < sizeof ARCHIVE_MAGIC || index_offset > footer_offset
+         || sources_offset != index_offset + (uint64_t)archive->num_blocks * ARCHIVE_INDEX_ENTRY_SIZE
+         || sources_offset > footer_offset) {
+          fprintf(stderr, "ERROR: %s: corrupt archive footer\n", path);
+          return -1;
+     }
+     archive->index = archive->data + index_offset;
+     archive->sources = archive->data + sources_offset;
+     archive->sources_end = footer;
+     // the blocks follow each other up to the index
+     int64_t offset = sizeof ARCHIVE_MAGIC;
+     for (int i = 0; i < archive->num_blocks; i++) {
+          ArchiveBlock block;
+          archive_get_block(archive, i, &block);
+          if (block.offset != offset || block.size < FORWARD_HEADER_SIZE || block.offset + block.size > (int64_t)index_offset
+              || forward_frame_size(archive->data + block.offset) != block.size
+              || (int)binary_get_u32(archive->data + block.offset + 4) != block.num_readings) {
+               fprintf(stderr, "ERROR: %s: corrupt archive block %d\n", path, i);
+               return -1;
+          }
+          offset += block.size;
+     }
+     if (offset != (int64_t)index_offset) {
+          fprintf(stderr, "ERROR: %s: corrupt archive index\n", path);
+          return -1;
+     }
+     return 0;
+}
+
+int archive_open(Archive *archive, char const *path)
+{
+     UU_FileMapping mapping;
+     if (uu_map_file_for_reading(&mapping, path) != 0) {
+          fprintf(stderr, "ERROR: could not map %s (missing or empty?)\n", path);
+          return -1;
+     }
+     if (archive_parse(archive, mapping.data, mapping.size, path) != 0) {
+          uu_unmap_file(&mapping);
+          return -1;
+     }
+     archive->mapping = mapping;
+     return 0;
+}
+
+void archive_close(Archive *archive)
+{
+     if (archive->mapping.data) uu_unmap_file(&archive->mapping);
+}
+
+// Decodes block i into readings, at least FORWARD_MAX_FRAME_READINGS.
+// Returns their number, or -1 when corrupt.
+int archive_decode_block(Archive const *archive, int i, Reading *readings)
+{
+     ArchiveBlock block;
+     archive_get_block(archive, i, &block);
+     return forward_decode_frame(archive->data + block.offset, readings);
+}
+
+// First block whose readings may be at or after time_unix_ns
+int archive_find_block(Archive const *archive, int64_t time_unix_ns)
+{
+     int lo = 0, hi = archive->num_blocks;
+     while (lo < hi) {
+          int mid = lo + (hi - lo) / 2;
+          ArchiveBlock block;
+          archive_get_block(archive, mid, &block);
+          if (block.max_ns < time_unix_ns) {
+               lo = mid + 1;
+          } else {
+               hi = mid;
+          }
+     }
+     return lo;
+}
+
+// Reads the source at *cursor, from archive->sources on. Returns 0, or -1
+// at the end or when corrupt.
+int archive_next_source(Archive const *archive, uint8_t const **cursor, ArchiveSource *source)
+{
+     uint8_t const *p = *cursor;
+     if (archive->sources_end - p < 26) return -1;
+     source->size = (int64_t)binary_get_u64(p);
+     source->num_readings = binary_get_u64(p + 8);
+     source->checksum = binary_get_u64(p + 16);
+     size_t length = binary_get_u16(p + 24);
+     p += 26;
+     if (length >= sizeof source->path || (size_t)(archive->sources_end - p) < length) return -1;
+     memcpy(source->path, p, length);
+     source->path[length] = 0;
+     *cursor = p + length;
+     return 0;
+}
@@ -0,0 +1,485 @@
+// Arrow IPC streams of readings
+//
+// With --format arrow, readings are written as an Apache Arrow IPC stream,
+// which pyarrow, pandas and polars load column by column without parsing
+// (pyarrow.ipc.open_stream, polars.read_ipc_stream), from a memory map if
+// need be:
+//
+//   time     timestamp[ns, UTC]
+//   sensor   utf8: the host name of the reader, or the source given to merge
+//   channel  utf8: CO2, Temperature, ChecksumError or UnexpectedOpcode
+//   value    float64: the ppm or degrees, as the text formats print them, the
+//            raw value of an unexpected opcode, null for a checksum error
+//
+// A stream is a schema message, a record batch message per batch of rows,
+// and an end of stream marker. Messages are encoded here, without the Arrow
+// or Flatbuffers libraries. Each is the continuation marker 0xFFFFFFFF, the
+// size of its metadata, the metadata: a flatbuffer built front to back by
+// the arrow_flat helpers, and its body: the buffers of the columns, each
+// padded to 8 bytes.
+//
+// An ArrowBatch accumulates the rows of a batch in column buffers which are
+// already laid out as in the body, little-endian, so that writing a batch
+// is mostly copying them. Nothing is allocated once the batch is set up.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { ARROW_DEFAULT_BATCH_ROWS = 65536 };
+enum { ARROW_MAX_BATCH_ROWS = 1 << 22 };
+enum { ARROW_MAX_SENSOR = 128 }; // with the NUL
+enum { ARROW_MAX_SENSORS = 65535 };
+enum { ARROW_MAX_METADATA_SIZE = 1024 };
+enum { ARROW_NUM_COLUMNS = 4 };
+enum { ARROW_NUM_BUFFERS = 10 };
+enum { ARROW_MAX_CHANNEL = 16 }; // UnexpectedOpcode
+
+// From Schema.fbs and Message.fbs of the Arrow format
+enum { ARROW_METADATA_V5 = 4 };
+enum { ARROW_HEADER_SCHEMA = 1, ARROW_HEADER_RECORD_BATCH = 3 };
+enum { ARROW_TYPE_FLOATING_POINT = 3, ARROW_TYPE_UTF8 = 5, ARROW_TYPE_TIMESTAMP = 10 };
+enum { ARROW_UNIT_NANOSECOND = 3 };
+enum { ARROW_PRECISION_DOUBLE = 2 };
+
+typedef struct ArrowColumn
+{
+     char const *name;
+     uint8_t type;
+     uint16_t parameter; // unit of a timestamp, precision of a floating point
+     uint8_t nullable;
+} ArrowColumn;
+
+static ArrowColumn const ARROW_COLUMNS[ARROW_NUM_COLUMNS] = {
+     { "time", ARROW_TYPE_TIMESTAMP, ARROW_UNIT_NANOSECOND, 0 },
+     { "sensor", ARROW_TYPE_UTF8, 0, 0 },
+     { "channel", ARROW_TYPE_UTF8, 0, 0 },
+     { "value", ARROW_TYPE_FLOATING_POINT, ARROW_PRECISION_DOUBLE, 1 },
+};
+
+typedef struct ArrowSensor
+{
+     char name[ARROW_MAX_SENSOR];
+     int length;
+} ArrowSensor;
+
+typedef struct ArrowBatch
+{
+     int capacity; // rows
+     int num_rows;
+     int num_nulls; // of the values
+     int64_t first_row_ns; // uu_monotonic_ns when num_rows became non-zero
+     uint8_t *times; // i64 per row
+     uint8_t *values; // f64 per row
+     uint8_t *validity; // of the values, a bit per row
+     uint8_t *kinds;
+     uint16_t *sensor_ids;
+     size_t sensor_bytes; // of the rows so far
+     size_t channel_bytes;
+     ArrowSensor *sensors;
+     int num_sensors;
+} ArrowBatch;
+
+int arrow_batch_init(ArrowBatch *batch, int capacity)
+{
+     assert(capacity > 0 && capacity <= ARROW_MAX_BATCH_ROWS);
+     memset(batch, 0, sizeof *batch);
+     batch->capacity = capacity;
+     batch->times = memory_alloc(8 * (size_t)capacity);
+     batch->values = memory_alloc(8 * (size_t)capacity);
+     batch->validity = memory_calloc((size_t)capacity / 8 + 1, 1);
+     batch->kinds = memory_alloc((size_t)capacity);
+     batch->sensor_ids = memory_alloc(sizeof *batch->sensor_ids * (size_t)capacity);
+     return batch->times && batch->values && batch->validity && batch->kinds && batch->sensor_ids ? 0 : -1;
+}
+
+void arrow_batch_destroy(ArrowBatch *batch)
+{
+     memory_free(batch->times);
+     memory_free(batch->values);
+     memory_free(batch->validity);
+     memory_free(batch->kinds);
+     memory_free(batch->sensor_ids);
+     memory_free(batch->sensors);
+     memset(batch, 0, sizeof *batch);
+}
+
+// Returns the id of the sensor for arrow_batch_append, -1 on errors
+int arrow_batch_add_sensor(ArrowBatch *batch, char const *name, int length)
+{
+     if (length <= 0 || length >= ARROW_MAX_SENSOR || batch->num_sensors == ARROW_MAX_SENSORS) return -1;
+     ArrowSensor *sensors = memory_realloc(batch->sensors, (batch->num_sensors + 1) * sizeof *sensors);
+     if (!sensors) return -1;
+     batch->sensors = sensors;
+     ArrowSensor *sensor = &sensors[batch->num_sensors];
+     memcpy(sensor->name, name, length);
+     sensor->name[length] = 0;
+     sensor->length = length;
+     return batch->num_sensors++;
+}
+
+// The host name, for the readings of this machine
+void arrow_default_sensor(char *dst, size_t size)
+{
+     char const *name = NULL;
+#if defined(WIN32)
+     name = getenv("COMPUTERNAME");
+#else
+     char host_name[256];
+     if (gethostname(host_name, sizeof host_name - 1) == 0) {
+          host_name[sizeof host_name - 1] = 0;
+          name = host_name;
+     }
+#endif
+     if (!name || !*name) name = "co2";
+     size_t length = strlen(name) < size ? strlen(name) : size - 1;
+     memcpy(dst, name, length);
+     dst[length] = 0;
+}
+
+// The value column: the ppm, the degrees as the text formats print them,
+// the raw value of an unexpected opcode. Returns 0 for none.
+int arrow_reading_value(Reading const *reading, double *value)
+{
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          *value = reading->co2_in_ppm;
+          return 1;
+     case ReadingKind_Temperature: {
+          // 21.1, not the 21.100000381 of the float
+          double micro_degrees = reading->temperature_in_C * 1e6;
+          *value = (double)(int64_t)(micro_degrees + (micro_degrees < 0 ? -0.5 : 0.5)) / 1e6;
+          return 1;
+     }
+     case ReadingKind_UnexpectedOpcode:
+          *value = reading->raw_value;
+          return 1;
+     default:
+          *value = 0;
+          return 0;
+     }
+}
+
+void arrow_batch_append(ArrowBatch *batch, Reading const *reading, int sensor_id)
+{
+     assert(batch->num_rows < batch->capacity && sensor_id < batch->num_sensors);
+     int i = batch->num_rows++;
+     if (i == 0) batch->first_row_ns = uu_monotonic_ns();
+     binary_put_u64(&batch->times[8 * (size_t)i], (uint64_t)reading->time_unix_ns);
+     double value;
+     int valid = arrow_reading_value(reading, &value);
+     uint64_t bits;
+     memcpy(&bits, &value, sizeof bits);
+     binary_put_u64(&batch->values[8 * (size_t)i], bits);
+     uint8_t bit = (uint8_t)(1 << (i % 8));
+     if (valid) {
+          batch->validity[i / 8] |= bit;
+     } else {
+          batch->validity[i / 8] &= (uint8_t)~bit;
+          batch->num_nulls++;
+     }
+     batch->kinds[i] = reading->kind;
+     batch->sensor_ids[i] = (uint16_t)sensor_id;
+     batch->sensor_bytes += batch->sensors[sensor_id].length;
+     batch->channel_bytes += strlen(READING_KIND_NAMES[reading->kind]);
+}
+
+static size_t arrow_pad(size_t size)
+{
+     return (size + 7) & ~(size_t)7;
+}
+
+static size_t arrow_body_size(int num_rows, size_t sensor_bytes, size_t channel_bytes)
+{
+     size_t n = (size_t)num_rows;
+     return arrow_pad(8 * n) + 2 * arrow_pad(4 * (n + 1)) + arrow_pad(sensor_bytes) + arrow_pad(channel_bytes)
+          + arrow_pad(n / 8 + 1) + arrow_pad(8 * n);
+}
+
+// Upper bound of the size of a record batch message of num_rows rows, with
+// sensor names of at most sensor_length bytes
+size_t arrow_max_message_size(int num_rows, int sensor_length)
+{
+     return 8 + ARROW_MAX_METADATA_SIZE + arrow_body_size(num_rows, (size_t)num_rows * sensor_length, (size_t)num_rows * ARROW_MAX_CHANNEL);
+}
+
+// Upper bound of the size of the message of the rows so far
+size_t arrow_batch_size(ArrowBatch const *batch)
+{
+     return 8 + ARROW_MAX_METADATA_SIZE + arrow_body_size(batch->num_rows, batch->sensor_bytes, batch->channel_bytes);
+}
+
+//
+// Flatbuffers, built front to back: a table is written before what it
+// points to, its offsets being set by arrow_flat_link once that is written,
+// and after its vtable.
+//
+
+typedef struct ArrowFlat
+{
+     uint8_t *base;
+     size_t size;
+} ArrowFlat;
+
+typedef struct ArrowFlatField
+{
+     int size; // 1, 2, 4 or 8 bytes, 0 when absent; offsets are 4 bytes
+     uint64_t value;
+     size_t position; // set by arrow_flat_table
+} ArrowFlatField;
+
+static size_t arrow_flat_align(ArrowFlat *flat, size_t alignment)
+{
+     while (flat->size % alignment) flat->base[flat->size++] = 0;
+     return flat->size;
+}
+
+static void arrow_flat_link(ArrowFlat *flat, size_t position, size_t target)
+{
+     assert(target > position);
+     binary_put_u32(&flat->base[position], (uint32_t)(target - position));
+}
+
+// Returns the position of the table
+static size_t arrow_flat_table(ArrowFlat *flat, ArrowFlatField *fields, int num_fields)
+{
+     size_t vtable = arrow_flat_align(flat, 2);
+     flat->size += 4 + 2 * (size_t)num_fields;
+     size_t table = arrow_flat_align(flat, 8);
+     flat->size += 4;
+     for (int i = 0; i < num_fields; i++) {
+          ArrowFlatField *field = &fields[i];
+          if (!field->size) continue;
+          field->position = arrow_flat_align(flat, field->size);
+          uint8_t *dst = &flat->base[field->position];
+          switch (field->size) {
+          case 1: *dst = (uint8_t)field->value; break;
+          case 2: binary_put_u16(dst, (uint16_t)field->value); break;
+          case 4: binary_put_u32(dst, (uint32_t)field->value); break;
+          case 8: binary_put_u64(dst, field->value); break;
+          default: assert(0);
+          }
+          flat->size += field->size;
+     }
+     binary_put_u16(&flat->base[vtable], (uint16_t)(4 + 2 * num_fields));
+     binary_put_u16(&flat->base[vtable + 2], (uint16_t)(flat->size - table));
+     for (int i = 0; i < num_fields; i++) {
+          binary_put_u16(&flat->base[vtable + 4 + 2 * i], (uint16_t)(fields[i].size ? fields[i].position - table : 0));
+     }
+     binary_put_u32(&flat->base[table], (uint32_t)(table - vtable));
+     return table;
+}
+
+// Returns the position of the vector, its elements following its length,
+// zeroed
+static size_t arrow_flat_vector(ArrowFlat *flat, uint32_t count, size_t element_size, size_t alignment)
+{
+     arrow_flat_align(flat, 4);
+     while ((flat->size + 4) % alignment) flat->base[flat->size++] = 0;
+     size_t vector = flat->size;
+     binary_put_u32(&flat->base[vector], count);
+     memset(&flat->base[vector + 4], 0, count * element_size);
+     flat->size += 4 + count * element_size;
+     return vector;
+}
+
+static size_t arrow_flat_string(ArrowFlat *flat, char const *text)
+{
+     size_t string = arrow_flat_align(flat, 4);
+     size_t length = strlen(text);
+     binary_put_u32(&flat->base[string], (uint32_t)length);
+     memcpy(&flat->base[string + 4], text, length + 1);
+     flat->size += 4 + length + 1;
+     return string;
+}
+
+// Starts the flatbuffer of a Message: returns the position of the offset to
+// its header
+static size_t arrow_flat_message(ArrowFlat *flat, int header_type, int64_t body_length)
+{
+     flat->size = 4; // offset to the root table
+     ArrowFlatField message[4] = {
+          { .size = 2, .value = ARROW_METADATA_V5 },
+          { .size = 1, .value = (uint64_t)header_type },
+          { .size = 4, .value = 0 }, // header
+          { .size = 8, .value = (uint64_t)body_length },
+     };
+     binary_put_u32(flat->base, (uint32_t)arrow_flat_table(flat, message, 4));
+     return message[2].position;
+}
+
+// Frames the metadata built at dst + 8: returns the end of the message
+// without its body
+static char *arrow_end_metadata(char *dst, ArrowFlat *flat)
+{
+     arrow_flat_align(flat, 8);
+     assert(flat->size <= ARROW_MAX_METADATA_SIZE);
+     binary_put_u32((uint8_t *)dst, 0xFFFFFFFF);
+     binary_put_u32((uint8_t *)dst + 4, (uint32_t)flat->size);
+     return dst + 8 + flat->size;
+}
+
+// Body length of a Message, -1 if it is not one
+static int64_t arrow_flat_body_length(uint8_t const *flat, size_t size)
+{
+     if (size < 8) return -1;
+     size_t table = binary_get_u32(flat);
+     if (table + 4 > size) return -1;
+     int64_t vtable = (int64_t)table - (int32_t)binary_get_u32(&flat[table]);
+     if (vtable < 0 || (size_t)vtable + 12 > size) return -1;
+     uint16_t vtable_size = binary_get_u16(&flat[vtable]);
+     uint16_t field = vtable_size >= 12 ? binary_get_u16(&flat[vtable + 10]) : 0;
+     if (!field) return 0;
+     if (table + field + 8 > size) return -1;
+     return (int64_t)binary_get_u64(&flat[table + field]);
+}
+
+//
+// Messages
+//
+
+// Writes the schema message, at most 8 + ARROW_MAX_METADATA_SIZE bytes
+char *arrow_write_schema(char *dst)
+{
+     ArrowFlat flat = { (uint8_t *)dst + 8, 0 };
+     size_t header = arrow_flat_message(&flat, ARROW_HEADER_SCHEMA, 0);
+     ArrowFlatField schema[2] = { { .size = 2, .value = 0 }, { .size = 4, .value = 0 } }; // little-endian, fields
+     arrow_flat_link(&flat, header, arrow_flat_table(&flat, schema, 2));
+     size_t fields = arrow_flat_vector(&flat, ARROW_NUM_COLUMNS, 4, 4);
+     arrow_flat_link(&flat, schema[1].position, fields);
+     for (int i = 0; i < ARROW_NUM_COLUMNS; i++) {
+          ArrowColumn const *column = &ARROW_COLUMNS[i];
+          ArrowFlatField field[6] = {
+               { .size = 4, .value = 0 }, // name
+               { .size = 1, .value = column->nullable },
+               { .size = 1, .value = column->type },
+               { .size = 4, .value = 0 }, // type
+               { .size = 0 }, // dictionary
+               { .size = 4, .value = 0 }, // children
+          };
+          arrow_flat_link(&flat, fields + 4 + 4 * i, arrow_flat_table(&flat, field, 6));
+          arrow_flat_link(&flat, field[0].position, arrow_flat_string(&flat, column->name));
+          // Timestamp { unit, timezone }, FloatingPoint { precision }, Utf8 {}
+          ArrowFlatField type[2] = { { .size = 2, .value = column->parameter }, { .size = 4, .value = 0 } };
+          int num_type_fields = column->type == ARROW_TYPE_TIMESTAMP ? 2 : column->type == ARROW_TYPE_FLOATING_POINT ? 1 : 0;
+          arrow_flat_link(&flat, field[3].position, arrow_flat_table(&flat, type, num_type_fields));
+          if (column->type == ARROW_TYPE_TIMESTAMP) arrow_flat_link(&flat, type[1].position, arrow_flat_string(&flat, "UTC"));
+          arrow_flat_link(&flat, field[5].position, arrow_flat_vector(&flat, 0, 4, 4));
+     }
+     return arrow_end_metadata(dst, &flat);
+}
+
+// Writes the rows of batch as a record batch message, of at most
+// arrow_batch_size bytes, and starts the next batch
+char *arrow_write_batch(char *dst, ArrowBatch *batch)
+{
+     size_t n = (size_t)batch->num_rows;
+     // the buffers of the columns in schema order: validity bitmaps are
+     // omitted without nulls
+     size_t lengths[ARROW_NUM_BUFFERS] = {
+          0, 8 * n, // time
+          0, 4 * (n + 1), batch->sensor_bytes, // sensor
+          0, 4 * (n + 1), batch->channel_bytes, // channel
+          batch->num_nulls ? (n + 7) / 8 : 0, 8 * n, // value
+     };
+     size_t offsets[ARROW_NUM_BUFFERS];
+     size_t body_length = 0;
+     for (int i = 0; i < ARROW_NUM_BUFFERS; i++) {
+          offsets[i] = body_length;
+          body_length += arrow_pad(lengths[i]);
+     }
+
+     ArrowFlat flat = { (uint8_t *)dst + 8, 0 };
+     size_t header = arrow_flat_message(&flat, ARROW_HEADER_RECORD_BATCH, (int64_t)body_length);
+     ArrowFlatField record_batch[3] = { { .size = 8, .value = n }, { .size = 4, .value = 0 }, { .size = 4, .value = 0 } }; // length, nodes, buffers
+     arrow_flat_link(&flat, header, arrow_flat_table(&flat, record_batch, 3));
+     size_t nodes = arrow_flat_vector(&flat, ARROW_NUM_COLUMNS, 16, 8);
+     arrow_flat_link(&flat, record_batch[1].position, nodes);
+     for (int i = 0; i < ARROW_NUM_COLUMNS; i++) {
+          binary_put_u64(&flat.base[nodes + 4 + 16 * i], n);
+          binary_put_u64(&flat.base[nodes + 4 + 16 * i + 8], i == 3 ? (uint64_t)batch->num_nulls : 0);
+     }
+     size_t buffers = arrow_flat_vector(&flat, ARROW_NUM_BUFFERS, 16, 8);
+     arrow_flat_link(&flat, record_batch[2].position, buffers);
+     for (int i = 0; i < ARROW_NUM_BUFFERS; i++) {
+          binary_put_u64(&flat.base[buffers + 4 + 16 * i], offsets[i]);
+          binary_put_u64(&flat.base[buffers + 4 + 16 * i + 8], lengths[i]);
+     }
+
+     uint8_t *body = (uint8_t *)arrow_end_metadata(dst, &flat);
+     memset(body, 0, body_length); // the padding
+     memcpy(&body[offsets[1]], batch->times, 8 * n);
+     uint8_t *sensor_offsets = &body[offsets[3]];
+     uint8_t *sensor_data = &body[offsets[4]];
+     uint8_t *channel_offsets = &body[offsets[6]];
+     uint8_t *channel_data = &body[offsets[7]];
+     uint32_t sensor_end = 0;
+     uint32_t channel_end = 0;
+     binary_put_u32(sensor_offsets, 0);
+     binary_put_u32(channel_offsets, 0);
+     for (size_t i = 0; i < n; i++) {
+          ArrowSensor const *sensor = &batch->sensors[batch->sensor_ids[i]];
+          memcpy(&sensor_data[sensor_end], sensor->name, sensor->length);
+          sensor_end += sensor->length;
+          binary_put_u32(&sensor_offsets[4 * (i + 1)], sensor_end);
+          char const *channel = READING_KIND_NAMES[batch->kinds[i]];
+          size_t channel_length = strlen(channel);
+          memcpy(&channel_data[channel_end], channel, channel_length);
+          channel_end += (uint32_t)channel_length;
+          binary_put_u32(&channel_offsets[4 * (i + 1)], channel_end);
+     }
+     memcpy(&body[offsets[8]], batch->validity, lengths[8]);
+     memcpy(&body[offsets[9]], batch->values, 8 * n);
+
+     batch->num_rows = 0;
+     batch->num_nulls = 0;
+     batch->sensor_bytes = 0;
+     batch->channel_bytes = 0;
+     return (char *)body + body_length;
+}
+
+// Writes the end of stream marker, 8 bytes
+char *arrow_write_end(char *dst)
+{
+     binary_put_u32((uint8_t *)dst, 0xFFFFFFFF);
+     binary_put_u32((uint8_t *)dst + 4, 0);
+     return dst + 8;
+}
+
+// Crash recovery for a stream that is appended to: keeps its complete
+// messages, without its end of stream marker, which is written again when
+// the stream is closed. Returns the size of the file that is kept, 0 meaning
+// the schema must be written again, or -1 on errors and for files that are
+// not a stream of readings.
+int64_t arrow_recover_tail(int fd)
+{
+     int64_t size = uu_file_size(fd);
+     if (size < 0) return -1;
+     char schema[8 + ARROW_MAX_METADATA_SIZE];
+     int64_t schema_size = arrow_write_schema(schema) - schema;
+     uint8_t message[8 + ARROW_MAX_METADATA_SIZE];
+     int64_t keep = 0;
+     if (size > 0) {
+          // a torn schema is written again
+          int64_t n = size < schema_size ? size : schema_size;
+          if (uu_seek(fd, 0) != 0 || uu_read_full(fd, message, n) != n || memcmp(message, schema, n) != 0) return -1;
+          if (n == schema_size) keep = schema_size;
+     }
+     while (keep > 0 && keep + 8 <= size) {
+          if (uu_seek(fd, keep) != 0 || uu_read_full(fd, message, 8) != 8) return -1;
+          uint32_t metadata_size = binary_get_u32(&message[4]);
+          if (binary_get_u32(message) != 0xFFFFFFFF || metadata_size == 0 || metadata_size > ARROW_MAX_METADATA_SIZE
+              || keep + 8 + metadata_size > size) {
+               break;
+          }
+          if (uu_read_full(fd, &message[8], metadata_size) != metadata_size) return -1;
+          int64_t body_length = arrow_flat_body_length(&message[8], metadata_size);
+          if (body_length < 0 || body_length > size - keep - 8 - metadata_size) break;
+          keep += 8 + metadata_size + body_length;
+     }
+     if (keep != size && uu_truncate(fd, keep) != 0) return -1;
+     if (uu_seek(fd, keep) != 0) return -1;
+     return keep;
+}
@@ -0,0 +1,497 @@
+// Collector daemon: the readings of many forwarders, a file per sensor
+//
+// collectd accepts the connections of fwd: targets (see Forwarder), hundreds
+// of them, on one thread with epoll. Frames are decoded as they arrive and
+// appended to the buffer of their sensor, named by the hello of the
+// connection and stored in <dir>/<name>.<format>. Every commit interval, the
+// sensors that received readings are written out, each in one write synced
+// with --sync, and only then are their frames acknowledged: a group commit,
+// one write and one sync per sensor for every frame of the interval, and no
+// acknowledgement of what a crash could lose.
+//
+// Sensor files are appended to, after cutting off a record torn by a crash,
+// so a restarted daemon continues them. Not on Windows nor macOS (epoll).
+//
+// collectd-load simulates readers: forwarders sending the synthetic stream
+// of the benchmark at a given rate, all from one thread.
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+enum { COLLECTD_MAX_CONNECTIONS = 4096 };
+enum { COLLECTD_MAX_SENSORS = 4096 };
+enum { COLLECTD_SENSOR_BUFFER_SIZE = 64 * 1024 };
+enum { COLLECTD_MAX_EVENTS = 256 };
+enum { COLLECTD_READS_PER_EVENT = 4 }; // then the other connections get their turn
+enum { COLLECTD_LOAD_TICK_MS = 100 };
+enum { COLLECTD_LOAD_MAX_RATE = 1000000 }; // readings/s of each reader
+enum { COLLECTD_LOAD_MAX_SECONDS = 86400 };
+
+typedef struct CollectdConfig
+{
+     char const *address; // [host:]port
+     char const *dir;
+     OutputSerializer const *serializer;
+     OutputSync sync;
+     int commit_interval_ms;
+     int stats_interval_seconds; // 0 for none
+} CollectdConfig;
+
+typedef struct CollectdSensor
+{
+     char name[FORWARD_MAX_NAME];
+     OutputWriter writer;
+     int fd;
+     int dirty; // readings not written yet
+     int failed; // its file could not be cut back after a failed write
+     int64_t committed_offset; // end of what was written and acknowledged
+     uint64_t readings;
+} CollectdSensor;
+
+typedef struct CollectdConnection
+{
+     int fd; // -1 when free
+     char peer[64];
+     CollectdSensor *sensor; // once the hello arrived
+     uint8_t *buffer; // FORWARD_MAX_FRAME_SIZE
+     size_t used;
+     uint64_t frames;
+     uint64_t frames_acked;
+     uint64_t readings;
+     uint64_t stats_previous_readings;
+     int64_t latest_time_unix_ns; // of the readings, for the lag
+} CollectdConnection;
+
+typedef struct Collectd
+{
+     CollectdConfig config;
+     int epoll_fd;
+     int listen_fd;
+     CollectdConnection *connections;
+     int num_connections; // slots in use or freed
+     CollectdSensor *sensors;
+     int num_sensors;
+     CollectdSensor **dirty_sensors;
+     int num_dirty_sensors;
+     Reading *readings; // of a frame
+
+     uint64_t frames;
+     uint64_t total_readings;
+     uint64_t stats_previous_readings;
+     uint64_t commits;
+     int64_t commit_ns_total;
+     int64_t commit_ns_max;
+} Collectd;
+
+#if defined(__linux__)
+
+static volatile sig_atomic_t collectd_stop_requested = 0;
+
+static void collectd_request_stop(int signal_number)
+{
+     (void)signal_number;
+     collectd_stop_requested = 1;
+}
+
+static CollectdSensor *collectd_find_sensor(Collectd *collectd, char const *name)
+{
+     for (int i = 0; i < collectd->num_sensors; i++) {
+          if (0 == strcmp(collectd->sensors[i].name, name)) return &collectd->sensors[i];
+     }
+     if (collectd->num_sensors == COLLECTD_MAX_SENSORS) return NULL;
+     CollectdSensor *sensor = &collectd->sensors[collectd->num_sensors];
+     memset(sensor, 0, sizeof *sensor);
+     snprintf(sensor->name, sizeof sensor->name, "%s", name);
+     char path[1024];
+     snprintf(path, sizeof path, "%s/%s.%s", collectd->config.dir, name, collectd->config.serializer->name);
+     OutputSync sync = collectd->config.sync;
+     sensor->fd = uu_open_for_updating(path, sync == OutputSync_OpenDataSync);
+     int64_t kept = sensor->fd >= 0 ? output_recover_tail(sensor->fd, collectd->config.serializer) : -1;
+     if (kept < 0 || output_writer_init(&sensor->writer, sensor->fd, collectd->config.serializer, COLLECTD_SENSOR_BUFFER_SIZE) != 0) {
+          fprintf(stderr, "ERROR: could not open %s for appending.\n", path);
+          if (sensor->fd >= 0) uu_close(sensor->fd);
+          return NULL;
+     }
+     output_writer_set_sync(&sensor->writer, sync, kept);
+     if (kept == 0) output_writer_header(&sensor->writer);
+     sensor->committed_offset = kept;
+     collectd->num_sensors++;
+     return sensor;
+}
+
+// Sensor names become file names: anything but letters, digits, - and _ is
+// replaced by _
+static void collectd_sanitize_name(char *name)
+{
+     for (char *p = name; *p; p++) {
+          if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '-' || *p == '_')) {
+               *p = '_';
+          }
+     }
+}
+
+static void collectd_close_connection(Collectd *collectd, CollectdConnection *connection, char const *reason)
+{
+     fprintf(stderr, "collectd\t%s %s %s after %llu frames, %llu readings\n", connection->peer,
+             connection->sensor ? connection->sensor->name : "-", reason,
+             (unsigned long long)connection->frames, (unsigned long long)connection->readings);
+     epoll_ctl(collectd->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+     close(connection->fd);
+     connection->fd = -1;
+     free(connection->buffer);
+     connection->buffer = NULL;
+}
+
+// Handles the frame at the start of the connection's buffer. Returns -1 when
+// the connection must be closed.
+static int collectd_handle_frame(Collectd *collectd, CollectdConnection *connection, uint8_t const *frame)
+{
+     if (forward_is_hello(frame)) {
+          char name[FORWARD_MAX_NAME];
+          uint32_t name_size = binary_get_u32(frame + 8);
+          memcpy(name, frame + FORWARD_HEADER_SIZE, name_size);
+          name[name_size] = 0;
+          collectd_sanitize_name(name);
+          if (!name[0]) return -1;
+          connection->sensor = collectd_find_sensor(collectd, name);
+          return connection->sensor && !connection->sensor->failed ? 0 : -1;
+     }
+     CollectdSensor *sensor = connection->sensor;
+     if (!sensor) return -1;
+     int n = forward_decode_frame(frame, collectd->readings);
+     if (n < 0) return -1;
+     for (int i = 0; i < n; i++) output_writer_append(&sensor->writer, &collectd->readings[i]);
+     if (n) connection->latest_time_unix_ns = collectd->readings[n - 1].time_unix_ns;
+     if (!sensor->dirty) {
+          sensor->dirty = 1;
+          collectd->dirty_sensors[collectd->num_dirty_sensors++] = sensor;
+     }
+     sensor->readings += n;
+     connection->frames++;
+     connection->readings += n;
+     collectd->frames++;
+     collectd->total_readings += n;
+     return 0;
+}
+
+static void collectd_read(Collectd *collectd, CollectdConnection *connection)
+{
+     for (int i = 0; i < COLLECTD_READS_PER_EVENT; i++) {
+          ssize_t n = read(connection->fd, connection->buffer + connection->used, FORWARD_MAX_FRAME_SIZE - connection->used);
+          if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) {
+               collectd_close_connection(collectd, connection, n == 0 ? "closed" : "failed");
+               return;
+          }
+          connection->used += n;
+          size_t begin = 0;
+          while (connection->used - begin >= FORWARD_HEADER_SIZE) {
+               uint8_t const *frame = connection->buffer + begin;
+               int64_t size = forward_frame_size(frame);
+               if (size < 0) {
+                    collectd_close_connection(collectd, connection, "sent a corrupt frame");
+                    return;
+               }
+               if ((int64_t)(connection->used - begin) < size) break;
+               if (collectd_handle_frame(collectd, connection, frame) != 0) {
+                    collectd_close_connection(collectd, connection, "sent a corrupt frame or no hello");
+                    return;
+               }
+               begin += size;
+          }
+          memmove(connection->buffer, connection->buffer + begin, connection->used - begin);
+          connection->used -= begin;
+     }
+}
+
+static void collectd_accept(Collectd *collectd)
+{
+     for (;;) {
+          struct sockaddr_storage address;
+          socklen_t address_size = sizeof address;
+          int fd = accept(collectd->listen_fd, (struct sockaddr *)&address, &address_size);
+          if (fd < 0) {
+               if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) fprintf(stderr, "ERROR: could not accept a connection\n");
+               return;
+          }
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+          CollectdConnection *connection = NULL;
+          for (int i = 0; i < collectd->num_connections && !connection; i++) {
+               if (collectd->connections[i].fd < 0) connection = &collectd->connections[i];
+          }
+          if (!connection && collectd->num_connections < COLLECTD_MAX_CONNECTIONS) {
+               connection = &collectd->connections[collectd->num_connections++];
+          }
+          uint8_t *buffer = connection ? malloc(FORWARD_MAX_FRAME_SIZE) : NULL;
+          if (!buffer) {
+               fprintf(stderr, "ERROR: too many connections, refused one\n");
+               close(fd);
+               continue;
+          }
+          memset(connection, 0, sizeof *connection);
+          connection->fd = fd;
+          connection->buffer = buffer;
+          char host[48], port[16];
+          if (getnameinfo((struct sockaddr *)&address, address_size, host, sizeof host, port, sizeof port, NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+               snprintf(host, sizeof host, "?");
+               snprintf(port, sizeof port, "?");
+          }
+          snprintf(connection->peer, sizeof connection->peer, "%s:%s", host, port);
+          struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+          if (epoll_ctl(collectd->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+               collectd_close_connection(collectd, connection, "failed");
+          }
+     }
+}
+
+// A sensor whose readings could not be written: its connections are closed
+// without acknowledging them, so that its forwarders spool and send again
+// once they reconnect, and its file is cut back to what was acknowledged.
+// The other sensors are not affected.
+static void collectd_fail_sensor(Collectd *collectd, CollectdSensor *sensor)
+{
+     for (int i = 0; i < collectd->num_connections; i++) {
+          CollectdConnection *connection = &collectd->connections[i];
+          if (connection->fd >= 0 && connection->sensor == sensor) collectd_close_connection(collectd, connection, "could not be written");
+     }
+     if (output_writer_rewind(&sensor->writer, sensor->committed_offset) != 0) {
+          fprintf(stderr, "ERROR: could not cut back the file of %s, refusing its readings\n", sensor->name);
+          sensor->failed = 1;
+     }
+}
+
+// Writes out the sensors that received readings, then acknowledges what
+// they received
+static void collectd_commit(Collectd *collectd)
+{
+     if (collectd->num_dirty_sensors) {
+          int64_t start_ns = uu_monotonic_ns();
+          for (int i = 0; i < collectd->num_dirty_sensors; i++) {
+               CollectdSensor *sensor = collectd->dirty_sensors[i];
+               sensor->dirty = 0;
+               if (output_writer_flush(&sensor->writer) != 0) {
+                    fprintf(stderr, "ERROR: could not write the readings of %s\n", sensor->name);
+                    collectd_fail_sensor(collectd, sensor);
+               } else {
+                    sensor->committed_offset = sensor->writer.buffer.file_offset;
+               }
+          }
+          collectd->num_dirty_sensors = 0;
+          int64_t commit_ns = uu_monotonic_ns() - start_ns;
+          collectd->commits++;
+          collectd->commit_ns_total += commit_ns;
+          if (commit_ns > collectd->commit_ns_max) collectd->commit_ns_max = commit_ns;
+     }
+     for (int i = 0; i < collectd->num_connections; i++) {
+          CollectdConnection *connection = &collectd->connections[i];
+          if (connection->fd < 0 || connection->frames == connection->frames_acked) continue;
+          // acknowledgements are cumulative: the latest count is enough
+          uint8_t ack[8];
+          binary_put_u64(ack, connection->frames);
+          ssize_t n = send(connection->fd, ack, sizeof ack, MSG_DONTWAIT | MSG_NOSIGNAL);
+          if (n == (ssize_t)sizeof ack) {
+               connection->frames_acked = connection->frames;
+          } else if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+               collectd_close_connection(collectd, connection, "failed");
+          }
+     }
+}
+
+static void collectd_print_stats(Collectd *collectd, double elapsed_seconds)
+{
+     int64_t now_unix_ns = (int64_t)time(NULL) * NS_PER_SECOND;
+     int num_open = 0;
+     for (int i = 0; i < collectd->num_connections; i++) {
+          CollectdConnection *connection = &collectd->connections[i];
+          if (connection->fd < 0) continue;
+          num_open++;
+          fprintf(stderr, "connection %s %s\tframes=%llu readings=%llu readings/s=%.0f unacked=%llu lag_ms=%lld\n",
+                  connection->peer, connection->sensor ? connection->sensor->name : "-",
+                  (unsigned long long)connection->frames, (unsigned long long)connection->readings,
+                  (connection->readings - connection->stats_previous_readings) / elapsed_seconds,
+                  (unsigned long long)(connection->frames - connection->frames_acked),
+                  connection->latest_time_unix_ns ? (long long)((now_unix_ns - connection->latest_time_unix_ns) / 1000000) : -1LL);
+          connection->stats_previous_readings = connection->readings;
+     }
+     fprintf(stderr, "collectd\tconnections=%d sensors=%d frames=%llu readings=%llu readings/s=%.0f commits=%llu commit_avg_us=%.0f commit_max_us=%.0f\n",
+             num_open, collectd->num_sensors, (unsigned long long)collectd->frames,
+             (unsigned long long)collectd->total_readings,
+             (collectd->total_readings - collectd->stats_previous_readings) / elapsed_seconds,
+             (unsigned long long)collectd->commits,
+             collectd->commits ? collectd->commit_ns_total / 1e3 / collectd->commits : 0.0,
+             collectd->commit_ns_max / 1e3);
+     collectd->stats_previous_readings = collectd->total_readings;
+}
+
+#endif
+
+// Runs the daemon until SIGINT or SIGTERM. Errors are reported on standard
+// error.
+int collectd_run(CollectdConfig const *config)
+{
+#if !defined(__linux__)
+     (void)config;
+     fprintf(stderr, "ERROR: collectd needs epoll, only on Linux\n");
+     return -1;
+#else
+     Collectd collectd = { .config = *config };
+     collectd.connections = calloc(COLLECTD_MAX_CONNECTIONS, sizeof *collectd.connections);
+     collectd.sensors = calloc(COLLECTD_MAX_SENSORS, sizeof *collectd.sensors);
+     collectd.dirty_sensors = calloc(COLLECTD_MAX_SENSORS, sizeof *collectd.dirty_sensors);
+     collectd.readings = malloc(FORWARD_MAX_FRAME_READINGS * sizeof *collectd.readings);
+     if (!collectd.connections || !collectd.sensors || !collectd.dirty_sensors || !collectd.readings) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          return -1;
+     }
+     collectd.listen_fd = forward_listen(config->address);
+     if (collectd.listen_fd < 0) {
+          fprintf(stderr, "ERROR: could not listen on %s\n", config->address);
+          return -1;
+     }
+     fcntl(collectd.listen_fd, F_SETFL, fcntl(collectd.listen_fd, F_GETFL) | O_NONBLOCK);
+     collectd.epoll_fd = epoll_create1(0);
+     struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL };
+     if (collectd.epoll_fd < 0 || epoll_ctl(collectd.epoll_fd, EPOLL_CTL_ADD, collectd.listen_fd, &listen_event) != 0) {
+          fprintf(stderr, "ERROR: could not set up epoll\n");
+          return -1;
+     }
+     signal(SIGPIPE, SIG_IGN);
+     signal(SIGINT, collectd_request_stop);
+     signal(SIGTERM, collectd_request_stop);
+
+     int64_t commit_interval_ns = (int64_t)config->commit_interval_ms * 1000000;
+     int64_t stats_interval_ns = (int64_t)config->stats_interval_seconds * NS_PER_SECOND;
+     int64_t next_commit_ns = uu_monotonic_ns() + commit_interval_ns;
+     int64_t stats_previous_ns = uu_monotonic_ns();
+     struct epoll_event events[COLLECTD_MAX_EVENTS];
+     while (!collectd_stop_requested) {
+          int64_t now_ns = uu_monotonic_ns();
+          int timeout_ms = next_commit_ns > now_ns ? (int)((next_commit_ns - now_ns + 999999) / 1000000) : 0;
+          int n = epoll_wait(collectd.epoll_fd, events, COLLECTD_MAX_EVENTS, timeout_ms);
+          if (n < 0 && errno != EINTR) {
+               fprintf(stderr, "ERROR: epoll_wait failed\n");
+               break;
+          }
+          for (int i = 0; i < n; i++) {
+               CollectdConnection *connection = events[i].data.ptr;
+               if (!connection) {
+                    collectd_accept(&collectd);
+               } else if (connection->fd >= 0) {
+                    collectd_read(&collectd, connection);
+               }
+          }
+          now_ns = uu_monotonic_ns();
+          if (now_ns >= next_commit_ns) {
+               collectd_commit(&collectd);
+               next_commit_ns += commit_interval_ns;
+               if (next_commit_ns <= now_ns) next_commit_ns = now_ns + commit_interval_ns;
+          }
+          if (stats_interval_ns && now_ns - stats_previous_ns >= stats_interval_ns) {
+               collectd_print_stats(&collectd, (now_ns - stats_previous_ns) / 1e9);
+               stats_previous_ns = now_ns;
+          }
+     }
+     collectd_commit(&collectd);
+     collectd_print_stats(&collectd, (uu_monotonic_ns() - stats_previous_ns) / 1e9);
+     for (int i = 0; i < collectd.num_connections; i++) {
+          if (collectd.connections[i].fd >= 0) collectd_close_connection(&collectd, &collectd.connections[i], "stopped");
+     }
+     for (int i = 0; i < collectd.num_sensors; i++) {
+          output_writer_destroy(&collectd.sensors[i].writer);
+          uu_close(collectd.sensors[i].fd);
+     }
+     close(collectd.epoll_fd);
+     close(collectd.listen_fd);
+     free(collectd.connections);
+     free(collectd.sensors);
+     free(collectd.dirty_sensors);
+     free(collectd.readings);
+     return 0;
+#endif
+}
+
+// Simulates num_readers readers, load-0 to load-<n-1>, each sending
+// readings_per_second readings of the synthetic stream to host_and_port for
+// seconds, their spools in spool_dir. Statistics and errors are reported on
+// standard error.
+int collectd_load(char const *host_and_port, int num_readers, int readings_per_second, int seconds, char const *spool_dir)
+{
+     Forwarder *forwarders = calloc(num_readers, sizeof *forwarders);
+     SyntheticSource *sources = calloc(num_readers, sizeof *sources);
+     if (!forwarders || !sources) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          return -1;
+     }
+#if !defined(WIN32)
+     signal(SIGPIPE, SIG_IGN);
+#endif
+     for (int i = 0; i < num_readers; i++) {
+          char address[320];
+          snprintf(address, sizeof address, "load-%d@%s", i, host_and_port);
+          if (forwarder_open(&forwarders[i], address, spool_dir) != 0) return -1;
+          synthetic_source_init(&sources[i], (int64_t)time(NULL) * NS_PER_SECOND, 1 + i);
+          forwarder_poll(&forwarders[i]);
+     }
+     int64_t start_ns = uu_monotonic_ns();
+     int num_ticks = seconds * 1000 / COLLECTD_LOAD_TICK_MS;
+     uint64_t sent = 0;
+     for (int tick = 1; tick <= num_ticks; tick++) {
+          int64_t tick_ns = start_ns + (int64_t)tick * COLLECTD_LOAD_TICK_MS * 1000000;
+          int64_t now_ns = uu_monotonic_ns();
+          if (tick_ns > now_ns) uu_sleep_ms((int)((tick_ns - now_ns) / 1000000));
+          // stamped like the reader does, with the wall clock to the second
+          int64_t time_unix_ns = (int64_t)time(NULL) * NS_PER_SECOND;
+          uint64_t due = (uint64_t)readings_per_second * tick * COLLECTD_LOAD_TICK_MS / 1000;
+          for (int i = 0; i < num_readers; i++) {
+               for (uint64_t j = sources[i].count; j < due; j++) {
+                    Reading reading;
+                    synthetic_source_next(&sources[i], &reading);
+                    reading.time_unix_ns = time_unix_ns;
+                    forwarder_add(&forwarders[i], &reading);
+                    sent++;
+               }
+               forwarder_commit(&forwarders[i]);
+               forwarder_poll(&forwarders[i]);
+          }
+     }
+     double seconds_sending = (uu_monotonic_ns() - start_ns) / 1e9;
+
+     // the last acknowledgements, for all readers at once
+     int64_t deadline_ns = uu_monotonic_ns() + (int64_t)FORWARD_ACK_TIMEOUT_MS * 1000000;
+     for (int pending = 1; pending && uu_monotonic_ns() < deadline_ns;) {
+          pending = 0;
+          for (int i = 0; i < num_readers; i++) {
+               forwarder_poll(&forwarders[i]);
+               if (forwarders[i].num_inflight || forwarders[i].spool_size) pending = 1;
+          }
+          if (pending) uu_sleep_ms(10);
+     }
+     uint64_t acknowledged = 0, spooled_frames = 0, frame_bytes = 0;
+     for (int i = 0; i < num_readers; i++) {
+          acknowledged += forwarders[i].stats.readings;
+          spooled_frames += forwarders[i].stats.spooled_frames;
+          frame_bytes += forwarders[i].stats.frame_bytes;
+          forwarder_close(&forwarders[i]);
+     }
+     fprintf(stderr, "load\t%d readers, %llu readings in %.3fs, %.0f readings/s, %llu acknowledged, %.2f bytes/report, %llu spooled frames\n",
+             num_readers, (unsigned long long)sent, seconds_sending, sent / seconds_sending,
+             (unsigned long long)acknowledged, acknowledged ? (double)frame_bytes / acknowledged : 0.0,
+             (unsigned long long)spooled_frames);
+     free(forwarders);
+     free(sources);
+     return acknowledged == sent ? 0 : -1;
+}
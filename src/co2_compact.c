@@ -0,0 +1,311 @@
+// Compaction of outputs into archives
+//
+// Outputs cut by day (logrotate, or a new -o a day) pile up into thousands
+// of small files per sensor, and a scan of a year opens and seeks every one.
+// co2 compact merges the closed ones, the segments, into an archive (see
+// co2_archive.c): one file, compressed 5 to 10 times, with an index of its
+// blocks, that merge, report and extract read like any output. The segments
+// of an archive should be those of a single sensor, as an archive does not
+// tell where a reading came from.
+//
+// In order, each step safe to interrupt:
+// 1. the process drops to idle processor and disk priority, so that it never
+//    competes with the reader
+// 2. every segment is scanned for its readings, first and last time and
+//    checksum. Those with readings outside of --from and --to (by default,
+//    up to the end of yesterday), modified in the last 10 minutes, without
+//    readings, or not in time order, are left alone: the output the reader
+//    still appends to is one of them. A segment that is not a tsv output
+//    (with its header), a binary output or an archive, or that has lines
+//    which are not readings, is an error, and nothing is compacted.
+// 3. the segments are merged in time order into archive.tmp, which is
+//    synced. Segments are opened in the order of their first reading and
+//    closed at their end, so that files open at once are only the ones that
+//    overlap.
+// 4. archive.tmp is read back, and its readings checked against the
+//    segments: count, checksum and time order
+// 5. archive.tmp is renamed to archive
+// 6. the segments and their .idx are deleted, unless --keep
+//
+// Started on an archive that exists, compact finishes an interrupted step 6:
+// the segments still there that it lists as its sources, with the same size
+// and checksum, are deleted; any other is an error.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { COMPACT_MIN_AGE_SECONDS = 600 };
+
+typedef struct CompactSegment
+{
+     char const *path;
+     int64_t size;
+     int64_t num_readings;
+     int64_t first_ns;
+     int64_t last_ns;
+     uint64_t checksum;
+     int64_t modified_unix;
+     int out_of_order;
+} CompactSegment;
+
+// Reads the segment at segment->path through. Returns 0, or -1 on errors and
+// when it is not an output or an archive, or has lines which are not
+// readings.
+static int compact_scan(CompactSegment *segment)
+{
+     MergeInput input = { .path = segment->path, .fd = -1 };
+     int rc = merge_input_open_path(&input);
+     int status = 0;
+     segment->num_readings = 0;
+     segment->checksum = 0;
+     segment->modified_unix = rc == 0 && input.fd > 0 ? uu_file_modified_unix(input.fd) : 0;
+     if (rc == 0 && !input.is_binary && !input.is_archive && !input.has_header) {
+          fprintf(stderr, "ERROR: %s is not a tsv or binary output, nor an archive\n", segment->path);
+          rc = -1;
+     }
+     while (rc == 0 && (status = merge_input_advance(&input)) > 0) {
+          if (!segment->num_readings) segment->first_ns = input.reading.time_unix_ns;
+          segment->last_ns = input.reading.time_unix_ns;
+          segment->num_readings++;
+          segment->checksum += archive_reading_hash(&input.reading);
+     }
+     if (status < 0) rc = -1;
+     if (rc == 0 && input.num_unparsed) {
+          fprintf(stderr, "ERROR: %s has lines which are not readings\n", segment->path);
+          rc = -1;
+     }
+     segment->out_of_order = input.num_out_of_order > 0;
+     segment->size = merge_input_close(&input);
+     return rc;
+}
+
+static int compact_segment_less(void const *a, void const *b)
+{
+     CompactSegment const *x = a, *y = b;
+     return x->first_ns < y->first_ns ? -1 : x->first_ns > y->first_ns;
+}
+
+static void compact_heap_push(Merge *merge, MergeHeapEntry entry)
+{
+     int i = merge->heap_size++;
+     for (; i > 0 && merge_heap_less(&entry, &merge->heap[(i - 1) / 2]); i = (i - 1) / 2) merge->heap[i] = merge->heap[(i - 1) / 2];
+     merge->heap[i] = entry;
+}
+
+// Merges the segments, sorted by their first reading, into writer
+static int compact_merge(CompactSegment const *segments, int num_segments, ArchiveWriter *writer)
+{
+     Merge merge = { 0 };
+     merge.inputs = calloc(num_segments, sizeof *merge.inputs);
+     merge.heap = calloc(num_segments, sizeof *merge.heap);
+     int rc = merge.inputs && merge.heap ? 0 : -1;
+     int next = 0; // segment to open
+     while (rc == 0) {
+          // the segments that start before the next reading
+          while (rc == 0 && next < num_segments && (!merge.heap_size || segments[next].first_ns <= merge.heap[0].time_unix_ns)) {
+               MergeInput *input = &merge.inputs[next];
+               input->path = segments[next].path;
+               rc = merge_input_open_path(input);
+               int status = rc == 0 ? merge_input_advance(input) : -1;
+               if (status < 0) rc = -1;
+               if (status > 0) compact_heap_push(&merge, (MergeHeapEntry){ input->reading.time_unix_ns, next });
+               if (status == 0) merge_input_close(input);
+               next++;
+          }
+          if (rc != 0 || !merge.heap_size) break;
+          MergeInput *input = &merge.inputs[merge.heap[0].input_index];
+          archive_writer_add(writer, &input->reading);
+          int status = merge_input_advance(input);
+          if (status < 0) rc = -1;
+          if (status > 0) {
+               merge.heap[0].time_unix_ns = input->reading.time_unix_ns;
+          } else {
+               merge_input_close(input);
+               merge.heap[0] = merge.heap[--merge.heap_size];
+          }
+          merge_heap_sift_down(&merge, 0);
+     }
+     for (int i = 0; merge.inputs && i < num_segments; i++) merge_input_close(&merge.inputs[i]);
+     free(merge.inputs);
+     free(merge.heap);
+     return rc;
+}
+
+// Reads the archive at path back. Errors are reported on standard error.
+static int compact_verify(char const *path, uint64_t num_readings, uint64_t checksum)
+{
+     Archive archive;
+     if (archive_open(&archive, path) != 0) return -1;
+     Reading *readings = malloc(FORWARD_MAX_FRAME_READINGS * sizeof *readings);
+     uint64_t found_readings = 0, found_checksum = 0;
+     int64_t previous_ns = INT64_MIN;
+     int rc = readings ? 0 : -1;
+     for (int i = 0; i < archive.num_blocks && rc == 0; i++) {
+          ArchiveBlock block;
+          archive_get_block(&archive, i, &block);
+          int n = archive_decode_block(&archive, i, readings);
+          if (n != block.num_readings) rc = -1;
+          for (int j = 0; j < n && rc == 0; j++) {
+               int64_t time_unix_ns = readings[j].time_unix_ns;
+               if (time_unix_ns < previous_ns || time_unix_ns < block.min_ns || time_unix_ns > block.max_ns) rc = -1;
+               previous_ns = time_unix_ns;
+               found_readings++;
+               found_checksum += archive_reading_hash(&readings[j]);
+          }
+     }
+     if (found_readings != num_readings || found_checksum != checksum || archive.num_readings != num_readings
+         || archive.checksum != checksum) {
+          rc = -1;
+     }
+     if (rc != 0) fprintf(stderr, "ERROR: %s does not hold the readings of the segments\n", path);
+     free(readings);
+     archive_close(&archive);
+     return rc;
+}
+
+static void compact_remove(char const *path)
+{
+     char index_path[1024];
+     snprintf(index_path, sizeof index_path, "%s.idx", path);
+     if (remove(path) != 0) fprintf(stderr, "WARNING: could not delete %s\n", path);
+     remove(index_path); // when there is one
+     uu_sync_directory_of(path);
+}
+
+// Finishes the compaction into the existing archive at path: deletes those
+// of the segments that are its sources, unchanged.
+static int compact_finish(char const *path, CompactSegment *segments, int num_segments, int keep)
+{
+     Archive archive;
+     if (archive_open(&archive, path) != 0) return -1;
+     int rc = 0, num_removed = 0;
+     for (int i = 0; i < num_segments && rc == 0; i++) {
+          CompactSegment *segment = &segments[i];
+          ArchiveSource source;
+          uint8_t const *cursor = archive.sources;
+          int found = 0;
+          while (!found && archive_next_source(&archive, &cursor, &source) == 0) found = 0 == strcmp(source.path, segment->path);
+          int fd = uu_open_for_reading(segment->path);
+          if (fd >= 0) uu_close(fd);
+          if (fd < 0 && found) continue; // deleted already
+          if (!found || compact_scan(segment) != 0 || segment->size != source.size
+              || (uint64_t)segment->num_readings != source.num_readings || segment->checksum != source.checksum) {
+               fprintf(stderr, "ERROR: %s exists, and %s is not one of its segments as they were: compact into another archive\n",
+                       path, segment->path);
+               rc = -1;
+          } else if (!keep) {
+               compact_remove(segment->path);
+               num_removed++;
+          }
+     }
+     archive_close(&archive);
+     if (rc == 0) fprintf(stderr, "compact\t%s exists, deleted %d of its segments\n", path, num_removed);
+     return rc;
+}
+
+// Compacts the segments at paths that are within [from_unix_ns, to_unix_ns]
+// into the archive at path. Statistics and errors are reported on standard
+// error.
+int compact_outputs(char const *path, char const *const *paths, int num_paths, int64_t from_unix_ns, int64_t to_unix_ns, int keep)
+{
+     if (uu_set_background_priority() != 0) fprintf(stderr, "WARNING: could not lower the priority: %s\n", strerror(errno));
+     CompactSegment *segments = calloc(num_paths, sizeof *segments);
+     if (!segments) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          return -1;
+     }
+     int rc = 0;
+     for (int i = 0; i < num_paths && rc == 0; i++) {
+          segments[i].path = paths[i];
+          if (0 == strcmp(paths[i], path) || 0 == strcmp(paths[i], "-")) {
+               fprintf(stderr, "ERROR: cannot compact %s into %s\n", paths[i], path);
+               rc = -1;
+          }
+     }
+     int fd = rc == 0 ? uu_open_for_reading(path) : -1;
+     if (fd >= 0) {
+          uu_close(fd);
+          rc = compact_finish(path, segments, num_paths, keep);
+          free(segments);
+          return rc;
+     }
+
+     int64_t start_ns = uu_monotonic_ns();
+     int64_t now_unix = uu_realtime_ns() / NS_PER_SECOND;
+     int num_segments = 0, num_skipped = 0;
+     int64_t num_bytes = 0;
+     uint64_t num_readings = 0, checksum = 0;
+     for (int i = 0; i < num_paths; i++) {
+          CompactSegment segment = segments[i];
+          if (compact_scan(&segment) != 0) {
+               rc = -1;
+               continue;
+          }
+          char const *reason = NULL;
+          if (segment.out_of_order) {
+               reason = "is not in time order";
+          } else if (!segment.num_readings) {
+               reason = "holds no reading";
+          } else if (now_unix - segment.modified_unix < COMPACT_MIN_AGE_SECONDS) {
+               reason = "was modified in the last 10 minutes";
+          }
+          if (reason) fprintf(stderr, "WARNING: %s %s, left alone\n", segment.path, reason);
+          if (reason || segment.first_ns < from_unix_ns || segment.last_ns > to_unix_ns) {
+               num_skipped++;
+               continue;
+          }
+          segments[num_segments++] = segment;
+          num_bytes += segment.size;
+          num_readings += segment.num_readings;
+          checksum += segment.checksum;
+     }
+     if (rc != 0) {
+          fprintf(stderr, "ERROR: nothing compacted\n");
+          free(segments);
+          return -1;
+     }
+     if (!num_segments) {
+          fprintf(stderr, "compact\tno segment to compact, %d left alone\n", num_skipped);
+          free(segments);
+          return 0;
+     }
+     qsort(segments, num_segments, sizeof *segments, compact_segment_less);
+
+     char temporary_path[1040];
+     snprintf(temporary_path, sizeof temporary_path, "%s.tmp", path);
+     ArchiveWriter writer;
+     if (rc == 0 && archive_writer_open(&writer, temporary_path) != 0) rc = -1;
+     if (rc == 0) {
+          rc = compact_merge(segments, num_segments, &writer);
+          for (int i = 0; i < num_segments; i++) {
+               ArchiveSource source = { .size = segments[i].size, .num_readings = segments[i].num_readings, .checksum = segments[i].checksum };
+               snprintf(source.path, sizeof source.path, "%s", segments[i].path);
+               archive_writer_add_source(&writer, &source);
+          }
+          if (archive_writer_finish(&writer) != 0 && rc == 0) {
+               fprintf(stderr, "ERROR: could not write %s\n", temporary_path);
+               rc = -1;
+          }
+          if (rc == 0) rc = compact_verify(temporary_path, num_readings, checksum);
+          if (rc == 0 && rename(temporary_path, path) != 0) {
+               fprintf(stderr, "ERROR: could not rename %s to %s\n", temporary_path, path);
+               rc = -1;
+          }
+          if (rc != 0) remove(temporary_path);
+     }
+     if (rc == 0) {
+          uu_sync_directory_of(path);
+          for (int i = 0; i < num_segments && !keep; i++) compact_remove(segments[i].path);
+          fd = uu_open_for_reading(path);
+          int64_t archive_size = fd >= 0 ? uu_file_size(fd) : 0;
+          if (fd >= 0) uu_close(fd);
+          double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+          fprintf(stderr, "compact\t%d segments (%d left alone), %llu readings, %lld bytes into %lld (%.1fx) in %.3fs\n",
+                  num_segments, num_skipped, (unsigned long long)num_readings, (long long)num_bytes, (long long)archive_size,
+                  archive_size ? (double)num_bytes / archive_size : 0.0, seconds);
+     }
+     free(segments);
+     return rc;
+}
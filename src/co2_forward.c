@@ -0,0 +1,789 @@
+// Forwarder: readings sent to a collector in batched, compressed frames
+//
+// A sink with a fwd:host:port target groups its readings into frames, by
+// default one per second, and sends them over TCP to a collector, e.g. co2
+// collect. Like every sink it runs on its own thread behind its queue, so
+// the reader never waits for the network.
+//
+// Frame: a 20 bytes header, little-endian:
+//
+//   magic CO2F, u32 number of readings, u32 payload size,
+//   i64 time_unix_ns the first time delta is taken from
+//
+// followed by the payload, per reading:
+//
+//   u8 flags: the kind (2 bits), FORWARD_FLAG_SECONDS, FORWARD_FLAG_OPCODE,
+//      FORWARD_FLAG_VALUE
+//   varint time delta from the previous reading, zigzag, in seconds when
+//      FORWARD_FLAG_SECONDS, else in ns
+//   u8 opcode, if FORWARD_FLAG_OPCODE: it differs from the previous reading
+//      of the same kind
+//   varint raw_value delta from the previous reading of the same kind, zigzag
+//   u32 value, if FORWARD_FLAG_VALUE: it is not the one decoded from
+//      raw_value
+//
+// so that the typical reading, a second after the previous one, takes 3 or 4
+// bytes instead of 16 in the binary format.
+//
+// Every connection starts with a hello, a header with the magic CO2H, no
+// readings and the name of the sensor as payload: the part before @ in
+// fwd:name@host:port, by default the host name.
+//
+// Delivery: the collector answers every frame with the u64 count of frames
+// it received on the connection. Frames are kept in memory until
+// acknowledged. When the link is down, or acknowledgements are overdue, the
+// unacknowledged frames and every frame after them are appended to a spool
+// file, which is replayed in order once connected again, before going back
+// to sending frames as they are made. Frames are thus delivered in order, at
+// least once. The spool outlives the program: a spool left by a previous run
+// is replayed first, after cutting off a frame torn by a crash.
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32)
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+enum { FORWARD_HEADER_SIZE = 20 };
+enum { FORWARD_MAX_FRAME_READINGS = 4096 };
+enum { FORWARD_MAX_READING_SIZE = 1 + 10 + 1 + 3 + 4 };
+enum { FORWARD_MAX_FRAME_SIZE = FORWARD_HEADER_SIZE + FORWARD_MAX_FRAME_READINGS * FORWARD_MAX_READING_SIZE };
+enum { FORWARD_MAX_INFLIGHT = 32 }; // frames sent and not acknowledged
+enum { FORWARD_CONNECT_TIMEOUT_MS = 2000 };
+enum { FORWARD_ACK_TIMEOUT_MS = 5000 }; // also the send timeout
+enum { FORWARD_MAX_BACKOFF_MS = 30000 };
+
+enum
+{
+     FORWARD_FLAG_SECONDS = 1 << 2,
+     FORWARD_FLAG_OPCODE = 1 << 3,
+     FORWARD_FLAG_VALUE = 1 << 4,
+};
+
+enum { FORWARD_MAX_NAME = 64 };
+
+static char const FORWARD_MAGIC[4] = { 'C', 'O', '2', 'F' };
+static char const FORWARD_HELLO_MAGIC[4] = { 'C', 'O', '2', 'H' };
+
+// The previous reading, the deltas are taken from
+typedef struct ForwardCodec
+{
+     int64_t time_unix_ns;
+     uint8_t opcodes[NumReadingKinds];
+     uint16_t raw_values[NumReadingKinds];
+} ForwardCodec;
+
+typedef struct ForwardStats
+{
+     uint64_t frames; // acknowledged
+     uint64_t frame_bytes;
+     uint64_t readings;
+     uint64_t spooled_frames;
+     uint64_t reconnects;
+     int64_t spool_bytes; // not yet acknowledged
+     int connected;
+} ForwardStats;
+
+typedef struct Forwarder
+{
+     char name[FORWARD_MAX_NAME];
+     char host_and_port[256];
+     char spool_path[1024];
+     int socket_fd; // -1 when disconnected
+     int failed; // the spool could not be read back: frames are dropped
+     int64_t next_connect_ns;
+     int backoff_ms;
+
+     // the frame being made
+     uint8_t *frame;
+     size_t frame_size;
+     int frame_readings;
+     int64_t frame_started_ns;
+     ForwardCodec codec;
+
+     // frames sent on the connection and not acknowledged: in inflight while
+     // live, or in the spool, ending at inflight_ends
+     uint8_t *inflight;
+     size_t inflight_size;
+     int64_t inflight_ends[FORWARD_MAX_INFLIGHT];
+     int inflight_readings[FORWARD_MAX_INFLIGHT];
+     int num_inflight;
+     int64_t inflight_sent_ns; // of the oldest
+     uint64_t frames_sent; // on the connection
+     uint8_t ack[8];
+     int ack_size;
+
+     // spooling while spool_size is not 0: frames are appended at the end,
+     // sent from spool_sent, and acknowledged up to spool_acked
+     int spool_fd;
+     int64_t spool_size;
+     int64_t spool_sent;
+     int64_t spool_acked;
+     uint8_t *scratch; // a frame read back from the spool
+
+     ForwardStats stats;
+} Forwarder;
+
+//
+// Encoding
+//
+
+static uint8_t *forward_put_varint(uint8_t *dst, uint64_t value)
+{
+     while (value >= 0x80) {
+          *dst++ = (uint8_t)(value | 0x80);
+          value >>= 7;
+     }
+     *dst++ = (uint8_t)value;
+     return dst;
+}
+
+static uint8_t const *forward_get_varint(uint8_t const *src, uint8_t const *end, uint64_t *value)
+{
+     *value = 0;
+     for (int shift = 0; src < end && shift < 64; shift += 7) {
+          uint8_t byte = *src++;
+          *value |= (uint64_t)(byte & 0x7f) << shift;
+          if (!(byte & 0x80)) return src;
+     }
+     return NULL;
+}
+
+static uint64_t forward_zigzag(int64_t value)
+{
+     return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t forward_unzigzag(uint64_t value)
+{
+     return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// The value the reader decodes from raw_value
+static uint32_t forward_decoded_value(uint8_t kind, uint16_t raw_value)
+{
+     Reading reading = { .kind = kind };
+     if (kind == ReadingKind_CO2) reading.co2_in_ppm = raw_value;
+     if (kind == ReadingKind_Temperature) reading.temperature_in_C = (float)(raw_value / 16.0 - 273.15);
+     uint32_t value;
+     memcpy(&value, &reading.co2_in_ppm, sizeof value);
+     return value;
+}
+
+static uint8_t *forward_encode_reading(uint8_t *dst, ForwardCodec *codec, Reading const *reading)
+{
+     uint8_t kind = reading->kind & 3;
+     int64_t delta_ns = reading->time_unix_ns - codec->time_unix_ns;
+     uint32_t value;
+     memcpy(&value, &reading->co2_in_ppm, sizeof value);
+     uint8_t flags = kind;
+     if (delta_ns % NS_PER_SECOND == 0) flags |= FORWARD_FLAG_SECONDS;
+     if (reading->opcode != codec->opcodes[kind]) flags |= FORWARD_FLAG_OPCODE;
+     if (value != forward_decoded_value(kind, reading->raw_value)) flags |= FORWARD_FLAG_VALUE;
+     *dst++ = flags;
+     dst = forward_put_varint(dst, forward_zigzag(flags & FORWARD_FLAG_SECONDS ? delta_ns / NS_PER_SECOND : delta_ns));
+     if (flags & FORWARD_FLAG_OPCODE) *dst++ = reading->opcode;
+     dst = forward_put_varint(dst, forward_zigzag((int64_t)reading->raw_value - codec->raw_values[kind]));
+     if (flags & FORWARD_FLAG_VALUE) {
+          binary_put_u32(dst, value);
+          dst += 4;
+     }
+     codec->time_unix_ns = reading->time_unix_ns;
+     codec->opcodes[kind] = reading->opcode;
+     codec->raw_values[kind] = reading->raw_value;
+     return dst;
+}
+
+static int forward_is_hello(uint8_t const header[FORWARD_HEADER_SIZE])
+{
+     return 0 == memcmp(header, FORWARD_HELLO_MAGIC, sizeof FORWARD_HELLO_MAGIC);
+}
+
+// Checks a frame or hello header. Returns the size of the frame, or -1.
+static int64_t forward_frame_size(uint8_t const header[FORWARD_HEADER_SIZE])
+{
+     uint32_t num_readings = binary_get_u32(header + 4);
+     uint32_t payload_size = binary_get_u32(header + 8);
+     if (forward_is_hello(header)) {
+          return num_readings == 0 && payload_size < FORWARD_MAX_NAME ? FORWARD_HEADER_SIZE + (int64_t)payload_size : -1;
+     }
+     if (memcmp(header, FORWARD_MAGIC, sizeof FORWARD_MAGIC) != 0 || num_readings > FORWARD_MAX_FRAME_READINGS
+         || payload_size > (uint32_t)num_readings * FORWARD_MAX_READING_SIZE) {
+          return -1;
+     }
+     return FORWARD_HEADER_SIZE + (int64_t)payload_size;
+}
+
+// Decodes a frame checked by forward_frame_size into readings, at least
+// FORWARD_MAX_FRAME_READINGS. Returns their number, or -1 when corrupt.
+int forward_decode_frame(uint8_t const *frame, Reading *readings)
+{
+     int n = (int)binary_get_u32(frame + 4);
+     uint8_t const *src = frame + FORWARD_HEADER_SIZE;
+     uint8_t const *end = src + binary_get_u32(frame + 8);
+     ForwardCodec codec = { .time_unix_ns = (int64_t)binary_get_u64(frame + 12) };
+     for (int i = 0; i < n; i++) {
+          Reading *reading = &readings[i];
+          uint64_t delta;
+          if (src == end) return -1;
+          uint8_t flags = *src++;
+          uint8_t kind = flags & 3;
+          if (!(src = forward_get_varint(src, end, &delta))) return -1;
+          int64_t delta_ns = forward_unzigzag(delta);
+          if (flags & FORWARD_FLAG_SECONDS) delta_ns *= NS_PER_SECOND;
+          memset(reading, 0, sizeof *reading);
+          reading->time_unix_ns = codec.time_unix_ns + delta_ns;
+          reading->kind = kind;
+          reading->opcode = codec.opcodes[kind];
+          if (flags & FORWARD_FLAG_OPCODE) {
+               if (src == end) return -1;
+               reading->opcode = *src++;
+          }
+          if (!(src = forward_get_varint(src, end, &delta))) return -1;
+          reading->raw_value = (uint16_t)(codec.raw_values[kind] + forward_unzigzag(delta));
+          uint32_t value = forward_decoded_value(kind, reading->raw_value);
+          if (flags & FORWARD_FLAG_VALUE) {
+               if (end - src < 4) return -1;
+               value = binary_get_u32(src);
+               src += 4;
+          }
+          memcpy(&reading->co2_in_ppm, &value, sizeof value);
+          codec.time_unix_ns = reading->time_unix_ns;
+          codec.opcodes[kind] = reading->opcode;
+          codec.raw_values[kind] = reading->raw_value;
+     }
+     return src == end ? n : -1;
+}
+
+//
+// Spool
+//
+
+static int forward_spool_append(Forwarder *forwarder, uint8_t const *frame, size_t size)
+{
+     if (uu_seek(forwarder->spool_fd, forwarder->spool_size) != 0 || uu_write_all(forwarder->spool_fd, frame, size) != 0) {
+          return -1;
+     }
+     forwarder->spool_size += size;
+     forwarder->stats.spooled_frames++;
+     return 0;
+}
+
+// Reads back the frame at offset into scratch. Returns its size, or -1.
+static int64_t forward_spool_read(Forwarder *forwarder, int64_t offset)
+{
+     uint8_t *frame = forwarder->scratch;
+     if (uu_seek(forwarder->spool_fd, offset) != 0
+         || uu_read_full(forwarder->spool_fd, frame, FORWARD_HEADER_SIZE) != FORWARD_HEADER_SIZE) {
+          return -1;
+     }
+     int64_t size = forward_frame_size(frame);
+     if (size < 0 || uu_read_full(forwarder->spool_fd, frame + FORWARD_HEADER_SIZE, size - FORWARD_HEADER_SIZE) != size - FORWARD_HEADER_SIZE) {
+          return -1;
+     }
+     return size;
+}
+
+// Opens the spool, keeping the whole frames a previous run left in it
+static int forward_spool_open(Forwarder *forwarder)
+{
+     forwarder->spool_fd = uu_open_for_updating(forwarder->spool_path, 0);
+     if (forwarder->spool_fd < 0) return -1;
+     int64_t size = uu_file_size(forwarder->spool_fd);
+     int64_t kept = 0;
+     for (int64_t frame_size; kept < size && (frame_size = forward_spool_read(forwarder, kept)) > 0 && kept + frame_size <= size;) {
+          kept += frame_size;
+     }
+     if (kept != size) {
+          fprintf(stderr, "%s: cut off %lld bytes of a torn frame\n", forwarder->spool_path, (long long)(size - kept));
+          if (uu_truncate(forwarder->spool_fd, kept) != 0) return -1;
+     }
+     if (kept) fprintf(stderr, "%s: %lld bytes to replay\n", forwarder->spool_path, (long long)kept);
+     forwarder->spool_size = kept;
+     return 0;
+}
+
+#if !defined(WIN32)
+
+//
+// Connection
+//
+
+static int forward_poll_fd(int fd, short events, int timeout_ms)
+{
+     struct pollfd poll_fd = { .fd = fd, .events = events };
+     int rc;
+     do {
+          rc = poll(&poll_fd, 1, timeout_ms);
+     } while (rc < 0 && errno == EINTR);
+     return rc;
+}
+
+// Connects within FORWARD_CONNECT_TIMEOUT_MS, so that a host which does not
+// answer does not hold the sink for minutes. Returns the socket or -1.
+static int forward_connect(char const *host_and_port)
+{
+     char host[256];
+     char const *colon = strrchr(host_and_port, ':');
+     if (!colon || colon == host_and_port || (size_t)(colon - host_and_port) >= sizeof host) return -1;
+     memcpy(host, host_and_port, colon - host_and_port);
+     host[colon - host_and_port] = 0;
+
+     struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+     struct addrinfo *addresses;
+     if (getaddrinfo(host, colon + 1, &hints, &addresses) != 0) return -1;
+     int fd = -1;
+     for (struct addrinfo *address = addresses; address && fd < 0; address = address->ai_next) {
+          fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+          if (fd < 0) continue;
+          int flags = fcntl(fd, F_GETFL);
+          fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+          int error = 0;
+          socklen_t error_size = sizeof error;
+          if (connect(fd, address->ai_addr, address->ai_addrlen) != 0
+              && (errno != EINPROGRESS || forward_poll_fd(fd, POLLOUT, FORWARD_CONNECT_TIMEOUT_MS) <= 0
+                  || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size) != 0 || error != 0)) {
+               close(fd);
+               fd = -1;
+               continue;
+          }
+          fcntl(fd, F_SETFL, flags);
+          struct timeval timeout = { FORWARD_ACK_TIMEOUT_MS / 1000, 0 };
+          setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+     }
+     freeaddrinfo(addresses);
+     return fd;
+}
+
+//
+// Delivery
+//
+
+static void forward_disconnect(Forwarder *forwarder)
+{
+     if (forwarder->socket_fd < 0) return;
+     close(forwarder->socket_fd);
+     forwarder->socket_fd = -1;
+     forwarder->stats.connected = 0;
+     forwarder->next_connect_ns = uu_monotonic_ns() + (int64_t)forwarder->backoff_ms * 1000000;
+     if (forwarder->spool_size) {
+          // sent again from the first one not acknowledged
+          forwarder->spool_sent = forwarder->spool_acked;
+     } else {
+          // live frames not acknowledged start the spool
+          size_t begin = 0;
+          for (int i = 0; i < forwarder->num_inflight; i++) {
+               size_t end = (size_t)forwarder->inflight_ends[i];
+               if (forward_spool_append(forwarder, forwarder->inflight + begin, end - begin) != 0) {
+                    fprintf(stderr, "ERROR: could not write %s, %d readings lost\n", forwarder->spool_path, forwarder->inflight_readings[i]);
+               }
+               begin = end;
+          }
+          forwarder->spool_sent = forwarder->spool_acked = 0;
+     }
+     forwarder->inflight_size = 0;
+     forwarder->num_inflight = 0;
+     forwarder->ack_size = 0;
+}
+
+// Sends a frame on the connection and keeps track of it until acknowledged.
+// end is where it ends in inflight or in the spool.
+static int forward_send(Forwarder *forwarder, uint8_t const *frame, size_t size, int64_t end)
+{
+     assert(forwarder->num_inflight < FORWARD_MAX_INFLIGHT);
+     if (uu_write_all(forwarder->socket_fd, frame, size) != 0) return -1;
+     if (!forwarder->num_inflight) forwarder->inflight_sent_ns = uu_monotonic_ns();
+     forwarder->inflight_ends[forwarder->num_inflight] = end;
+     forwarder->inflight_readings[forwarder->num_inflight] = (int)binary_get_u32(frame + 4);
+     forwarder->num_inflight++;
+     forwarder->frames_sent++;
+     return 0;
+}
+
+// Reads the acknowledgements that arrived, waiting up to timeout_ms for one.
+// Returns -1 when the connection is lost.
+static int forward_read_acks(Forwarder *forwarder, int timeout_ms)
+{
+     if (timeout_ms && forward_poll_fd(forwarder->socket_fd, POLLIN, timeout_ms) <= 0) return 0;
+     for (;;) {
+          ssize_t n = recv(forwarder->socket_fd, forwarder->ack + forwarder->ack_size, sizeof forwarder->ack - forwarder->ack_size, MSG_DONTWAIT);
+          if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) return -1;
+          if (n < 0) return 0;
+          forwarder->ack_size += (int)n;
+          if (forwarder->ack_size < (int)sizeof forwarder->ack) continue;
+          forwarder->ack_size = 0;
+          uint64_t count = binary_get_u64(forwarder->ack);
+          uint64_t first_inflight = forwarder->frames_sent - forwarder->num_inflight;
+          if (count < first_inflight || count > forwarder->frames_sent) return -1;
+          int acked = (int)(count - first_inflight);
+          if (!acked) continue;
+          int64_t acked_end = forwarder->inflight_ends[acked - 1];
+          for (int i = 0; i < acked; i++) {
+               forwarder->stats.frames++;
+               forwarder->stats.readings += forwarder->inflight_readings[i];
+          }
+          if (forwarder->spool_size) {
+               forwarder->stats.frame_bytes += acked_end - forwarder->spool_acked;
+               forwarder->spool_acked = acked_end;
+          } else {
+               forwarder->stats.frame_bytes += acked_end;
+               memmove(forwarder->inflight, forwarder->inflight + acked_end, forwarder->inflight_size - acked_end);
+               forwarder->inflight_size -= acked_end;
+               for (int i = acked; i < forwarder->num_inflight; i++) forwarder->inflight_ends[i] -= acked_end;
+          }
+          memmove(forwarder->inflight_ends, forwarder->inflight_ends + acked, (forwarder->num_inflight - acked) * sizeof forwarder->inflight_ends[0]);
+          memmove(forwarder->inflight_readings, forwarder->inflight_readings + acked, (forwarder->num_inflight - acked) * sizeof forwarder->inflight_readings[0]);
+          forwarder->num_inflight -= acked;
+          forwarder->inflight_sent_ns = uu_monotonic_ns();
+     }
+}
+
+#endif
+
+// Reconnects when due, reads acknowledgements and replays the spool. Called
+// by the sink between frames. Returns -1 once the spool cannot be read back,
+// after which the forwarder drops its frames.
+int forwarder_poll(Forwarder *forwarder)
+{
+     if (forwarder->failed) return -1;
+#if !defined(WIN32)
+     int64_t now_ns = uu_monotonic_ns();
+     if (forwarder->socket_fd < 0 && now_ns >= forwarder->next_connect_ns) {
+          forwarder->socket_fd = forward_connect(forwarder->host_and_port);
+          if (forwarder->socket_fd < 0) {
+               forwarder->next_connect_ns = uu_monotonic_ns() + (int64_t)forwarder->backoff_ms * 1000000;
+               forwarder->backoff_ms = forwarder->backoff_ms * 2 < FORWARD_MAX_BACKOFF_MS ? forwarder->backoff_ms * 2 : FORWARD_MAX_BACKOFF_MS;
+               return 0;
+          }
+          uint8_t hello[FORWARD_HEADER_SIZE + FORWARD_MAX_NAME] = { 0 };
+          size_t name_size = strlen(forwarder->name);
+          memcpy(hello, FORWARD_HELLO_MAGIC, sizeof FORWARD_HELLO_MAGIC);
+          binary_put_u32(hello + 8, (uint32_t)name_size);
+          memcpy(hello + FORWARD_HEADER_SIZE, forwarder->name, name_size);
+          if (uu_write_all(forwarder->socket_fd, hello, FORWARD_HEADER_SIZE + name_size) != 0) {
+               forward_disconnect(forwarder);
+               return 0;
+          }
+          forwarder->backoff_ms = 1000;
+          forwarder->frames_sent = 0;
+          forwarder->stats.reconnects++;
+          forwarder->stats.connected = 1;
+     }
+     if (forwarder->socket_fd < 0) return 0;
+     if (forward_read_acks(forwarder, 0) != 0
+         || (forwarder->num_inflight && now_ns - forwarder->inflight_sent_ns > (int64_t)FORWARD_ACK_TIMEOUT_MS * 1000000)) {
+          forward_disconnect(forwarder);
+          return 0;
+     }
+     if (!forwarder->spool_size) return 0;
+     while (forwarder->spool_sent < forwarder->spool_size && forwarder->num_inflight < FORWARD_MAX_INFLIGHT) {
+          int64_t size = forward_spool_read(forwarder, forwarder->spool_sent);
+          if (size < 0) {
+               fprintf(stderr, "ERROR: could not read back %s, %s fails\n", forwarder->spool_path, forwarder->host_and_port);
+               forwarder->failed = 1;
+               return -1;
+          }
+          forwarder->spool_sent += size;
+          if (forward_send(forwarder, forwarder->scratch, (size_t)size, forwarder->spool_sent) != 0) {
+               forward_disconnect(forwarder);
+               return 0;
+          }
+     }
+     if (forwarder->spool_acked == forwarder->spool_size) {
+          // caught up: back to live frames
+          uu_truncate(forwarder->spool_fd, 0);
+          forwarder->spool_size = forwarder->spool_sent = forwarder->spool_acked = 0;
+     }
+#endif
+     return 0;
+}
+
+// Ends the frame being made and sends it, or spools it
+void forwarder_commit(Forwarder *forwarder)
+{
+     if (!forwarder->frame_readings) return;
+     if (forwarder->failed) {
+          forwarder->frame_size = FORWARD_HEADER_SIZE;
+          forwarder->frame_readings = 0;
+          return;
+     }
+     uint8_t *frame = forwarder->frame;
+     memcpy(frame, FORWARD_MAGIC, sizeof FORWARD_MAGIC);
+     binary_put_u32(frame + 4, (uint32_t)forwarder->frame_readings);
+     binary_put_u32(frame + 8, (uint32_t)(forwarder->frame_size - FORWARD_HEADER_SIZE));
+     size_t size = forwarder->frame_size;
+     forwarder->frame_size = FORWARD_HEADER_SIZE;
+     forwarder->frame_readings = 0;
+#if !defined(WIN32)
+     if (forwarder->socket_fd >= 0 && !forwarder->spool_size) {
+          // a full window waits for acknowledgements, up to the timeout
+          while (forwarder->socket_fd >= 0 && forwarder->num_inflight == FORWARD_MAX_INFLIGHT) {
+               if (forward_read_acks(forwarder, FORWARD_ACK_TIMEOUT_MS) != 0 || forwarder->num_inflight == FORWARD_MAX_INFLIGHT) {
+                    forward_disconnect(forwarder);
+               }
+          }
+     }
+     if (forwarder->socket_fd >= 0 && !forwarder->spool_size) {
+          memcpy(forwarder->inflight + forwarder->inflight_size, frame, size);
+          forwarder->inflight_size += size;
+          if (forward_send(forwarder, frame, size, (int64_t)forwarder->inflight_size) == 0) return;
+          forwarder->inflight_size -= size;
+          forward_disconnect(forwarder);
+     }
+#endif
+     if (forward_spool_append(forwarder, frame, size) != 0) {
+          fprintf(stderr, "ERROR: could not write %s, %u readings lost\n", forwarder->spool_path, binary_get_u32(frame + 4));
+     }
+}
+
+// Adds a reading to the frame being made, which is committed when full
+void forwarder_add(Forwarder *forwarder, Reading const *reading)
+{
+     if (!forwarder->frame_readings) {
+          forwarder->frame_started_ns = uu_monotonic_ns();
+          memset(&forwarder->codec, 0, sizeof forwarder->codec);
+          forwarder->codec.time_unix_ns = reading->time_unix_ns;
+          binary_put_u64(forwarder->frame + 12, (uint64_t)reading->time_unix_ns);
+     }
+     forwarder->frame_size = forward_encode_reading(forwarder->frame + forwarder->frame_size, &forwarder->codec, reading) - forwarder->frame;
+     if (++forwarder->frame_readings == FORWARD_MAX_FRAME_READINGS) forwarder_commit(forwarder);
+}
+
+// Spool depth, in bytes not yet acknowledged
+static int64_t forwarder_spool_depth(Forwarder const *forwarder)
+{
+     return forwarder->spool_size - forwarder->spool_acked;
+}
+
+// address of the collector, [name@]host:port, the spool goes to spool_dir.
+// Errors are reported on standard error.
+int forwarder_open(Forwarder *forwarder, char const *address, char const *spool_dir)
+{
+     memset(forwarder, 0, sizeof *forwarder);
+     forwarder->socket_fd = -1;
+     forwarder->spool_fd = -1;
+     forwarder->backoff_ms = 1000;
+     forwarder->frame_size = FORWARD_HEADER_SIZE;
+#if defined(WIN32)
+     fprintf(stderr, "ERROR: forwarding is not supported on Windows\n");
+     return -1;
+#else
+     char const *at = strchr(address, '@');
+     char const *host_and_port = at ? at + 1 : address;
+     if (at && (at == address || at - address >= FORWARD_MAX_NAME)) {
+          fprintf(stderr, "ERROR: expected a name of 1 to %d characters before @ in %s\n", FORWARD_MAX_NAME - 1, address);
+          return -1;
+     }
+     if (at) {
+          memcpy(forwarder->name, address, at - address);
+     } else if (gethostname(forwarder->name, sizeof forwarder->name - 1) != 0) {
+          snprintf(forwarder->name, sizeof forwarder->name, "co2");
+     }
+     snprintf(forwarder->host_and_port, sizeof forwarder->host_and_port, "%s", host_and_port);
+     char name[256];
+     snprintf(name, sizeof name, "%s", address);
+     for (char *p = name; *p; p++) {
+          if (*p == ':' || *p == '/' || *p == '\\') *p = '_';
+     }
+     snprintf(forwarder->spool_path, sizeof forwarder->spool_path, "%s/co2_forward_%s.spool", spool_dir, name);
+     forwarder->frame = memory_alloc(FORWARD_MAX_FRAME_SIZE);
+     forwarder->scratch = memory_alloc(FORWARD_MAX_FRAME_SIZE);
+     forwarder->inflight = memory_alloc((size_t)FORWARD_MAX_FRAME_SIZE * FORWARD_MAX_INFLIGHT);
+     if (!forwarder->frame || !forwarder->scratch || !forwarder->inflight) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          return -1;
+     }
+     if (forward_spool_open(forwarder) != 0) {
+          fprintf(stderr, "ERROR: could not open the spool %s\n", forwarder->spool_path);
+          return -1;
+     }
+     return 0;
+#endif
+}
+
+// Sends what is left, waiting a few seconds for the collector, and spools
+// what it did not acknowledge
+void forwarder_close(Forwarder *forwarder)
+{
+     forwarder_commit(forwarder);
+#if !defined(WIN32)
+     int64_t deadline_ns = uu_monotonic_ns() + (int64_t)FORWARD_ACK_TIMEOUT_MS * 1000000;
+     while (forwarder->socket_fd >= 0 && !forwarder->failed && (forwarder->num_inflight || forwarder->spool_size)
+            && uu_monotonic_ns() < deadline_ns) {
+          if (forward_read_acks(forwarder, 100) != 0) forward_disconnect(forwarder);
+          if (forwarder->socket_fd >= 0) forwarder_poll(forwarder);
+     }
+     forward_disconnect(forwarder);
+#endif
+     if (forwarder->spool_fd >= 0) {
+          uu_close(forwarder->spool_fd);
+          if (!forwarder->spool_size) remove(forwarder->spool_path);
+     }
+     memory_free(forwarder->frame);
+     memory_free(forwarder->scratch);
+     memory_free(forwarder->inflight);
+}
+
+//
+// Collector
+//
+
+#if !defined(WIN32)
+
+// Listens on [host:]port, by default on every interface
+static int forward_listen(char const *address)
+{
+     char host[256] = "";
+     char const *port = address;
+     char const *colon = strrchr(address, ':');
+     if (colon) {
+          if ((size_t)(colon - address) >= sizeof host) return -1;
+          memcpy(host, address, colon - address);
+          host[colon - address] = 0;
+          port = colon + 1;
+     }
+     struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE };
+     struct addrinfo *addresses;
+     if (getaddrinfo(host[0] ? host : NULL, port, &hints, &addresses) != 0) return -1;
+     int fd = -1;
+     for (struct addrinfo *a = addresses; a && fd < 0; a = a->ai_next) {
+          fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+          if (fd < 0) continue;
+          int yes = 1;
+          setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+          if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 || listen(fd, SOMAXCONN) != 0) {
+               close(fd);
+               fd = -1;
+          }
+     }
+     freeaddrinfo(addresses);
+     return fd;
+}
+
+// Closing a connection with frames left unread resets it, and the forwarder
+// loses the acknowledgements it did not read yet: it would send those frames
+// again. Instead, this side is shut down, and what the forwarder still sends
+// is read until it closes too, for at most FORWARD_ACK_TIMEOUT_MS.
+static void forward_collect_close_gracefully(int fd)
+{
+     shutdown(fd, SHUT_WR);
+     int64_t deadline_ns = uu_monotonic_ns() + (int64_t)FORWARD_ACK_TIMEOUT_MS * 1000000;
+     char discarded[4096];
+     while (uu_monotonic_ns() < deadline_ns) {
+          struct pollfd pfd = { .fd = fd, .events = POLLIN };
+          if (poll(&pfd, 1, 100) < 0 && errno != EINTR) break;
+          if (pfd.revents && read(fd, discarded, sizeof discarded) <= 0) break;
+     }
+     close(fd);
+}
+
+// Writes the readings of a connection's frames, acknowledging each once
+// written, and moving *committed_offset to its end. Returns the number of
+// frames. *failed is set when a frame could not be written: it is not
+// acknowledged, and the connection is closed.
+static uint64_t forward_collect_connection(int fd, OutputWriter *writer, uint8_t *frame, Reading *readings, uint64_t *num_readings, uint64_t *num_bytes,
+                                           int64_t *committed_offset, int *failed)
+{
+     uint64_t frames = 0;
+     for (;;) {
+          if (uu_read_full(fd, frame, FORWARD_HEADER_SIZE) != FORWARD_HEADER_SIZE) break;
+          int64_t size = forward_frame_size(frame);
+          if (size < 0) {
+               fprintf(stderr, "ERROR: not a frame, closing the connection\n");
+               break;
+          }
+          if (uu_read_full(fd, frame + FORWARD_HEADER_SIZE, size - FORWARD_HEADER_SIZE) != size - FORWARD_HEADER_SIZE) break;
+          if (forward_is_hello(frame)) continue;
+          int n = forward_decode_frame(frame, readings);
+          if (n < 0) {
+               fprintf(stderr, "ERROR: corrupt frame, closing the connection\n");
+               break;
+          }
+          for (int i = 0; i < n; i++) output_writer_append(writer, &readings[i]);
+          if (output_writer_flush(writer) != 0) {
+               fprintf(stderr, "ERROR: could not write the readings, closing the connection\n");
+               *failed = 1;
+               break;
+          }
+          *committed_offset = writer->buffer.file_offset;
+          frames++;
+          *num_readings += n;
+          *num_bytes += size;
+          uint8_t ack[8];
+          binary_put_u64(ack, frames);
+          if (uu_write_all(fd, ack, sizeof ack) != 0) break;
+     }
+     return frames;
+}
+
+#endif
+
+// Receives the frames of forwarders on address, [host:]port, one connection
+// at a time, and writes their readings to target ("-" for standard output)
+// with serializer. Runs until killed; statistics and errors are reported on
+// standard error.
+int forward_collect(char const *address, char const *target, OutputSerializer const *serializer)
+{
+#if defined(WIN32)
+     (void)address, (void)target, (void)serializer;
+     fprintf(stderr, "ERROR: collecting is not supported on Windows\n");
+     return -1;
+#else
+     signal(SIGPIPE, SIG_IGN);
+     int listen_fd = forward_listen(address);
+     if (listen_fd < 0) {
+          fprintf(stderr, "ERROR: could not listen on %s\n", address);
+          return -1;
+     }
+     int out_fd = 0 == strcmp(target, "-") ? 1 : uu_open_for_writing(target);
+     if (out_fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for writing.\n", target);
+          return -1;
+     }
+     OutputWriter writer;
+     uint8_t *frame = malloc(FORWARD_MAX_FRAME_SIZE);
+     Reading *readings = malloc(FORWARD_MAX_FRAME_READINGS * sizeof *readings);
+     if (!frame || !readings || output_writer_init(&writer, out_fd, serializer, OUTPUT_DEFAULT_BUFFER_SIZE) != 0) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          return -1;
+     }
+     output_writer_header(&writer);
+     output_writer_flush(&writer);
+     int64_t committed_offset = writer.buffer.file_offset;
+     for (;;) {
+          int fd = accept(listen_fd, NULL, NULL);
+          if (fd < 0) {
+               if (errno == EINTR) continue;
+               fprintf(stderr, "ERROR: could not accept a connection\n");
+               return -1;
+          }
+          uint64_t num_readings = 0, num_bytes = 0;
+          int64_t start_ns = uu_monotonic_ns();
+          int failed = 0;
+          uint64_t frames = forward_collect_connection(fd, &writer, frame, readings, &num_readings, &num_bytes, &committed_offset, &failed);
+          double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+          if (failed) {
+               forward_collect_close_gracefully(fd);
+          } else {
+               close(fd);
+          }
+          // the forwarder sends the frame again, the next connections are served
+          if (failed && output_writer_rewind(&writer, committed_offset) != 0) {
+               fprintf(stderr, "ERROR: could not cut %s back to the acknowledged frames\n", target);
+               return -1;
+          }
+          fprintf(stderr, "collect\t%llu frames, %llu readings in %.3fs, %.2f bytes/report, %.0f frames/s\n",
+                  (unsigned long long)frames, (unsigned long long)num_readings, seconds,
+                  num_readings ? (double)num_bytes / num_readings : 0.0, seconds > 0 ? frames / seconds : 0.0);
+     }
+#endif
+}
@@ -0,0 +1,463 @@
+// In-memory history
+//
+// The reader keeps round-robin archives of every channel (CO2 ppm,
+// temperature), each a fixed number of consolidated points of a fixed step,
+// e.g. the default 1s:1h,10s:1d,1m:30d,1h:5y: a point per second for an hour,
+// per 10 seconds for a day, per minute for 30 days and per hour for 5 years.
+// A point holds the count, mean, minimum and maximum of the reports of its
+// step. Every report updates the current point of every archive in place, in
+// O(1), and the memory of the archives is allocated once, at start.
+//
+// Point t/step of an archive lives at index (t/step) % points and carries its
+// start second, so that the points overwritten by newer ones, and the steps
+// without reports, are told apart from the ones of a queried range.
+//
+// A thread answers queries on a local (Unix domain) socket, one per
+// connection, as a line:
+//
+//   channel from to [points] [binary]
+//
+// - channel: co2 or temperature
+// - from, to: unix seconds, now, or a duration before now (-1h, -30d)
+// - points: answer from the finest archive with at most that many points
+//   in the range, otherwise the finest one still covering from
+//
+// The answer is tsv, "Time	Count	Mean	Min	Max" then a line per point,
+// or with binary, a HistoryAnswerHeader followed by the HistoryPoints as they
+// are in memory. Errors are a single "ERROR: message" line.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if !defined(WIN32)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+enum { HISTORY_MAX_ARCHIVES = 8 }; // per channel
+enum { HISTORY_MAX_POINTS = 1 << 24 }; // per archive
+enum { HISTORY_COPY_CHUNK_POINTS = 4096 }; // copied per lock of the set
+static char const HISTORY_DEFAULT_SPEC[] = "1s:1h,10s:1d,1m:30d,1h:5y";
+
+typedef struct HistoryPoint
+{
+     int64_t second; // start of the step
+     uint32_t count;
+     float mean;
+     float min;
+     float max;
+} HistoryPoint;
+
+typedef struct HistoryAnswerHeader
+{
+     uint32_t step_seconds;
+     uint32_t num_points;
+} HistoryAnswerHeader;
+
+typedef struct HistoryArchive
+{
+     int64_t step_seconds;
+     int64_t num_points;
+     HistoryPoint *points;
+} HistoryArchive;
+
+typedef struct HistorySet
+{
+     HistoryArchive archives[2][HISTORY_MAX_ARCHIVES]; // per channel, finest first
+     int num_archives;
+     int64_t latest_second[2];
+     UU_Mutex mutex; // the reader updates, the query thread copies
+
+     // query thread
+     char socket_path[256];
+     int listen_fd;
+     HistoryPoint *answer_points; // room for the largest archive
+     char *answer_text;
+     int closing;
+     uint64_t num_queries;
+     int64_t query_ns_max;
+     UU_Thread thread;
+} HistorySet;
+
+static int history_channel_index(ReadingKind kind)
+{
+     return kind == ReadingKind_CO2 ? 0 : kind == ReadingKind_Temperature ? 1 : -1;
+}
+
+// Parses step:retention[,step:retention]..., into steps and numbers of
+// points. Returns the number of archives, or -1 when invalid.
+int history_parse_spec(char const *spec, int64_t *steps, int64_t *num_points)
+{
+     int n = 0;
+     char const *start = spec;
+     for (;;) {
+          char item[64];
+          size_t length = strcspn(start, ",");
+          if (length >= sizeof item || n == HISTORY_MAX_ARCHIVES) return -1;
+          memcpy(item, start, length);
+          item[length] = 0;
+          char *colon = strchr(item, ':');
+          if (!colon) return -1;
+          *colon = 0;
+          int64_t step = window_parse_duration(item);
+          int64_t retention = window_parse_duration(colon + 1);
+          if (step <= 0 || retention < step || retention / step > HISTORY_MAX_POINTS) return -1;
+          steps[n] = step;
+          num_points[n] = retention / step;
+          n++;
+          if (!start[length]) break;
+          start += length + 1;
+     }
+     // finest first
+     for (int i = 1; i < n; i++) {
+          for (int j = i; j > 0 && steps[j] < steps[j - 1]; j--) {
+               int64_t step = steps[j], points = num_points[j];
+               steps[j] = steps[j - 1];
+               num_points[j] = num_points[j - 1];
+               steps[j - 1] = step;
+               num_points[j - 1] = points;
+          }
+     }
+     return n;
+}
+
+//
+// Updates, in the reader
+//
+
+// Called with every decoded report of a channel, whether or not it is output
+void history_set_add(HistorySet *set, Reading const *reading)
+{
+     int c = history_channel_index(reading->kind);
+     if (c < 0) return;
+     int64_t second = reading->time_unix_ns / NS_PER_SECOND;
+     float value = reading->kind == ReadingKind_CO2 ? (float)reading->co2_in_ppm : reading->temperature_in_C;
+     uu_mutex_lock(&set->mutex);
+     if (second > set->latest_second[c]) set->latest_second[c] = second;
+     for (int i = 0; i < set->num_archives; i++) {
+          HistoryArchive *archive = &set->archives[c][i];
+          int64_t start = second - second % archive->step_seconds;
+          HistoryPoint *point = &archive->points[(start / archive->step_seconds) % archive->num_points];
+          if (point->second != start) {
+               // an older point, or one from a clock set back: replaced
+               *point = (HistoryPoint){ .second = start, .count = 1, .mean = value, .min = value, .max = value };
+          } else {
+               point->count++;
+               point->mean += (value - point->mean) / point->count;
+               if (value < point->min) point->min = value;
+               if (value > point->max) point->max = value;
+          }
+     }
+     uu_mutex_unlock(&set->mutex);
+}
+
+//
+// Queries, in the query thread
+//
+
+// Copies the points of [from, to] into set->answer_points. Returns their
+// number, and the archive in *archive_index.
+static int64_t history_set_copy(HistorySet *set, int c, int64_t from, int64_t to, int64_t max_points, int *archive_index)
+{
+     uu_mutex_lock(&set->mutex);
+     int64_t latest = set->latest_second[c];
+     int chosen = set->num_archives - 1;
+     for (int i = 0; i < set->num_archives; i++) {
+          HistoryArchive const *archive = &set->archives[c][i];
+          int64_t oldest = latest - latest % archive->step_seconds - (archive->num_points - 1) * archive->step_seconds;
+          int64_t num_steps = (to - from) / archive->step_seconds + 1;
+          if (from >= oldest && (!max_points || num_steps <= max_points)) {
+               chosen = i;
+               break;
+          }
+     }
+     HistoryArchive const *archive = &set->archives[c][chosen];
+     int64_t step = archive->step_seconds;
+     int64_t oldest = latest - latest % step - (archive->num_points - 1) * step;
+     int64_t first = from - from % step;
+     if (first < oldest) first = oldest;
+     if (to > latest) to = latest;
+     uu_mutex_unlock(&set->mutex);
+
+     // At most num_points steps, in chunks: the reader waits for one chunk,
+     // not for the whole archive. A point it replaces meanwhile is newer than
+     // latest, and left out like one that was never filled.
+     int64_t n = 0;
+     for (int64_t start = first; start <= to;) {
+          int64_t chunk_end = start + (HISTORY_COPY_CHUNK_POINTS - 1) * step;
+          if (chunk_end > to) chunk_end = to;
+          uu_mutex_lock(&set->mutex);
+          for (; start <= chunk_end; start += step) {
+               HistoryPoint const *point = &archive->points[(start / step) % archive->num_points];
+               if (point->second == start && point->count) set->answer_points[n++] = *point;
+          }
+          uu_mutex_unlock(&set->mutex);
+     }
+     *archive_index = chosen;
+     return n;
+}
+
+// Accepts unix seconds, now, or -duration
+static int history_parse_time(char const *text, int64_t now, int64_t *second)
+{
+     if (0 == strcmp(text, "now")) {
+          *second = now;
+          return 0;
+     }
+     if (text[0] == '-') {
+          int64_t duration = window_parse_duration(text + 1);
+          *second = now - duration;
+          return duration > 0 ? 0 : -1;
+     }
+     char *end;
+     long long value = strtoll(text, &end, 10);
+     *second = value;
+     return end != text && !*end ? 0 : -1;
+}
+
+#if !defined(WIN32)
+static void history_set_answer(HistorySet *set, int fd, char *request)
+{
+     char const *error = NULL;
+     char *tokens[6];
+     int num_tokens = 0;
+     for (char *token = strtok(request, " \t\r\n"); token && num_tokens < 6; token = strtok(NULL, " \t\r\n")) {
+          tokens[num_tokens++] = token;
+     }
+     int c = -1;
+     int64_t from = 0, to = 0, max_points = 0;
+     int binary = 0;
+     int64_t now = (int64_t)time(NULL);
+     if (num_tokens < 3) {
+          error = "expected channel from to [points] [binary]";
+     } else if ((c = 0 == strcmp(tokens[0], "co2") ? 0 : 0 == strcmp(tokens[0], "temperature") ? 1 : -1) < 0) {
+          error = "expected co2 or temperature";
+     } else if (history_parse_time(tokens[1], now, &from) != 0 || history_parse_time(tokens[2], now, &to) != 0 || to < from) {
+          error = "expected from and to as unix seconds, now or -duration, from first";
+     }
+     for (int i = 3; !error && i < num_tokens; i++) {
+          if (0 == strcmp(tokens[i], "binary")) {
+               binary = 1;
+          } else if ((max_points = atoll(tokens[i])) <= 0) {
+               error = "expected a positive number of points, or binary";
+          }
+     }
+     if (error) {
+          char line[128];
+          int size = snprintf(line, sizeof line, "ERROR: %s\n", error);
+          uu_write_all(fd, line, size);
+          return;
+     }
+
+     int archive_index;
+     int64_t n = history_set_copy(set, c, from, to, max_points, &archive_index);
+     int64_t step = set->archives[c][archive_index].step_seconds;
+     if (binary) {
+          HistoryAnswerHeader header = { .step_seconds = (uint32_t)step, .num_points = (uint32_t)n };
+          if (uu_write_all(fd, &header, sizeof header) == 0) uu_write_all(fd, set->answer_points, n * sizeof(HistoryPoint));
+          return;
+     }
+     // tsv, written in chunks
+     enum { CHUNK_SIZE = 1 << 16 };
+     char *text = set->answer_text;
+     char *dst = output_append_string(text, "Time\tCount\tMean\tMin\tMax\n");
+     OutputTimeCache time_cache = {0};
+     for (int64_t i = 0; i < n; i++) {
+          HistoryPoint const *point = &set->answer_points[i];
+          Reading reading = { .time_unix_ns = point->second * NS_PER_SECOND };
+          dst = output_append_time(dst, &time_cache, &reading);
+          *dst++ = '\t';
+          dst = output_append_uint(dst, point->count);
+          *dst++ = '\t';
+          dst = output_append_float6(dst, point->mean);
+          *dst++ = '\t';
+          dst = output_append_float6(dst, point->min);
+          *dst++ = '\t';
+          dst = output_append_float6(dst, point->max);
+          *dst++ = '\n';
+          if (dst - text > CHUNK_SIZE) {
+               if (uu_write_all(fd, text, dst - text) != 0) return;
+               dst = text;
+          }
+     }
+     uu_write_all(fd, text, dst - text);
+}
+
+static void history_set_serve(void *arg)
+{
+     HistorySet *set = arg;
+     for (;;) {
+          uu_mutex_lock(&set->mutex);
+          int closing = set->closing;
+          uu_mutex_unlock(&set->mutex);
+          if (closing) break;
+
+          struct pollfd listening = { .fd = set->listen_fd, .events = POLLIN };
+          if (poll(&listening, 1, 200) <= 0) continue;
+          int fd = accept(set->listen_fd, NULL, NULL);
+          if (fd < 0) continue;
+          // a client that does not send its request does not hold the others
+          struct timeval timeout = { .tv_sec = 1 };
+          setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+          char request[256];
+          size_t used = 0;
+          while (used < sizeof request - 1 && !memchr(request, '\n', used)) {
+               ssize_t size = recv(fd, request + used, sizeof request - 1 - used, 0);
+               if (size <= 0) break;
+               used += size;
+          }
+          request[used] = 0;
+          int64_t start_ns = uu_monotonic_ns();
+          history_set_answer(set, fd, request);
+          int64_t query_ns = uu_monotonic_ns() - start_ns;
+          close(fd);
+
+          uu_mutex_lock(&set->mutex);
+          set->num_queries++;
+          if (query_ns > set->query_ns_max) set->query_ns_max = query_ns;
+          uu_mutex_unlock(&set->mutex);
+     }
+}
+#endif
+
+//
+// Set up, stats and tear down
+//
+
+// Allocates the archives of spec (see history_parse_spec) and starts
+// answering queries on socket_path. Errors are reported on standard error.
+int history_set_open(HistorySet *set, char const *spec, char const *socket_path)
+{
+     memset(set, 0, sizeof *set);
+     set->listen_fd = -1;
+#if defined(WIN32)
+     (void)spec;
+     (void)socket_path;
+     fprintf(stderr, "ERROR: the history socket is not supported on Windows\n");
+     return -1;
+#else
+     int64_t steps[HISTORY_MAX_ARCHIVES], num_points[HISTORY_MAX_ARCHIVES];
+     set->num_archives = history_parse_spec(spec, steps, num_points);
+     if (set->num_archives <= 0) {
+          fprintf(stderr, "ERROR: invalid history %s\n", spec);
+          return -1;
+     }
+     int64_t max_points = 0;
+     for (int c = 0; c < 2; c++) {
+          set->latest_second[c] = INT64_MIN / 2;
+          for (int i = 0; i < set->num_archives; i++) {
+               HistoryArchive *archive = &set->archives[c][i];
+               archive->step_seconds = steps[i];
+               archive->num_points = num_points[i];
+               archive->points = memory_calloc(num_points[i], sizeof *archive->points);
+               if (!archive->points) {
+                    fprintf(stderr, "ERROR: could not allocate the history\n");
+                    return -1;
+               }
+               if (num_points[i] > max_points) max_points = num_points[i];
+          }
+     }
+     set->answer_points = memory_alloc(max_points * sizeof *set->answer_points);
+     set->answer_text = memory_alloc((1 << 16) + OUTPUT_MAX_RECORD_SIZE);
+     if (!set->answer_points || !set->answer_text) {
+          fprintf(stderr, "ERROR: could not allocate the history\n");
+          return -1;
+     }
+
+     struct sockaddr_un address = { .sun_family = AF_UNIX };
+     if (strlen(socket_path) >= sizeof address.sun_path || strlen(socket_path) >= sizeof set->socket_path) {
+          fprintf(stderr, "ERROR: history socket path too long: %s\n", socket_path);
+          return -1;
+     }
+     strcpy(address.sun_path, socket_path);
+     strcpy(set->socket_path, socket_path);
+     unlink(socket_path); // left by a previous run
+     set->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+     if (set->listen_fd < 0 || bind(set->listen_fd, (struct sockaddr *)&address, sizeof address) != 0
+         || listen(set->listen_fd, 16) != 0) {
+          fprintf(stderr, "ERROR: could not listen on %s\n", socket_path);
+          return -1;
+     }
+     uu_mutex_init(&set->mutex);
+     if (uu_thread_start(&set->thread, history_set_serve, set) != 0) {
+          fprintf(stderr, "ERROR: could not start the history thread\n");
+          return -1;
+     }
+     return 0;
+#endif
+}
+
+void history_set_print_stats(HistorySet *set, FILE *out)
+{
+     int64_t num_points = 0;
+     for (int i = 0; i < set->num_archives; i++) num_points += set->archives[0][i].num_points;
+     uu_mutex_lock(&set->mutex);
+     uint64_t num_queries = set->num_queries;
+     int64_t query_ns_max = set->query_ns_max;
+     uu_mutex_unlock(&set->mutex);
+     fprintf(out, "history\tarchives=%d points=%lld memory=%lldKiB queries=%llu query_us max=%.0f\n",
+             set->num_archives, (long long)(2 * num_points),
+             (long long)(2 * num_points * (int64_t)sizeof(HistoryPoint) >> 10),
+             (unsigned long long)num_queries, query_ns_max / 1e3);
+}
+
+void history_set_close(HistorySet *set)
+{
+#if !defined(WIN32)
+     uu_mutex_lock(&set->mutex);
+     set->closing = 1;
+     uu_mutex_unlock(&set->mutex);
+     uu_thread_join(&set->thread);
+     close(set->listen_fd);
+     unlink(set->socket_path);
+     uu_mutex_destroy(&set->mutex);
+#endif
+     for (int c = 0; c < 2; c++) {
+          for (int i = 0; i < set->num_archives; i++) memory_free(set->archives[c][i].points);
+     }
+     memory_free(set->answer_points);
+     memory_free(set->answer_text);
+}
+
+// Sends request to the history socket at path and copies the answer to fd
+int history_query(char const *path, char const *request, int fd)
+{
+#if defined(WIN32)
+     (void)path;
+     (void)request;
+     (void)fd;
+     fprintf(stderr, "ERROR: the history socket is not supported on Windows\n");
+     return -1;
+#else
+     struct sockaddr_un address = { .sun_family = AF_UNIX };
+     if (strlen(path) >= sizeof address.sun_path) return -1;
+     strcpy(address.sun_path, path);
+     int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+     if (socket_fd < 0 || connect(socket_fd, (struct sockaddr *)&address, sizeof address) != 0) {
+          fprintf(stderr, "ERROR: could not connect to %s\n", path);
+          if (socket_fd >= 0) close(socket_fd);
+          return -1;
+     }
+     int rc = uu_write_all(socket_fd, request, strlen(request));
+     static char buffer[1 << 16];
+     for (;;) {
+          ssize_t size = recv(socket_fd, buffer, sizeof buffer, 0);
+          if (size <= 0) {
+               if (size < 0) rc = -1;
+               break;
+          }
+          if (uu_write_all(fd, buffer, size) != 0) {
+               rc = -1;
+               break;
+          }
+     }
+     close(socket_fd);
+     return rc;
+#endif
+}
@@ -0,0 +1,338 @@
+// Import of tsv outputs
+//
+// co2 import converts files in the tsv layout written by the reader (Time
+// Reading Value) into the binary format, or into a columnar one, on every
+// processor:
+//
+// - the input is memory mapped and cut into blocks of whole lines, a block
+//   per thread and round. Newlines are found 16 bytes at a time with SSE2 or
+//   NEON where available.
+// - lines are parsed by tsv_parse_reading, in a single pass over the fixed
+//   layout, without strtod or sscanf.
+// - every thread fills its own output buffer, sized from the count of
+//   newlines of its block, and the blocks are written in order.
+//
+// With --verify, every parsed line is decoded back from the output, written
+// again with the tsv serializer and compared to the input, byte for byte.
+// Lines which are not readings (the header) are counted as skipped.
+//
+// Columnar: an 8 bytes magic CO2COL1\n followed by a group per block, each
+// the number n of readings as u32 then its columns, little-endian:
+//
+//   i64 time_unix_ns[n], u8 kind[n], u8 opcode[n], u16 raw_value[n],
+//   i32/f32 co2_in_ppm or temperature_in_C[n]
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMPORT_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMPORT_NEON 1
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+enum { IMPORT_BLOCK_SIZE = 16 << 20 };
+enum { IMPORT_MAX_THREADS = 64 };
+
+typedef enum ImportFormat
+{
+     ImportFormat_Binary,
+     ImportFormat_Columnar,
+     NumImportFormats,
+} ImportFormat;
+
+static char const *IMPORT_FORMAT_NAMES[NumImportFormats] = {
+     [ImportFormat_Binary] = "binary",
+     [ImportFormat_Columnar] = "columnar",
+};
+
+static char const COLUMNAR_MAGIC[8] = { 'C', 'O', '2', 'C', 'O', 'L', '1', '\n' };
+
+typedef struct ImportTask
+{
+     char const *begin; // whole lines
+     char const *end;
+     ImportFormat format;
+     int verify;
+
+     uint8_t *output;
+     size_t output_capacity;
+     size_t output_size;
+     TsvTimeCache time_cache;
+
+     uint64_t num_readings;
+     uint64_t num_skipped_lines;
+     uint64_t num_mismatches;
+     UU_Thread thread;
+} ImportTask;
+
+//
+// Byte scanning
+//
+
+static int import_count_trailing_zeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+     unsigned long index;
+     _BitScanForward(&index, mask);
+     return (int)index;
+#else
+     return __builtin_ctz(mask);
+#endif
+}
+
+static int import_popcount(uint32_t mask)
+{
+#if defined(_MSC_VER)
+     return (int)__popcnt(mask);
+#else
+     return __builtin_popcount(mask);
+#endif
+}
+
+// First newline of [p, end), or NULL
+static char const *import_find_newline(char const *p, char const *end)
+{
+#if defined(IMPORT_SSE2)
+     __m128i const newline = _mm_set1_epi8('\n');
+     for (; end - p >= 16; p += 16) {
+          uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)p), newline));
+          if (mask) return p + import_count_trailing_zeros(mask);
+     }
+#elif defined(IMPORT_NEON)
+     uint8x16_t const newline = vdupq_n_u8('\n');
+     for (; end - p >= 16; p += 16) {
+          uint8x16_t equal = vceqq_u8(vld1q_u8((uint8_t const *)p), newline);
+          if (vmaxvq_u8(equal)) break; // found in this vector, located below
+     }
+#endif
+     for (; p < end; p++) {
+          if (*p == '\n') return p;
+     }
+     return NULL;
+}
+
+static size_t import_count_newlines(char const *p, char const *end)
+{
+     size_t count = 0;
+#if defined(IMPORT_SSE2)
+     __m128i const newline = _mm_set1_epi8('\n');
+     for (; end - p >= 16; p += 16) {
+          count += import_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)p), newline)));
+     }
+#elif defined(IMPORT_NEON)
+     uint8x16_t const newline = vdupq_n_u8('\n');
+     uint8x16_t const one = vdupq_n_u8(1);
+     for (; end - p >= 16; p += 16) {
+          count += vaddvq_u8(vandq_u8(vceqq_u8(vld1q_u8((uint8_t const *)p), newline), one));
+     }
+#endif
+     for (; p < end; p++) count += *p == '\n';
+     return count;
+}
+
+// Start of the first line at or after p, which looks like a reading: cuts
+// between blocks avoid the newlines written as raw opcode bytes
+static char const *import_find_line_start(char const *p, char const *end)
+{
+     for (;;) {
+          char const *newline = import_find_newline(p, end);
+          if (!newline) return end;
+          p = newline + 1;
+          if (end - p >= 20 && p[4] == '-' && p[10] == 'T' && p[19] == '\t') return p;
+     }
+}
+
+//
+// Conversion of a block, on a thread
+//
+
+static void import_columnar_get(uint8_t const *group, uint32_t n, uint32_t i, Reading *reading)
+{
+     uint8_t const *times = group + 4;
+     uint8_t const *kinds = times + 8 * (size_t)n;
+     uint8_t const *opcodes = kinds + n;
+     uint8_t const *raw_values = opcodes + n;
+     uint8_t const *values = raw_values + 2 * (size_t)n;
+     reading->time_unix_ns = (int64_t)binary_get_u64(times + 8 * (size_t)i);
+     reading->kind = kinds[i];
+     reading->opcode = opcodes[i];
+     reading->raw_value = binary_get_u16(raw_values + 2 * (size_t)i);
+     uint32_t value = binary_get_u32(values + 4 * (size_t)i);
+     memcpy(&reading->co2_in_ppm, &value, sizeof value);
+}
+
+static void import_run(void *arg)
+{
+     ImportTask *task = arg;
+     // every reading is a line: the newlines bound the number of records
+     size_t max_readings = import_count_newlines(task->begin, task->end) + 1;
+     size_t capacity = 4 + max_readings * BINARY_RECORD_SIZE;
+     if (capacity > task->output_capacity) {
+          free(task->output);
+          task->output = malloc(capacity);
+          task->output_capacity = task->output ? capacity : 0;
+          if (!task->output) {
+               task->output_size = 0;
+               task->num_skipped_lines = max_readings;
+               return;
+          }
+     }
+     uint8_t *records = task->output;
+     // columns are first filled at the offsets of max_readings, then packed
+     uint8_t *times = task->output + 4;
+     uint8_t *kinds = times + 8 * max_readings;
+     uint8_t *opcodes = kinds + max_readings;
+     uint8_t *raw_values = opcodes + max_readings;
+     uint8_t *values = raw_values + 2 * max_readings;
+
+     OutputSerializer const *tsv = output_serializer_find("tsv");
+     OutputTimeCache output_time_cache = {0};
+     size_t n = 0;
+     for (char const *p = task->begin; p < task->end;) {
+          Reading reading;
+          char const *next = tsv_parse_reading(p, task->end, &task->time_cache, &reading);
+          if (!next) {
+               char const *newline = import_find_newline(p, task->end);
+               p = newline ? newline + 1 : task->end;
+               task->num_skipped_lines++;
+               continue;
+          }
+          if (task->format == ImportFormat_Binary) {
+               binary_pack_reading(records + n * BINARY_RECORD_SIZE, &reading);
+          } else {
+               binary_put_u64(times + 8 * n, (uint64_t)reading.time_unix_ns);
+               kinds[n] = reading.kind;
+               opcodes[n] = reading.opcode;
+               binary_put_u16(raw_values + 2 * n, reading.raw_value);
+               uint32_t value;
+               memcpy(&value, &reading.co2_in_ppm, sizeof value);
+               binary_put_u32(values + 4 * n, value);
+          }
+          if (task->verify) {
+               Reading decoded;
+               if (task->format == ImportFormat_Binary) {
+                    binary_unpack_reading(records + n * BINARY_RECORD_SIZE, &decoded);
+               } else {
+                    import_columnar_get(task->output, (uint32_t)max_readings, (uint32_t)n, &decoded);
+               }
+               char line[OUTPUT_MAX_RECORD_SIZE];
+               char *line_end = tsv->write_reading(line, &output_time_cache, &decoded);
+               if (line_end - line != next - p || memcmp(line, p, next - p) != 0) task->num_mismatches++;
+          }
+          n++;
+          p = next;
+     }
+     task->num_readings = n;
+     if (task->format == ImportFormat_Binary) {
+          task->output_size = n * BINARY_RECORD_SIZE;
+     } else {
+          binary_put_u32(task->output, (uint32_t)n);
+          // pack the columns, in order, each moving down
+          uint8_t *dst = times + 8 * n;
+          memmove(dst, kinds, n);
+          dst += n;
+          memmove(dst, opcodes, n);
+          dst += n;
+          memmove(dst, raw_values, 2 * n);
+          dst += 2 * n;
+          memmove(dst, values, 4 * n);
+          dst += 4 * n;
+          task->output_size = n ? (size_t)(dst - task->output) : 0;
+     }
+}
+
+//
+// Command
+//
+
+// Converts the tsv at path to format, written to target ("-" for standard
+// output, NULL for none). Statistics and errors are reported on standard
+// error. Returns 0, or -1 on errors and verification mismatches.
+int import_tsv(char const *path, char const *target, ImportFormat format, int num_threads, int verify)
+{
+     static ImportTask tasks[IMPORT_MAX_THREADS];
+     if (num_threads <= 0) num_threads = uu_cpu_count();
+     if (num_threads > IMPORT_MAX_THREADS) num_threads = IMPORT_MAX_THREADS;
+
+     UU_FileMapping input;
+     if (uu_map_file_for_reading(&input, path) != 0) {
+          fprintf(stderr, "ERROR: could not map %s (missing or empty?)\n", path);
+          return -1;
+     }
+     int fd = -1;
+     if (target) {
+          fd = 0 == strcmp(target, "-") ? 1 : uu_open_for_writing(target);
+          if (fd < 0) {
+               fprintf(stderr, "ERROR: could not open %s for writing.\n", target);
+               uu_unmap_file(&input);
+               return -1;
+          }
+#if defined(WIN32)
+          if (fd == 1) _setmode(fd, _O_BINARY);
+#endif
+          char const *magic = format == ImportFormat_Binary ? BINARY_MAGIC : COLUMNAR_MAGIC;
+          if (uu_write_all(fd, magic, 8) != 0) fd = -2;
+     }
+
+     int64_t start_ns = uu_monotonic_ns();
+     char const *data = input.data;
+     char const *end = data + input.size;
+     char const *p = data;
+     uint64_t num_readings = 0, num_skipped_lines = 0, num_mismatches = 0;
+     int rc = fd == -2 ? -1 : 0;
+     while (p < end && rc == 0) {
+          int n = 0;
+          for (; n < num_threads && p < end; n++) {
+               ImportTask *task = &tasks[n];
+               task->begin = p;
+               task->end = end - p > IMPORT_BLOCK_SIZE ? import_find_line_start(p + IMPORT_BLOCK_SIZE - 1, end) : end;
+               task->format = format;
+               task->verify = verify;
+               task->num_readings = task->num_skipped_lines = task->num_mismatches = 0;
+               p = task->end;
+               if (uu_thread_start(&task->thread, import_run, task) != 0) {
+                    fprintf(stderr, "ERROR: could not start an import thread\n");
+                    rc = -1;
+                    break;
+               }
+          }
+          for (int i = 0; i < n; i++) {
+               ImportTask *task = &tasks[i];
+               uu_thread_join(&task->thread);
+               num_readings += task->num_readings;
+               num_skipped_lines += task->num_skipped_lines;
+               num_mismatches += task->num_mismatches;
+               if (!task->output) rc = -1;
+               if (rc == 0 && fd >= 0 && task->output_size && uu_write_all(fd, task->output, task->output_size) != 0) {
+                    fprintf(stderr, "ERROR: could not write %s\n", target);
+                    rc = -1;
+               }
+          }
+     }
+     double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+     fprintf(stderr, "import\t%lld bytes, %llu readings, %llu skipped lines in %.3fs, %.0f MB/s, %d threads\n",
+             (long long)input.size, (unsigned long long)num_readings, (unsigned long long)num_skipped_lines, seconds,
+             input.size / 1e6 / seconds, num_threads);
+     if (verify) {
+          fprintf(stderr, "verify\t%llu lines differ once written back\n", (unsigned long long)num_mismatches);
+          if (num_mismatches) rc = -1;
+     }
+     if (fd > 1) uu_close(fd);
+     for (int i = 0; i < num_threads; i++) {
+          free(tasks[i].output);
+          tasks[i].output = NULL;
+          tasks[i].output_capacity = 0;
+     }
+     uu_unmap_file(&input);
+     return rc;
+}
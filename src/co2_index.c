@@ -0,0 +1,327 @@
+// Time range lookups in outputs
+//
+// extract writes the records of a time range of an output, found in
+// O(log n) and copied in O(result), both files memory mapped:
+//
+// - binary outputs: binary search on the fixed size records
+// - tsv outputs with a sidecar index (see OutputIndex): binary search on the
+//   entries, then on the lines between the two entries around the range
+// - tsv outputs without one: binary search on the file itself, every probe
+//   moving to the start of the next line
+// - archives: binary search on the index of their blocks, the readings of
+//   the blocks in the range decoded and written as tsv
+//
+// Outputs must be in time order, as the reader writes them unless the clock
+// is set back.
+//
+// index bootstraps the sidecar index of an existing tsv output: an entry per
+// interval of time, each found by binary search, so O(entries log n).
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { INDEX_SCAN_SIZE = 4096 }; // below this, ranges of lines are scanned
+
+typedef struct IndexedFile
+{
+     UU_FileMapping mapping;
+     char const *data;
+     int64_t size;
+     int is_binary;
+     int64_t data_start; // after the magic or the tsv header
+     TsvTimeCache time_cache;
+
+     UU_FileMapping index_mapping; // data NULL when none
+     uint8_t const *entries;
+     int64_t num_entries;
+} IndexedFile;
+
+// Time of the reading of the line at offset. Returns -1 when not a reading.
+static int index_line_time(IndexedFile *file, int64_t offset, int64_t *time_unix_ns, int64_t *next)
+{
+     Reading reading;
+     char const *end = tsv_parse_reading(file->data + offset, file->data + file->size, &file->time_cache, &reading);
+     if (!end) {
+          char const *newline = memchr(file->data + offset, '\n', file->size - offset);
+          *next = newline ? newline + 1 - file->data : file->size;
+          return -1;
+     }
+     *time_unix_ns = reading.time_unix_ns;
+     *next = end - file->data;
+     return 0;
+}
+
+// First line start at or after offset
+static int64_t index_line_start_at(IndexedFile *file, int64_t offset)
+{
+     if (offset <= file->data_start) return file->data_start;
+     return import_find_line_start(file->data + offset - 1, file->data + file->size) - file->data;
+}
+
+// First line starting in [lo, hi) with a time at or after time_unix_ns, or
+// hi. Lines starting before lo are known to be earlier, and the ones at or
+// after hi not to be.
+static int64_t index_lower_bound(IndexedFile *file, int64_t lo, int64_t hi, int64_t time_unix_ns)
+{
+     int64_t time, next;
+     if (file->is_binary) {
+          int64_t first = (lo - file->data_start + BINARY_RECORD_SIZE - 1) / BINARY_RECORD_SIZE;
+          int64_t last = (hi - file->data_start) / BINARY_RECORD_SIZE;
+          while (first < last) {
+               int64_t middle = first + (last - first) / 2;
+               Reading reading;
+               binary_unpack_reading((uint8_t const *)file->data + file->data_start + middle * BINARY_RECORD_SIZE, &reading);
+               if (reading.time_unix_ns < time_unix_ns) {
+                    first = middle + 1;
+               } else {
+                    last = middle;
+               }
+          }
+          return file->data_start + first * BINARY_RECORD_SIZE;
+     }
+     while (hi - lo > INDEX_SCAN_SIZE) {
+          int64_t middle = index_line_start_at(file, lo + (hi - lo) / 2);
+          if (middle >= hi) {
+               hi = lo + (hi - lo) / 2;
+          } else if (index_line_time(file, middle, &time, &next) != 0 || time < time_unix_ns) {
+               lo = next;
+          } else {
+               hi = middle;
+          }
+     }
+     for (int64_t offset = index_line_start_at(file, lo); offset < hi; offset = next) {
+          if (index_line_time(file, offset, &time, &next) == 0 && time >= time_unix_ns) return offset;
+     }
+     return hi;
+}
+
+static void index_get_entry(IndexedFile const *file, int64_t i, OutputIndexEntry *entry)
+{
+     output_index_unpack_entry(file->entries + i * OUTPUT_INDEX_ENTRY_SIZE, entry);
+}
+
+// Checks that an entry points to the start of a line of its time, which
+// the tsv output truncates to the second
+static int index_entry_is_valid(IndexedFile *file, OutputIndexEntry const *entry)
+{
+     int64_t time, next;
+     if (entry->offset < file->data_start || entry->offset >= file->size) return 0;
+     if (entry->offset > file->data_start && file->data[entry->offset - 1] != '\n') return 0;
+     return index_line_time(file, entry->offset, &time, &next) == 0
+            && time == entry->time_unix_ns - entry->time_unix_ns % NS_PER_SECOND;
+}
+
+// First record at or after time_unix_ns, narrowed by the index if any
+static int64_t index_find(IndexedFile *file, int64_t time_unix_ns)
+{
+     int64_t lo = file->data_start, hi = file->size;
+     if (file->num_entries) {
+          // first entry at or after the time
+          int64_t first = 0, last = file->num_entries;
+          while (first < last) {
+               int64_t middle = first + (last - first) / 2;
+               OutputIndexEntry entry;
+               index_get_entry(file, middle, &entry);
+               if (entry.time_unix_ns < time_unix_ns) {
+                    first = middle + 1;
+               } else {
+                    last = middle;
+               }
+          }
+          OutputIndexEntry before = { 0, -1 }, after = { 0, -1 };
+          if (first > 0) index_get_entry(file, first - 1, &before);
+          if (first < file->num_entries) index_get_entry(file, first, &after);
+          if ((before.offset >= 0 && !index_entry_is_valid(file, &before))
+              || (after.offset >= 0 && !index_entry_is_valid(file, &after))) {
+               fprintf(stderr, "WARNING: the index does not match the file, searching the file instead\n");
+               file->num_entries = 0;
+          } else {
+               if (before.offset >= 0) lo = before.offset + 1;
+               if (after.offset >= 0) hi = after.offset;
+          }
+     }
+     return index_lower_bound(file, lo, hi, time_unix_ns);
+}
+
+static void index_close(IndexedFile *file)
+{
+     if (file->index_mapping.data) uu_unmap_file(&file->index_mapping);
+     uu_unmap_file(&file->mapping);
+}
+
+// Maps path and, with use_index, its sidecar index when there is one.
+// Errors are reported on standard error.
+static int index_open(IndexedFile *file, char const *path, int use_index)
+{
+     memset(file, 0, sizeof *file);
+     if (uu_map_file_for_reading(&file->mapping, path) != 0) {
+          fprintf(stderr, "ERROR: could not map %s (missing or empty?)\n", path);
+          return -1;
+     }
+     file->data = file->mapping.data;
+     file->size = file->mapping.size;
+     file->is_binary = file->size >= (int64_t)sizeof BINARY_MAGIC && 0 == memcmp(file->data, BINARY_MAGIC, sizeof BINARY_MAGIC);
+     if (file->is_binary) {
+          file->data_start = sizeof BINARY_MAGIC;
+          file->size -= (file->size - file->data_start) % BINARY_RECORD_SIZE; // torn last record
+          return 0;
+     }
+     // the header, or whatever precedes the first reading
+     int64_t time, next;
+     while (file->data_start < file->size && index_line_time(file, file->data_start, &time, &next) != 0) {
+          file->data_start = next;
+          if (file->data_start > INDEX_SCAN_SIZE) {
+               fprintf(stderr, "ERROR: %s is neither a tsv nor a binary output\n", path);
+               index_close(file);
+               return -1;
+          }
+     }
+     char index_path[1024];
+     snprintf(index_path, sizeof index_path, "%s.idx", path);
+     if (use_index && uu_map_file_for_reading(&file->index_mapping, index_path) == 0) {
+          if (file->index_mapping.size >= (int64_t)sizeof INDEX_MAGIC
+              && 0 == memcmp(file->index_mapping.data, INDEX_MAGIC, sizeof INDEX_MAGIC)) {
+               file->entries = (uint8_t const *)file->index_mapping.data + sizeof INDEX_MAGIC;
+               file->num_entries = (file->index_mapping.size - (int64_t)sizeof INDEX_MAGIC) / OUTPUT_INDEX_ENTRY_SIZE;
+          } else {
+               fprintf(stderr, "WARNING: %s is not an index, ignored\n", index_path);
+          }
+     }
+     return 0;
+}
+
+// Writes the header and the records of [from_unix_ns, to_unix_ns) of the
+// output at path to fd. Errors are reported on standard error.
+// Archives (see co2_archive.c) are written as tsv, from the first block
+// that may hold readings of the range on
+static int index_extract_archive(Archive const *archive, int64_t from_unix_ns, int64_t to_unix_ns, int fd)
+{
+     OutputWriter writer;
+     Reading *readings = malloc(FORWARD_MAX_FRAME_READINGS * sizeof *readings);
+     if (!readings || output_writer_init(&writer, fd, output_serializer_find("tsv"), OUTPUT_DEFAULT_BUFFER_SIZE) != 0) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          free(readings);
+          return -1;
+     }
+     output_writer_header(&writer);
+     int rc = 0;
+     for (int i = archive_find_block(archive, from_unix_ns); i < archive->num_blocks && rc == 0; i++) {
+          ArchiveBlock block;
+          archive_get_block(archive, i, &block);
+          if (block.min_ns >= to_unix_ns) break;
+          int n = archive_decode_block(archive, i, readings);
+          if (n < 0) {
+               fprintf(stderr, "ERROR: corrupt archive block %d\n", i);
+               rc = -1;
+          }
+          for (int j = 0; j < n; j++) {
+               if (readings[j].time_unix_ns >= from_unix_ns && readings[j].time_unix_ns < to_unix_ns) output_writer_append(&writer, &readings[j]);
+          }
+     }
+     if (output_writer_flush(&writer) != 0) rc = -1;
+     output_writer_destroy(&writer);
+     free(readings);
+     return rc;
+}
+
+int index_extract(char const *path, int64_t from_unix_ns, int64_t to_unix_ns, int fd)
+{
+     Archive archive;
+     UU_FileMapping mapping;
+     int mapped = uu_map_file_for_reading(&mapping, path) == 0;
+     if (mapped && archive_is_archive(mapping.data, mapping.size)) {
+          int rc = archive_parse(&archive, mapping.data, mapping.size, path);
+          if (rc == 0) rc = index_extract_archive(&archive, from_unix_ns, to_unix_ns, fd);
+          uu_unmap_file(&mapping);
+          return rc;
+     }
+     if (mapped) uu_unmap_file(&mapping);
+     IndexedFile file;
+     if (index_open(&file, path, 1) != 0) return -1;
+     int64_t begin = index_find(&file, from_unix_ns);
+     int64_t end = index_find(&file, to_unix_ns);
+     if (end < begin) end = begin;
+     int rc = uu_write_all(fd, file.data, file.data_start);
+     if (rc == 0) rc = uu_write_all(fd, file.data + begin, end - begin);
+     index_close(&file);
+     return rc;
+}
+
+// Writes the sidecar index of the tsv output at path, an entry at the first
+// line of every every_seconds of time
+int index_bootstrap(char const *path, int64_t every_seconds)
+{
+     IndexedFile file;
+     if (index_open(&file, path, 0) != 0) return -1;
+     if (file.is_binary) {
+          fprintf(stderr, "ERROR: %s is a binary output, searched without an index\n", path);
+          index_close(&file);
+          return -1;
+     }
+     char index_path[1024], temporary_path[1040];
+     snprintf(index_path, sizeof index_path, "%s.idx", path);
+     snprintf(temporary_path, sizeof temporary_path, "%s.tmp", index_path);
+     FILE *out = fopen(temporary_path, "wb");
+     if (!out) {
+          fprintf(stderr, "ERROR: could not open %s for writing.\n", temporary_path);
+          index_close(&file);
+          return -1;
+     }
+     int failed = fwrite(INDEX_MAGIC, sizeof INDEX_MAGIC, 1, out) != 1;
+     int64_t every_ns = every_seconds * NS_PER_SECOND;
+     int64_t offset = file.data_start;
+     int64_t num_entries = 0;
+     int64_t time, next;
+     while (!failed && offset < file.size && index_line_time(&file, offset, &time, &next) == 0) {
+          OutputIndexEntry entry = { time, offset };
+          uint8_t packed[OUTPUT_INDEX_ENTRY_SIZE];
+          output_index_pack_entry(packed, &entry);
+          failed = fwrite(packed, sizeof packed, 1, out) != 1;
+          num_entries++;
+          // the first line of the next interval, at least one line further
+          int64_t boundary = time - time % every_ns + every_ns;
+          offset = index_lower_bound(&file, next, file.size, boundary);
+     }
+     if (fclose(out) != 0) failed = 1;
+#if defined(WIN32)
+     if (!failed) remove(index_path);
+#endif
+     if (failed || rename(temporary_path, index_path) != 0) {
+          fprintf(stderr, "ERROR: could not write %s\n", index_path);
+          remove(temporary_path);
+          failed = 1;
+     } else {
+          fprintf(stderr, "index\t%lld entries for %lld bytes\n", (long long)num_entries, (long long)file.size);
+     }
+     index_close(&file);
+     return failed ? -1 : 0;
+}
+
+// Accepts unix seconds or a local time as in the tsv output,
+// 2024-01-01T12:00:00. Returns -1 when invalid.
+int index_parse_time(char const *text, int64_t *unix_seconds)
+{
+     if (strlen(text) == 19 && text[4] == '-' && text[7] == '-' && text[10] == 'T' && text[13] == ':' && text[16] == ':') {
+          struct tm local_time = { .tm_isdst = -1 };
+          local_time.tm_year = tsv_parse_digits(text, 4) - 1900;
+          local_time.tm_mon = tsv_parse_digits(text + 5, 2) - 1;
+          local_time.tm_mday = tsv_parse_digits(text + 8, 2);
+          local_time.tm_hour = tsv_parse_digits(text + 11, 2);
+          local_time.tm_min = tsv_parse_digits(text + 14, 2);
+          local_time.tm_sec = tsv_parse_digits(text + 17, 2);
+          if (local_time.tm_year < 0 || local_time.tm_mon < 0 || local_time.tm_mday < 0 || local_time.tm_hour < 0
+              || local_time.tm_min < 0 || local_time.tm_sec < 0) {
+               return -1;
+          }
+          *unix_seconds = (int64_t)mktime(&local_time);
+          return 0;
+     }
+     char *end;
+     long long value = strtoll(text, &end, 10);
+     *unix_seconds = value;
+     return end != text && !*end ? 0 : -1;
+}
@@ -1,8 +1,155 @@
-static char const *USAGE = "Usage: <program>[-o file.tsv]\n"
+static char const *USAGE = "Usage: <program>[-o target]... [-a] [--format tsv|csv|jsonl|influx|binary|arrow]\n"
+     "                 [--overflow block|drop-oldest|spill] [--queue readings] [--spill-dir dir] [--stats seconds]\n"
+     "                 [--commit-interval ms] [--commit-bytes bytes] [--commit-rows rows]\n"
+     "                 [--sync none|fdatasync|O_DSYNC] [--index duration[,bytes]] [--qos 0|1] [--arrow-batch rows]\n"
+     "                 [--ring-file path [--ring-size bytes] [--ring-sync ms]]\n"
+     "                 [--window duration]... [--window-every duration] [--window-output target]\n"
+     "                 [--alert rule]... [--alerts file]\n"
+     "                 [--history-socket path [--history step:retention,...]] [--rollup prefix]\n"
+     "                 [--realtime cpu [--realtime-priority 1-99] [--realtime-mlock]] [--arena bytes]\n"
+     "                 [--replay path [--replay-speed 1x|Nx|max] [--replay-wire] [--replay-restamp]]\n"
+     "                 [--metrics [host:]port]\n"
+     "       <program> ring-dump path [--format name]\n"
+     "       <program> history path channel from to [points] [binary]\n"
+     "       <program> rollup-rebuild prefix file...\n"
+     "       <program> rollup-dump path\n"
+     "       <program> import path [-o target] [--format binary|columnar] [--threads n] [--verify]\n"
+     "       <program> extract path from to\n"
+     "       <program> index path [duration]\n"
+     "       <program> merge [-o target] [--format tsv|arrow] [--arrow-batch rows] [--grid duration] [tag=]path...\n"
+     "       <program> report heatmap|histogram [-o target] [--bands ppm,...] [--bin ppm] [--threads n] path...\n"
+     "       <program> compact [--from time] [--to time] [--keep] archive path...\n"
+     "       <program> collect [host:]port [-o target] [--format name]\n"
+     "       <program> collectd [host:]port [--dir dir] [--format name] [--sync policy]\n"
+     "                 [--commit-interval ms] [--stats seconds]\n"
+     "       <program> collectd-load host:port [--readers n] [--rate readings/s] [--seconds s] [--spill-dir dir]\n"
+     "       <program> mqtt-broker [host:]port [--drop-every n]\n"
+     "       <program> check [ring|window|alert|rollup]... [--dir dir]\n"
+     "       <program> bench [rows]\n"
      "\nThis program collects co2 readings from Zyaura sensors.\n"
      "Options:\n"
-     "  -o file.tsv: write to a tab-separated-value file (otherwise to standard output)\n"
-     "  -a: force an output on every read (otherwise skip if value unchanged)\n";
+     "  -o target: write to a file, to standard output (-), to a shell command (|command),\n"
+     "     to a TCP connection (tcp:host:port), to a collector (fwd:host:port), see collect, or\n"
+     "     to an MQTT broker (mqtt:[serial@]host:port) or to a SQLite database (sqlite:path), when\n"
+     "     built with CO2_SQLITE. Can be repeated, otherwise standard output.\n"
+     "  -a: force an output on every read (otherwise skip if value unchanged)\n"
+     "  --format name: output format, one of tsv (default), csv, jsonl, influx (line protocol), binary\n"
+     "     or arrow (an Arrow IPC stream of time, sensor, channel and value, the sensor being the\n"
+     "     host name)\n"
+     "  --overflow policy: when a target's queue is full, drop the oldest reading, spill to a\n"
+     "     file in --spill-dir, or block the reader (default: drop-oldest, block with --replay).\n"
+     "     block makes the reader, and with it every target, wait for the slowest target.\n"
+     "  --queue readings: capacity of a target's queue (default: 4096, at most 16777216)\n"
+     "  --spill-dir dir: directory of the spill files (default: .)\n"
+     "  --stats seconds: print the lag, drops, errors, writes/s and sync latency of every target\n"
+     "     to standard error\n"
+     "  --commit-interval ms: write at most ms milliseconds after a reading (default: when the\n"
+     "     second changes, if --commit-bytes is not given either)\n"
+     "  --commit-bytes bytes: write once that many bytes (K, M or G suffix, up to 1G) are pending,\n"
+     "     in writes ending on 4KiB boundaries of the file\n"
+     "  --commit-rows rows: commit the transaction of a sqlite: target every rows readings\n"
+     "     (default: 10000), or every --commit-interval (default: 1000)\n"
+     "  --sync policy: make every write of a file durable with fdatasync or by opening it with\n"
+     "     O_DSYNC (default: none). Such files are appended to, after cutting off a torn last\n"
+     "     record, instead of being truncated.\n"
+     "  --index duration[,bytes]: write a sparse time index of a tsv file to path.idx, with an\n"
+     "     entry every duration of readings or bytes of output (default: 64K), for extract\n"
+     "  --ring-file path: also keep the latest readings in a fixed size, memory mapped, circular\n"
+     "     file. Without -o, the readings then only go there.\n"
+     "  --ring-size bytes: size of the ring file, with an optional K, M or G suffix (default: 64M)\n"
+     "  --ring-sync ms: interval between two msyncs of the ring file (default: 1000)\n"
+     "  --window duration: maintain the count, mean, standard deviation, min and max of the CO2\n"
+     "     and temperature reports of the last duration (90s, 5m, 1h, 1d). Can be repeated.\n"
+     "  --window-every duration: cadence of the window statistics (default: 1m)\n"
+     "  --window-output target: file (or - for standard output) where the window statistics are\n"
+     "     written as tsv (default: standard output, when the readings do not go there)\n"
+     "  --alert rule: run an action when a threshold is crossed, see below. Can be repeated.\n"
+     "  --alerts file: read alert rules from a file, one per line\n"
+     "  --history-socket path: keep in memory archives of every channel, and answer queries on\n"
+     "     this local socket\n"
+     "  --history step:retention,...: the archives, finest first (default: 1s:1h,10s:1d,1m:30d,1h:5y)\n"
+     "  --rollup prefix: append the count, min, max, sum, sum of squares, first and last of every\n"
+     "     minute and hour of every channel to prefix-1m.rollup and prefix-1h.rollup\n"
+     "  --qos 0|1: QoS of the publishes of mqtt: targets, to co2/serial/co2 and\n"
+     "     co2/serial/temperature, serial by default the host name (default: 1)\n"
+     "  --arrow-batch rows: rows of the record batches of arrow targets (default: 65536), also\n"
+     "     written every --commit-interval (default: 60000)\n"
+     "  --realtime cpu: read the sensor on a thread of its own pinned to processor cpu, and stamp\n"
+     "     the readings to the nanosecond, on the monotonic clock mapped to the wall clock every\n"
+     "     second. --stats adds the distributions of the stamping and handling delays and of the\n"
+     "     interval between reports.\n"
+     "  --realtime-priority priority: run the reader with SCHED_FIFO priority (1 to 99)\n"
+     "  --realtime-mlock: lock the memory of the process, so that the reader never page faults\n"
+     "  --replay path: read the readings of a tsv or binary output or of an archive instead of the\n"
+     "     sensor, paced as recorded, and print the rate achieved and the lateness of the readings\n"
+     "  --replay-speed speed: replay at 1x (default), n times faster (60x), or as fast as the\n"
+     "     outputs take the readings (max)\n"
+     "  --replay-wire: encrypt every reading back into a report of the sensor and decode it as a\n"
+     "     live one\n"
+     "  --replay-restamp: stamp the readings with the time they are replayed, not the recorded one\n"
+     "  --metrics [host:]port: serve the latest CO2 and temperature, the reports by opcode, the\n"
+     "     checksum errors, the age of the last report and the reconnects of the targets to\n"
+     "     Prometheus, in the OpenMetrics format at http://host:port/metrics (Linux only)\n"
+     "  --arena bytes: allocate the queues, buffers and archives from a single block of that size\n"
+     "     (K, M or G suffix), taken at startup, after which the memory of the outputs cannot grow.\n"
+     "     --stats prints the resident size, at startup too.\n"
+     "  --format, --overflow, --queue, --commit-interval, --commit-bytes, --commit-rows, --sync,\n"
+     "  --index, --qos and --arrow-batch apply to the -o that follow them, and if given after the\n"
+     "  last -o, to every target that did not get its own.\n"
+     "Alert rules:\n"
+     "  name: co2|temperature [rate] >|< threshold [clear level] [over duration] [for duration]\n"
+     "        exec 'command' | fifo path | udp host:port\n"
+     "  e.g. 'ventilate: co2 > 1200 clear 1000 for 30s exec \"ventilation on\"'\n"
+     "  rate compares the change per minute over the last over duration (default: 1m).\n"
+     "  Actions run when the rule turns on and off, exec with CO2_ALERT, CO2_ALERT_STATE and\n"
+     "  CO2_ALERT_VALUE in the environment.\n"
+     "Commands:\n"
+     "  ring-dump path: write the readings of a ring file in time order, as tsv by default\n"
+     "  history path channel from to [points] [binary]: query the history of a running reader,\n"
+     "     for co2 or temperature, from and to as unix seconds, now or -duration (-1h), from the\n"
+     "     finest archive with at most points points\n"
+     "  rollup-rebuild prefix file...: regenerate the rollup files from tsv or binary outputs,\n"
+     "     given in time order\n"
+     "  rollup-dump path: write the records of a rollup file as tsv\n"
+     "  import path: convert a tsv output to the binary format (default) or a columnar one, on\n"
+     "     every processor or --threads n. --verify checks that every line is written back\n"
+     "     identically from the conversion.\n"
+     "  extract path from to: write the readings of a tsv or binary output from from to to (unix\n"
+     "     seconds or 2024-01-01T12:00:00, local), found by binary search, using path.idx if any\n"
+     "  index path [duration]: write the sparse index of an existing tsv output, an entry every\n"
+     "     duration (default: 1m)\n"
+     "  merge [tag=]path...: merge tsv or binary outputs, each in time order, into a tsv in time\n"
+     "     order with a Source column, the tag or the file name without extension (default\n"
+     "     target: standard output). --grid writes the latest CO2 and temperature of every\n"
+     "     source in each step of duration instead. --format arrow writes an Arrow IPC stream,\n"
+     "     with the tag as sensor, in batches of --arrow-batch rows: a converter of existing outputs.\n"
+     "  report heatmap path...: count the CO2 readings of tsv or binary outputs per hour of the\n"
+     "     week and band of --bands (default: 600,800,1000,1500,2000), on every processor or\n"
+     "     --threads n\n"
+     "  report histogram path...: count them per --bin ppm (default: 50) instead\n"
+     "  compact archive path...: merge closed tsv or binary outputs of a sensor, those with all\n"
+     "     their readings from --from to --to (default: the end of yesterday) and not modified in\n"
+     "     the last 10 minutes, into a compressed and indexed archive, which extract, merge and\n"
+     "     report read too, then delete them unless --keep. Any path which is not an output or an\n"
+     "     archive, or has lines which are not readings, is an error. Runs at idle processor and\n"
+     "     disk priority.\n"
+     "  collect [host:]port: receive the readings of fwd: targets and write them, as tsv by\n"
+     "     default. A fwd: target sends a compressed frame every --commit-interval (default: 1s)\n"
+     "     and spools them to --spill-dir while the collector is unreachable.\n"
+     "  collectd [host:]port: receive the readings of many fwd: targets, hundreds, each named by\n"
+     "     the name in fwd:name@host:port (default: the host name), and append them to\n"
+     "     dir/name.format (default dir: .). Frames are acknowledged once written, and synced\n"
+     "     with --sync, every --commit-interval (default: 100). --stats prints the readings/s\n"
+     "     and lag of every connection.\n"
+     "  collectd-load host:port: simulate --readers (default: 100, at most 4096) readers sending --rate\n"
+     "     (default: 10) synthetic readings/s each for --seconds (default: 10)\n"
+     "  mqtt-broker [host:]port: a stand-in MQTT broker for tests, printing the topic and payload\n"
+     "     of every publish. --drop-every closes the connection at every n-th publish.\n"
+     "  check [name]...: run the self-checks, all of them or the named ones: ring (wrap-around,\n"
+     "     resuming, and dumping while written), window (statistics against a brute-force\n"
+     "     recomputation), alert (clear levels and for durations against a model of the rules),\n"
+     "     rollup (a rebuild against the incremental files). Their files go to --dir (default: .).\n"
+     "  bench [rows]: measure the rows/s of every output format against the original fprintf output\n";
 
 enum ProgramOption
 {
@@ -11,29 +158,927 @@ enum ProgramOption
      NumProgramOptions,
 };
 
+// Sink options that can be given per -o
+enum SinkOptionBits
+{
+     SinkOptionBits_Format = 1 << 0,
+     SinkOptionBits_Overflow = 1 << 1,
+     SinkOptionBits_Queue = 1 << 2,
+     SinkOptionBits_CommitInterval = 1 << 3,
+     SinkOptionBits_CommitBytes = 1 << 4,
+     SinkOptionBits_Sync = 1 << 5,
+     SinkOptionBits_Index = 1 << 6,
+     SinkOptionBits_Qos = 1 << 7,
+     SinkOptionBits_ArrowBatch = 1 << 8,
+     SinkOptionBits_CommitRows = 1 << 9,
+};
+
 #include <assert.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-static int zyaura_record_output_to_stream(FILE* stream, int force_output_even_without_change);
+// Where the decoded readings go
+typedef struct ZyAuraOutputs
+{
+     SinkSet *sinks;
+     RingFile *ring_file; // optional
+     WindowSet *windows; // optional
+     AlertEngine *alerts; // optional
+     HistorySet *history; // optional
+     RollupSet *rollups; // optional
+     MetricsServer *metrics; // optional
+} ZyAuraOutputs;
+
+static int zyaura_record_output(ZyAuraOutputs *outputs, int force_output_even_without_change, RealtimeReader *realtime);
+static int zyaura_replay_output(ZyAuraOutputs *outputs, int force_output_even_without_change, ReplayConfig const *config,
+                                int stats_interval_seconds);
+
+// Accepts 1234, 64K, 64M, 1G. Returns -1 when invalid.
+static int64_t parse_byte_size(char const *text)
+{
+     char *end;
+     long long value = strtoll(text, &end, 10);
+     if (end == text || value <= 0) return -1;
+     switch (*end) {
+     case 0: break;
+     case 'K': case 'k': value <<= 10; end++; break;
+     case 'M': case 'm': value <<= 20; end++; break;
+     case 'G': case 'g': value <<= 30; end++; break;
+     default: return -1;
+     }
+     return *end ? -1 : value;
+}
+
+// Accepts a whole number from 1 to max. Returns -1 when invalid or out of range.
+static int parse_count(char const *text, int max)
+{
+     char *end;
+     long long value = strtoll(text, &end, 10);
+     if (end == text || *end || value <= 0 || value > max) return -1;
+     return (int)value;
+}
+
+static int ring_dump_main(int argc, char **argv)
+{
+     OutputSerializer const *serializer = output_serializer_find("tsv");
+     char const *path = NULL;
+     for (int argi = 2; argi < argc; argi++) {
+          if (0 == strcmp(argv[argi], "--format") && argi + 1 < argc) {
+               serializer = output_serializer_find(argv[++argi]);
+               if (!serializer) {
+                    fprintf(stderr, "ERROR: unknown output format %s\n\n%s\n", argv[argi], USAGE);
+                    return 1;
+               }
+          } else if (!path) {
+               path = argv[argi];
+          } else {
+               fprintf(stderr, "ERROR: unexpected argument %s\n\n%s\n", argv[argi], USAGE);
+               return 1;
+          }
+     }
+     if (!path) {
+          fprintf(stderr, "ERROR: expected the path of a ring file\n\n%s\n", USAGE);
+          return 1;
+     }
+#if defined(WIN32)
+     _setmode(1, _O_BINARY);
+#endif
+     return ring_file_dump(path, serializer, 1) == 0 ? 0 : 1;
+}
+
+typedef struct SelfCheck
+{
+     char const *name;
+     int (*run)(char const *dir); // 0 when it passes
+} SelfCheck;
+
+static SelfCheck const SELF_CHECKS[] = {
+     { .name = "ring", .run = ring_file_check },
+     { .name = "window", .run = window_check },
+     { .name = "alert", .run = alert_check },
+     { .name = "rollup", .run = rollup_check },
+};
+
+static int check_main(int argc, char **argv)
+{
+     enum { NUM_SELF_CHECKS = sizeof SELF_CHECKS / sizeof SELF_CHECKS[0] };
+     int selected[NUM_SELF_CHECKS] = {0};
+     int num_selected = 0;
+     char const *dir = ".";
+     for (int argi = 2; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          if (0 == strcmp(arg, "--dir") && argi + 1 < argc) {
+               dir = argv[++argi];
+               continue;
+          }
+          int found = 0;
+          for (int i = 0; i < NUM_SELF_CHECKS; i++) {
+               if (0 == strcmp(arg, SELF_CHECKS[i].name)) found = selected[i] = 1;
+          }
+          if (!found) {
+               fprintf(stderr, "ERROR: unknown check %s\n\n%s\n", arg, USAGE);
+               return 1;
+          }
+          num_selected++;
+     }
+     int failed = 0;
+     for (int i = 0; i < NUM_SELF_CHECKS; i++) {
+          if ((selected[i] || !num_selected) && SELF_CHECKS[i].run(dir) != 0) failed = 1;
+     }
+     return failed;
+}
+
+static int history_main(int argc, char **argv)
+{
+     if (argc < 6 || argc > 8) {
+          fprintf(stderr, "ERROR: expected path channel from to [points] [binary]\n\n%s\n", USAGE);
+          return 1;
+     }
+     char request[256] = "";
+     for (int argi = 3; argi < argc; argi++) {
+          if (strlen(request) + strlen(argv[argi]) + 2 >= sizeof request) return 1;
+          strcat(request, argv[argi]);
+          strcat(request, argi + 1 < argc ? " " : "\n");
+     }
+#if defined(WIN32)
+     _setmode(1, _O_BINARY);
+#endif
+     return history_query(argv[2], request, 1) == 0 ? 0 : 1;
+}
+
+static int extract_main(int argc, char **argv)
+{
+     int64_t from, to;
+     if (argc != 5 || index_parse_time(argv[3], &from) != 0 || index_parse_time(argv[4], &to) != 0) {
+          fprintf(stderr, "ERROR: expected path from to, as unix seconds or local times\n\n%s\n", USAGE);
+          return 1;
+     }
+#if defined(WIN32)
+     _setmode(1, _O_BINARY);
+#endif
+     // to is inclusive, to the second
+     return index_extract(argv[2], from * NS_PER_SECOND, (to + 1) * NS_PER_SECOND, 1) == 0 ? 0 : 1;
+}
+
+static int compact_main(int argc, char **argv)
+{
+     // by default, up to the end of yesterday: the output of today is not closed
+     time_t now = time(NULL);
+     struct tm today;
+     localtime_r(&now, &today);
+     today.tm_hour = today.tm_min = today.tm_sec = 0;
+     today.tm_isdst = -1;
+     int64_t from = INT64_MIN / NS_PER_SECOND, to = (int64_t)mktime(&today) - 1;
+     int keep = 0;
+     int argi = 2;
+     for (; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if ((0 == strcmp(arg, "--from") || 0 == strcmp(arg, "--to")) && value) {
+               if (index_parse_time(value, 0 == strcmp(arg, "--from") ? &from : &to) != 0) {
+                    fprintf(stderr, "ERROR: expected a unix time or a local time, not %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--keep")) {
+               keep = 1;
+          } else {
+               break;
+          }
+     }
+     if (argc - argi < 2) {
+          fprintf(stderr, "ERROR: expected the archive and the outputs to compact into it\n\n%s\n", USAGE);
+          return 1;
+     }
+     // to is inclusive, to the second
+     return compact_outputs(argv[argi], (char const *const *)argv + argi + 1, argc - argi - 1, from * NS_PER_SECOND,
+                            (to + 1) * NS_PER_SECOND - 1, keep) == 0 ? 0 : 1;
+}
+
+static int merge_main(int argc, char **argv)
+{
+     char const *target = "-";
+     int64_t grid_seconds = 0;
+     int arrow_batch_rows = 0;
+     int arrow = 0;
+     int argi = 2;
+     for (; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if (0 == strcmp(arg, "-o") && value) {
+               target = value;
+               argi++;
+          } else if (0 == strcmp(arg, "--grid") && value) {
+               grid_seconds = window_parse_duration(value);
+               if (grid_seconds <= 0) {
+                    fprintf(stderr, "ERROR: invalid grid duration %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--format") && value) {
+               if (strcmp(value, "tsv") != 0 && strcmp(value, "arrow") != 0) {
+                    fprintf(stderr, "ERROR: merge writes tsv or arrow, not %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               arrow = 0 == strcmp(value, "arrow");
+               argi++;
+          } else if (0 == strcmp(arg, "--arrow-batch") && value) {
+               arrow_batch_rows = atoi(value);
+               if (arrow_batch_rows <= 0 || arrow_batch_rows > ARROW_MAX_BATCH_ROWS) {
+                    fprintf(stderr, "ERROR: expected a positive number of rows, up to %d\n\n%s\n", ARROW_MAX_BATCH_ROWS, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else {
+               break;
+          }
+     }
+     if (argi == argc) {
+          fprintf(stderr, "ERROR: expected the outputs to merge\n\n%s\n", USAGE);
+          return 1;
+     }
+     if (arrow && !arrow_batch_rows) arrow_batch_rows = ARROW_DEFAULT_BATCH_ROWS;
+     return merge_outputs((char const *const *)argv + argi, argc - argi, target, grid_seconds, arrow ? arrow_batch_rows : 0) == 0 ? 0 : 1;
+}
+
+static int report_main(int argc, char **argv)
+{
+     ReportConfig config = { .bin_ppm = 50 };
+     report_parse_bands("600,800,1000,1500,2000", &config);
+     char const *target = "-";
+     config.kind = NumReportKinds;
+     for (int i = 0; argc > 2 && i < NumReportKinds; i++) {
+          if (0 == strcmp(argv[2], REPORT_KIND_NAMES[i])) config.kind = (ReportKind)i;
+     }
+     if (config.kind == NumReportKinds) {
+          fprintf(stderr, "ERROR: expected heatmap or histogram\n\n%s\n", USAGE);
+          return 1;
+     }
+     int argi = 3;
+     for (; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if (0 == strcmp(arg, "-o") && value) {
+               target = value;
+          } else if (0 == strcmp(arg, "--bands") && value) {
+               if (report_parse_bands(value, &config) != 0) {
+                    fprintf(stderr, "ERROR: expected increasing ppm band edges, up to %d\n\n%s\n", REPORT_MAX_BANDS, USAGE);
+                    return 1;
+               }
+          } else if (0 == strcmp(arg, "--bin") && value) {
+               config.bin_ppm = atoi(value);
+               if (config.bin_ppm <= 0 || config.bin_ppm > REPORT_MAX_PPM) {
+                    fprintf(stderr, "ERROR: expected a bin width in ppm\n\n%s\n", USAGE);
+                    return 1;
+               }
+          } else if (0 == strcmp(arg, "--threads") && value) {
+               config.num_threads = atoi(value);
+               if (config.num_threads <= 0) {
+                    fprintf(stderr, "ERROR: expected a positive number of threads\n\n%s\n", USAGE);
+                    return 1;
+               }
+          } else {
+               break;
+          }
+          argi++;
+     }
+     if (argi == argc) {
+          fprintf(stderr, "ERROR: expected the outputs to report on\n\n%s\n", USAGE);
+          return 1;
+     }
+     return report_outputs(&config, (char const *const *)argv + argi, argc - argi, target) == 0 ? 0 : 1;
+}
+
+static int collect_main(int argc, char **argv)
+{
+     char const *address = NULL;
+     char const *target = "-";
+     OutputSerializer const *serializer = output_serializer_find("tsv");
+     for (int argi = 2; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if (0 == strcmp(arg, "-o") && value) {
+               target = value;
+               argi++;
+          } else if (0 == strcmp(arg, "--format") && value) {
+               serializer = output_serializer_find(value);
+               if (!serializer) {
+                    fprintf(stderr, "ERROR: unknown output format %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (!address) {
+               address = arg;
+          } else {
+               fprintf(stderr, "ERROR: unexpected argument %s\n\n%s\n", arg, USAGE);
+               return 1;
+          }
+     }
+     if (!address) {
+          fprintf(stderr, "ERROR: expected the port to listen on\n\n%s\n", USAGE);
+          return 1;
+     }
+     return forward_collect(address, target, serializer) == 0 ? 0 : 1;
+}
+
+static int collectd_main(int argc, char **argv)
+{
+     CollectdConfig config = {
+          .dir = ".",
+          .serializer = output_serializer_find("tsv"),
+          .sync = OutputSync_None,
+          .commit_interval_ms = 100,
+     };
+     for (int argi = 2; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if (0 == strcmp(arg, "--dir") && value) {
+               config.dir = value;
+               argi++;
+          } else if (0 == strcmp(arg, "--format") && value) {
+               config.serializer = output_serializer_find(value);
+               if (!config.serializer) {
+                    fprintf(stderr, "ERROR: unknown output format %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--sync") && value) {
+               if (output_sync_from_name(value, &config.sync) != 0) {
+                    fprintf(stderr, "ERROR: unknown sync policy %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--commit-interval") && value) {
+               config.commit_interval_ms = atoi(value);
+               if (config.commit_interval_ms <= 0) {
+                    fprintf(stderr, "ERROR: expected a positive commit interval\n\n%s\n", USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--stats") && value) {
+               config.stats_interval_seconds = atoi(value);
+               argi++;
+          } else if (!config.address) {
+               config.address = arg;
+          } else {
+               fprintf(stderr, "ERROR: unexpected argument %s\n\n%s\n", arg, USAGE);
+               return 1;
+          }
+     }
+     if (!config.address) {
+          fprintf(stderr, "ERROR: expected the port to listen on\n\n%s\n", USAGE);
+          return 1;
+     }
+     return collectd_run(&config) == 0 ? 0 : 1;
+}
+
+static int collectd_load_main(int argc, char **argv)
+{
+     char const *address = NULL;
+     char const *spill_dir = ".";
+     int num_readers = 100;
+     int rate = 10;
+     int seconds = 10;
+     for (int argi = 2; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if (0 == strcmp(arg, "--readers") && value) {
+               num_readers = parse_count(value, COLLECTD_MAX_CONNECTIONS);
+               if (num_readers <= 0) {
+                    fprintf(stderr, "ERROR: expected from 1 to %d readers\n\n%s\n", COLLECTD_MAX_CONNECTIONS, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--rate") && value) {
+               rate = parse_count(value, COLLECTD_LOAD_MAX_RATE);
+               if (rate <= 0) {
+                    fprintf(stderr, "ERROR: expected a rate from 1 to %d readings/s\n\n%s\n", COLLECTD_LOAD_MAX_RATE, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--seconds") && value) {
+               seconds = parse_count(value, COLLECTD_LOAD_MAX_SECONDS);
+               if (seconds <= 0) {
+                    fprintf(stderr, "ERROR: expected from 1 to %d seconds\n\n%s\n", COLLECTD_LOAD_MAX_SECONDS, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--spill-dir") && value) {
+               spill_dir = value;
+               argi++;
+          } else if (!address) {
+               address = arg;
+          } else {
+               fprintf(stderr, "ERROR: unexpected argument %s\n\n%s\n", arg, USAGE);
+               return 1;
+          }
+     }
+     if (!address) {
+          fprintf(stderr, "ERROR: expected host:port\n\n%s\n", USAGE);
+          return 1;
+     }
+     return collectd_load(address, num_readers, rate, seconds, spill_dir) == 0 ? 0 : 1;
+}
+
+static int import_main(int argc, char **argv)
+{
+     char const *path = NULL;
+     char const *target = NULL;
+     ImportFormat format = ImportFormat_Binary;
+     int num_threads = 0;
+     int verify = 0;
+     for (int argi = 2; argi < argc; argi++) {
+          char const *arg = argv[argi];
+          char const *value = argi + 1 < argc ? argv[argi + 1] : NULL;
+          if (0 == strcmp(arg, "-o") && value) {
+               target = value;
+               argi++;
+          } else if (0 == strcmp(arg, "--format") && value) {
+               format = NumImportFormats;
+               for (int i = 0; i < NumImportFormats; i++) {
+                    if (0 == strcmp(value, IMPORT_FORMAT_NAMES[i])) format = (ImportFormat)i;
+               }
+               if (format == NumImportFormats) {
+                    fprintf(stderr, "ERROR: unknown import format %s\n\n%s\n", value, USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--threads") && value) {
+               num_threads = atoi(value);
+               if (num_threads <= 0) {
+                    fprintf(stderr, "ERROR: expected a positive number of threads\n\n%s\n", USAGE);
+                    return 1;
+               }
+               argi++;
+          } else if (0 == strcmp(arg, "--verify")) {
+               verify = 1;
+          } else if (!path) {
+               path = arg;
+          } else {
+               fprintf(stderr, "ERROR: unexpected argument %s\n\n%s\n", arg, USAGE);
+               return 1;
+          }
+     }
+     if (!path || (!target && !verify)) {
+          fprintf(stderr, "ERROR: expected a tsv file, and -o or --verify\n\n%s\n", USAGE);
+          return 1;
+     }
+     return import_tsv(path, target, format, num_threads, verify) == 0 ? 0 : 1;
+}
+
+static volatile sig_atomic_t zyaura_stop_requested = 0;
+
+static void zyaura_request_stop(int signal_number)
+{
+     (void)signal_number;
+     zyaura_stop_requested = 1;
+}
+
+// The reader of --realtime, on a thread of its own
+typedef struct ZyAuraRealtimeThread
+{
+     ZyAuraOutputs *outputs;
+     int force_output_even_without_change;
+     RealtimeReader *reader;
+     int rc;
+     uint64_t volatile done;
+} ZyAuraRealtimeThread;
+
+static void zyaura_realtime_thread(void *arg)
+{
+     ZyAuraRealtimeThread *thread = arg;
+     thread->rc = -1;
+     if (realtime_reader_enter(thread->reader) == 0) {
+          thread->rc = zyaura_record_output(thread->outputs, thread->force_output_even_without_change, thread->reader);
+     }
+     uu_atomic_store_u64(&thread->done, 1);
+}
+
+// Runs the reader on its thread while the main thread prints its statistics
+static int zyaura_record_output_realtime(ZyAuraOutputs *outputs, int force_output_even_without_change,
+                                         RealtimeConfig const *config, int stats_interval_seconds)
+{
+     static RealtimeReader reader;
+     if (realtime_reader_init(&reader, config) != 0) return -1;
+     static ZyAuraRealtimeThread thread;
+     thread = (ZyAuraRealtimeThread){ outputs, force_output_even_without_change, &reader, 0, 0 };
+     UU_Thread handle;
+     if (uu_thread_start(&handle, zyaura_realtime_thread, &thread) != 0) {
+          fprintf(stderr, "ERROR: could not start the reader thread\n");
+          realtime_reader_destroy(&reader);
+          return -1;
+     }
+     int64_t next_stats_ns = uu_monotonic_ns() + (int64_t)stats_interval_seconds * NS_PER_SECOND;
+     while (!uu_atomic_load_u64(&thread.done)) {
+          uu_sleep_ms(100);
+          if (stats_interval_seconds > 0 && uu_monotonic_ns() >= next_stats_ns) {
+               realtime_reader_print_stats(&reader, stderr);
+               next_stats_ns += (int64_t)stats_interval_seconds * NS_PER_SECOND;
+          }
+     }
+     uu_thread_join(&handle);
+     if (stats_interval_seconds > 0) realtime_reader_print_stats(&reader, stderr);
+     realtime_reader_destroy(&reader);
+     return thread.rc;
+}
 
 int main(int argc, char **argv)
 {
-     char *output_filename = NULL;
      int force_output_even_without_change = 0;
+     SinkConfig sink_configs[SINK_MAX_COUNT];
+     unsigned sink_explicit_options[SINK_MAX_COUNT];
+     int num_sinks = 0;
+     SinkConfig next_sink = {
+          .target = "-",
+          .serializer = output_serializer_find("tsv"),
+          .overflow = SinkOverflow_DropOldest,
+          .queue_capacity = SINK_DEFAULT_QUEUE_CAPACITY,
+          .sync = OutputSync_None,
+          .mqtt_qos = 1,
+          .arrow_batch_rows = ARROW_DEFAULT_BATCH_ROWS,
+     };
+     unsigned next_sink_options = 0; // set so far
+     unsigned trailing_sink_options = 0; // set since the last -o
+     char const *spill_dir = ".";
+     int stats_interval_seconds = 0;
+     RealtimeConfig realtime = { .cpu = -1 };
+     ReplayConfig replay = { .speed = 1 };
+     int64_t arena_size = 0;
+     char const *ring_file_path = NULL;
+     int64_t ring_file_size = 64 << 20;
+     int ring_file_sync_interval_ms = RING_FILE_DEFAULT_SYNC_INTERVAL_MS;
+     int64_t window_durations[WINDOW_MAX_COUNT];
+     char const *window_labels[WINDOW_MAX_COUNT];
+     int num_windows = 0;
+     int64_t window_every_seconds = 60;
+     char const *window_output = NULL;
+     static AlertEngine alerts;
+     char const *history_spec = NULL;
+     char const *history_socket_path = NULL;
+     char const *metrics_address = NULL;
+     char const *rollup_prefix = NULL;
+     if (argc > 1 && 0 == strcmp(argv[1], "ring-dump")) {
+          return ring_dump_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "history")) {
+          return history_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "rollup-rebuild")) {
+          if (argc < 4) {
+               fprintf(stderr, "ERROR: expected a prefix and raw output files\n\n%s\n", USAGE);
+               return 1;
+          }
+          return rollup_rebuild(argv[2], (char const *const *)argv + 3, argc - 3) == 0 ? 0 : 1;
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "rollup-dump")) {
+          if (argc != 3) {
+               fprintf(stderr, "ERROR: expected the path of a rollup file\n\n%s\n", USAGE);
+               return 1;
+          }
+          return rollup_dump(argv[2], stdout) == 0 ? 0 : 1;
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "import")) {
+          return import_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "extract")) {
+          return extract_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "index")) {
+          int64_t seconds = argc > 3 ? window_parse_duration(argv[3]) : 60;
+          if (argc < 3 || argc > 4 || seconds <= 0) {
+               fprintf(stderr, "ERROR: expected the path of a tsv output and a duration\n\n%s\n", USAGE);
+               return 1;
+          }
+          return index_bootstrap(argv[2], seconds) == 0 ? 0 : 1;
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "merge")) {
+          return merge_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "report")) {
+          return report_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "compact")) {
+          return compact_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "collect")) {
+          return collect_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "collectd")) {
+          return collectd_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "collectd-load")) {
+          return collectd_load_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "mqtt-broker")) {
+          if (argc != 3 && !(argc == 5 && 0 == strcmp(argv[3], "--drop-every") && atoll(argv[4]) > 0)) {
+               fprintf(stderr, "ERROR: expected the port to listen on, and a positive --drop-every\n\n%s\n", USAGE);
+               return 1;
+          }
+          return mqtt_broker_run(argv[2], argc == 5 ? (uint64_t)atoll(argv[4]) : 0) == 0 ? 0 : 1;
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "check")) {
+          return check_main(argc, argv);
+     }
+     if (argc > 1 && 0 == strcmp(argv[1], "bench")) {
+          int num_rows = argc > 2 ? atoi(argv[2]) : 10000000;
+          if (num_rows <= 0) {
+               fprintf(stderr, "ERROR: expected a positive number of rows\n\n%s\n", USAGE);
+               return 1;
+          }
+          return output_benchmark(num_rows);
+     }
      /* parse args */ {
           int argi = 1;
           char *error = NULL;
+          char error_text[128]; // for the errors with a number
           while (argi < argc && !error) {
                char *arg = argv[argi++];
-               if (arg[0] == '-' && arg[1] == ProgramOption_OutputFile && !arg[2]) {
-                    if (argi < argc) {
-                         output_filename = argv[argi++];
+               char *value = argi < argc ? argv[argi] : NULL;
+               if (0 == strcmp(arg, "--format")) {
+                    if (value) {
+                         argi++;
+                         next_sink.arrow = 0 == strcmp(value, "arrow");
+                         if (!next_sink.arrow) {
+                              next_sink.serializer = output_serializer_find(value);
+                              if (!next_sink.serializer) error = "Unknown output format";
+                         }
+                         next_sink_options |= SinkOptionBits_Format;
+                         trailing_sink_options |= SinkOptionBits_Format;
                     } else {
+                         error = "Expected format argument to --format";
+                    }
+               } else if (0 == strcmp(arg, "--overflow")) {
+                    if (value) {
+                         argi++;
+                         if (sink_overflow_from_name(value, &next_sink.overflow) != 0) error = "Unknown overflow policy";
+                         next_sink_options |= SinkOptionBits_Overflow;
+                         trailing_sink_options |= SinkOptionBits_Overflow;
+                    } else {
+                         error = "Expected policy argument to --overflow";
+                    }
+               } else if (0 == strcmp(arg, "--queue")) {
+                    if (value) {
+                         argi++;
+                         next_sink.queue_capacity = parse_count(value, SINK_MAX_QUEUE_CAPACITY);
+                         if (next_sink.queue_capacity <= 0) {
+                              snprintf(error_text, sizeof error_text, "Expected a queue capacity from 1 to %d readings", SINK_MAX_QUEUE_CAPACITY);
+                              error = error_text;
+                         }
+                         next_sink_options |= SinkOptionBits_Queue;
+                         trailing_sink_options |= SinkOptionBits_Queue;
+                    } else {
+                         error = "Expected readings argument to --queue";
+                    }
+               } else if (0 == strcmp(arg, "--commit-interval")) {
+                    if (value) {
+                         argi++;
+                         next_sink.commit_interval_ms = atoi(value);
+                         if (next_sink.commit_interval_ms <= 0) error = "Expected a positive number of milliseconds";
+                         next_sink_options |= SinkOptionBits_CommitInterval;
+                         trailing_sink_options |= SinkOptionBits_CommitInterval;
+                    } else {
+                         error = "Expected ms argument to --commit-interval";
+                    }
+               } else if (0 == strcmp(arg, "--commit-bytes")) {
+                    if (value) {
+                         argi++;
+                         // the buffer of a sink holds that much
+                         int64_t commit_bytes = parse_byte_size(value);
+                         if (commit_bytes <= 0 || commit_bytes > (1 << 30)) error = "Expected a size like 65536, 64K, 64M or 1G";
+                         next_sink.commit_bytes = (int)commit_bytes;
+                         next_sink_options |= SinkOptionBits_CommitBytes;
+                         trailing_sink_options |= SinkOptionBits_CommitBytes;
+                    } else {
+                         error = "Expected bytes argument to --commit-bytes";
+                    }
+               } else if (0 == strcmp(arg, "--commit-rows")) {
+                    if (value) {
+                         argi++;
+                         next_sink.commit_rows = atoi(value);
+                         if (next_sink.commit_rows <= 0) error = "Expected a positive number of rows";
+                         next_sink_options |= SinkOptionBits_CommitRows;
+                         trailing_sink_options |= SinkOptionBits_CommitRows;
+                    } else {
+                         error = "Expected rows argument to --commit-rows";
+                    }
+               } else if (0 == strcmp(arg, "--sync")) {
+                    if (value) {
+                         argi++;
+                         if (output_sync_from_name(value, &next_sink.sync) != 0) error = "Unknown sync policy";
+                         next_sink_options |= SinkOptionBits_Sync;
+                         trailing_sink_options |= SinkOptionBits_Sync;
+                    } else {
+                         error = "Expected policy argument to --sync";
+                    }
+               } else if (0 == strcmp(arg, "--index")) {
+                    if (value) {
+                         argi++;
+                         char duration[32];
+                         size_t length = strcspn(value, ",");
+                         snprintf(duration, sizeof duration, "%.*s", (int)length, value);
+                         int64_t seconds = window_parse_duration(duration);
+                         next_sink.index_every_ns = seconds * NS_PER_SECOND;
+                         next_sink.index_every_bytes = value[length] ? parse_byte_size(value + length + 1) : 64 << 10;
+                         if (seconds <= 0 || next_sink.index_every_bytes <= 0) error = "Expected duration[,bytes]";
+                         next_sink_options |= SinkOptionBits_Index;
+                         trailing_sink_options |= SinkOptionBits_Index;
+                    } else {
+                         error = "Expected duration[,bytes] argument to --index";
+                    }
+               } else if (0 == strcmp(arg, "--qos")) {
+                    if (value) {
+                         argi++;
+                         next_sink.mqtt_qos = atoi(value);
+                         if (strcmp(value, "0") != 0 && strcmp(value, "1") != 0) error = "Expected QoS 0 or 1";
+                         next_sink_options |= SinkOptionBits_Qos;
+                         trailing_sink_options |= SinkOptionBits_Qos;
+                    } else {
+                         error = "Expected 0 or 1 argument to --qos";
+                    }
+               } else if (0 == strcmp(arg, "--arrow-batch")) {
+                    if (value) {
+                         argi++;
+                         next_sink.arrow_batch_rows = atoi(value);
+                         if (next_sink.arrow_batch_rows <= 0 || next_sink.arrow_batch_rows > ARROW_MAX_BATCH_ROWS) {
+                              snprintf(error_text, sizeof error_text, "Expected a positive number of rows, up to %d", ARROW_MAX_BATCH_ROWS);
+                              error = error_text;
+                         }
+                         next_sink_options |= SinkOptionBits_ArrowBatch;
+                         trailing_sink_options |= SinkOptionBits_ArrowBatch;
+                    } else {
+                         error = "Expected rows argument to --arrow-batch";
+                    }
+               } else if (0 == strcmp(arg, "--spill-dir")) {
+                    if (value) {
+                         argi++;
+                         spill_dir = value;
+                    } else {
+                         error = "Expected directory argument to --spill-dir";
+                    }
+               } else if (0 == strcmp(arg, "--stats")) {
+                    if (value) {
+                         argi++;
+                         stats_interval_seconds = atoi(value);
+                         if (stats_interval_seconds <= 0) error = "Expected a positive number of seconds";
+                    } else {
+                         error = "Expected seconds argument to --stats";
+                    }
+               } else if (0 == strcmp(arg, "--realtime")) {
+                    if (value) {
+                         argi++;
+                         realtime.cpu = atoi(value);
+                         if (realtime.cpu < 0 || realtime.cpu >= uu_cpu_count()) error = "Expected a processor number";
+                    } else {
+                         error = "Expected cpu argument to --realtime";
+                    }
+               } else if (0 == strcmp(arg, "--realtime-priority")) {
+                    if (value) {
+                         argi++;
+                         realtime.priority = atoi(value);
+                         if (realtime.priority < 1 || realtime.priority > 99) error = "Expected a priority from 1 to 99";
+                    } else {
+                         error = "Expected priority argument to --realtime-priority";
+                    }
+               } else if (0 == strcmp(arg, "--realtime-mlock")) {
+                    realtime.lock_memory = 1;
+               } else if (0 == strcmp(arg, "--replay")) {
+                    if (value) {
+                         argi++;
+                         replay.path = value;
+                    } else {
+                         error = "Expected path argument to --replay";
+                    }
+               } else if (0 == strcmp(arg, "--replay-speed")) {
+                    if (value) {
+                         argi++;
+                         if (replay_parse_speed(value, &replay.speed) != 0) error = "Expected a speed like 1x, 60x or max";
+                    } else {
+                         error = "Expected speed argument to --replay-speed";
+                    }
+               } else if (0 == strcmp(arg, "--replay-wire")) {
+                    replay.wire = 1;
+               } else if (0 == strcmp(arg, "--replay-restamp")) {
+                    replay.restamp = 1;
+               } else if (0 == strcmp(arg, "--arena")) {
+                    if (value) {
+                         argi++;
+                         arena_size = parse_byte_size(value);
+                         if (arena_size <= 0) error = "Expected a size like 65536, 64K, 64M or 1G";
+                    } else {
+                         error = "Expected bytes argument to --arena";
+                    }
+               } else if (0 == strcmp(arg, "--ring-file")) {
+                    if (value) {
+                         argi++;
+                         ring_file_path = value;
+                    } else {
+                         error = "Expected path argument to --ring-file";
+                    }
+               } else if (0 == strcmp(arg, "--ring-size")) {
+                    if (value) {
+                         argi++;
+                         ring_file_size = parse_byte_size(value);
+                         if (ring_file_size <= 0) error = "Expected a size like 65536, 64K, 64M or 1G";
+                    } else {
+                         error = "Expected bytes argument to --ring-size";
+                    }
+               } else if (0 == strcmp(arg, "--ring-sync")) {
+                    if (value) {
+                         argi++;
+                         ring_file_sync_interval_ms = atoi(value);
+                         if (ring_file_sync_interval_ms <= 0) error = "Expected a positive number of milliseconds";
+                    } else {
+                         error = "Expected ms argument to --ring-sync";
+                    }
+               } else if (0 == strcmp(arg, "--window")) {
+                    if (!value) {
+                         error = "Expected duration argument to --window";
+                    } else if (num_windows == WINDOW_MAX_COUNT) {
+                         error = "Too many windows";
+                    } else {
+                         argi++;
+                         window_durations[num_windows] = window_parse_duration(value);
+                         window_labels[num_windows] = value;
+                         if (window_durations[num_windows] <= 0 || window_durations[num_windows] > WINDOW_MAX_SECONDS) {
+                              error = "Expected a duration like 90s, 5m, 1h or 1d, of at most 7d";
+                         }
+                         num_windows++;
+                    }
+               } else if (0 == strcmp(arg, "--window-every")) {
+                    if (value) {
+                         argi++;
+                         window_every_seconds = window_parse_duration(value);
+                         if (window_every_seconds <= 0) error = "Expected a duration like 10s, 5m or 1h";
+                    } else {
+                         error = "Expected duration argument to --window-every";
+                    }
+               } else if (0 == strcmp(arg, "--window-output")) {
+                    if (value) {
+                         argi++;
+                         window_output = value;
+                    } else {
+                         error = "Expected target argument to --window-output";
+                    }
+               } else if (0 == strcmp(arg, "--alert")) {
+                    if (value) {
+                         argi++;
+                         error = (char *)alert_engine_add_rule(&alerts, value);
+                    } else {
+                         error = "Expected rule argument to --alert";
+                    }
+               } else if (0 == strcmp(arg, "--alerts")) {
+                    if (value) {
+                         argi++;
+                         if (alert_engine_load_rules(&alerts, value) != 0) error = "Invalid alert rules";
+                    } else {
+                         error = "Expected file argument to --alerts";
+                    }
+               } else if (0 == strcmp(arg, "--history")) {
+                    if (value) {
+                         argi++;
+                         int64_t steps[HISTORY_MAX_ARCHIVES], num_points[HISTORY_MAX_ARCHIVES];
+                         history_spec = value;
+                         if (history_parse_spec(value, steps, num_points) <= 0) error = "Expected step:retention[,step:retention]...";
+                    } else {
+                         error = "Expected archives argument to --history";
+                    }
+               } else if (0 == strcmp(arg, "--history-socket")) {
+                    if (value) {
+                         argi++;
+                         history_socket_path = value;
+                    } else {
+                         error = "Expected path argument to --history-socket";
+                    }
+               } else if (0 == strcmp(arg, "--metrics")) {
+                    if (value) {
+                         argi++;
+                         metrics_address = value;
+                    } else {
+                         error = "Expected [host:]port argument to --metrics";
+                    }
+               } else if (0 == strcmp(arg, "--rollup")) {
+                    if (value) {
+                         argi++;
+                         rollup_prefix = value;
+                    } else {
+                         error = "Expected prefix argument to --rollup";
+                    }
+               } else if (arg[0] == '-' && arg[1] == ProgramOption_OutputFile && !arg[2]) {
+                    if (!value) {
                          error = "Expected filename argument to -o";
+                    } else if (num_sinks == SINK_MAX_COUNT) {
+                         error = "Too many outputs";
+                    } else {
+                         argi++;
+                         sink_configs[num_sinks] = next_sink;
+                         sink_configs[num_sinks].target = value;
+                         sink_explicit_options[num_sinks] = next_sink_options;
+                         num_sinks++;
+                         trailing_sink_options = 0;
                     }
 	       } else if (arg[0] == '-' && arg[1] == ProgramOption_OutputEveryReading && !arg[2]) {
 		    force_output_even_without_change = 1;
@@ -65,17 +1110,137 @@ int main(int argc, char **argv)
                return 1;
           }
      }
-     FILE *output_stream = stdout;
-     if (output_filename) {
-          output_stream = fopen(output_filename, "wb");
-	  if (!output_stream) {
-              fprintf(stderr, "ERROR: could not open file %s for writing.\n", output_filename);
-              return 1;
+     if (!num_sinks && !ring_file_path) {
+          sink_configs[num_sinks] = next_sink;
+          sink_explicit_options[num_sinks++] = next_sink_options;
+     }
+     if ((realtime.priority || realtime.lock_memory) && realtime.cpu < 0) {
+          fprintf(stderr, "ERROR: --realtime-priority and --realtime-mlock go with --realtime\n\n%s\n", USAGE);
+          return 1;
+     }
+     if ((replay.speed != 1 || replay.wire || replay.restamp) && !replay.path) {
+          fprintf(stderr, "ERROR: --replay-speed, --replay-wire and --replay-restamp go with --replay\n\n%s\n", USAGE);
+          return 1;
+     }
+     if (replay.path && realtime.cpu >= 0) {
+          fprintf(stderr, "ERROR: --realtime reads the sensor, not a --replay\n\n%s\n", USAGE);
+          return 1;
+     }
+     if (num_windows && !window_output) {
+          for (int i = 0; i < num_sinks; i++) {
+               if (0 == strcmp(sink_configs[i].target, "-")) {
+                    fprintf(stderr, "ERROR: the readings go to standard output, give the window statistics a --window-output\n\n%s\n", USAGE);
+                    return 1;
+               }
           }
-	  // implicit fclose(output_stream), we let the OS do it for us
+          window_output = "-";
      }
-     zyaura_record_output_to_stream(output_stream, force_output_even_without_change);
-     return 0;
+     for (int i = 0; i < num_sinks; i++) {
+          unsigned apply = trailing_sink_options & ~sink_explicit_options[i];
+          if (apply & SinkOptionBits_Format) {
+               sink_configs[i].serializer = next_sink.serializer;
+               sink_configs[i].arrow = next_sink.arrow;
+          }
+          if (apply & SinkOptionBits_Overflow) sink_configs[i].overflow = next_sink.overflow;
+          if (apply & SinkOptionBits_Queue) sink_configs[i].queue_capacity = next_sink.queue_capacity;
+          if (apply & SinkOptionBits_CommitInterval) sink_configs[i].commit_interval_ms = next_sink.commit_interval_ms;
+          if (apply & SinkOptionBits_CommitBytes) sink_configs[i].commit_bytes = next_sink.commit_bytes;
+          if (apply & SinkOptionBits_CommitRows) sink_configs[i].commit_rows = next_sink.commit_rows;
+          if (apply & SinkOptionBits_Sync) sink_configs[i].sync = next_sink.sync;
+          if (apply & SinkOptionBits_Index) {
+               sink_configs[i].index_every_ns = next_sink.index_every_ns;
+               sink_configs[i].index_every_bytes = next_sink.index_every_bytes;
+          }
+          if (apply & SinkOptionBits_Qos) sink_configs[i].mqtt_qos = next_sink.mqtt_qos;
+          if (apply & SinkOptionBits_ArrowBatch) sink_configs[i].arrow_batch_rows = next_sink.arrow_batch_rows;
+          // a replay has no device to fall behind: it waits for the targets
+          // rather than dropping, unless told otherwise
+          if (replay.path && !((sink_explicit_options[i] | apply) & SinkOptionBits_Overflow)) {
+               sink_configs[i].overflow = SinkOverflow_Block;
+          }
+     }
+
+     if (arena_size && memory_arena_open(arena_size) != 0) {
+          return 1;
+     }
+     static SinkSet sinks;
+     static RingFile ring_file;
+     static WindowSet windows;
+     ZyAuraOutputs outputs = { .sinks = &sinks };
+     if (sink_set_open(&sinks, sink_configs, num_sinks, spill_dir, stats_interval_seconds) != 0) {
+          return 1;
+     }
+     if (ring_file_path) {
+          if (ring_file_open(&ring_file, ring_file_path, ring_file_size, ring_file_sync_interval_ms) != 0) {
+               return 1;
+          }
+          outputs.ring_file = &ring_file;
+     }
+     if (num_windows) {
+          if (window_set_open(&windows, window_durations, window_labels, num_windows, window_every_seconds, window_output) != 0) {
+               return 1;
+          }
+          outputs.windows = &windows;
+     }
+     if (alerts.num_rules) {
+          if (alert_engine_start(&alerts) != 0) {
+               return 1;
+          }
+          outputs.alerts = &alerts;
+     }
+     static HistorySet history;
+     if (history_socket_path) {
+          if (history_set_open(&history, history_spec ? history_spec : HISTORY_DEFAULT_SPEC, history_socket_path) != 0) {
+               return 1;
+          }
+          outputs.history = &history;
+     }
+     static RollupSet rollups;
+     if (rollup_prefix) {
+          if (rollup_set_open(&rollups, rollup_prefix) != 0) {
+               return 1;
+          }
+          outputs.rollups = &rollups;
+     }
+     static MetricsServer metrics;
+     if (metrics_address) {
+          if (metrics_server_open(&metrics, metrics_address, &sinks) != 0) {
+               return 1;
+          }
+          outputs.metrics = &metrics;
+     }
+     memory_arena_seal();
+     if (stats_interval_seconds > 0 || arena_size) memory_print_stats(stderr);
+     signal(SIGINT, zyaura_request_stop);
+     signal(SIGTERM, zyaura_request_stop);
+     int rc = replay.path
+          ? zyaura_replay_output(&outputs, force_output_even_without_change, &replay, stats_interval_seconds)
+          : realtime.cpu >= 0
+          ? zyaura_record_output_realtime(&outputs, force_output_even_without_change, &realtime, stats_interval_seconds)
+          : zyaura_record_output(&outputs, force_output_even_without_change, NULL);
+     if (outputs.metrics) {
+          // before the sinks, whose counters it reads
+          metrics_server_close(outputs.metrics);
+          if (stats_interval_seconds > 0) metrics_server_print_stats(outputs.metrics, stderr);
+     }
+     sink_set_close(&sinks);
+     if (outputs.windows) window_set_close(outputs.windows);
+     if (outputs.alerts) {
+          alert_engine_stop(outputs.alerts);
+          if (stats_interval_seconds > 0) alert_engine_print_stats(outputs.alerts, stderr);
+     }
+     if (outputs.rollups) rollup_set_close(outputs.rollups);
+     if (outputs.history) {
+          if (stats_interval_seconds > 0) history_set_print_stats(outputs.history, stderr);
+          history_set_close(outputs.history);
+     }
+     if (outputs.ring_file) {
+          if (stats_interval_seconds > 0) ring_file_print_stats(outputs.ring_file, stderr);
+          ring_file_close(outputs.ring_file);
+     }
+     if (stats_interval_seconds > 0) memory_print_stats(stderr);
+     if (memory_check_steady() != 0) rc = -1;
+     return rc == 0 ? 0 : 1;
 }
 
 // References
@@ -131,24 +1296,156 @@ typedef struct ZyAuraReport
      };
 } ZyAuraReport;
 
+// The key the reports are encrypted with, sent to the sensor when it starts
+static unsigned char const ZYAURA_KEY[8] = {0xc4, 0xc6, 0xc0, 0x92, 0x40, 0x23, 0xdc, 0x96};
+
 UU_USB_Device uu_find_holtek_zytemp();
 void uu_decrypt_holtek_zytemp_report(uint8_t const key[8], uint8_t data[8]);
+void uu_encrypt_holtek_zytemp_report(uint8_t const key[8], uint8_t data[8]);
 ZyAuraReport unpack_holtek_zytemp_report(uint8_t decrypted_data[8]);
 
-#if defined(WIN32)
-struct tm* localtime_r(time_t *clock, struct tm *result)
+// Every report of a channel, before the unchanged ones are skipped
+static void zyaura_observe_reading(ZyAuraOutputs *outputs, Reading const *reading, int64_t received_ns)
+{
+     if (outputs->windows) window_set_add(outputs->windows, reading);
+     if (outputs->alerts) alert_engine_evaluate(outputs->alerts, reading, received_ns);
+     if (outputs->history) history_set_add(outputs->history, reading);
+     if (outputs->rollups) rollup_set_add(outputs->rollups, reading);
+}
+
+static void zyaura_output_reading(ZyAuraOutputs *outputs, Reading const *reading)
+{
+     sink_set_push(outputs->sinks, reading);
+     if (outputs->ring_file) ring_file_append(outputs->ring_file, reading);
+}
+
+// What the handling of a reading remembers until the next one
+typedef struct ZyAuraDecoder
+{
+     ZyAuraOutputs *outputs;
+     int force_output_even_without_change;
+     int last_co2_in_ppm;
+     float last_temperature_in_C;
+} ZyAuraDecoder;
+
+static void zyaura_decoder_init(ZyAuraDecoder *decoder, ZyAuraOutputs *outputs, int force_output_even_without_change)
 {
-    struct tm *p = localtime(clock);
-    if (p) {
-        *result = *p;
-    }
-    return p;
+     decoder->outputs = outputs;
+     decoder->force_output_even_without_change = force_output_even_without_change;
+     decoder->last_co2_in_ppm = 0; // invalid value
+     decoder->last_temperature_in_C = 0.0/0.0; // invalid value
 }
+
+static void zyaura_handle_reading(ZyAuraDecoder *decoder, Reading const *reading, int64_t received_ns)
+{
+     ZyAuraOutputs *outputs = decoder->outputs;
+     if (outputs->metrics) metrics_server_add_reading(outputs->metrics, reading, received_ns);
+     switch (reading->kind) {
+     case ReadingKind_CO2: {
+          zyaura_observe_reading(outputs, reading, received_ns);
+          if (decoder->force_output_even_without_change || reading->co2_in_ppm != decoder->last_co2_in_ppm) {
+               decoder->last_co2_in_ppm = reading->co2_in_ppm;
+               zyaura_output_reading(outputs, reading);
+          }
+          break;
+     }
+
+     case ReadingKind_Temperature: {
+          zyaura_observe_reading(outputs, reading, received_ns);
+          if (decoder->force_output_even_without_change || reading->temperature_in_C != decoder->last_temperature_in_C) {
+               decoder->last_temperature_in_C = reading->temperature_in_C;
+               zyaura_output_reading(outputs, reading);
+          }
+          break;
+     }
+
+     default: {
+          zyaura_output_reading(outputs, reading);
+          break;
+     }
+     }
+}
+
+// Decrypts and checks an input report, and hands its reading to the outputs
+static int zyaura_decode_report(ZyAuraDecoder *decoder, uint8_t data[8], int64_t time_unix_ns, int64_t received_ns)
+{
+     uu_decrypt_holtek_zytemp_report(ZYAURA_KEY, data);
+     MetricsServer *metrics = decoder->outputs->metrics;
+     if (data[4] != 0x0d) {
+          if (metrics) metrics_server_add_bad_report(metrics);
+          fprintf(stderr, "ERROR: missing terminator\n");
+          return -1;
+     }
+     if (data[3] != ((data[0] + data[1] + data[2]) & 0xff)) {
+          if (metrics) metrics_server_add_bad_report(metrics);
+          fprintf(stderr, "ERROR: checksum\n");
+          return -1;
+     }
+
+     struct ZyAuraReport report = unpack_holtek_zytemp_report(data);
+     Reading reading = {
+          .time_unix_ns = time_unix_ns,
+          .opcode = report.opcode,
+          .raw_value = report.raw_value,
+     };
+     switch (report.opcode) {
+     case ZyAuraOpcode_Relative_CO2_Concentration: {
+          reading.kind = ReadingKind_CO2;
+          reading.co2_in_ppm = report.co2_in_ppm;
+          break;
+     }
+
+     case ZyAuraOpcode_Temperature: {
+          reading.kind = ReadingKind_Temperature;
+          reading.temperature_in_C = report.temperature_in_C;
+          break;
+     }
+
+     case ZyAuraOpcode_RelativeHumidity: {
+          // Our ZG01CV does not support relative humidity. The opcode is
+          // being received but reads always as zero. So we disable it.
+          //
+          // fprintf(out, "Relative Humidity: %f %%\n", report.relative_humidity);
+          if (metrics) metrics_server_add_report(metrics, report.opcode, received_ns);
+          return 0;
+     }
+
+     case ZyAuraOpcode_Checksum_Error: {
+          reading.kind = ReadingKind_ChecksumError; // this should happen on write.
+          break;
+     }
+
+     case ZyAuraOpcode_Unknown_C:
+     case ZyAuraOpcode_Unknown_O:
+     case ZyAuraOpcode_Unknown_R:
+     case ZyAuraOpcode_Unknown_W:
+     case ZyAuraOpcode_Unknown_V:
+     case ZyAuraOpcode_Unknown_m:
+     case ZyAuraOpcode_Unknown_n:
+     case ZyAuraOpcode_Unknown_q: {
+#if 0
+          // These report numbers are received regularly, but we don't know
+          // what they mean, and what info they're carrying.
+          fprintf(out, "<Unknown Opcode: 0x%x '%c'>\t%d\n", report.opcode, (char) report.opcode, report.raw_value);
 #endif
+          if (metrics) metrics_server_add_report(metrics, report.opcode, received_ns);
+          return 0;
+     }
 
-int zyaura_record_output_to_stream(FILE *out, int force_output_even_without_change)
+     default: {
+          reading.kind = ReadingKind_UnexpectedOpcode;
+          break;
+     }
+     }
+     zyaura_handle_reading(decoder, &reading, received_ns);
+     return 0;
+}
+
+// With a realtime reader, readings are stamped to the nanosecond, see
+// co2_realtime.c, otherwise to the second.
+int zyaura_record_output(ZyAuraOutputs *outputs, int force_output_even_without_change, RealtimeReader *realtime)
 {
-     assert(out);
+     assert(outputs);
      int rc = -1;
      UU_HIDAPI_GUARD(hid_init(), "hidapi: hid_init");
      UU_USB_Device device = uu_find_holtek_zytemp();
@@ -158,13 +1455,12 @@ int zyaura_record_output_to_stream(FILE *out, int force_output_even_without_chan
      }
 
      // Send encoding key and start device
-     unsigned char const key[] = {0xc4, 0xc6, 0xc0, 0x92, 0x40, 0x23, 0xdc, 0x96};
      {
-        unsigned char msg[sizeof key + 1] = { 0x00, };
+        unsigned char msg[sizeof ZYAURA_KEY + 1] = { 0x00, };
         // "The first byte of data[] must contain the Report-ID (note that hidapi
         // on the mac doesn't have this requirement, and silently drops the
         // initial zero)
-        memcpy(&msg[1], &key[0], sizeof key);
+        memcpy(&msg[1], &ZYAURA_KEY[0], sizeof ZYAURA_KEY);
 
         int num_bytes_or_error = hid_send_feature_report(device.handle, msg, sizeof msg);
         if (num_bytes_or_error != sizeof msg) {
@@ -173,111 +1469,83 @@ int zyaura_record_output_to_stream(FILE *out, int force_output_even_without_chan
         }
      }
 
-     time_t prev_time_unix = time(NULL);
-     fprintf(out, "Time\tReading\tValue\n");
-     int last_co2_in_ppm = 0; // invalid value
-     float last_temperature_in_C = 0.0/0.0; // invalid value
-     for (;;) {
+     ZyAuraDecoder decoder;
+     zyaura_decoder_init(&decoder, outputs, force_output_even_without_change);
+     while (!zyaura_stop_requested) {
           enum { INPUT_REPORT_SIZE = 8 };
           unsigned char msg[1 + INPUT_REPORT_SIZE] = {0, };
           // ^ "the first byte will contain the report number if the device
           // uses numbered reports"
           int num_bytes_or_error = hid_read(device.handle, msg, sizeof msg);
+          int64_t received_ns = uu_monotonic_ns();
+          if (zyaura_stop_requested) break;
           if (num_bytes_or_error != sizeof msg &&
               num_bytes_or_error != INPUT_REPORT_SIZE) {
-               UU_HIDAPI_GUARD(num_bytes_or_error, "hidapi: reading report");
-               exit(1);
+               // the sinks still write out what they have queued
+               fprintf(stderr, "unexpected hdiapi error: %d (%s)\n", num_bytes_or_error, "hidapi: reading report");
+               goto done;
           }
+          int64_t time_unix_ns = realtime ? realtime_reader_stamp(realtime, received_ns) : (int64_t)time(NULL) * NS_PER_SECOND;
           unsigned char data[INPUT_REPORT_SIZE];
           if (num_bytes_or_error == INPUT_REPORT_SIZE + 1) {
                // this happens on windows, the report is prefixed with
                // the report-id of zero:
                if (msg[0] != 0) {
                    fprintf(stderr, "ERROR: unexpected report from device (expected report-id 0)\n");
-                  exit(1);
+                  goto done;
                }
                memcpy(&data[0], &msg[1], sizeof data);
           } else {
                memcpy(&data[0], &msg[0], sizeof data);
           }
 
-          time_t now_unix = time(NULL);
-          struct tm now_localtime;
-          localtime_r(&now_unix, &now_localtime);
-
-          uu_decrypt_holtek_zytemp_report(key, data);
-          if (data[4] != 0x0d) {
-               fprintf(stderr, "ERROR: missing terminator\n");
-               exit(1);
-          }
-          if (data[3] != ((data[0] + data[1] + data[2]) & 0xff)) {
-               fprintf(stderr, "ERROR: checksum\n");
-               exit(1);
-          }
-
-          char time_string_buffer[4096];
-          size_t time_string_len = strftime(&time_string_buffer[0], sizeof time_string_buffer, "%Y-%m-%dT%H:%M:%S", &now_localtime);
-          assert(time_string_len);
-
-          struct ZyAuraReport report = unpack_holtek_zytemp_report(data);
-          switch (report.opcode) {
-          case ZyAuraOpcode_Relative_CO2_Concentration: {
-	       if (force_output_even_without_change || report.co2_in_ppm != last_co2_in_ppm) {
-		    last_co2_in_ppm = report.co2_in_ppm;
-		    fprintf(out, "%*s\tCO2\t%d\n", (int)time_string_len, time_string_buffer, report.co2_in_ppm);
-	       }
-               break;
-          }
-
-          case ZyAuraOpcode_Temperature: {
-	       if (force_output_even_without_change || report.temperature_in_C != last_temperature_in_C) {
-		    last_temperature_in_C = report.temperature_in_C;
-		    fprintf(out, "%*s\tTemperature\t%f\n", (int)time_string_len, time_string_buffer, report.temperature_in_C);
-	       }
-               break;
-          }
-
-          case ZyAuraOpcode_RelativeHumidity: {
-               // Our ZG01CV does not support relative humidity. The opcode is
-               // being received but reads always as zero. So we disable it.
-               //
-               // fprintf(out, "Relative Humidity: %f %%\n", report.relative_humidity);
-               break;
-          }
+          if (zyaura_decode_report(&decoder, data, time_unix_ns, received_ns) != 0) goto done;
+          if (realtime) realtime_reader_handled(realtime, received_ns);
+          memory_thread_set_steady(1);
+     }
 
-          case ZyAuraOpcode_Checksum_Error: {
-               fprintf(out, "%*s\t<Module returned checksum error>\n", (int)time_string_len, time_string_buffer); // this should happen on write.
-          }
+     rc = 0;
+done:
+     memory_thread_set_steady(0);
+     hid_exit();
+     return rc;
+}
 
-          case ZyAuraOpcode_Unknown_C:
-          case ZyAuraOpcode_Unknown_O:
-          case ZyAuraOpcode_Unknown_R:
-          case ZyAuraOpcode_Unknown_W:
-          case ZyAuraOpcode_Unknown_V:
-          case ZyAuraOpcode_Unknown_m:
-          case ZyAuraOpcode_Unknown_n:
-          case ZyAuraOpcode_Unknown_q: {
-#if 0
-               // These report numbers are received regularly, but we don't know
-               // what they mean, and what info they're carrying.
-               fprintf(out, "<Unknown Opcode: 0x%x '%c'>\t%d\n", report.opcode, (char) report.opcode, report.raw_value);
-#endif
+// Replays the readings of --replay through the outputs, see co2_replay.c
+static int zyaura_replay_output(ZyAuraOutputs *outputs, int force_output_even_without_change, ReplayConfig const *config,
+                         int stats_interval_seconds)
+{
+     static ReplaySource source;
+     if (replay_source_open(&source, config, &zyaura_stop_requested) != 0) return -1;
+     ZyAuraDecoder decoder;
+     zyaura_decoder_init(&decoder, outputs, force_output_even_without_change);
+     int64_t next_stats_ns = uu_monotonic_ns() + (int64_t)stats_interval_seconds * NS_PER_SECOND;
+     int rc = 0;
+     Reading reading;
+     int64_t received_ns;
+     while (rc == 0 && !zyaura_stop_requested) {
+          int status = replay_source_next(&source, &reading, &received_ns);
+          if (status <= 0) {
+               rc = status;
                break;
           }
-
-          default: {
-               fprintf(out, "%*s\t<Unexpected Opcode: 0x%x '%c'\t%d\n", (int)time_string_len, time_string_buffer, report.opcode, (char) report.opcode, report.raw_value);
-               break;
+          if (config->wire) {
+               uint8_t data[8];
+               replay_encode_report(&reading, data);
+               uu_encrypt_holtek_zytemp_report(ZYAURA_KEY, data);
+               rc = zyaura_decode_report(&decoder, data, reading.time_unix_ns, received_ns);
+          } else {
+               zyaura_handle_reading(&decoder, &reading, received_ns);
           }
+          memory_thread_set_steady(1);
+          if (stats_interval_seconds > 0 && received_ns >= next_stats_ns) {
+               replay_source_print_stats(&source, stderr);
+               next_stats_ns += (int64_t)stats_interval_seconds * NS_PER_SECOND;
           }
-
-          if (now_unix - prev_time_unix > 0)  fflush(out);
-          prev_time_unix = now_unix;
      }
-
-     rc = 0;
-done:
-     hid_exit();
+     memory_thread_set_steady(0);
+     replay_source_print_stats(&source, stderr);
+     replay_source_close(&source);
      return rc;
 }
 
@@ -315,6 +1583,30 @@ void uu_decrypt_holtek_zytemp_report(uint8_t const key[8], uint8_t data[8])
      }
 }
 
+// The inverse of uu_decrypt_holtek_zytemp_report, what the sensor does
+void uu_encrypt_holtek_zytemp_report(uint8_t const key[8], uint8_t data[8])
+{
+     int shuffle[8] = { 2, 4, 0, 7, 1, 6, 5, 3 };
+
+     uint8_t cstate[8] = {'H', 't', 'e', 'm', 'p', '9', '9', 'e'}; // salt
+     uint8_t temp1[8] = { 0, };
+     for (int i = 0; i < 8; i++) {
+          uint8_t ctemp = ((cstate[i] >> 4) & 15) | (cstate[i]<<4);
+          temp1[i] = (data[i] + ctemp) & 0xff;
+     }
+
+     uint8_t temp[8] = { 0, };
+     for (int i = 0; i < 8; i++) {
+          int ni = (i + 1) & 7;
+          temp[i] = ((temp1[i]<<3) | (temp1[ni]>>5)) & 0xff;
+     }
+
+     for (int i = 0; i < 8; i++) {
+          int di = shuffle[i];
+          data[i] = temp[di] ^ key[di];
+     }
+}
+
 ZyAuraReport unpack_holtek_zytemp_report(uint8_t decrypted_data[8])
 {
      ZyAuraReport Result;
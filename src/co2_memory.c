@@ -0,0 +1,205 @@
+// Memory: the arena of --arena, allocation accounting and the resident size
+//
+// The buffers of the live pipeline, the report slots of the sink queues,
+// the output buffers and batches, the windows, the history archives and the
+// alert histories, are allocated once when the program starts, through
+// memory_alloc and memory_calloc. With --arena bytes they come from a single
+// block of that size, touched at startup so that it is resident from then
+// on, and the arena is sealed once every output is open: an allocation past
+// the seal fails, so the memory of the process cannot grow through it.
+// memory_free of an arena block does nothing, the arena goes with the
+// process.
+//
+// Accounting: a build with CO2_COUNT_ALLOCATIONS (Linux, glibc) replaces
+// malloc, calloc, realloc and free with versions that count, so that the
+// allocations of the C library (stdio, name resolution) and of hidapi are
+// counted too. The reader and the file sinks mark their thread steady once
+// their first reading went through; the allocations of a steady thread are
+// counted apart, shown on the memory line of --stats, and with --arena make
+// the program exit with an error.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { MEMORY_ALIGNMENT = 16 }; // of the blocks, and size of their header
+
+typedef struct MemoryArena
+{
+     uint8_t *data; // NULL without --arena
+     int64_t size;
+     int64_t used;
+     int sealed;
+     int full; // reported once
+     UU_Mutex mutex; // sink threads start while others still allocate
+} MemoryArena;
+
+static MemoryArena memory_arena;
+
+#if defined(CO2_COUNT_ALLOCATIONS)
+
+static uint64_t memory_heap_allocations; // every malloc, calloc and realloc
+static uint64_t memory_steady_allocations; // the ones of steady threads
+static __thread int memory_thread_is_steady;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *data, size_t size);
+extern void __libc_free(void *data);
+
+static void memory_count_allocation(void)
+{
+     __atomic_add_fetch(&memory_heap_allocations, 1, __ATOMIC_RELAXED);
+     if (memory_thread_is_steady) __atomic_add_fetch(&memory_steady_allocations, 1, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+     memory_count_allocation();
+     return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+     memory_count_allocation();
+     return __libc_calloc(count, size);
+}
+
+void *realloc(void *data, size_t size)
+{
+     memory_count_allocation();
+     return __libc_realloc(data, size);
+}
+
+void free(void *data)
+{
+     __libc_free(data);
+}
+
+#endif
+
+// Marks the calling thread as in its steady state, or out of it before it
+// tears down
+void memory_thread_set_steady(int steady)
+{
+#if defined(CO2_COUNT_ALLOCATIONS)
+     memory_thread_is_steady = steady;
+#else
+     (void)steady;
+#endif
+}
+
+// Reserves and touches the arena, from which the memory_ allocations come
+// from then on
+int memory_arena_open(int64_t size)
+{
+     memory_arena.data = malloc((size_t)size);
+     if (!memory_arena.data) {
+          fprintf(stderr, "ERROR: could not allocate an arena of %lld bytes\n", (long long)size);
+          return -1;
+     }
+     memset(memory_arena.data, 0, (size_t)size);
+     memory_arena.size = size;
+     uu_mutex_init(&memory_arena.mutex);
+     return 0;
+}
+
+// Every later arena allocation fails
+void memory_arena_seal(void)
+{
+     if (!memory_arena.data) return;
+     uu_mutex_lock(&memory_arena.mutex);
+     memory_arena.sealed = 1;
+     uu_mutex_unlock(&memory_arena.mutex);
+}
+
+static int memory_in_arena(void const *data)
+{
+     return memory_arena.data && (uint8_t const *)data >= memory_arena.data
+          && (uint8_t const *)data < memory_arena.data + memory_arena.size;
+}
+
+static void *memory_arena_alloc(size_t size)
+{
+     int64_t needed = MEMORY_ALIGNMENT + (((int64_t)size + MEMORY_ALIGNMENT - 1) & ~(int64_t)(MEMORY_ALIGNMENT - 1));
+     uint8_t *block = NULL;
+     uu_mutex_lock(&memory_arena.mutex);
+     if (!memory_arena.sealed && memory_arena.used + needed <= memory_arena.size) {
+          block = memory_arena.data + memory_arena.used;
+          memory_arena.used += needed;
+     } else if (!memory_arena.full) {
+          memory_arena.full = 1;
+          if (memory_arena.sealed) {
+               fprintf(stderr, "ERROR: allocation of %llu bytes after startup, from the sealed arena\n", (unsigned long long)size);
+          } else {
+               fprintf(stderr, "ERROR: the arena of %lld bytes is full, give a larger --arena\n", (long long)memory_arena.size);
+          }
+     }
+     uu_mutex_unlock(&memory_arena.mutex);
+     if (!block) return NULL;
+     memcpy(block, &size, sizeof size);
+     return block + MEMORY_ALIGNMENT;
+}
+
+void *memory_alloc(size_t size)
+{
+     return memory_arena.data ? memory_arena_alloc(size) : malloc(size);
+}
+
+void *memory_calloc(size_t count, size_t size)
+{
+     if (!memory_arena.data) return calloc(count, size);
+     if (size && count > SIZE_MAX / size) return NULL;
+     void *data = memory_arena_alloc(count * size);
+     if (data) memset(data, 0, count * size);
+     return data;
+}
+
+// An arena block grows into a new one, the old one stays unused
+void *memory_realloc(void *data, size_t size)
+{
+     if (!memory_in_arena(data)) return memory_arena.data && !data ? memory_arena_alloc(size) : realloc(data, size);
+     size_t old_size;
+     memcpy(&old_size, (uint8_t *)data - MEMORY_ALIGNMENT, sizeof old_size);
+     if (size <= old_size) return data;
+     void *grown = memory_arena_alloc(size);
+     if (grown) memcpy(grown, data, old_size);
+     return grown;
+}
+
+void memory_free(void *data)
+{
+     if (!memory_in_arena(data)) free(data);
+}
+
+void memory_print_stats(FILE *out)
+{
+     int64_t arena_used = 0;
+     if (memory_arena.data) {
+          uu_mutex_lock(&memory_arena.mutex);
+          arena_used = memory_arena.used;
+          uu_mutex_unlock(&memory_arena.mutex);
+     }
+     fprintf(out, "memory\trss=%lldKiB arena=%lldKiB arena_used=%lldKiB",
+             (long long)(uu_resident_bytes() >> 10), (long long)(memory_arena.size >> 10), (long long)(arena_used >> 10));
+#if defined(CO2_COUNT_ALLOCATIONS)
+     fprintf(out, " heap_allocations=%llu steady_allocations=%llu",
+             (unsigned long long)__atomic_load_n(&memory_heap_allocations, __ATOMIC_RELAXED),
+             (unsigned long long)__atomic_load_n(&memory_steady_allocations, __ATOMIC_RELAXED));
+#endif
+     fprintf(out, "\n");
+}
+
+// With --arena, in a counting build: fails when a steady thread allocated
+int memory_check_steady(void)
+{
+#if defined(CO2_COUNT_ALLOCATIONS)
+     uint64_t steady_allocations = __atomic_load_n(&memory_steady_allocations, __ATOMIC_RELAXED);
+     if (memory_arena.data && steady_allocations) {
+          fprintf(stderr, "ERROR: %llu heap allocations in the steady state\n", (unsigned long long)steady_allocations);
+          return -1;
+     }
+#endif
+     return 0;
+}
@@ -0,0 +1,457 @@
+// Merge of outputs by time
+//
+// co2 merge streams time-ordered tsv or binary outputs or archives, e.g. one
+// per room, into a single tsv in time order, with the source of every
+// reading in an extra column:
+//
+//   Time Source Reading Value
+//
+// Every input is read through its own fixed size buffer, so memory is
+// constant per input and inputs can be pipes. Archives are memory mapped
+// instead, and decoded a block at a time. The inputs are merged with a
+// binary min-heap on the time of their next reading, O(log k) per reading
+// for k inputs; ties go to the input given first, which keeps the output
+// deterministic.
+//
+// With a grid, the output has the latest CO2 and temperature of every source
+// within each step of the grid, stamped with the start of the step. A step
+// is written once the merge reaches a later one, sources in the order given.
+//
+// With arrow_batch_rows, the output is an Arrow IPC stream instead (see
+// ArrowBatch), the source being the sensor: a conversion of outputs for
+// analysis.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { MERGE_INPUT_BUFFER_SIZE = 64 << 10 };
+enum { MERGE_MAX_LINE = 4096 }; // longer lines are skipped
+enum { MERGE_MAX_TAG = 128 };
+enum { MERGE_OUTPUT_BUFFER_SIZE = 1 << 20 };
+
+typedef struct MergeInput
+{
+     char const *path;
+     char tag[MERGE_MAX_TAG];
+     int tag_length;
+     int fd;
+     int is_binary;
+     int is_archive; // read through archive rather than fd and buffer
+     int has_header; // a tsv output, rather than any text
+     int eof;
+     char *buffer;
+     char const *next; // in buffer
+     char const *end;
+     TsvTimeCache time_cache;
+
+     Reading reading; // next in time order
+     char const *line; // of the reading in a tsv, in buffer until the next one
+     OutputTimeCache time_cache_out; // to write the readings of a binary
+     int64_t num_readings;
+     int64_t num_out_of_order;
+     int64_t num_unparsed; // lines of a tsv that are not readings, or a torn binary record
+     Archive archive;
+     Reading *block_readings; // decoded block of the archive
+     int block; // next to decode
+     int block_size;
+     int block_next;
+     Reading pending[2]; // with a grid: latest CO2 and temperature of the step
+     int has_pending[2];
+} MergeInput;
+
+// The heap holds the keys, for its comparisons not to touch the inputs
+typedef struct MergeHeapEntry
+{
+     int64_t time_unix_ns;
+     int input_index;
+} MergeHeapEntry;
+
+typedef struct Merge
+{
+     MergeInput *inputs;
+     int num_inputs;
+     MergeHeapEntry *heap; // ordered by time then input index
+     int heap_size;
+
+     int64_t grid_ns; // 0 for none
+     int64_t grid_step_ns; // start of the current step
+     int *pending_inputs; // inputs with a pending reading, in the step
+     int num_pending_inputs;
+
+     int fd;
+     char *output;
+     size_t output_used;
+     int error;
+     OutputTimeCache time_cache;
+     ArrowBatch arrow; // capacity 0 for tsv
+} Merge;
+
+// Refills the buffer of input after what is left of it. Returns -1 on errors.
+static int merge_input_fill(MergeInput *input)
+{
+     size_t left = input->end - input->next;
+     memmove(input->buffer, input->next, left);
+     input->next = input->buffer;
+     input->end = input->buffer + left;
+     int64_t n = uu_read_full(input->fd, input->buffer + left, MERGE_INPUT_BUFFER_SIZE - left);
+     if (n < 0) {
+          fprintf(stderr, "ERROR: could not read %s\n", input->path);
+          return -1;
+     }
+     input->end += n;
+     if ((size_t)n < MERGE_INPUT_BUFFER_SIZE - left) input->eof = 1;
+     return 0;
+}
+
+// Reads the next reading of input. Returns 1, 0 at the end, -1 on errors.
+static int merge_input_advance(MergeInput *input)
+{
+     int64_t previous_ns = input->reading.time_unix_ns;
+     while (input->is_archive) {
+          if (input->block_next < input->block_size) {
+               input->reading = input->block_readings[input->block_next++];
+               break;
+          }
+          if (input->block == input->archive.num_blocks) return 0;
+          input->block_size = archive_decode_block(&input->archive, input->block++, input->block_readings);
+          input->block_next = 0;
+          if (input->block_size < 0) {
+               fprintf(stderr, "ERROR: %s: corrupt archive block %d\n", input->path, input->block - 1);
+               return -1;
+          }
+     }
+     while (!input->is_archive) {
+          if (!input->eof && input->end - input->next < MERGE_MAX_LINE && merge_input_fill(input) != 0) return -1;
+          if (input->next == input->end) return 0;
+          if (input->is_binary) {
+               if (input->end - input->next < BINARY_RECORD_SIZE) {
+                    // torn last record
+                    input->num_unparsed++;
+                    input->next = input->end;
+                    return 0;
+               }
+               binary_unpack_reading((uint8_t const *)input->next, &input->reading);
+               input->next += BINARY_RECORD_SIZE;
+               break;
+          }
+          char const *line_end = tsv_parse_reading(input->next, input->end, &input->time_cache, &input->reading);
+          if (line_end) {
+               input->line = input->next;
+               input->next = line_end;
+               break;
+          }
+          // any line which is not a reading
+          input->num_unparsed++;
+          char const *newline = memchr(input->next, '\n', input->end - input->next);
+          input->next = newline ? newline + 1 : input->end;
+     }
+     if (input->num_readings++ && input->reading.time_unix_ns < previous_ns) input->num_out_of_order++;
+     return 1;
+}
+
+// Opens input->path, "-" for standard input, and finds out what it holds
+static int merge_input_open_path(MergeInput *input)
+{
+     input->fd = 0 == strcmp(input->path, "-") ? 0 : uu_open_for_reading(input->path);
+     input->buffer = malloc(MERGE_INPUT_BUFFER_SIZE);
+     if (input->fd < 0 || !input->buffer) {
+          fprintf(stderr, "ERROR: could not open %s for reading.\n", input->path);
+          return -1;
+     }
+#if defined(WIN32)
+     if (input->fd == 0) _setmode(0, _O_BINARY);
+#endif
+     input->next = input->end = input->buffer;
+     if (merge_input_fill(input) != 0) return -1;
+     if (input->end - input->next >= (ptrdiff_t)sizeof BINARY_MAGIC && 0 == memcmp(input->next, BINARY_MAGIC, sizeof BINARY_MAGIC)) {
+          input->is_binary = 1;
+          input->next += sizeof BINARY_MAGIC;
+     } else if (archive_is_archive(input->next, input->end - input->next)) {
+          // archives are read from their mapping, block by block
+          if (input->fd == 0) {
+               fprintf(stderr, "ERROR: an archive is read from a file, not from standard input\n");
+               return -1;
+          }
+          uu_close(input->fd);
+          input->fd = -1;
+          input->block_readings = malloc(FORWARD_MAX_FRAME_READINGS * sizeof *input->block_readings);
+          if (!input->block_readings || archive_open(&input->archive, input->path) != 0) return -1;
+          input->is_archive = 1;
+     } else if (input->end - input->next >= (ptrdiff_t)sizeof TSV_HEADER - 1
+                && 0 == memcmp(input->next, TSV_HEADER, sizeof TSV_HEADER - 1)) {
+          input->has_header = 1;
+          input->next += sizeof TSV_HEADER - 1;
+     }
+     return 0;
+}
+
+static int merge_input_open(MergeInput *input, char const *spec)
+{
+     // tag=path, or path with the tag from its name without directory or extension
+     char const *equal = strchr(spec, '=');
+     char const *name = spec;
+     size_t length;
+     if (equal) {
+          length = equal - spec;
+          input->path = equal + 1;
+     } else {
+          input->path = spec;
+          for (char const *p = spec; *p; p++) {
+               if (*p == '/' || *p == '\\') name = p + 1;
+          }
+          char const *dot = strrchr(name, '.');
+          length = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+     }
+     if (length == 0 || length >= MERGE_MAX_TAG || strcspn(name, "\t\n") < length) {
+          fprintf(stderr, "ERROR: invalid source name in %s\n", spec);
+          return -1;
+     }
+     memcpy(input->tag, name, length);
+     input->tag_length = (int)length;
+     return merge_input_open_path(input);
+}
+
+// Closes input. Returns the size of the file it read, 0 for a pipe.
+static int64_t merge_input_close(MergeInput *input)
+{
+     int64_t size = 0;
+     if (input->fd > 0) {
+          size = uu_file_size(input->fd);
+          uu_close(input->fd);
+     }
+     if (input->is_archive) {
+          size = input->archive.size;
+          archive_close(&input->archive);
+     }
+     free(input->buffer);
+     free(input->block_readings);
+     input->fd = -1;
+     input->is_archive = 0;
+     input->buffer = NULL;
+     input->block_readings = NULL;
+     return size > 0 ? size : 0;
+}
+
+static int merge_output_flush(Merge *merge)
+{
+     if (!merge->error && merge->output_used && uu_write_all(merge->fd, merge->output, merge->output_used) != 0) {
+          fprintf(stderr, "ERROR: could not write the merged output\n");
+          merge->error = 1;
+     }
+     merge->output_used = 0;
+     return merge->error ? -1 : 0;
+}
+
+// Writes a tsv record with the tag of input after the time
+static void merge_write_record(Merge *merge, MergeInput const *input, char const *record, char const *record_end)
+{
+     if (MERGE_OUTPUT_BUFFER_SIZE - merge->output_used < MERGE_MAX_LINE + MERGE_MAX_TAG) merge_output_flush(merge);
+     char const *tab = memchr(record, '\t', record_end - record);
+     assert(tab);
+     char *dst = merge->output + merge->output_used;
+     memcpy(dst, record, tab + 1 - record);
+     dst += tab + 1 - record;
+     memcpy(dst, input->tag, input->tag_length);
+     dst += input->tag_length;
+     memcpy(dst, tab, record_end - tab);
+     dst += record_end - tab;
+     merge->output_used = dst - merge->output;
+}
+
+static void merge_write_arrow(Merge *merge, MergeInput const *input, Reading const *reading)
+{
+     arrow_batch_append(&merge->arrow, reading, (int)(input - merge->inputs));
+     if (merge->arrow.num_rows == merge->arrow.capacity) {
+          merge->output_used = arrow_write_batch(merge->output + merge->output_used, &merge->arrow) - merge->output;
+          merge_output_flush(merge);
+     }
+}
+
+// Writes the next reading of input. Lines of tsv inputs are copied, which
+// saves formatting their time: the readings of many inputs change second at
+// almost every line, each time a call to localtime.
+static void merge_write(Merge *merge, MergeInput *input)
+{
+     if (merge->arrow.capacity) {
+          merge_write_arrow(merge, input, &input->reading);
+          return;
+     }
+     if (!input->is_binary && !input->is_archive) {
+          merge_write_record(merge, input, input->line, input->next);
+          return;
+     }
+     char record[OUTPUT_MAX_RECORD_SIZE];
+     merge_write_record(merge, input, record, tsv_write_reading(record, &input->time_cache_out, &input->reading));
+}
+
+// Writes the readings of the current step of the grid
+static void merge_write_step(Merge *merge)
+{
+     // in the order of the inputs, whatever the order their readings came in
+     for (int i = 1; i < merge->num_pending_inputs; i++) {
+          int input_index = merge->pending_inputs[i], j = i;
+          for (; j > 0 && merge->pending_inputs[j - 1] > input_index; j--) merge->pending_inputs[j] = merge->pending_inputs[j - 1];
+          merge->pending_inputs[j] = input_index;
+     }
+     for (int i = 0; i < merge->num_pending_inputs; i++) {
+          MergeInput *input = &merge->inputs[merge->pending_inputs[i]];
+          for (int channel = 0; channel < 2; channel++) {
+               if (!input->has_pending[channel]) continue;
+               Reading reading = input->pending[channel];
+               reading.time_unix_ns = merge->grid_step_ns;
+               input->has_pending[channel] = 0;
+               if (merge->arrow.capacity) {
+                    merge_write_arrow(merge, input, &reading);
+                    continue;
+               }
+               char record[OUTPUT_MAX_RECORD_SIZE];
+               merge_write_record(merge, input, record, tsv_write_reading(record, &merge->time_cache, &reading));
+          }
+     }
+     merge->num_pending_inputs = 0;
+}
+
+static void merge_grid_add(Merge *merge, int input_index)
+{
+     MergeInput *input = &merge->inputs[input_index];
+     Reading const *reading = &input->reading;
+     if (reading->kind != ReadingKind_CO2 && reading->kind != ReadingKind_Temperature) return;
+     int64_t step_ns = reading->time_unix_ns - reading->time_unix_ns % merge->grid_ns;
+     if (reading->time_unix_ns % merge->grid_ns < 0) step_ns -= merge->grid_ns;
+     if (step_ns > merge->grid_step_ns) {
+          merge_write_step(merge);
+          merge->grid_step_ns = step_ns;
+     }
+     int channel = reading->kind == ReadingKind_CO2 ? 0 : 1;
+     if (!input->has_pending[0] && !input->has_pending[1]) merge->pending_inputs[merge->num_pending_inputs++] = input_index;
+     input->pending[channel] = *reading;
+     input->has_pending[channel] = 1;
+}
+
+static int merge_heap_less(MergeHeapEntry const *a, MergeHeapEntry const *b)
+{
+     return a->time_unix_ns < b->time_unix_ns || (a->time_unix_ns == b->time_unix_ns && a->input_index < b->input_index);
+}
+
+static void merge_heap_sift_down(Merge *merge, int i)
+{
+     MergeHeapEntry *heap = merge->heap;
+     for (;;) {
+          int smallest = i, left = 2 * i + 1, right = left + 1;
+          if (left < merge->heap_size && merge_heap_less(&heap[left], &heap[smallest])) smallest = left;
+          if (right < merge->heap_size && merge_heap_less(&heap[right], &heap[smallest])) smallest = right;
+          if (smallest == i) return;
+          MergeHeapEntry swap = heap[i];
+          heap[i] = heap[smallest];
+          heap[smallest] = swap;
+          i = smallest;
+     }
+}
+
+// Merges the inputs, given as path or tag=path ("-" for standard input), to
+// target ("-" for standard output), on a grid of grid_seconds if not 0, as
+// tsv or as arrow in batches of arrow_batch_rows if not 0. Statistics and
+// errors are reported on standard error.
+int merge_outputs(char const *const *specs, int num_inputs, char const *target, int64_t grid_seconds, int arrow_batch_rows)
+{
+     Merge merge = { 0 };
+     merge.num_inputs = num_inputs;
+     merge.grid_ns = grid_seconds * NS_PER_SECOND;
+     merge.grid_step_ns = INT64_MIN;
+     merge.inputs = calloc(num_inputs, sizeof *merge.inputs);
+     merge.heap = calloc(num_inputs, sizeof *merge.heap);
+     merge.pending_inputs = calloc(num_inputs, sizeof *merge.pending_inputs);
+     size_t output_size = MERGE_OUTPUT_BUFFER_SIZE;
+     if (arrow_batch_rows) {
+          // the schema, a batch and the end of the stream
+          output_size = 2 * (8 + ARROW_MAX_METADATA_SIZE) + arrow_max_message_size(arrow_batch_rows, MERGE_MAX_TAG);
+          if (arrow_batch_init(&merge.arrow, arrow_batch_rows) != 0) output_size = 0;
+     }
+     merge.output = output_size ? malloc(output_size) : NULL;
+     merge.fd = 0 == strcmp(target, "-") ? 1 : uu_open_for_writing(target);
+     int rc = 0;
+     if (!merge.inputs || !merge.heap || !merge.pending_inputs || !merge.output) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          rc = -1;
+     } else if (merge.fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for writing.\n", target);
+          rc = -1;
+     }
+#if defined(WIN32)
+     if (merge.fd == 1) _setmode(1, _O_BINARY);
+#endif
+     for (int i = 0; i < num_inputs && rc == 0; i++) {
+          merge.inputs[i].fd = -1;
+          rc = merge_input_open(&merge.inputs[i], specs[i]);
+          if (rc == 0 && arrow_batch_rows && arrow_batch_add_sensor(&merge.arrow, merge.inputs[i].tag, merge.inputs[i].tag_length) != i) {
+               fprintf(stderr, "ERROR: too many inputs\n");
+               rc = -1;
+          }
+     }
+
+     int64_t start_ns = uu_monotonic_ns();
+     int64_t num_readings = 0;
+     if (rc == 0) {
+          if (arrow_batch_rows) {
+               merge.output_used = arrow_write_schema(merge.output) - merge.output;
+          } else {
+               merge.output_used = output_append_string(merge.output, "Time\tSource\tReading\tValue\n") - merge.output;
+          }
+          for (int i = 0; i < num_inputs && rc == 0; i++) {
+               int status = merge_input_advance(&merge.inputs[i]);
+               if (status < 0) rc = -1;
+               if (status > 0) merge.heap[merge.heap_size++] = (MergeHeapEntry){ merge.inputs[i].reading.time_unix_ns, i };
+          }
+          for (int i = merge.heap_size / 2 - 1; i >= 0; i--) merge_heap_sift_down(&merge, i);
+     }
+     while (rc == 0 && merge.heap_size && !merge.error) {
+          int input_index = merge.heap[0].input_index;
+          MergeInput *input = &merge.inputs[input_index];
+          if (merge.grid_ns) {
+               merge_grid_add(&merge, input_index);
+          } else {
+               merge_write(&merge, input);
+          }
+          num_readings++;
+          int status = merge_input_advance(input);
+          if (status < 0) rc = -1;
+          if (status > 0) {
+               merge.heap[0].time_unix_ns = input->reading.time_unix_ns;
+          } else {
+               merge.heap[0] = merge.heap[--merge.heap_size];
+          }
+          merge_heap_sift_down(&merge, 0);
+     }
+     if (rc == 0 && merge.grid_ns) merge_write_step(&merge);
+     if (rc == 0 && arrow_batch_rows) {
+          if (merge.arrow.num_rows) merge.output_used = arrow_write_batch(merge.output + merge.output_used, &merge.arrow) - merge.output;
+          merge_output_flush(&merge);
+          merge.output_used = arrow_write_end(merge.output) - merge.output;
+     }
+     if (rc == 0 && merge_output_flush(&merge) != 0) rc = -1;
+
+     int64_t num_bytes = 0;
+     for (int i = 0; i < num_inputs; i++) {
+          MergeInput *input = &merge.inputs[i];
+          if (input->num_out_of_order) {
+               fprintf(stderr, "WARNING: %s is not in time order, %lld readings are earlier than the one before\n",
+                       input->path, (long long)input->num_out_of_order);
+          }
+          num_bytes += merge_input_close(input);
+     }
+     if (rc == 0) {
+          double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+          fprintf(stderr, "merge\t%lld readings from %d inputs in %.3fs, %.0f MB/s\n", (long long)num_readings, num_inputs,
+                  seconds, num_bytes / 1e6 / seconds);
+     }
+     if (merge.fd > 1) uu_close(merge.fd);
+     free(merge.inputs);
+     free(merge.heap);
+     free(merge.pending_inputs);
+     free(merge.output);
+     arrow_batch_destroy(&merge.arrow);
+     return rc;
+}
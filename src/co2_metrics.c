@@ -0,0 +1,541 @@
+// Metrics: --metrics [host:]port, an OpenMetrics endpoint for Prometheus
+//
+// A thread of its own serves GET /metrics over HTTP/1.1 with keep-alive,
+// all connections on one epoll, in the OpenMetrics text format: the latest
+// CO2 and temperature of the sensor, the reports received by opcode, the
+// reports that failed their checksum, the time and age of the last report,
+// and the link, reconnects and drops of the targets.
+//
+// The reader never waits on a scrape: it updates its counters and latest
+// values in place, between two increments of a sequence number, and the
+// metrics thread copies them when the sequence is even and unchanged across
+// the copy (a seqlock). The drops, links and reconnects of the targets are
+// copies the sinks store atomically, loaded without the mutex of their
+// queue (see sink_set_load_metrics). The page is rendered by the metrics
+// thread into a buffer when the sequence has moved, at most every
+// METRICS_RENDER_MS, and at least every second for the counters of the
+// targets. A scrape sends that
+// buffer, followed by the age of the last report computed when it is sent:
+// a few microseconds, no allocation, no disk.
+//
+// The sensor is opened once, and the reader exits on errors rather than
+// reopening it: the reconnects are those of the fwd: and mqtt: targets.
+// Linux only (epoll), like collectd.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+enum { METRICS_MAX_CONNECTIONS = 64 };
+enum { METRICS_REQUEST_SIZE = 4096 };
+enum { METRICS_PAGE_SIZE = 64 * 1024 };
+enum { METRICS_RENDER_MS = 250 };
+enum { METRICS_IDLE_SECONDS = 300 }; // then a keep-alive connection is closed
+
+// What the reader updates, under the sequence of MetricsServer
+typedef struct MetricsState
+{
+     uint64_t reports[256]; // by opcode
+     uint64_t bad_reports; // failed their terminator or checksum
+     uint64_t sensor_checksum_errors; // reported by the sensor
+     int32_t co2_in_ppm;
+     float temperature_in_C;
+     int has_co2;
+     int has_temperature;
+     int64_t last_report_unix_ns;
+     int64_t last_report_ns; // monotonic, 0 before the first
+} MetricsState;
+
+typedef struct MetricsConnection
+{
+     int fd; // -1 when free
+     char *request; // METRICS_REQUEST_SIZE
+     size_t used;
+     int64_t active_ns;
+} MetricsConnection;
+
+typedef struct MetricsServer
+{
+     // reader
+     MetricsState state;
+     uint64_t volatile sequence; // odd while the reader updates state
+
+     // metrics thread
+     SinkSet *sinks; // optional
+     char sensor[256]; // label value, escaped
+     int listen_fd;
+     int epoll_fd;
+     MetricsConnection connections[METRICS_MAX_CONNECTIONS];
+     char *page; // METRICS_PAGE_SIZE
+     size_t page_size;
+     uint64_t rendered_sequence;
+     int64_t rendered_ns;
+     int64_t last_report_ns; // of the rendered state
+     uint64_t num_scrapes;
+     uint64_t num_renders;
+     uint64_t num_rejected; // connections beyond METRICS_MAX_CONNECTIONS
+     JitterHistogram scrape_times;
+     uint64_t volatile closing;
+     UU_Thread thread;
+} MetricsServer;
+
+//
+// Reader side
+//
+
+static void metrics_server_begin_update(MetricsServer *server)
+{
+     uu_atomic_store_u64(&server->sequence, server->sequence + 1);
+     uu_atomic_fence();
+}
+
+static void metrics_server_end_update(MetricsServer *server)
+{
+     uu_atomic_store_u64(&server->sequence, server->sequence + 1);
+}
+
+// A report the reader decoded but did not turn into a reading (humidity,
+// unknown opcodes)
+void metrics_server_add_report(MetricsServer *server, uint8_t opcode, int64_t received_ns)
+{
+     metrics_server_begin_update(server);
+     server->state.reports[opcode]++;
+     server->state.last_report_ns = received_ns;
+     metrics_server_end_update(server);
+}
+
+// A report that failed its terminator or checksum
+void metrics_server_add_bad_report(MetricsServer *server)
+{
+     metrics_server_begin_update(server);
+     server->state.bad_reports++;
+     metrics_server_end_update(server);
+}
+
+void metrics_server_add_reading(MetricsServer *server, Reading const *reading, int64_t received_ns)
+{
+     MetricsState *state = &server->state;
+     metrics_server_begin_update(server);
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          state->reports['P']++;
+          state->co2_in_ppm = reading->co2_in_ppm;
+          state->has_co2 = 1;
+          break;
+     case ReadingKind_Temperature:
+          state->reports['B']++;
+          state->temperature_in_C = reading->temperature_in_C;
+          state->has_temperature = 1;
+          break;
+     case ReadingKind_ChecksumError:
+          state->reports['S']++;
+          state->sensor_checksum_errors++;
+          break;
+     default:
+          state->reports[reading->opcode]++;
+          break;
+     }
+     state->last_report_unix_ns = reading->time_unix_ns;
+     state->last_report_ns = received_ns;
+     metrics_server_end_update(server);
+}
+
+#if defined(__linux__)
+
+//
+// Rendering
+//
+
+// A copy of the state consistent with a single sequence number. Returns
+// that sequence number.
+static uint64_t metrics_server_copy_state(MetricsServer *server, MetricsState *state)
+{
+     for (;;) {
+          uint64_t sequence = uu_atomic_load_u64(&server->sequence);
+          if (sequence & 1) continue; // the reader is in the middle of an update
+          memcpy(state, (MetricsState const *)&server->state, sizeof *state);
+          uu_atomic_fence();
+          if (uu_atomic_load_u64(&server->sequence) == sequence) return sequence;
+     }
+}
+
+// Appends to the page, truncating at its end
+static void metrics_server_printf(MetricsServer *server, char const *format, ...)
+{
+     size_t room = METRICS_PAGE_SIZE - server->page_size;
+     va_list args;
+     va_start(args, format);
+     int n = vsnprintf(server->page + server->page_size, room, format, args);
+     va_end(args);
+     if (n > 0) server->page_size += (size_t)n < room ? (size_t)n : room - 1;
+}
+
+// An OpenMetrics label value: \, " and newlines escaped
+static void metrics_escape_label(char *dst, size_t size, char const *value)
+{
+     size_t used = 0;
+     for (; *value && used + 3 < size; value++) {
+          if (*value == '\\' || *value == '"') dst[used++] = '\\';
+          if (*value == '\n') {
+               dst[used++] = '\\';
+               dst[used++] = 'n';
+          } else {
+               dst[used++] = *value;
+          }
+     }
+     dst[used] = 0;
+}
+
+static void metrics_server_render(MetricsServer *server, uint64_t sequence, MetricsState const *state, int64_t now_ns)
+{
+     char const *sensor = server->sensor;
+     server->page_size = 0;
+     metrics_server_printf(server, "# TYPE co2_ppm gauge\n# UNIT co2_ppm ppm\n# HELP co2_ppm Latest CO2 concentration.\n");
+     if (state->has_co2) metrics_server_printf(server, "co2_ppm{sensor=\"%s\"} %d\n", sensor, state->co2_in_ppm);
+     metrics_server_printf(server, "# TYPE co2_temperature_celsius gauge\n# UNIT co2_temperature_celsius celsius\n"
+                           "# HELP co2_temperature_celsius Latest temperature.\n");
+     if (state->has_temperature) {
+          metrics_server_printf(server, "co2_temperature_celsius{sensor=\"%s\"} %.4f\n", sensor, state->temperature_in_C);
+     }
+     metrics_server_printf(server, "# TYPE co2_reports counter\n# HELP co2_reports Reports received from the sensor, by opcode.\n");
+     for (int opcode = 0; opcode < 256; opcode++) {
+          if (!state->reports[opcode]) continue;
+          char name[8];
+          if ((opcode >= 'A' && opcode <= 'Z') || (opcode >= 'a' && opcode <= 'z') || (opcode >= '0' && opcode <= '9')) {
+               snprintf(name, sizeof name, "%c", opcode);
+          } else {
+               snprintf(name, sizeof name, "0x%02x", opcode);
+          }
+          metrics_server_printf(server, "co2_reports_total{sensor=\"%s\",opcode=\"%s\"} %llu\n", sensor, name,
+                                (unsigned long long)state->reports[opcode]);
+     }
+     metrics_server_printf(server, "# TYPE co2_checksum_errors counter\n"
+                           "# HELP co2_checksum_errors Reports with a bad terminator or checksum, and checksum errors reported by the sensor.\n"
+                           "co2_checksum_errors_total{sensor=\"%s\",source=\"report\"} %llu\n"
+                           "co2_checksum_errors_total{sensor=\"%s\",source=\"sensor\"} %llu\n",
+                           sensor, (unsigned long long)state->bad_reports, sensor, (unsigned long long)state->sensor_checksum_errors);
+     metrics_server_printf(server, "# TYPE co2_last_report_timestamp_seconds gauge\n"
+                           "# HELP co2_last_report_timestamp_seconds Time of the last report.\n");
+     if (state->last_report_ns) {
+          metrics_server_printf(server, "co2_last_report_timestamp_seconds{sensor=\"%s\"} %.3f\n", sensor,
+                                state->last_report_unix_ns / 1e9);
+     }
+     if (server->sinks) {
+          // the samples of a family follow its metadata, so the targets are gone through once per family
+          char targets[SINK_MAX_COUNT][1024];
+          int is_link[SINK_MAX_COUNT]; // fwd: and mqtt:
+          int up[SINK_MAX_COUNT];
+          uint64_t reconnects[SINK_MAX_COUNT];
+          uint64_t dropped[SINK_MAX_COUNT];
+          int num_sinks = server->sinks->num_sinks;
+          int num_links = 0;
+          for (int i = 0; i < num_sinks; i++) {
+               Sink const *sink = &server->sinks->sinks[i];
+               SinkMetrics metrics;
+               sink_set_load_metrics(server->sinks, i, &metrics);
+               metrics_escape_label(targets[i], sizeof targets[i], sink->config.target);
+               is_link[i] = sink->kind == SinkKind_Forward || sink->kind == SinkKind_Mqtt;
+               up[i] = metrics.up != 0;
+               reconnects[i] = metrics.reconnects;
+               dropped[i] = metrics.dropped;
+               num_links += is_link[i];
+          }
+          if (num_links) {
+               metrics_server_printf(server, "# TYPE co2_target_up gauge\n# HELP co2_target_up Whether the connection of a fwd: or mqtt: target is up.\n");
+               for (int i = 0; i < num_sinks; i++) {
+                    if (is_link[i]) metrics_server_printf(server, "co2_target_up{target=\"%s\"} %d\n", targets[i], up[i] ? 1 : 0);
+               }
+               metrics_server_printf(server, "# TYPE co2_target_reconnects counter\n# HELP co2_target_reconnects Reconnections of a fwd: or mqtt: target.\n");
+               for (int i = 0; i < num_sinks; i++) {
+                    if (!is_link[i]) continue;
+                    metrics_server_printf(server, "co2_target_reconnects_total{target=\"%s\"} %llu\n", targets[i],
+                                          (unsigned long long)reconnects[i]);
+               }
+          }
+          metrics_server_printf(server, "# TYPE co2_target_dropped counter\n# HELP co2_target_dropped Readings a target dropped, its queue full.\n");
+          for (int i = 0; i < num_sinks; i++) {
+               metrics_server_printf(server, "co2_target_dropped_total{target=\"%s\"} %llu\n", targets[i], (unsigned long long)dropped[i]);
+          }
+     }
+     metrics_server_printf(server, "# TYPE co2_last_report_age_seconds gauge\n"
+                           "# HELP co2_last_report_age_seconds Seconds since the last report.\n");
+     server->rendered_sequence = sequence;
+     server->rendered_ns = now_ns;
+     server->last_report_ns = state->last_report_ns;
+     server->num_renders++;
+}
+
+static void metrics_server_refresh(MetricsServer *server, int64_t now_ns)
+{
+     if (uu_atomic_load_u64(&server->sequence) == server->rendered_sequence && now_ns - server->rendered_ns < NS_PER_SECOND) return;
+     MetricsState state;
+     uint64_t sequence = metrics_server_copy_state(server, &state);
+     metrics_server_render(server, sequence, &state, now_ns);
+}
+
+//
+// HTTP
+//
+
+static void metrics_server_close_connection(MetricsServer *server, MetricsConnection *connection)
+{
+     epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+     close(connection->fd);
+     connection->fd = -1;
+     connection->used = 0;
+}
+
+static void metrics_server_accept(MetricsServer *server, int64_t now_ns)
+{
+     for (;;) {
+          int fd = accept(server->listen_fd, NULL, NULL);
+          if (fd < 0) return;
+          MetricsConnection *connection = NULL;
+          for (int i = 0; i < METRICS_MAX_CONNECTIONS && !connection; i++) {
+               if (server->connections[i].fd < 0) connection = &server->connections[i];
+          }
+          struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+          if (!connection) {
+               server->num_rejected++;
+               close(fd);
+               continue;
+          }
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+          if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+               close(fd);
+               continue;
+          }
+          connection->fd = fd;
+          connection->used = 0;
+          connection->active_ns = now_ns;
+     }
+}
+
+// Sends all of the parts or fails: the responses fit in the send buffer of
+// a socket, and a client that does not read them is dropped
+static int metrics_send(int fd, struct iovec *parts, int num_parts)
+{
+     size_t total = 0;
+     for (int i = 0; i < num_parts; i++) total += parts[i].iov_len;
+     struct msghdr message = { .msg_iov = parts, .msg_iovlen = num_parts };
+     ssize_t n = sendmsg(fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+     return n == (ssize_t)total ? 0 : -1;
+}
+
+static int metrics_header_has(char const *headers, char const *name, char const *value)
+{
+     for (char const *line = strstr(headers, "\r\n"); line && line[2]; line = strstr(line + 2, "\r\n")) {
+          size_t length = strlen(name);
+          if (0 == strncasecmp(line + 2, name, length) && line[2 + length] == ':') {
+               char const *end = strstr(line + 2, "\r\n");
+               for (char const *p = line + 3 + length; p + strlen(value) <= end; p++) {
+                    if (0 == strncasecmp(p, value, strlen(value))) return 1;
+               }
+          }
+     }
+     return 0;
+}
+
+// Answers the request at the start of the buffer of connection, of size
+// bytes with its headers. Returns 0 to keep the connection, -1 to close it.
+static int metrics_server_answer(MetricsServer *server, MetricsConnection *connection, size_t size)
+{
+     int64_t start_ns = uu_monotonic_ns();
+     char *request = connection->request;
+     char saved = request[size];
+     request[size] = 0;
+     int head = 0 == strncmp(request, "HEAD ", 5);
+     int get = head || 0 == strncmp(request, "GET ", 4);
+     char const *path = strchr(request, ' ') + 1;
+     size_t path_length = strcspn(path, " \r");
+     int http_10 = 0 == strncmp(path + path_length, " HTTP/1.0", 9);
+     int keep_alive = http_10 ? metrics_header_has(request, "Connection", "keep-alive") : !metrics_header_has(request, "Connection", "close");
+     // requests with a body are not read through
+     if (metrics_header_has(request, "Content-Length", "") || metrics_header_has(request, "Transfer-Encoding", "")) keep_alive = 0;
+     int found = (path_length == 8 && 0 == strncmp(path, "/metrics", 8)) || (path_length == 1 && path[0] == '/');
+     request[size] = saved;
+
+     char header[256];
+     char tail[128];
+     struct iovec parts[3];
+     int num_parts = 1;
+     char const *connection_header = keep_alive ? "keep-alive" : "close";
+     if (!get || !found) {
+          char const *status = !get ? "405 Method Not Allowed" : "404 Not Found";
+          parts[0].iov_len = snprintf(header, sizeof header, "HTTP/1.1 %s\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n"
+                                      "Connection: %s\r\n\r\n%s\n", status, (int)strlen(status) + 1, connection_header, status);
+     } else {
+          metrics_server_refresh(server, start_ns);
+          int tail_size;
+          if (server->last_report_ns) {
+               tail_size = snprintf(tail, sizeof tail, "co2_last_report_age_seconds{sensor=\"%s\"} %.3f\n# EOF\n",
+                                    server->sensor, (start_ns - server->last_report_ns) / 1e9);
+          } else {
+               tail_size = snprintf(tail, sizeof tail, "# EOF\n");
+          }
+          if (tail_size >= (int)sizeof tail) tail_size = snprintf(tail, sizeof tail, "# EOF\n");
+          parts[0].iov_len = snprintf(header, sizeof header, "HTTP/1.1 200 OK\r\n"
+                                      "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                                      "Content-Length: %zu\r\nConnection: %s\r\n\r\n",
+                                      server->page_size + tail_size, connection_header);
+          if (!head) {
+               parts[1] = (struct iovec){ .iov_base = server->page, .iov_len = server->page_size };
+               parts[2] = (struct iovec){ .iov_base = tail, .iov_len = tail_size };
+               num_parts = 3;
+          }
+     }
+     parts[0].iov_base = header;
+     int rc = metrics_send(connection->fd, parts, num_parts);
+     if (get && found) {
+          server->num_scrapes++;
+          jitter_add(&server->scrape_times, uu_monotonic_ns() - start_ns);
+     }
+     return rc == 0 && keep_alive ? 0 : -1;
+}
+
+// Reads what the client sent, and answers every complete request in it
+static void metrics_server_read(MetricsServer *server, MetricsConnection *connection, int64_t now_ns)
+{
+     connection->active_ns = now_ns;
+     for (;;) {
+          ssize_t n = recv(connection->fd, connection->request + connection->used, METRICS_REQUEST_SIZE - 1 - connection->used, 0);
+          if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) {
+               metrics_server_close_connection(server, connection);
+               return;
+          }
+          connection->used += n;
+          connection->request[connection->used] = 0;
+          char *end;
+          while ((end = strstr(connection->request, "\r\n\r\n"))) {
+               size_t size = end + 4 - connection->request;
+               if (!memchr(connection->request, ' ', size) || metrics_server_answer(server, connection, size) != 0) {
+                    metrics_server_close_connection(server, connection);
+                    return;
+               }
+               connection->used -= size;
+               memmove(connection->request, connection->request + size, connection->used + 1);
+          }
+          if (connection->used == METRICS_REQUEST_SIZE - 1) { // headers too long
+               metrics_server_close_connection(server, connection);
+               return;
+          }
+     }
+}
+
+static void metrics_server_run(void *arg)
+{
+     MetricsServer *server = arg;
+     struct epoll_event events[METRICS_MAX_CONNECTIONS + 1];
+     while (!uu_atomic_load_u64(&server->closing)) {
+          int n = epoll_wait(server->epoll_fd, events, METRICS_MAX_CONNECTIONS + 1, METRICS_RENDER_MS);
+          int64_t now_ns = uu_monotonic_ns();
+          for (int i = 0; i < n; i++) {
+               MetricsConnection *connection = events[i].data.ptr;
+               if (!connection) {
+                    metrics_server_accept(server, now_ns);
+               } else if (connection->fd >= 0) {
+                    metrics_server_read(server, connection, now_ns);
+               }
+          }
+          metrics_server_refresh(server, now_ns);
+          for (int i = 0; i < METRICS_MAX_CONNECTIONS; i++) {
+               MetricsConnection *connection = &server->connections[i];
+               if (connection->fd >= 0 && now_ns - connection->active_ns > METRICS_IDLE_SECONDS * NS_PER_SECOND) {
+                    metrics_server_close_connection(server, connection);
+               }
+          }
+     }
+}
+
+#endif
+
+//
+// Set up, stats and tear down
+//
+
+// Starts serving the metrics on address, [host:]port, with the counters of
+// sinks if not NULL. Errors are reported on standard error.
+int metrics_server_open(MetricsServer *server, char const *address, SinkSet *sinks)
+{
+     memset(server, 0, sizeof *server);
+     server->listen_fd = -1;
+     server->epoll_fd = -1;
+#if !defined(__linux__)
+     (void)address;
+     (void)sinks;
+     fprintf(stderr, "ERROR: --metrics needs epoll, only on Linux\n");
+     return -1;
+#else
+     server->sinks = sinks;
+     char sensor[sizeof server->sensor / 2];
+     arrow_default_sensor(sensor, sizeof sensor);
+     metrics_escape_label(server->sensor, sizeof server->sensor, sensor);
+     server->page = memory_alloc(METRICS_PAGE_SIZE);
+     for (int i = 0; i < METRICS_MAX_CONNECTIONS; i++) {
+          server->connections[i].fd = -1;
+          server->connections[i].request = memory_alloc(METRICS_REQUEST_SIZE);
+          if (!server->connections[i].request) server->page = NULL;
+     }
+     if (!server->page) {
+          fprintf(stderr, "ERROR: could not allocate the metrics\n");
+          return -1;
+     }
+     server->listen_fd = forward_listen(address);
+     if (server->listen_fd < 0) {
+          fprintf(stderr, "ERROR: could not listen on %s\n", address);
+          return -1;
+     }
+     fcntl(server->listen_fd, F_SETFL, fcntl(server->listen_fd, F_GETFL) | O_NONBLOCK);
+     server->epoll_fd = epoll_create1(0);
+     struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL };
+     if (server->epoll_fd < 0 || epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &listen_event) != 0) {
+          fprintf(stderr, "ERROR: could not set up epoll\n");
+          return -1;
+     }
+     signal(SIGPIPE, SIG_IGN);
+     metrics_server_refresh(server, uu_monotonic_ns());
+     if (uu_thread_start(&server->thread, metrics_server_run, server) != 0) {
+          fprintf(stderr, "ERROR: could not start the metrics thread\n");
+          return -1;
+     }
+     return 0;
+#endif
+}
+
+// Once closed
+void metrics_server_print_stats(MetricsServer *server, FILE *out)
+{
+     JitterHistogram const *times = &server->scrape_times;
+     fprintf(out, "metrics\tscrapes=%llu renders=%llu rejected=%llu page_bytes=%zu scrape_us p50=%.1f p99=%.1f max=%.1f\n",
+             (unsigned long long)server->num_scrapes, (unsigned long long)server->num_renders,
+             (unsigned long long)server->num_rejected, server->page_size,
+             jitter_percentile_ns(times, 0.5) / 1e3, jitter_percentile_ns(times, 0.99) / 1e3, times->max_ns / 1e3);
+}
+
+void metrics_server_close(MetricsServer *server)
+{
+#if defined(__linux__)
+     uu_atomic_store_u64(&server->closing, 1);
+     uu_thread_join(&server->thread);
+     for (int i = 0; i < METRICS_MAX_CONNECTIONS; i++) {
+          if (server->connections[i].fd >= 0) close(server->connections[i].fd);
+          memory_free(server->connections[i].request);
+     }
+     close(server->epoll_fd);
+     close(server->listen_fd);
+     memory_free(server->page);
+#endif
+}
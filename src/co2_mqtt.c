@@ -0,0 +1,561 @@
+// MQTT sink: readings published to a broker
+//
+// A sink with a mqtt:[serial@]host:port target publishes every CO2 and
+// temperature reading to co2/<serial>/co2 and co2/<serial>/temperature, the
+// serial by default the host name, the value as text as in the tsv output,
+// with QoS 0 or 1 (--qos). It is a minimal MQTT 3.1.1 client: a clean
+// session with a keep alive, PUBLISH, PUBACK and nothing else.
+//
+// QoS 1 publishes are pipelined: up to MQTT_MAX_INFLIGHT go out before their
+// PUBACKs come back, and every publish at hand goes out in one write. Like
+// every sink it runs behind its queue: while the broker is unreachable it
+// keeps taking readings, up to MQTT_MAX_PENDING of them (then the oldest are
+// dropped), and reconnects with a backoff of 1s doubling up to 30s. QoS 1
+// publishes that were not acknowledged are sent again, with DUP, once
+// reconnected.
+//
+// mqtt-broker is a stand-in broker for tests: it acknowledges what it
+// receives and prints it, one connection at a time.
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+enum { MQTT_MAX_INFLIGHT = 64 };
+enum { MQTT_MAX_PENDING = 65536 }; // readings, about 9 hours of a sensor
+enum { MQTT_MAX_PACKET_SIZE = 256 }; // of a PUBLISH
+enum { MQTT_OUT_BUFFER_SIZE = 64 * 1024 };
+enum { MQTT_IN_BUFFER_SIZE = 4096 };
+enum { MQTT_KEEP_ALIVE_SECONDS = 60 };
+enum { MQTT_TIMEOUT_MS = 10000 }; // for CONNACK, PUBACK and PINGRESP
+enum { MQTT_MAX_BACKOFF_MS = 30000 };
+
+typedef enum MqttPacketType
+{
+     MqttPacketType_Connect = 1,
+     MqttPacketType_ConnAck = 2,
+     MqttPacketType_Publish = 3,
+     MqttPacketType_PubAck = 4,
+     MqttPacketType_PingReq = 12,
+     MqttPacketType_PingResp = 13,
+     MqttPacketType_Disconnect = 14,
+} MqttPacketType;
+
+typedef struct MqttInflight
+{
+     Reading reading;
+     uint16_t packet_id;
+} MqttInflight;
+
+typedef struct MqttStats
+{
+     uint64_t published; // sent at least once
+     uint64_t acknowledged;
+     uint64_t resent;
+     uint64_t dropped;
+     uint64_t reconnects;
+     uint64_t writes;
+     int connected;
+     int inflight;
+     int pending;
+} MqttStats;
+
+typedef struct MqttClient
+{
+     char serial[64];
+     char host_and_port[256];
+     int qos;
+     int socket_fd; // -1 when disconnected
+     int connected; // CONNACK received
+     int64_t next_connect_ns;
+     int backoff_ms;
+     int64_t connect_sent_ns;
+     int64_t last_sent_ns;
+     int64_t ping_sent_ns; // 0 when no PINGRESP is due
+
+     // readings to publish
+     Reading *pending;
+     int pending_head;
+     int pending_count;
+
+     // QoS 1 publishes sent and not acknowledged, in the order sent
+     MqttInflight inflight[MQTT_MAX_INFLIGHT];
+     int num_inflight;
+     int64_t inflight_sent_ns; // of the oldest
+     uint16_t next_packet_id;
+
+     uint8_t out[MQTT_OUT_BUFFER_SIZE];
+     size_t out_used;
+     uint8_t in[MQTT_IN_BUFFER_SIZE];
+     size_t in_used;
+
+     MqttStats stats;
+} MqttClient;
+
+//
+// Packets
+//
+
+static uint8_t *mqtt_put_remaining_length(uint8_t *dst, size_t length)
+{
+     do {
+          uint8_t byte = length % 128;
+          length /= 128;
+          *dst++ = byte | (length ? 0x80 : 0);
+     } while (length);
+     return dst;
+}
+
+static uint8_t *mqtt_put_string(uint8_t *dst, char const *text, size_t size)
+{
+     *dst++ = (uint8_t)(size >> 8);
+     *dst++ = (uint8_t)size;
+     memcpy(dst, text, size);
+     return dst + size;
+}
+
+// Parses the fixed header of the packet at src. Returns the size of the
+// whole packet, 0 when incomplete, or -1 when invalid.
+static int64_t mqtt_packet_size(uint8_t const *src, size_t available, size_t *header_size)
+{
+     size_t length = 0;
+     for (size_t i = 1; i < 5; i++) {
+          if (i >= available) return 0;
+          length |= (size_t)(src[i] & 0x7f) << (7 * (i - 1));
+          if (!(src[i] & 0x80)) {
+               *header_size = i + 1;
+               return i + 1 + length <= available ? (int64_t)(i + 1 + length) : 0;
+          }
+     }
+     return -1;
+}
+
+// Encodes a PUBLISH of the reading, at most MQTT_MAX_PACKET_SIZE bytes
+static uint8_t *mqtt_put_publish(uint8_t *dst, char const *serial, int qos, int dup, uint16_t packet_id, Reading const *reading)
+{
+     char topic[128];
+     int topic_size = snprintf(topic, sizeof topic, "co2/%s/%s", serial, reading->kind == ReadingKind_CO2 ? "co2" : "temperature");
+     char payload[32];
+     char *end = reading->kind == ReadingKind_CO2 ? output_append_int(payload, reading->co2_in_ppm)
+                                                  : output_append_float6(payload, reading->temperature_in_C);
+     size_t payload_size = end - payload;
+     *dst++ = (MqttPacketType_Publish << 4) | (dup ? 0x08 : 0) | (qos << 1);
+     dst = mqtt_put_remaining_length(dst, 2 + topic_size + (qos ? 2 : 0) + payload_size);
+     dst = mqtt_put_string(dst, topic, topic_size);
+     if (qos) {
+          *dst++ = (uint8_t)(packet_id >> 8);
+          *dst++ = (uint8_t)packet_id;
+     }
+     memcpy(dst, payload, payload_size);
+     return dst + payload_size;
+}
+
+#if !defined(WIN32)
+
+//
+// Client
+//
+
+static void mqtt_disconnect(MqttClient *client)
+{
+     if (client->socket_fd < 0) return;
+     close(client->socket_fd);
+     client->socket_fd = -1;
+     client->connected = 0;
+     client->stats.connected = 0;
+     client->out_used = 0;
+     client->in_used = 0;
+     client->next_connect_ns = uu_monotonic_ns() + (int64_t)client->backoff_ms * 1000000;
+     client->backoff_ms = client->backoff_ms * 2 < MQTT_MAX_BACKOFF_MS ? client->backoff_ms * 2 : MQTT_MAX_BACKOFF_MS;
+}
+
+// Writes out the packets of the out buffer, in one write
+static void mqtt_flush(MqttClient *client)
+{
+     if (!client->out_used || client->socket_fd < 0) return;
+     if (uu_write_all(client->socket_fd, client->out, client->out_used) != 0) {
+          mqtt_disconnect(client);
+          return;
+     }
+     client->stats.writes++;
+     client->out_used = 0;
+     client->last_sent_ns = uu_monotonic_ns();
+}
+
+static void mqtt_send_publish(MqttClient *client, Reading const *reading, uint16_t packet_id, int dup)
+{
+     if (MQTT_OUT_BUFFER_SIZE - client->out_used < MQTT_MAX_PACKET_SIZE) mqtt_flush(client);
+     client->out_used = mqtt_put_publish(client->out + client->out_used, client->serial, client->qos, dup, packet_id, reading) - client->out;
+}
+
+static void mqtt_connect(MqttClient *client)
+{
+     client->socket_fd = forward_connect(client->host_and_port);
+     if (client->socket_fd < 0) {
+          client->next_connect_ns = uu_monotonic_ns() + (int64_t)client->backoff_ms * 1000000;
+          client->backoff_ms = client->backoff_ms * 2 < MQTT_MAX_BACKOFF_MS ? client->backoff_ms * 2 : MQTT_MAX_BACKOFF_MS;
+          return;
+     }
+     char client_id[24];
+     int client_id_size = snprintf(client_id, sizeof client_id, "co2-%s", client->serial);
+     if (client_id_size >= (int)sizeof client_id) client_id_size = sizeof client_id - 1;
+     uint8_t *dst = client->out;
+     *dst++ = MqttPacketType_Connect << 4;
+     dst = mqtt_put_remaining_length(dst, 10 + 2 + client_id_size);
+     dst = mqtt_put_string(dst, "MQTT", 4);
+     *dst++ = 4; // 3.1.1
+     *dst++ = 0x02; // clean session
+     *dst++ = MQTT_KEEP_ALIVE_SECONDS >> 8;
+     *dst++ = MQTT_KEEP_ALIVE_SECONDS & 0xff;
+     dst = mqtt_put_string(dst, client_id, client_id_size);
+     client->out_used = dst - client->out;
+     mqtt_flush(client);
+     client->connect_sent_ns = uu_monotonic_ns();
+     client->ping_sent_ns = 0;
+     client->stats.reconnects++;
+}
+
+// Handles the packets received. Returns -1 when the connection must be
+// closed.
+static int mqtt_read(MqttClient *client)
+{
+     for (;;) {
+          ssize_t n = recv(client->socket_fd, client->in + client->in_used, sizeof client->in - client->in_used, MSG_DONTWAIT);
+          if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) return -1;
+          if (n < 0) return 0;
+          client->in_used += n;
+          size_t begin = 0;
+          for (;;) {
+               size_t header_size;
+               int64_t size = mqtt_packet_size(client->in + begin, client->in_used - begin, &header_size);
+               if (size < 0) return -1;
+               if (size == 0) break;
+               uint8_t const *packet = client->in + begin;
+               uint8_t const *body = packet + header_size;
+               switch (packet[0] >> 4) {
+               case MqttPacketType_ConnAck:
+                    if (size - header_size < 2 || body[1] != 0) {
+                         fprintf(stderr, "ERROR: %s refused the connection (%d)\n", client->host_and_port, size - header_size < 2 ? -1 : body[1]);
+                         return -1;
+                    }
+                    client->connected = 1;
+                    client->stats.connected = 1;
+                    client->backoff_ms = 1000;
+                    // a clean session: what was not acknowledged is sent again
+                    for (int i = 0; i < client->num_inflight; i++) {
+                         mqtt_send_publish(client, &client->inflight[i].reading, client->inflight[i].packet_id, 1);
+                         client->stats.resent++;
+                    }
+                    if (client->num_inflight) client->inflight_sent_ns = uu_monotonic_ns();
+                    break;
+               case MqttPacketType_PubAck: {
+                    if (size - header_size < 2) return -1;
+                    uint16_t packet_id = (uint16_t)(body[0] << 8 | body[1]);
+                    for (int i = 0; i < client->num_inflight; i++) {
+                         if (client->inflight[i].packet_id != packet_id) continue;
+                         memmove(&client->inflight[i], &client->inflight[i + 1], (client->num_inflight - i - 1) * sizeof client->inflight[0]);
+                         client->num_inflight--;
+                         client->stats.acknowledged++;
+                         if (i == 0) client->inflight_sent_ns = uu_monotonic_ns();
+                         break;
+                    }
+                    break;
+               }
+               case MqttPacketType_PingResp:
+                    client->ping_sent_ns = 0;
+                    break;
+               default:
+                    break;
+               }
+               begin += size;
+          }
+          memmove(client->in, client->in + begin, client->in_used - begin);
+          client->in_used -= begin;
+          if (client->in_used == sizeof client->in) return -1;
+     }
+}
+
+#endif
+
+// Connects when due, reads the acknowledgements, keeps the connection alive
+// and publishes what is pending, as far as the window allows. Called by the
+// sink between batches.
+void mqtt_client_poll(MqttClient *client)
+{
+#if !defined(WIN32)
+     int64_t now_ns = uu_monotonic_ns();
+     int64_t timeout_ns = (int64_t)MQTT_TIMEOUT_MS * 1000000;
+     if (client->socket_fd < 0 && now_ns >= client->next_connect_ns) mqtt_connect(client);
+     if (client->socket_fd < 0) return;
+     if (mqtt_read(client) != 0 || (!client->connected && now_ns - client->connect_sent_ns > timeout_ns)
+         || (client->num_inflight && now_ns - client->inflight_sent_ns > timeout_ns)
+         || (client->ping_sent_ns && now_ns - client->ping_sent_ns > timeout_ns)) {
+          mqtt_disconnect(client);
+          return;
+     }
+     if (!client->connected) return;
+     while (client->socket_fd >= 0 && client->pending_count && (client->qos == 0 || client->num_inflight < MQTT_MAX_INFLIGHT)) {
+          Reading const *reading = &client->pending[client->pending_head];
+          client->pending_head = (client->pending_head + 1) % MQTT_MAX_PENDING;
+          client->pending_count--;
+          uint16_t packet_id = 0;
+          if (client->qos) {
+               if (++client->next_packet_id == 0) client->next_packet_id = 1;
+               packet_id = client->next_packet_id;
+               if (!client->num_inflight) client->inflight_sent_ns = now_ns;
+               client->inflight[client->num_inflight++] = (MqttInflight){ *reading, packet_id };
+          }
+          mqtt_send_publish(client, reading, packet_id, 0);
+          client->stats.published++;
+     }
+     if (!client->out_used && !client->ping_sent_ns && now_ns - client->last_sent_ns > (int64_t)MQTT_KEEP_ALIVE_SECONDS * NS_PER_SECOND / 2) {
+          client->out[client->out_used++] = MqttPacketType_PingReq << 4;
+          client->out[client->out_used++] = 0;
+          client->ping_sent_ns = now_ns;
+     }
+     mqtt_flush(client);
+#else
+     (void)client;
+#endif
+}
+
+// Waits up to timeout_ms for acknowledgements, when the window is full
+void mqtt_client_wait(MqttClient *client, int timeout_ms)
+{
+#if !defined(WIN32)
+     if (client->socket_fd >= 0 && client->connected && client->num_inflight == MQTT_MAX_INFLIGHT) {
+          forward_poll_fd(client->socket_fd, POLLIN, timeout_ms);
+     }
+#else
+     (void)client, (void)timeout_ms;
+#endif
+}
+
+int mqtt_client_is_busy(MqttClient const *client)
+{
+     return client->pending_count && client->connected && client->num_inflight == MQTT_MAX_INFLIGHT;
+}
+
+// Queues a reading to publish, if CO2 or temperature. While connected, waits
+// for room, otherwise drops the oldest.
+void mqtt_client_add(MqttClient *client, Reading const *reading)
+{
+     if (reading->kind != ReadingKind_CO2 && reading->kind != ReadingKind_Temperature) return;
+     while (client->pending_count == MQTT_MAX_PENDING && client->connected) {
+          mqtt_client_wait(client, 100);
+          mqtt_client_poll(client);
+     }
+     if (client->pending_count == MQTT_MAX_PENDING) {
+          client->pending_head = (client->pending_head + 1) % MQTT_MAX_PENDING;
+          client->pending_count--;
+          client->stats.dropped++;
+     }
+     client->pending[(client->pending_head + client->pending_count) % MQTT_MAX_PENDING] = *reading;
+     client->pending_count++;
+}
+
+// address is [serial@]host:port. Errors are reported on standard error.
+int mqtt_client_open(MqttClient *client, char const *address, int qos)
+{
+     memset(client, 0, sizeof *client);
+     client->socket_fd = -1;
+     client->backoff_ms = 1000;
+     client->qos = qos;
+#if defined(WIN32)
+     (void)address;
+     fprintf(stderr, "ERROR: mqtt sinks are not supported on Windows\n");
+     return -1;
+#else
+     char const *at = strchr(address, '@');
+     char const *host_and_port = at ? at + 1 : address;
+     if (at && (at == address || at - address >= (int)sizeof client->serial)) {
+          fprintf(stderr, "ERROR: expected a serial of 1 to %d characters before @ in %s\n", (int)sizeof client->serial - 1, address);
+          return -1;
+     }
+     if (at) {
+          memcpy(client->serial, address, at - address);
+     } else if (gethostname(client->serial, sizeof client->serial - 1) != 0) {
+          snprintf(client->serial, sizeof client->serial, "co2");
+     }
+     // topic levels cannot hold these
+     for (char *p = client->serial; *p; p++) {
+          if (*p == '/' || *p == '+' || *p == '#') *p = '_';
+     }
+     snprintf(client->host_and_port, sizeof client->host_and_port, "%s", host_and_port);
+     client->pending = memory_alloc(MQTT_MAX_PENDING * sizeof *client->pending);
+     if (!client->pending) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          return -1;
+     }
+     return 0;
+#endif
+}
+
+// Publishes what is left, waiting a few seconds for the broker
+void mqtt_client_close(MqttClient *client)
+{
+#if !defined(WIN32)
+     int64_t deadline_ns = uu_monotonic_ns() + (int64_t)MQTT_TIMEOUT_MS / 2 * 1000000;
+     while ((client->pending_count || client->num_inflight) && uu_monotonic_ns() < deadline_ns) {
+          if (client->connected && client->num_inflight) {
+               forward_poll_fd(client->socket_fd, POLLIN, 100);
+          } else {
+               uu_sleep_ms(10);
+          }
+          mqtt_client_poll(client);
+     }
+     if (client->socket_fd >= 0 && client->connected) {
+          client->out[client->out_used++] = MqttPacketType_Disconnect << 4;
+          client->out[client->out_used++] = 0;
+          mqtt_flush(client);
+     }
+     mqtt_disconnect(client);
+#endif
+     client->stats.dropped += client->pending_count + client->num_inflight;
+     memory_free(client->pending);
+     client->pending = NULL;
+}
+
+// The counters, with the current window and backlog
+void mqtt_client_stats(MqttClient const *client, MqttStats *stats)
+{
+     *stats = client->stats;
+     stats->inflight = client->num_inflight;
+     stats->pending = client->pending_count;
+}
+
+//
+// Broker stand-in
+//
+
+#if !defined(WIN32)
+
+typedef struct MqttBrokerStats
+{
+     uint64_t publishes;
+     uint64_t duplicates; // with DUP
+     uint64_t reads;
+     uint64_t max_publishes_per_read;
+} MqttBrokerStats;
+
+// Returns 0 when the client disconnected, -1 on errors or when dropped
+static int mqtt_broker_serve(int fd, FILE *out, uint64_t drop_every, uint64_t *num_publishes, MqttBrokerStats *stats)
+{
+     uint8_t in[MQTT_IN_BUFFER_SIZE * 4];
+     size_t used = 0;
+     uint8_t acks[MQTT_IN_BUFFER_SIZE * 4];
+     for (;;) {
+          ssize_t n = recv(fd, in + used, sizeof in - used, 0);
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) return -1;
+          used += n;
+          stats->reads++;
+          size_t begin = 0, acks_used = 0;
+          uint64_t publishes = 0;
+          for (;;) {
+               size_t header_size;
+               int64_t size = mqtt_packet_size(in + begin, used - begin, &header_size);
+               if (size < 0) return -1;
+               if (size == 0) break;
+               uint8_t const *packet = in + begin;
+               uint8_t const *body = packet + header_size;
+               uint8_t const *end = packet + size;
+               switch (packet[0] >> 4) {
+               case MqttPacketType_Connect:
+                    acks[acks_used++] = MqttPacketType_ConnAck << 4;
+                    acks[acks_used++] = 2;
+                    acks[acks_used++] = 0;
+                    acks[acks_used++] = 0;
+                    break;
+               case MqttPacketType_Publish: {
+                    int qos = (packet[0] >> 1) & 3;
+                    if (end - body < 2) return -1;
+                    size_t topic_size = (size_t)body[0] << 8 | body[1];
+                    uint8_t const *payload = body + 2 + topic_size + (qos ? 2 : 0);
+                    if (payload > end) return -1;
+                    if (drop_every && ++*num_publishes % drop_every == 0) {
+                         fflush(out);
+                         return -1;
+                    }
+                    fprintf(out, "%.*s\t%.*s\n", (int)topic_size, (char const *)body + 2, (int)(end - payload), (char const *)payload);
+                    stats->publishes++;
+                    if (packet[0] & 0x08) stats->duplicates++;
+                    publishes++;
+                    if (qos) {
+                         acks[acks_used++] = MqttPacketType_PubAck << 4;
+                         acks[acks_used++] = 2;
+                         acks[acks_used++] = body[2 + topic_size];
+                         acks[acks_used++] = body[2 + topic_size + 1];
+                    }
+                    break;
+               }
+               case MqttPacketType_PingReq:
+                    acks[acks_used++] = MqttPacketType_PingResp << 4;
+                    acks[acks_used++] = 0;
+                    break;
+               case MqttPacketType_Disconnect:
+                    fflush(out);
+                    return 0;
+               default:
+                    break;
+               }
+               begin += size;
+          }
+          if (publishes > stats->max_publishes_per_read) stats->max_publishes_per_read = publishes;
+          memmove(in, in + begin, used - begin);
+          used -= begin;
+          if (used == sizeof in) return -1;
+          fflush(out);
+          if (acks_used && uu_write_all(fd, acks, acks_used) != 0) return -1;
+     }
+}
+
+#endif
+
+// Accepts MQTT clients on address, [host:]port, one at a time, acknowledges
+// their publishes and prints them to standard output as topic and payload.
+// With drop_every, closes the connection at every drop_every-th publish,
+// without acknowledging it. Runs until killed.
+int mqtt_broker_run(char const *address, uint64_t drop_every)
+{
+#if defined(WIN32)
+     (void)address, (void)drop_every;
+     fprintf(stderr, "ERROR: mqtt-broker is not supported on Windows\n");
+     return -1;
+#else
+     signal(SIGPIPE, SIG_IGN);
+     int listen_fd = forward_listen(address);
+     if (listen_fd < 0) {
+          fprintf(stderr, "ERROR: could not listen on %s\n", address);
+          return -1;
+     }
+     uint64_t num_publishes = 0;
+     for (;;) {
+          int fd = accept(listen_fd, NULL, NULL);
+          if (fd < 0) {
+               if (errno == EINTR) continue;
+               fprintf(stderr, "ERROR: could not accept a connection\n");
+               return -1;
+          }
+          MqttBrokerStats stats = { 0 };
+          int64_t start_ns = uu_monotonic_ns();
+          int rc = mqtt_broker_serve(fd, stdout, drop_every, &num_publishes, &stats);
+          double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+          close(fd);
+          fprintf(stderr, "mqtt-broker\t%s after %llu publishes (%llu duplicates) in %.3fs, %llu reads, up to %llu publishes per read\n",
+                  rc == 0 ? "disconnected" : "closed", (unsigned long long)stats.publishes,
+                  (unsigned long long)stats.duplicates, seconds, (unsigned long long)stats.reads,
+                  (unsigned long long)stats.max_publishes_per_read);
+     }
+#endif
+}
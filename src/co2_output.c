@@ -0,0 +1,1015 @@
+// Output of decoded readings
+//
+// Every decoded report that should be recorded becomes a Reading. An
+// OutputSerializer formats readings, without allocating, into a large
+// preallocated OutputBuffer, which is flushed with a single write().
+//
+// Durability: when asked to, the writer ends its writes on OUTPUT_ALIGNMENT
+// boundaries of the file, so that the flash under it is rewritten in whole
+// pages, and makes every batch durable with fdatasync or O_DSYNC.
+//
+// Index: the writer can also maintain a sparse index of the file in a
+// sidecar file, <path>.idx: the 8 bytes magic CO2IDX1\n followed by 16 bytes
+// little-endian entries, the time_unix_ns of a record as i64 and its offset
+// in the file as i64, one every so many seconds of readings or bytes of
+// output. An entry is appended once its record is written.
+
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum ReadingKind
+{
+     ReadingKind_CO2,
+     ReadingKind_Temperature,
+     ReadingKind_ChecksumError,
+     ReadingKind_UnexpectedOpcode,
+     NumReadingKinds,
+} ReadingKind;
+
+typedef struct Reading
+{
+     int64_t time_unix_ns;
+     uint8_t kind; // ReadingKind
+     uint8_t opcode;
+     uint16_t raw_value;
+     union {
+          int32_t co2_in_ppm;
+          float temperature_in_C;
+     };
+} Reading;
+
+static char const *READING_KIND_NAMES[NumReadingKinds] = {
+     [ReadingKind_CO2] = "CO2",
+     [ReadingKind_Temperature] = "Temperature",
+     [ReadingKind_ChecksumError] = "ChecksumError",
+     [ReadingKind_UnexpectedOpcode] = "UnexpectedOpcode",
+};
+
+static int64_t const NS_PER_SECOND = 1000000000;
+
+typedef enum OutputSync
+{
+     OutputSync_None,
+     OutputSync_DataSync, // fdatasync after each write
+     OutputSync_OpenDataSync, // file opened with O_DSYNC
+     NumOutputSyncs,
+} OutputSync;
+
+static char const *OUTPUT_SYNC_NAMES[NumOutputSyncs] = {
+     [OutputSync_None] = "none",
+     [OutputSync_DataSync] = "fdatasync",
+     [OutputSync_OpenDataSync] = "O_DSYNC",
+};
+
+typedef struct OutputCommitStats
+{
+     uint64_t writes;
+     uint64_t bytes;
+     uint64_t syncs;
+     int64_t sync_ns_total;
+     int64_t sync_ns_max;
+} OutputCommitStats;
+
+typedef struct OutputBuffer
+{
+     int fd;
+     char *data;
+     size_t used;
+     size_t capacity;
+     int error;
+     OutputSync sync;
+     int64_t file_offset;
+     int64_t first_pending_ns; // uu_monotonic_ns when used became non-zero
+     OutputCommitStats stats;
+} OutputBuffer;
+
+// Local time formatted as in the original TSV output, recomputed only when
+// the second changes. Within a quarter hour, where time zones do not change
+// their offset, only the minutes and seconds are rewritten, without
+// localtime.
+typedef struct OutputTimeCache
+{
+     int64_t unix_time;
+     int len;
+     char iso8601[32];
+     int64_t quarter_unix_time; // localtime was called for its first second
+     int quarter_minute;
+     int quarter_second;
+} OutputTimeCache;
+
+typedef struct OutputSerializer
+{
+     char const *name;
+     // both return the end of what was written, and never write more
+     // than OUTPUT_MAX_RECORD_SIZE bytes
+     char *(*write_header)(char *dst);
+     char *(*write_reading)(char *dst, OutputTimeCache *time_cache, Reading const *reading);
+     // 0 for text formats of newline terminated records
+     int header_size;
+     int record_size;
+} OutputSerializer;
+
+enum { OUTPUT_INDEX_MAX_PENDING = 256 };
+enum { OUTPUT_INDEX_ENTRY_SIZE = 16 };
+static char const INDEX_MAGIC[8] = { 'C', 'O', '2', 'I', 'D', 'X', '1', '\n' };
+
+typedef struct OutputIndexEntry
+{
+     int64_t time_unix_ns;
+     int64_t offset;
+} OutputIndexEntry;
+
+typedef struct OutputIndex
+{
+     int fd; // -1 when none
+     int64_t every_ns;
+     int64_t every_bytes;
+     OutputIndexEntry latest; // offset -1 before the first entry
+     OutputIndexEntry pending[OUTPUT_INDEX_MAX_PENDING]; // not yet written
+     int num_pending;
+     int error;
+} OutputIndex;
+
+typedef struct OutputWriter
+{
+     OutputBuffer buffer;
+     OutputSerializer const *serializer;
+     OutputTimeCache time_cache;
+     OutputIndex index;
+} OutputWriter;
+
+enum { OUTPUT_MAX_RECORD_SIZE = 256 };
+enum { OUTPUT_DEFAULT_BUFFER_SIZE = 1 << 20 };
+enum { OUTPUT_ALIGNMENT = 4096 };
+
+//
+// Formatting helpers. They never allocate and assume the caller reserved
+// enough space.
+//
+
+static char *output_append_string(char *dst, char const *str)
+{
+     size_t len = strlen(str);
+     memcpy(dst, str, len);
+     return dst + len;
+}
+
+static char *output_append_uint(char *dst, uint64_t value)
+{
+     char digits[20];
+     int n = 0;
+     do {
+          digits[n++] = '0' + value % 10;
+          value /= 10;
+     } while (value);
+     while (n) *dst++ = digits[--n];
+     return dst;
+}
+
+static char *output_append_int(char *dst, int64_t value)
+{
+     if (value < 0) {
+          *dst++ = '-';
+          return output_append_uint(dst, (uint64_t)0 - (uint64_t)value);
+     }
+     return output_append_uint(dst, value);
+}
+
+static char *output_append_hex(char *dst, unsigned value)
+{
+     char digits[8];
+     int n = 0;
+     do {
+          digits[n++] = "0123456789abcdef"[value & 15];
+          value >>= 4;
+     } while (value);
+     while (n) *dst++ = digits[--n];
+     return dst;
+}
+
+// Byte-identical to printf("%f", value).
+//
+// value * 1e6 is exact in a double (24 bits of mantissa times a 20 bits
+// integer), so rounding it to the nearest integer, ties to even, gives the
+// same digits as printf's correctly rounded conversion.
+static char *output_append_float6(char *dst, float value)
+{
+     double scaled = (double)value * 1e6;
+     if (!isfinite(value) || scaled >= 9e15 || scaled <= -9e15) {
+          return dst + sprintf(dst, "%f", value);
+     }
+     if (signbit(value)) {
+          *dst++ = '-';
+          scaled = -scaled;
+     }
+     uint64_t n = (uint64_t)scaled;
+     double remainder = scaled - (double)n;
+     if (remainder > 0.5 || (remainder == 0.5 && (n & 1))) n++;
+     dst = output_append_uint(dst, n / 1000000);
+     *dst++ = '.';
+     uint32_t fraction = n % 1000000;
+     for (int i = 5; i >= 0; i--) {
+          dst[i] = '0' + fraction % 10;
+          fraction /= 10;
+     }
+     return dst + 6;
+}
+
+static void output_time_cache_update(OutputTimeCache *cache, int64_t time_unix_ns)
+{
+     int64_t unix_time = time_unix_ns / NS_PER_SECOND;
+     if (cache->len && unix_time == cache->unix_time) return;
+     int64_t quarter_unix_time = unix_time - (unix_time % 900 + 900) % 900;
+     if (cache->len == 19 && quarter_unix_time == cache->quarter_unix_time) {
+          int seconds = cache->quarter_second + (int)(unix_time - quarter_unix_time);
+          int minute = cache->quarter_minute + seconds / 60;
+          int second = seconds % 60;
+          if (minute < 60) {
+               cache->iso8601[14] = (char)('0' + minute / 10);
+               cache->iso8601[15] = (char)('0' + minute % 10);
+               cache->iso8601[17] = (char)('0' + second / 10);
+               cache->iso8601[18] = (char)('0' + second % 10);
+               cache->unix_time = unix_time;
+               return;
+          }
+     }
+     time_t t = (time_t)quarter_unix_time;
+     struct tm local_time;
+     localtime_r(&t, &local_time);
+     cache->quarter_unix_time = quarter_unix_time;
+     cache->quarter_minute = local_time.tm_min;
+     cache->quarter_second = local_time.tm_sec;
+     if (unix_time != quarter_unix_time) {
+          t = (time_t)unix_time;
+          localtime_r(&t, &local_time);
+     }
+     cache->len = (int)strftime(&cache->iso8601[0], sizeof cache->iso8601, "%Y-%m-%dT%H:%M:%S", &local_time);
+     assert(cache->len);
+     cache->unix_time = unix_time;
+}
+
+static char *output_append_time(char *dst, OutputTimeCache *cache, Reading const *reading)
+{
+     output_time_cache_update(cache, reading->time_unix_ns);
+     memcpy(dst, cache->iso8601, cache->len);
+     return dst + cache->len;
+}
+
+//
+// TSV: the original format
+//
+
+static char const TSV_HEADER[] = "Time\tReading\tValue\n";
+
+static char *tsv_write_header(char *dst)
+{
+     return output_append_string(dst, TSV_HEADER);
+}
+
+static char *tsv_write_reading(char *dst, OutputTimeCache *time_cache, Reading const *reading)
+{
+     dst = output_append_time(dst, time_cache, reading);
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          dst = output_append_string(dst, "\tCO2\t");
+          dst = output_append_int(dst, reading->co2_in_ppm);
+          break;
+     case ReadingKind_Temperature:
+          dst = output_append_string(dst, "\tTemperature\t");
+          dst = output_append_float6(dst, reading->temperature_in_C);
+          break;
+     case ReadingKind_ChecksumError:
+          dst = output_append_string(dst, "\t<Module returned checksum error>");
+          break;
+     case ReadingKind_UnexpectedOpcode:
+          dst = output_append_string(dst, "\t<Unexpected Opcode: 0x");
+          dst = output_append_hex(dst, reading->opcode);
+          dst = output_append_string(dst, " '");
+          *dst++ = (char)reading->opcode;
+          dst = output_append_string(dst, "'\t");
+          dst = output_append_int(dst, reading->raw_value);
+          break;
+     }
+     *dst++ = '\n';
+     return dst;
+}
+
+// Parsing tsv back, for imports and rebuilds. The layout is fixed, so a line
+// is parsed in a single pass, without scanning for tabs and without strtod or
+// sscanf. Times are local, converted with mktime once per hour of the input.
+typedef struct TsvTimeCache
+{
+     char hour_text[13]; // 2024-01-01T12
+     int64_t hour_unix_time;
+} TsvTimeCache;
+
+static int tsv_parse_digits(char const *src, int n)
+{
+     int value = 0;
+     for (int i = 0; i < n; i++) {
+          unsigned digit = (unsigned)(src[i] - '0');
+          if (digit > 9) return -1;
+          value = value * 10 + (int)digit;
+     }
+     return value;
+}
+
+// Parses [-]digits up to a newline, at most 18 digits
+static char const *tsv_parse_int(char const *src, char const *end, int64_t *value)
+{
+     int negative = src < end && *src == '-';
+     src += negative;
+     char const *start = src;
+     int64_t result = 0;
+     for (unsigned digit; src < end && (digit = (unsigned)(*src - '0')) <= 9; src++) result = result * 10 + digit;
+     if (src == start || src - start > 18) return NULL;
+     *value = negative ? -result : result;
+     return src;
+}
+
+// Parses the output of output_append_float6, [-]digits.digits
+static float tsv_parse_float6(char const **src, char const *end, int *ok)
+{
+     static double const POWERS_OF_TEN[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+     int64_t integer;
+     char const *p = tsv_parse_int(*src, end, &integer);
+     if (!p || p >= end || *p != '.') {
+          *ok = 0;
+          return 0;
+     }
+     int negative = **src == '-';
+     char const *fraction_start = ++p;
+     int64_t fraction = 0;
+     for (unsigned digit; p < end && (digit = (unsigned)(*p - '0')) <= 9; p++) fraction = fraction * 10 + digit;
+     int num_decimals = (int)(p - fraction_start);
+     if (num_decimals == 0 || num_decimals > 9) {
+          *ok = 0;
+          return 0;
+     }
+     *src = p;
+     *ok = 1;
+     double magnitude = (negative ? -(double)integer : (double)integer) + fraction / POWERS_OF_TEN[num_decimals];
+     return (float)(negative ? -magnitude : magnitude);
+}
+
+// Parses the tsv line at src into reading. Returns the start of the next
+// line, or NULL when the line, up to end, is not a complete reading line
+// (the header, a truncated line).
+static char const *tsv_parse_reading(char const *src, char const *end, TsvTimeCache *cache, Reading *reading)
+{
+     if (end - src < 21 || src[4] != '-' || src[7] != '-' || src[10] != 'T' || src[13] != ':' || src[16] != ':'
+         || src[19] != '\t') {
+          return NULL;
+     }
+     int minute = tsv_parse_digits(src + 14, 2);
+     int second = tsv_parse_digits(src + 17, 2);
+     if (minute < 0 || second < 0) return NULL;
+     if (memcmp(src, cache->hour_text, sizeof cache->hour_text) != 0) {
+          struct tm local_time = { .tm_isdst = -1 };
+          local_time.tm_year = tsv_parse_digits(src, 4) - 1900;
+          local_time.tm_mon = tsv_parse_digits(src + 5, 2) - 1;
+          local_time.tm_mday = tsv_parse_digits(src + 8, 2);
+          local_time.tm_hour = tsv_parse_digits(src + 11, 2);
+          if (local_time.tm_year < 0 || local_time.tm_mon < 0 || local_time.tm_mday < 0 || local_time.tm_hour < 0) return NULL;
+          cache->hour_unix_time = (int64_t)mktime(&local_time);
+          memcpy(cache->hour_text, src, sizeof cache->hour_text);
+     }
+     memset(reading, 0, sizeof *reading);
+     reading->time_unix_ns = (cache->hour_unix_time + minute * 60 + second) * NS_PER_SECOND;
+
+     char const *p = src + 20;
+     int64_t value;
+#define TSV_SKIP(literal) (end - p >= (ptrdiff_t)sizeof literal - 1 && 0 == memcmp(p, literal, sizeof literal - 1) ? (p += sizeof literal - 1, 1) : 0)
+     if (TSV_SKIP("CO2\t")) {
+          if (!(p = tsv_parse_int(p, end, &value))) return NULL;
+          reading->kind = ReadingKind_CO2;
+          reading->co2_in_ppm = (int32_t)value;
+     } else if (TSV_SKIP("Temperature\t")) {
+          int ok;
+          reading->kind = ReadingKind_Temperature;
+          reading->temperature_in_C = tsv_parse_float6(&p, end, &ok);
+          if (!ok) return NULL;
+     } else if (TSV_SKIP("<Module returned checksum error>")) {
+          reading->kind = ReadingKind_ChecksumError;
+     } else if (TSV_SKIP("<Unexpected Opcode: 0x")) {
+          unsigned opcode = 0;
+          char const *digits = p;
+          for (; p < end && p - digits < 2 && isxdigit((unsigned char)*p); p++) {
+               opcode = opcode * 16 + (unsigned)(*p <= '9' ? *p - '0' : (*p | 0x20) - 'a' + 10);
+          }
+          // the opcode is also written as a raw byte, which can be a newline
+          if (p == digits || end - p < 5 || p[0] != ' ' || p[1] != '\'' || p[3] != '\'' || p[4] != '\t') return NULL;
+          p += 5;
+          if (!(p = tsv_parse_int(p, end, &value)) || value < 0 || value > UINT16_MAX) return NULL;
+          reading->kind = ReadingKind_UnexpectedOpcode;
+          reading->opcode = (uint8_t)opcode;
+          reading->raw_value = (uint16_t)value;
+     } else {
+          return NULL;
+     }
+#undef TSV_SKIP
+     if (p >= end || *p != '\n') return NULL;
+     return p + 1;
+}
+
+//
+// CSV
+//
+
+static char *csv_write_header(char *dst)
+{
+     return output_append_string(dst, "time,reading,value,opcode\n");
+}
+
+static char *csv_write_reading(char *dst, OutputTimeCache *time_cache, Reading const *reading)
+{
+     dst = output_append_time(dst, time_cache, reading);
+     *dst++ = ',';
+     dst = output_append_string(dst, READING_KIND_NAMES[reading->kind]);
+     *dst++ = ',';
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          dst = output_append_int(dst, reading->co2_in_ppm);
+          break;
+     case ReadingKind_Temperature:
+          dst = output_append_float6(dst, reading->temperature_in_C);
+          break;
+     case ReadingKind_ChecksumError:
+          break;
+     case ReadingKind_UnexpectedOpcode:
+          dst = output_append_int(dst, reading->raw_value);
+          break;
+     }
+     *dst++ = ',';
+     if (reading->kind == ReadingKind_UnexpectedOpcode) {
+          dst = output_append_int(dst, reading->opcode);
+     }
+     *dst++ = '\n';
+     return dst;
+}
+
+//
+// JSON Lines
+//
+
+static char *jsonl_write_header(char *dst)
+{
+     return dst;
+}
+
+static char *jsonl_write_reading(char *dst, OutputTimeCache *time_cache, Reading const *reading)
+{
+     dst = output_append_string(dst, "{\"time\":\"");
+     dst = output_append_time(dst, time_cache, reading);
+     dst = output_append_string(dst, "\",\"reading\":\"");
+     dst = output_append_string(dst, READING_KIND_NAMES[reading->kind]);
+     *dst++ = '"';
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          dst = output_append_string(dst, ",\"value\":");
+          dst = output_append_int(dst, reading->co2_in_ppm);
+          break;
+     case ReadingKind_Temperature:
+          dst = output_append_string(dst, ",\"value\":");
+          dst = output_append_float6(dst, reading->temperature_in_C);
+          break;
+     case ReadingKind_ChecksumError:
+          break;
+     case ReadingKind_UnexpectedOpcode:
+          dst = output_append_string(dst, ",\"value\":");
+          dst = output_append_int(dst, reading->raw_value);
+          dst = output_append_string(dst, ",\"opcode\":");
+          dst = output_append_int(dst, reading->opcode);
+          break;
+     }
+     dst = output_append_string(dst, "}\n");
+     return dst;
+}
+
+//
+// InfluxDB line protocol, one measurement per reading kind, nanosecond timestamps
+//
+
+static char *influx_write_header(char *dst)
+{
+     return dst;
+}
+
+static char *influx_write_reading(char *dst, OutputTimeCache *time_cache, Reading const *reading)
+{
+     (void)time_cache;
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          dst = output_append_string(dst, "co2 ppm=");
+          dst = output_append_int(dst, reading->co2_in_ppm);
+          *dst++ = 'i';
+          break;
+     case ReadingKind_Temperature:
+          dst = output_append_string(dst, "temperature celsius=");
+          dst = output_append_float6(dst, reading->temperature_in_C);
+          break;
+     case ReadingKind_ChecksumError:
+          dst = output_append_string(dst, "checksum_error count=1i");
+          break;
+     case ReadingKind_UnexpectedOpcode:
+          dst = output_append_string(dst, "unexpected_opcode opcode=");
+          dst = output_append_int(dst, reading->opcode);
+          dst = output_append_string(dst, "i,value=");
+          dst = output_append_int(dst, reading->raw_value);
+          *dst++ = 'i';
+          break;
+     }
+     *dst++ = ' ';
+     dst = output_append_int(dst, reading->time_unix_ns);
+     *dst++ = '\n';
+     return dst;
+}
+
+//
+// Binary: an 8 bytes magic followed by fixed size little-endian records of
+// BINARY_RECORD_SIZE bytes:
+//
+// | offset | type      | field                                    |
+// +--------+-----------+------------------------------------------+
+// | 0      | i64       | time_unix_ns                             |
+// | 8      | u8        | kind (ReadingKind)                       |
+// | 9      | u8        | opcode                                   |
+// | 10     | u16       | raw_value                                |
+// | 12     | i32/f32   | co2_in_ppm or temperature_in_C           |
+//
+
+static char const BINARY_MAGIC[8] = { 'C', 'O', '2', 'R', 'E', 'C', '1', '\n' };
+enum { BINARY_RECORD_SIZE = 16 };
+
+static void binary_put_u16(uint8_t *dst, uint16_t value)
+{
+     dst[0] = value & 0xff;
+     dst[1] = value >> 8;
+}
+
+static void binary_put_u32(uint8_t *dst, uint32_t value)
+{
+     for (int i = 0; i < 4; i++) dst[i] = (value >> (8 * i)) & 0xff;
+}
+
+static void binary_put_u64(uint8_t *dst, uint64_t value)
+{
+     for (int i = 0; i < 8; i++) dst[i] = (value >> (8 * i)) & 0xff;
+}
+
+static uint16_t binary_get_u16(uint8_t const *src)
+{
+     return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t binary_get_u32(uint8_t const *src)
+{
+     uint32_t value = 0;
+     for (int i = 0; i < 4; i++) value |= (uint32_t)src[i] << (8 * i);
+     return value;
+}
+
+static uint64_t binary_get_u64(uint8_t const *src)
+{
+     uint64_t value = 0;
+     for (int i = 0; i < 8; i++) value |= (uint64_t)src[i] << (8 * i);
+     return value;
+}
+
+void binary_pack_reading(uint8_t dst[BINARY_RECORD_SIZE], Reading const *reading)
+{
+     binary_put_u64(&dst[0], (uint64_t)reading->time_unix_ns);
+     dst[8] = reading->kind;
+     dst[9] = reading->opcode;
+     binary_put_u16(&dst[10], reading->raw_value);
+     uint32_t value;
+     memcpy(&value, &reading->co2_in_ppm, sizeof value);
+     binary_put_u32(&dst[12], value);
+}
+
+void binary_unpack_reading(uint8_t const src[BINARY_RECORD_SIZE], Reading *reading)
+{
+     reading->time_unix_ns = (int64_t)binary_get_u64(&src[0]);
+     reading->kind = src[8];
+     reading->opcode = src[9];
+     reading->raw_value = binary_get_u16(&src[10]);
+     uint32_t value = binary_get_u32(&src[12]);
+     memcpy(&reading->co2_in_ppm, &value, sizeof value);
+}
+
+static char *binary_write_header(char *dst)
+{
+     memcpy(dst, BINARY_MAGIC, sizeof BINARY_MAGIC);
+     return dst + sizeof BINARY_MAGIC;
+}
+
+static char *binary_write_reading(char *dst, OutputTimeCache *time_cache, Reading const *reading)
+{
+     (void)time_cache;
+     binary_pack_reading((uint8_t *)dst, reading);
+     return dst + BINARY_RECORD_SIZE;
+}
+
+static OutputSerializer const OUTPUT_SERIALIZERS[] = {
+     { .name = "tsv", .write_header = tsv_write_header, .write_reading = tsv_write_reading },
+     { .name = "csv", .write_header = csv_write_header, .write_reading = csv_write_reading },
+     { .name = "jsonl", .write_header = jsonl_write_header, .write_reading = jsonl_write_reading },
+     { .name = "influx", .write_header = influx_write_header, .write_reading = influx_write_reading },
+     { .name = "binary",
+       .write_header = binary_write_header,
+       .write_reading = binary_write_reading,
+       .header_size = sizeof BINARY_MAGIC,
+       .record_size = BINARY_RECORD_SIZE },
+};
+enum { NUM_OUTPUT_SERIALIZERS = sizeof OUTPUT_SERIALIZERS / sizeof OUTPUT_SERIALIZERS[0] };
+
+OutputSerializer const *output_serializer_find(char const *name)
+{
+     for (int i = 0; i < NUM_OUTPUT_SERIALIZERS; i++) {
+          if (0 == strcmp(OUTPUT_SERIALIZERS[i].name, name)) return &OUTPUT_SERIALIZERS[i];
+     }
+     return NULL;
+}
+
+//
+// Writer
+//
+
+int output_writer_init(OutputWriter *writer, int fd, OutputSerializer const *serializer, size_t capacity)
+{
+     assert(capacity >= OUTPUT_ALIGNMENT + OUTPUT_MAX_RECORD_SIZE);
+     memset(writer, 0, sizeof *writer);
+     writer->serializer = serializer;
+     writer->buffer.fd = fd;
+     writer->buffer.capacity = capacity;
+     writer->buffer.data = memory_alloc(capacity);
+     writer->index.fd = -1;
+     return writer->buffer.data ? 0 : -1;
+}
+
+int output_sync_from_name(char const *name, OutputSync *result)
+{
+     for (int i = 0; i < NumOutputSyncs; i++) {
+          if (0 == strcmp(OUTPUT_SYNC_NAMES[i], name)) {
+               *result = i;
+               return 0;
+          }
+     }
+     return -1;
+}
+
+// For a file opened with uu_open_for_updating, that already holds
+// file_offset bytes.
+void output_writer_set_sync(OutputWriter *writer, OutputSync sync, int64_t file_offset)
+{
+     writer->buffer.sync = sync;
+     writer->buffer.file_offset = file_offset;
+}
+
+static void output_index_pack_entry(uint8_t dst[OUTPUT_INDEX_ENTRY_SIZE], OutputIndexEntry const *entry)
+{
+     binary_put_u64(&dst[0], (uint64_t)entry->time_unix_ns);
+     binary_put_u64(&dst[8], (uint64_t)entry->offset);
+}
+
+static void output_index_unpack_entry(uint8_t const src[OUTPUT_INDEX_ENTRY_SIZE], OutputIndexEntry *entry)
+{
+     entry->time_unix_ns = (int64_t)binary_get_u64(&src[0]);
+     entry->offset = (int64_t)binary_get_u64(&src[8]);
+}
+
+// Indexes the file of the writer in path, an entry every every_ns of
+// readings or every_bytes of output. The index of a file that is appended to
+// (see output_writer_set_sync) is kept up to the end of the file, otherwise
+// it starts over.
+int output_writer_set_index(OutputWriter *writer, char const *path, int64_t every_ns, int64_t every_bytes)
+{
+     OutputIndex *index = &writer->index;
+     if (index->fd >= 0) uu_close(index->fd);
+     index->every_ns = every_ns;
+     index->every_bytes = every_bytes;
+     index->latest.offset = -1;
+     index->fd = uu_open_for_updating(path, 0);
+     if (index->fd < 0) return -1;
+     int64_t file_offset = writer->buffer.file_offset;
+     int64_t size = uu_file_size(index->fd);
+     int64_t keep = 0;
+     uint8_t magic[sizeof INDEX_MAGIC];
+     if (file_offset > 0 && size >= (int64_t)sizeof INDEX_MAGIC && uu_seek(index->fd, 0) == 0
+         && uu_read_full(index->fd, magic, sizeof magic) == (int64_t)sizeof magic && 0 == memcmp(magic, INDEX_MAGIC, sizeof magic)) {
+          // keep the entries of what is left of the file
+          keep = size - (size - (int64_t)sizeof INDEX_MAGIC) % OUTPUT_INDEX_ENTRY_SIZE;
+          while (keep > (int64_t)sizeof INDEX_MAGIC) {
+               uint8_t packed[OUTPUT_INDEX_ENTRY_SIZE];
+               OutputIndexEntry entry;
+               if (uu_seek(index->fd, keep - OUTPUT_INDEX_ENTRY_SIZE) != 0
+                   || uu_read_full(index->fd, packed, sizeof packed) != (int64_t)sizeof packed) {
+                    return -1;
+               }
+               output_index_unpack_entry(packed, &entry);
+               if (entry.offset < file_offset) {
+                    index->latest = entry;
+                    break;
+               }
+               keep -= OUTPUT_INDEX_ENTRY_SIZE;
+          }
+     }
+     if (keep == 0) {
+          if (uu_truncate(index->fd, 0) != 0 || uu_seek(index->fd, 0) != 0) return -1;
+          return uu_write_all(index->fd, INDEX_MAGIC, sizeof INDEX_MAGIC);
+     }
+     if ((keep != size && uu_truncate(index->fd, keep) != 0) || uu_seek(index->fd, keep) != 0) return -1;
+     return 0;
+}
+
+// Appends the entries of what was written
+static void output_index_write(OutputIndex *index, int64_t file_offset)
+{
+     uint8_t packed[OUTPUT_INDEX_MAX_PENDING * OUTPUT_INDEX_ENTRY_SIZE];
+     int n = 0;
+     while (n < index->num_pending && index->pending[n].offset < file_offset) {
+          output_index_pack_entry(&packed[n * OUTPUT_INDEX_ENTRY_SIZE], &index->pending[n]);
+          n++;
+     }
+     if (!n) return;
+     // the index is a hint: a failure stops it, not the output
+     if (!index->error && uu_write_all(index->fd, packed, (size_t)n * OUTPUT_INDEX_ENTRY_SIZE) != 0) index->error = 1;
+     memmove(index->pending, index->pending + n, (index->num_pending - n) * sizeof index->pending[0]);
+     index->num_pending -= n;
+}
+
+// Writes the first size bytes of the buffer, in one write, then syncs.
+static int output_writer_write(OutputWriter *writer, size_t size)
+{
+     OutputBuffer *buffer = &writer->buffer;
+     if (size && !buffer->error) {
+          int64_t start_ns = buffer->sync != OutputSync_None ? uu_monotonic_ns() : 0;
+          if (uu_write_all(buffer->fd, buffer->data, size) != 0) buffer->error = 1;
+          if (!buffer->error && buffer->sync == OutputSync_DataSync && uu_sync_data(buffer->fd) != 0) buffer->error = 1;
+          if (buffer->sync != OutputSync_None) {
+               // with O_DSYNC the write itself is the sync
+               int64_t sync_ns = uu_monotonic_ns() - start_ns;
+               buffer->stats.syncs++;
+               buffer->stats.sync_ns_total += sync_ns;
+               if (sync_ns > buffer->stats.sync_ns_max) buffer->stats.sync_ns_max = sync_ns;
+          }
+          buffer->stats.writes++;
+          buffer->stats.bytes += size;
+          buffer->file_offset += size;
+          if (writer->index.fd >= 0 && !buffer->error) output_index_write(&writer->index, buffer->file_offset);
+     }
+     memmove(buffer->data, buffer->data + size, buffer->used - size);
+     buffer->used -= size;
+     return buffer->error ? -1 : 0;
+}
+
+int output_writer_flush(OutputWriter *writer)
+{
+     return output_writer_write(writer, writer->buffer.used);
+}
+
+// Writes as much as possible while ending on an OUTPUT_ALIGNMENT boundary of
+// the file, the rest stays in the buffer.
+int output_writer_flush_aligned(OutputWriter *writer)
+{
+     OutputBuffer *buffer = &writer->buffer;
+     int64_t end = buffer->file_offset + (int64_t)buffer->used;
+     int64_t aligned_end = end - end % OUTPUT_ALIGNMENT;
+     if (aligned_end <= buffer->file_offset) return buffer->error ? -1 : 0;
+     return output_writer_write(writer, (size_t)(aligned_end - buffer->file_offset));
+}
+
+static char *output_writer_reserve(OutputWriter *writer)
+{
+     OutputBuffer *buffer = &writer->buffer;
+     if (buffer->capacity - buffer->used < OUTPUT_MAX_RECORD_SIZE) output_writer_flush_aligned(writer);
+     if (buffer->used == 0) buffer->first_pending_ns = uu_monotonic_ns();
+     return buffer->data + buffer->used;
+}
+
+void output_writer_header(OutputWriter *writer)
+{
+     char *dst = output_writer_reserve(writer);
+     writer->buffer.used = writer->serializer->write_header(dst) - writer->buffer.data;
+}
+
+void output_writer_append(OutputWriter *writer, Reading const *reading)
+{
+     char *dst = output_writer_reserve(writer);
+     OutputIndex *index = &writer->index;
+     if (index->fd >= 0) {
+          OutputIndexEntry entry = { reading->time_unix_ns, writer->buffer.file_offset + (int64_t)writer->buffer.used };
+          if ((index->latest.offset < 0 || entry.time_unix_ns - index->latest.time_unix_ns >= index->every_ns
+               || entry.offset - index->latest.offset >= index->every_bytes)
+              && index->num_pending < OUTPUT_INDEX_MAX_PENDING) {
+               index->pending[index->num_pending++] = entry;
+               index->latest = entry;
+          }
+     }
+     writer->buffer.used = writer->serializer->write_reading(dst, &writer->time_cache, reading) - writer->buffer.data;
+}
+
+// After a failed write: drops what is buffered, and cuts the file back to
+// file_offset, the end of what was written and acknowledged before. At 0,
+// the header is written again. Returns -1 when the file cannot be cut, the
+// writer then stays failed.
+int output_writer_rewind(OutputWriter *writer, int64_t file_offset)
+{
+     OutputBuffer *buffer = &writer->buffer;
+     if (uu_truncate(buffer->fd, file_offset) != 0 || uu_seek(buffer->fd, file_offset) != 0) return -1;
+     buffer->used = 0;
+     buffer->file_offset = file_offset;
+     buffer->error = 0;
+     writer->index.num_pending = 0; // all past file_offset
+     if (file_offset == 0) output_writer_header(writer);
+     return 0;
+}
+
+void output_writer_destroy(OutputWriter *writer)
+{
+     memory_free(writer->buffer.data);
+     writer->buffer.data = NULL;
+     if (writer->index.fd >= 0) uu_close(writer->index.fd);
+     writer->index.fd = -1;
+}
+
+// Crash recovery for a file that is appended to: a write interrupted by a
+// crash can leave a partial record at the end, which is cut off. Returns the
+// size of the file that is kept, 0 meaning the header must be written again,
+// or -1 on error.
+int64_t output_recover_tail(int fd, OutputSerializer const *serializer)
+{
+     int64_t size = uu_file_size(fd);
+     if (size < 0) return -1;
+     int64_t keep = 0;
+     if (serializer->record_size) {
+          if (size >= serializer->header_size) {
+               keep = size - (size - serializer->header_size) % serializer->record_size;
+          }
+     } else {
+          // keep up to the last newline
+          char chunk[OUTPUT_ALIGNMENT];
+          int64_t end = size;
+          while (end > 0 && !keep) {
+               int64_t begin = end > (int64_t)sizeof chunk ? end - (int64_t)sizeof chunk : 0;
+               if (uu_seek(fd, begin) != 0 || uu_read_full(fd, chunk, end - begin) != end - begin) return -1;
+               for (int64_t i = end - begin; i > 0 && !keep; i--) {
+                    if (chunk[i - 1] == '\n') keep = begin + i;
+               }
+               end = begin;
+          }
+     }
+     if (keep != size && uu_truncate(fd, keep) != 0) return -1;
+     if (uu_seek(fd, keep) != 0) return -1;
+     return keep;
+}
+
+//
+// Benchmark of the serializers against the original fprintf path
+//
+
+#if defined(WIN32)
+static char const *NULL_DEVICE_PATH = "NUL";
+#else
+static char const *NULL_DEVICE_PATH = "/dev/null";
+#endif
+
+// A plausible stream: mostly CO2 and temperature readings, a few per second.
+typedef struct SyntheticSource
+{
+     uint32_t random;
+     int64_t time_unix_ns;
+     uint64_t count;
+} SyntheticSource;
+
+void synthetic_source_init(SyntheticSource *source, int64_t time_unix_ns, uint32_t seed)
+{
+     source->random = seed;
+     source->time_unix_ns = time_unix_ns;
+     source->count = 0;
+}
+
+void synthetic_source_next(SyntheticSource *source, Reading *reading)
+{
+     source->random = source->random * 1664525 + 1013904223;
+     memset(reading, 0, sizeof *reading);
+     reading->time_unix_ns = source->time_unix_ns + (int64_t)(source->count / 4) * NS_PER_SECOND;
+     if (source->count % 2 == 0) {
+          reading->kind = ReadingKind_CO2;
+          reading->opcode = 'P';
+          reading->raw_value = 400 + (source->random >> 20) % 1600;
+          reading->co2_in_ppm = reading->raw_value;
+     } else {
+          reading->kind = ReadingKind_Temperature;
+          reading->opcode = 'B';
+          reading->raw_value = 4600 + (source->random >> 20) % 300;
+          reading->temperature_in_C = reading->raw_value/16.0 - 273.15;
+     }
+     source->count++;
+}
+
+static void output_benchmark_fill_readings(Reading *readings, int num_readings)
+{
+     SyntheticSource source;
+     synthetic_source_init(&source, (int64_t)time(NULL) * NS_PER_SECOND, 12345);
+     for (int i = 0; i < num_readings; i++) synthetic_source_next(&source, &readings[i]);
+}
+
+// Same as the original output loop: strftime on every reading, fprintf, and
+// fflush when the second changes.
+static void output_benchmark_fprintf(FILE *out, Reading const *readings, int num_readings)
+{
+     fprintf(out, "Time\tReading\tValue\n");
+     int64_t prev_time_unix = readings[0].time_unix_ns / NS_PER_SECOND;
+     for (int i = 0; i < num_readings; i++) {
+          Reading const *reading = &readings[i];
+          time_t now_unix = (time_t)(reading->time_unix_ns / NS_PER_SECOND);
+          struct tm now_localtime;
+          localtime_r(&now_unix, &now_localtime);
+          char time_string_buffer[4096];
+          size_t time_string_len = strftime(&time_string_buffer[0], sizeof time_string_buffer, "%Y-%m-%dT%H:%M:%S", &now_localtime);
+          if (reading->kind == ReadingKind_CO2) {
+               fprintf(out, "%*s\tCO2\t%d\n", (int)time_string_len, time_string_buffer, reading->co2_in_ppm);
+          } else {
+               fprintf(out, "%*s\tTemperature\t%f\n", (int)time_string_len, time_string_buffer, reading->temperature_in_C);
+          }
+          if (now_unix - prev_time_unix > 0) fflush(out);
+          prev_time_unix = now_unix;
+     }
+     fflush(out);
+}
+
+static void output_benchmark_writer(OutputWriter *writer, Reading const *readings, int num_readings)
+{
+     output_writer_header(writer);
+     int64_t prev_time_unix = readings[0].time_unix_ns / NS_PER_SECOND;
+     for (int i = 0; i < num_readings; i++) {
+          int64_t now_unix = readings[i].time_unix_ns / NS_PER_SECOND;
+          output_writer_append(writer, &readings[i]);
+          if (now_unix - prev_time_unix > 0) output_writer_flush(writer);
+          prev_time_unix = now_unix;
+     }
+     output_writer_flush(writer);
+}
+
+// Writes num_readings to the null device in every format, as well as through
+// the original fprintf path, flushing at every change of second (like the
+// reader) or only when the buffer is full (like a batch conversion).
+int output_benchmark(int num_readings)
+{
+     Reading *readings = malloc(num_readings * sizeof *readings);
+     if (!readings) return 1;
+     output_benchmark_fill_readings(readings, num_readings);
+
+     printf("Format\tFlush\tRows/s\tMB/s\n");
+     FILE *null_stream = fopen(NULL_DEVICE_PATH, "wb");
+     if (!null_stream) {
+          fprintf(stderr, "ERROR: could not open %s\n", NULL_DEVICE_PATH);
+          return 1;
+     }
+     int64_t start_ns = uu_monotonic_ns();
+     output_benchmark_fprintf(null_stream, readings, num_readings);
+     double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+     printf("fprintf\tsecond\t%.0f\t-\n", num_readings / seconds);
+     fclose(null_stream);
+
+     for (int i = 0; i < NUM_OUTPUT_SERIALIZERS; i++) {
+          for (int batch = 0; batch < 2; batch++) {
+               int fd = uu_open_for_writing(NULL_DEVICE_PATH);
+               OutputWriter writer;
+               if (fd < 0 || output_writer_init(&writer, fd, &OUTPUT_SERIALIZERS[i], OUTPUT_DEFAULT_BUFFER_SIZE) != 0) {
+                    fprintf(stderr, "ERROR: could not open %s\n", NULL_DEVICE_PATH);
+                    return 1;
+               }
+               // count the bytes by serializing into the buffer only
+               size_t total_bytes = 0;
+               OutputTimeCache time_cache = {0};
+               for (int j = 0; j < num_readings; j++) {
+                    char record[OUTPUT_MAX_RECORD_SIZE];
+                    total_bytes += OUTPUT_SERIALIZERS[i].write_reading(record, &time_cache, &readings[j]) - record;
+               }
+               start_ns = uu_monotonic_ns();
+               if (batch) {
+                    output_writer_header(&writer);
+                    for (int j = 0; j < num_readings; j++) output_writer_append(&writer, &readings[j]);
+                    output_writer_flush(&writer);
+               } else {
+                    output_benchmark_writer(&writer, readings, num_readings);
+               }
+               seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+               printf("%s\t%s\t%.0f\t%.1f\n", OUTPUT_SERIALIZERS[i].name, batch ? "buffer" : "second",
+                      num_readings / seconds, total_bytes / seconds / 1e6);
+               output_writer_destroy(&writer);
+               uu_close(fd);
+          }
+     }
+     free(readings);
+     return 0;
+}
@@ -0,0 +1,713 @@
+// Platform layer: the few system services the program needs, behind
+// functions that work the same on Windows, Linux and Macos.
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // pthread_setaffinity_np
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(WIN32)
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#if defined(WIN32)
+struct tm* localtime_r(time_t *clock, struct tm *result)
+{
+    struct tm *p = localtime(clock);
+    if (p) {
+        *result = *p;
+    }
+    return p;
+}
+#endif
+
+int uu_write_all(int fd, void const *data, size_t size)
+{
+     char const *bytes = data;
+     while (size > 0) {
+#if defined(WIN32)
+          int n_or_error = _write(fd, bytes, (unsigned int)size);
+#else
+          ssize_t n_or_error = write(fd, bytes, size);
+#endif
+          if (n_or_error <= 0) return -1;
+          bytes += n_or_error;
+          size -= n_or_error;
+     }
+     return 0;
+}
+
+int uu_open_for_writing(char const *path)
+{
+#if defined(WIN32)
+     return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+     return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+
+// For appending to an existing file: the file is not truncated and the
+// caller positions itself. With data_sync every write returns only once the
+// data is on the device.
+int uu_open_for_updating(char const *path, int data_sync)
+{
+#if defined(WIN32)
+     (void)data_sync; // see uu_has_open_data_sync
+     return _open(path, _O_RDWR | _O_CREAT | _O_BINARY, 0644);
+#else
+     return open(path, O_RDWR | O_CREAT | (data_sync ? O_DSYNC : 0), 0644);
+#endif
+}
+
+int uu_has_open_data_sync(void)
+{
+#if defined(WIN32)
+     return 0;
+#else
+     return 1;
+#endif
+}
+
+// Makes the data written so far durable, metadata only as far as needed to
+// read it back.
+int uu_sync_data(int fd)
+{
+#if defined(WIN32)
+     return _commit(fd);
+#elif defined(__APPLE__)
+     // fsync does not flush the drive's cache on Macos
+     if (fcntl(fd, F_FULLFSYNC) == 0) return 0;
+     return fsync(fd);
+#else
+     return fdatasync(fd);
+#endif
+}
+
+// Syncs the directory of the file at path, so that a rename or unlink in it
+// survives a crash. A no-op on Windows, where directories are not synced.
+int uu_sync_directory_of(char const *path)
+{
+#if defined(WIN32)
+     (void)path;
+     return 0;
+#else
+     char directory[1024];
+     char const *slash = strrchr(path, '/');
+     size_t length = slash ? (size_t)(slash - path) : 0;
+     if (length >= sizeof directory) return errno = ENAMETOOLONG, -1;
+     memcpy(directory, path, length);
+     strcpy(directory + length, slash ? (length ? "" : "/") : ".");
+     int fd = open(directory, O_RDONLY);
+     if (fd < 0) return -1;
+     int rc = fsync(fd);
+     close(fd);
+     return rc;
+#endif
+}
+
+int64_t uu_file_size(int fd)
+{
+#if defined(WIN32)
+     return _filelengthi64(fd);
+#else
+     struct stat st;
+     if (fstat(fd, &st) != 0) return -1;
+     return (int64_t)st.st_size;
+#endif
+}
+
+// Last modification, in seconds since 1970
+int64_t uu_file_modified_unix(int fd)
+{
+#if defined(WIN32)
+     struct _stat64 st;
+     if (_fstat64(fd, &st) != 0) return -1;
+#else
+     struct stat st;
+     if (fstat(fd, &st) != 0) return -1;
+#endif
+     return (int64_t)st.st_mtime;
+}
+
+int uu_open_for_reading(char const *path)
+{
+#if defined(WIN32)
+     return _open(path, _O_RDONLY | _O_BINARY);
+#else
+     return open(path, O_RDONLY);
+#endif
+}
+
+// Reads until size bytes or the end of the file, returns the number of bytes
+// read or -1.
+int64_t uu_read_full(int fd, void *data, size_t size)
+{
+     char *bytes = data;
+     size_t done = 0;
+     while (done < size) {
+#if defined(WIN32)
+          int n_or_error = _read(fd, bytes + done, (unsigned int)(size - done));
+#else
+          ssize_t n_or_error = read(fd, bytes + done, size - done);
+#endif
+          if (n_or_error < 0) return -1;
+          if (n_or_error == 0) break;
+          done += n_or_error;
+     }
+     return (int64_t)done;
+}
+
+int uu_seek(int fd, int64_t offset)
+{
+#if defined(WIN32)
+     return _lseeki64(fd, offset, SEEK_SET) < 0 ? -1 : 0;
+#else
+     return lseek(fd, (off_t)offset, SEEK_SET) < 0 ? -1 : 0;
+#endif
+}
+
+int uu_truncate(int fd, int64_t size)
+{
+#if defined(WIN32)
+     return _chsize_s(fd, size) == 0 ? 0 : -1;
+#else
+     return ftruncate(fd, (off_t)size);
+#endif
+}
+
+void uu_close(int fd)
+{
+#if defined(WIN32)
+     _close(fd);
+#else
+     close(fd);
+#endif
+}
+
+// Monotonic clock, for measurements
+int64_t uu_monotonic_ns(void)
+{
+#if defined(WIN32)
+     LARGE_INTEGER frequency, counter;
+     QueryPerformanceFrequency(&frequency);
+     QueryPerformanceCounter(&counter);
+     return (int64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// Wall clock, in nanoseconds since 1970
+int64_t uu_realtime_ns(void)
+{
+#if defined(WIN32)
+     FILETIME time; // 100ns units since 1601
+     GetSystemTimePreciseAsFileTime(&time);
+     int64_t ticks = (int64_t)(((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime);
+     return (ticks - 116444736000000000LL) * 100;
+#else
+     struct timespec ts;
+     clock_gettime(CLOCK_REALTIME, &ts);
+     return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// Resident set size of the process, 0 when unknown
+int64_t uu_resident_bytes(void)
+{
+#if defined(WIN32)
+     PROCESS_MEMORY_COUNTERS counters;
+     return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters) ? (int64_t)counters.WorkingSetSize : 0;
+#elif defined(__APPLE__)
+     mach_task_basic_info_data_t info;
+     mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+     kern_return_t rc = task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count);
+     return rc == KERN_SUCCESS ? (int64_t)info.resident_size : 0;
+#else
+     // without stdio, which would allocate
+     char text[64];
+     int fd = open("/proc/self/statm", O_RDONLY);
+     if (fd < 0) return 0;
+     ssize_t n = read(fd, text, sizeof text - 1);
+     close(fd);
+     if (n <= 0) return 0;
+     text[n] = 0;
+     char const *resident = strchr(text, ' ');
+     return resident ? strtoll(resident + 1, NULL, 10) * sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+void uu_sleep_ms(int milliseconds)
+{
+#if defined(WIN32)
+     Sleep(milliseconds);
+#else
+     struct timespec ts = { milliseconds / 1000, (milliseconds % 1000) * 1000000L };
+     nanosleep(&ts, NULL);
+#endif
+}
+
+// Sleeps until uu_monotonic_ns reaches deadline_ns. An absolute deadline,
+// so that the lateness of one wakeup does not delay the next ones. Returns
+// early when a signal is handled.
+void uu_sleep_until_ns(int64_t deadline_ns)
+{
+#if defined(WIN32) || defined(__APPLE__)
+     int64_t left_ns = deadline_ns - uu_monotonic_ns();
+     if (left_ns <= 0) return;
+#if defined(WIN32)
+     Sleep((DWORD)((left_ns + 999999) / 1000000));
+#else
+     struct timespec ts = { (time_t)(left_ns / 1000000000), (long)(left_ns % 1000000000) };
+     nanosleep(&ts, NULL);
+#endif
+#else
+     struct timespec ts = { (time_t)(deadline_ns / 1000000000), (long)(deadline_ns % 1000000000) };
+     clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+#endif
+}
+
+//
+// Threads
+//
+
+// Number of online processors, at least 1
+int uu_cpu_count(void)
+{
+#if defined(WIN32)
+     SYSTEM_INFO info;
+     GetSystemInfo(&info);
+     return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+     long count = sysconf(_SC_NPROCESSORS_ONLN);
+     return count > 0 ? (int)count : 1;
+#endif
+}
+
+typedef void UU_ThreadFunction(void *arg);
+
+typedef struct UU_Thread
+{
+#if defined(WIN32)
+     HANDLE handle;
+#else
+     pthread_t handle;
+#endif
+     UU_ThreadFunction *function;
+     void *arg;
+} UU_Thread;
+
+typedef struct UU_Mutex
+{
+#if defined(WIN32)
+     SRWLOCK lock;
+#else
+     pthread_mutex_t lock;
+#endif
+} UU_Mutex;
+
+typedef struct UU_CondVar
+{
+#if defined(WIN32)
+     CONDITION_VARIABLE cond;
+#else
+     pthread_cond_t cond;
+#endif
+} UU_CondVar;
+
+#if defined(WIN32)
+static DWORD WINAPI uu_thread_trampoline(LPVOID arg)
+{
+     UU_Thread *thread = arg;
+     thread->function(thread->arg);
+     return 0;
+}
+#else
+static void *uu_thread_trampoline(void *arg)
+{
+     UU_Thread *thread = arg;
+     thread->function(thread->arg);
+     return NULL;
+}
+#endif
+
+// The thread struct must stay at the same address until uu_thread_join.
+int uu_thread_start(UU_Thread *thread, UU_ThreadFunction *function, void *arg)
+{
+     thread->function = function;
+     thread->arg = arg;
+#if defined(WIN32)
+     thread->handle = CreateThread(NULL, 0, uu_thread_trampoline, thread, 0, NULL);
+     return thread->handle ? 0 : -1;
+#else
+     return pthread_create(&thread->handle, NULL, uu_thread_trampoline, thread) == 0 ? 0 : -1;
+#endif
+}
+
+void uu_thread_join(UU_Thread *thread)
+{
+#if defined(WIN32)
+     WaitForSingleObject(thread->handle, INFINITE);
+     CloseHandle(thread->handle);
+#else
+     pthread_join(thread->handle, NULL);
+#endif
+}
+
+#if !defined(WIN32)
+static void uu_thread_interrupted(int signal_number)
+{
+     (void)signal_number;
+}
+#endif
+
+// Makes the blocking system call thread is in fail, e.g. a write to a pipe
+// nobody reads (EINTR). A call it did not start yet is not interrupted: call
+// again until the thread gave up.
+void uu_thread_interrupt(UU_Thread *thread)
+{
+#if defined(WIN32)
+     CancelSynchronousIo(thread->handle);
+#else
+     // without SA_RESTART, so that the call is not restarted
+     struct sigaction action = { .sa_handler = uu_thread_interrupted };
+     sigemptyset(&action.sa_mask);
+     sigaction(SIGUSR2, &action, NULL);
+     pthread_kill(thread->handle, SIGUSR2);
+#endif
+}
+
+// Restricts the calling thread to one processor. Sets errno on failure.
+int uu_thread_pin_to_cpu(int cpu)
+{
+#if defined(WIN32)
+     if (cpu < 0 || cpu >= 64) return errno = EINVAL, -1;
+     return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) ? 0 : (errno = EINVAL, -1);
+#elif defined(__linux__)
+     if (cpu < 0 || cpu >= CPU_SETSIZE) return errno = EINVAL, -1;
+     cpu_set_t set;
+     CPU_ZERO(&set);
+     CPU_SET(cpu, &set);
+     int error = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+     return error == 0 ? 0 : (errno = error, -1);
+#else
+     (void)cpu;
+     return errno = ENOTSUP, -1; // Macos only takes affinity hints
+#endif
+}
+
+// Puts the calling thread ahead of the ordinary ones: SCHED_FIFO with a
+// priority of 1 to 99, or the time critical priority on Windows. Sets errno
+// on failure.
+int uu_thread_set_realtime_priority(int priority)
+{
+#if defined(WIN32)
+     (void)priority;
+     return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? 0 : (errno = EPERM, -1);
+#else
+     struct sched_param param = { .sched_priority = priority };
+     int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+     return error == 0 ? 0 : (errno = error, -1);
+#endif
+}
+
+// Keeps every page of the process in memory, the current ones and the ones
+// mapped later, so that no thread stalls on a page fault. Sets errno on
+// failure.
+int uu_lock_memory(void)
+{
+#if defined(WIN32)
+     return errno = ENOTSUP, -1;
+#else
+     return mlockall(MCL_CURRENT | MCL_FUTURE);
+#endif
+}
+
+// Moves the process behind every other one for processor and disk: the
+// lowest nice and the idle I/O class on Linux, throttled I/O on Macos,
+// background mode on Windows. Sets errno on failure.
+int uu_set_background_priority(void)
+{
+#if defined(WIN32)
+     return SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN) ? 0 : (errno = EPERM, -1);
+#else
+     if (setpriority(PRIO_PROCESS, 0, 19) != 0) return -1;
+#if defined(__linux__) && defined(SYS_ioprio_set)
+     enum { IOPRIO_WHO_PROCESS = 1, IOPRIO_CLASS_IDLE = 3, IOPRIO_CLASS_SHIFT = 13 };
+     return (int)syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0 ? 0 : -1;
+#elif defined(__APPLE__)
+     return setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE);
+#else
+     return 0;
+#endif
+#endif
+}
+
+void uu_mutex_init(UU_Mutex *mutex)
+{
+#if defined(WIN32)
+     InitializeSRWLock(&mutex->lock);
+#else
+     pthread_mutex_init(&mutex->lock, NULL);
+#endif
+}
+
+void uu_mutex_destroy(UU_Mutex *mutex)
+{
+#if !defined(WIN32)
+     pthread_mutex_destroy(&mutex->lock);
+#endif
+}
+
+void uu_mutex_lock(UU_Mutex *mutex)
+{
+#if defined(WIN32)
+     AcquireSRWLockExclusive(&mutex->lock);
+#else
+     pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+void uu_mutex_unlock(UU_Mutex *mutex)
+{
+#if defined(WIN32)
+     ReleaseSRWLockExclusive(&mutex->lock);
+#else
+     pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+void uu_condvar_init(UU_CondVar *condvar)
+{
+#if defined(WIN32)
+     InitializeConditionVariable(&condvar->cond);
+#else
+     pthread_cond_init(&condvar->cond, NULL);
+#endif
+}
+
+void uu_condvar_destroy(UU_CondVar *condvar)
+{
+#if !defined(WIN32)
+     pthread_cond_destroy(&condvar->cond);
+#endif
+}
+
+void uu_condvar_wait(UU_CondVar *condvar, UU_Mutex *mutex)
+{
+#if defined(WIN32)
+     SleepConditionVariableSRW(&condvar->cond, &mutex->lock, INFINITE, 0);
+#else
+     pthread_cond_wait(&condvar->cond, &mutex->lock);
+#endif
+}
+
+// May return early, callers check their condition again
+void uu_condvar_wait_timeout(UU_CondVar *condvar, UU_Mutex *mutex, int64_t timeout_ns)
+{
+#if defined(WIN32)
+     SleepConditionVariableSRW(&condvar->cond, &mutex->lock, (DWORD)((timeout_ns + 999999) / 1000000), 0);
+#else
+     struct timespec deadline;
+     clock_gettime(CLOCK_REALTIME, &deadline);
+     int64_t ns = deadline.tv_nsec + timeout_ns;
+     deadline.tv_sec += ns / 1000000000;
+     deadline.tv_nsec = ns % 1000000000;
+     pthread_cond_timedwait(&condvar->cond, &mutex->lock, &deadline);
+#endif
+}
+
+void uu_condvar_signal(UU_CondVar *condvar)
+{
+#if defined(WIN32)
+     WakeConditionVariable(&condvar->cond);
+#else
+     pthread_cond_signal(&condvar->cond);
+#endif
+}
+
+void uu_condvar_broadcast(UU_CondVar *condvar)
+{
+#if defined(WIN32)
+     WakeAllConditionVariable(&condvar->cond);
+#else
+     pthread_cond_broadcast(&condvar->cond);
+#endif
+}
+
+//
+// Memory mapped files
+//
+
+typedef struct UU_FileMapping
+{
+     void *data;
+     int64_t size;
+#if defined(WIN32)
+     HANDLE file;
+     HANDLE mapping;
+#else
+     int fd;
+#endif
+} UU_FileMapping;
+
+// Maps path, created or resized to exactly size bytes, for reading and
+// writing. The file's blocks are allocated up front where possible, so that
+// stores into the mapping cannot fail for lack of space later.
+int uu_map_file_for_writing(UU_FileMapping *mapping, char const *path, int64_t size)
+{
+     mapping->size = size;
+#if defined(WIN32)
+     mapping->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+     if (mapping->file == INVALID_HANDLE_VALUE) return -1;
+     LARGE_INTEGER end = { .QuadPart = size };
+     if (!SetFilePointerEx(mapping->file, end, NULL, FILE_BEGIN) || !SetEndOfFile(mapping->file)) {
+          CloseHandle(mapping->file);
+          return -1;
+     }
+     mapping->mapping = CreateFileMappingA(mapping->file, NULL, PAGE_READWRITE, 0, 0, NULL);
+     mapping->data = mapping->mapping ? MapViewOfFile(mapping->mapping, FILE_MAP_WRITE, 0, 0, 0) : NULL;
+     if (!mapping->data) {
+          if (mapping->mapping) CloseHandle(mapping->mapping);
+          CloseHandle(mapping->file);
+          return -1;
+     }
+#else
+     mapping->fd = open(path, O_RDWR | O_CREAT, 0644);
+     if (mapping->fd < 0) return -1;
+     int failed = ftruncate(mapping->fd, (off_t)size) != 0;
+#if defined(__linux__)
+     if (!failed) failed = posix_fallocate(mapping->fd, 0, (off_t)size) != 0;
+#endif
+     int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+     flags |= MAP_POPULATE;
+#endif
+     mapping->data = failed ? MAP_FAILED : mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, flags, mapping->fd, 0);
+     if (mapping->data == MAP_FAILED) {
+          close(mapping->fd);
+          mapping->data = NULL;
+          return -1;
+     }
+#endif
+     return 0;
+}
+
+// Maps the whole of an existing file, read only
+int uu_map_file_for_reading(UU_FileMapping *mapping, char const *path)
+{
+#if defined(WIN32)
+     mapping->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+     if (mapping->file == INVALID_HANDLE_VALUE) return -1;
+     LARGE_INTEGER size;
+     if (!GetFileSizeEx(mapping->file, &size) || size.QuadPart == 0) {
+          CloseHandle(mapping->file);
+          return -1;
+     }
+     mapping->size = size.QuadPart;
+     mapping->mapping = CreateFileMappingA(mapping->file, NULL, PAGE_READONLY, 0, 0, NULL);
+     mapping->data = mapping->mapping ? MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+     if (!mapping->data) {
+          if (mapping->mapping) CloseHandle(mapping->mapping);
+          CloseHandle(mapping->file);
+          return -1;
+     }
+#else
+     mapping->fd = open(path, O_RDONLY);
+     if (mapping->fd < 0) return -1;
+     mapping->size = uu_file_size(mapping->fd);
+     mapping->data = mapping->size > 0 ? mmap(NULL, (size_t)mapping->size, PROT_READ, MAP_SHARED, mapping->fd, 0) : MAP_FAILED;
+     if (mapping->data == MAP_FAILED) {
+          close(mapping->fd);
+          mapping->data = NULL;
+          return -1;
+     }
+#endif
+     return 0;
+}
+
+// Writes the modified pages of [offset, offset + size) back to the file
+int uu_flush_mapping(UU_FileMapping *mapping, int64_t offset, int64_t size)
+{
+#if defined(WIN32)
+     if (!FlushViewOfFile((char *)mapping->data + offset, (SIZE_T)size)) return -1;
+     return FlushFileBuffers(mapping->file) ? 0 : -1;
+#else
+     // msync wants a page aligned address
+     int64_t page_size = sysconf(_SC_PAGESIZE);
+     int64_t begin = offset - offset % page_size;
+     return msync((char *)mapping->data + begin, (size_t)(offset + size - begin), MS_SYNC);
+#endif
+}
+
+void uu_unmap_file(UU_FileMapping *mapping)
+{
+#if defined(WIN32)
+     UnmapViewOfFile(mapping->data);
+     CloseHandle(mapping->mapping);
+     CloseHandle(mapping->file);
+#else
+     munmap(mapping->data, (size_t)mapping->size);
+     close(mapping->fd);
+#endif
+     mapping->data = NULL;
+}
+
+//
+// Atomics, for what is shared with another process through a mapping
+//
+
+uint64_t uu_atomic_load_u64(uint64_t const volatile *value)
+{
+#if defined(WIN32)
+     return (uint64_t)InterlockedCompareExchange64((LONG64 volatile *)value, 0, 0);
+#else
+     return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void uu_atomic_store_u64(uint64_t volatile *value, uint64_t new_value)
+{
+#if defined(WIN32)
+     InterlockedExchange64((LONG64 volatile *)value, (LONG64)new_value);
+#else
+     __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Orders the memory accesses before it with the ones after it
+void uu_atomic_fence(void)
+{
+#if defined(WIN32)
+     MemoryBarrier();
+#else
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
@@ -0,0 +1,193 @@
+// Real-time reader: --realtime cpu
+//
+// By default the reader runs on the main thread, wherever the scheduler
+// puts it, and stamps a report with time(), to the second, once it is
+// decoded. With --realtime the reader runs on a thread of its own, pinned to
+// the given processor, optionally with SCHED_FIFO priority
+// (--realtime-priority) and with the memory of the process locked
+// (--realtime-mlock), so that it is neither preempted by the sink threads nor
+// stalled on a page fault.
+//
+// A report is then stamped with the monotonic clock first thing after
+// hid_read returns, and the stamp mapped to the wall clock with an offset
+// measured once a second: times keep their nanosecond precision, and an
+// adjustment of the wall clock shows at the next measurement rather than
+// between two reports. Correlating sensors across hosts still takes their
+// wall clocks to agree, with NTP or PTP.
+//
+// Jitter statistics, with --stats, on a realtime line:
+// - stamp: from the return of hid_read to the reading stamped
+// - handling: from the return of hid_read to the reading handed to the
+//   outputs, after which the next read starts
+// - interval: between consecutive reports
+// - offset_step: the largest change of the offset between two measurements
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Logarithmic buckets, 4 per power of two, so a percentile is within 25%
+enum { JITTER_SUB_BUCKETS = 4, JITTER_NUM_BUCKETS = 64 * JITTER_SUB_BUCKETS };
+
+typedef struct JitterHistogram
+{
+     uint64_t counts[JITTER_NUM_BUCKETS];
+     uint64_t count;
+     int64_t max_ns;
+} JitterHistogram;
+
+typedef struct RealtimeConfig
+{
+     int cpu; // -1: no real-time reader
+     int priority; // SCHED_FIFO priority, 0 for none
+     int lock_memory;
+} RealtimeConfig;
+
+typedef struct RealtimeReader
+{
+     RealtimeConfig config;
+     int64_t offset_ns; // wall clock minus monotonic clock
+     int64_t next_sync_ns;
+     int64_t last_report_ns;
+     UU_Mutex mutex; // guards the statistics
+     JitterHistogram stamp;
+     JitterHistogram handling;
+     JitterHistogram interval;
+     int64_t offset_step_ns_max;
+} RealtimeReader;
+
+static int jitter_bucket(int64_t ns)
+{
+     if (ns < JITTER_SUB_BUCKETS) return ns < 0 ? 0 : (int)ns;
+     int log2 = 2;
+     while (log2 < 62 && (ns >> (log2 + 1))) log2++;
+     return log2 * JITTER_SUB_BUCKETS + (int)((ns >> (log2 - 2)) & (JITTER_SUB_BUCKETS - 1));
+}
+
+// Largest value of a bucket
+static int64_t jitter_bucket_max_ns(int bucket)
+{
+     if (bucket < JITTER_SUB_BUCKETS) return bucket;
+     int log2 = bucket / JITTER_SUB_BUCKETS;
+     int64_t sub = bucket % JITTER_SUB_BUCKETS;
+     return ((JITTER_SUB_BUCKETS + sub + 1) << (log2 - 2)) - 1;
+}
+
+static void jitter_add(JitterHistogram *histogram, int64_t ns)
+{
+     histogram->counts[jitter_bucket(ns)]++;
+     histogram->count++;
+     if (ns > histogram->max_ns) histogram->max_ns = ns;
+}
+
+static int64_t jitter_percentile_ns(JitterHistogram const *histogram, double fraction)
+{
+     uint64_t rank = (uint64_t)(fraction * (double)histogram->count + 0.5);
+     if (rank < 1) rank = 1;
+     uint64_t seen = 0;
+     for (int i = 0; i < JITTER_NUM_BUCKETS; i++) {
+          seen += histogram->counts[i];
+          if (seen >= rank) {
+               int64_t ns = jitter_bucket_max_ns(i);
+               return ns < histogram->max_ns ? ns : histogram->max_ns;
+          }
+     }
+     return histogram->max_ns;
+}
+
+// Locks the memory already, so that the pages touched from now on are too.
+int realtime_reader_init(RealtimeReader *reader, RealtimeConfig const *config)
+{
+     memset(reader, 0, sizeof *reader);
+     reader->config = *config;
+     uu_mutex_init(&reader->mutex);
+     if (config->lock_memory && uu_lock_memory() != 0) {
+          fprintf(stderr, "ERROR: could not lock the memory: %s (see ulimit -l, or CAP_IPC_LOCK)\n", strerror(errno));
+          return -1;
+     }
+     return 0;
+}
+
+// To call on the reader thread, before the first read
+int realtime_reader_enter(RealtimeReader *reader)
+{
+     if (uu_thread_pin_to_cpu(reader->config.cpu) != 0) {
+          fprintf(stderr, "ERROR: could not pin the reader to CPU %d: %s\n", reader->config.cpu, strerror(errno));
+          return -1;
+     }
+     if (reader->config.priority && uu_thread_set_realtime_priority(reader->config.priority) != 0) {
+          fprintf(stderr, "ERROR: could not give the reader SCHED_FIFO priority %d: %s (see ulimit -r, or CAP_SYS_NICE)\n",
+                  reader->config.priority, strerror(errno));
+          return -1;
+     }
+     return 0;
+}
+
+// Measures the offset of the wall clock, between two monotonic readings so
+// that it holds for their midpoint
+static void realtime_reader_sync(RealtimeReader *reader, int64_t now_ns)
+{
+     int64_t before_ns = uu_monotonic_ns();
+     int64_t realtime_ns = uu_realtime_ns();
+     int64_t after_ns = uu_monotonic_ns();
+     int64_t offset_ns = realtime_ns - (before_ns + (after_ns - before_ns) / 2);
+     if (reader->next_sync_ns) {
+          int64_t step_ns = offset_ns > reader->offset_ns ? offset_ns - reader->offset_ns : reader->offset_ns - offset_ns;
+          if (step_ns > reader->offset_step_ns_max) {
+               uu_mutex_lock(&reader->mutex);
+               reader->offset_step_ns_max = step_ns;
+               uu_mutex_unlock(&reader->mutex);
+          }
+     }
+     reader->offset_ns = offset_ns;
+     reader->next_sync_ns = now_ns + NS_PER_SECOND;
+}
+
+// The wall clock time of a report received at received_ns, on the monotonic
+// clock
+int64_t realtime_reader_stamp(RealtimeReader *reader, int64_t received_ns)
+{
+     if (received_ns >= reader->next_sync_ns) realtime_reader_sync(reader, received_ns);
+     int64_t time_unix_ns = received_ns + reader->offset_ns;
+     int64_t stamped_ns = uu_monotonic_ns();
+     uu_mutex_lock(&reader->mutex);
+     jitter_add(&reader->stamp, stamped_ns - received_ns);
+     if (reader->last_report_ns) jitter_add(&reader->interval, received_ns - reader->last_report_ns);
+     uu_mutex_unlock(&reader->mutex);
+     reader->last_report_ns = received_ns;
+     return time_unix_ns;
+}
+
+// Once the report received at received_ns is handed to the outputs
+void realtime_reader_handled(RealtimeReader *reader, int64_t received_ns)
+{
+     int64_t handled_ns = uu_monotonic_ns();
+     uu_mutex_lock(&reader->mutex);
+     jitter_add(&reader->handling, handled_ns - received_ns);
+     uu_mutex_unlock(&reader->mutex);
+}
+
+void realtime_reader_print_stats(RealtimeReader *reader, FILE *out)
+{
+     uu_mutex_lock(&reader->mutex);
+     JitterHistogram stamp = reader->stamp;
+     JitterHistogram handling = reader->handling;
+     JitterHistogram interval = reader->interval;
+     int64_t offset_step_ns_max = reader->offset_step_ns_max;
+     uu_mutex_unlock(&reader->mutex);
+     fprintf(out,
+             "realtime\tcpu=%d priority=%d mlock=%s reports=%llu"
+             " stamp_us p50=%.1f p99=%.1f max=%.1f handling_us p50=%.1f p99=%.1f max=%.1f"
+             " interval_ms p50=%.1f p99=%.1f max=%.1f offset_step_us max=%.1f\n",
+             reader->config.cpu, reader->config.priority, reader->config.lock_memory ? "yes" : "no",
+             (unsigned long long)stamp.count,
+             jitter_percentile_ns(&stamp, 0.5) / 1e3, jitter_percentile_ns(&stamp, 0.99) / 1e3, stamp.max_ns / 1e3,
+             jitter_percentile_ns(&handling, 0.5) / 1e3, jitter_percentile_ns(&handling, 0.99) / 1e3, handling.max_ns / 1e3,
+             jitter_percentile_ns(&interval, 0.5) / 1e6, jitter_percentile_ns(&interval, 0.99) / 1e6, interval.max_ns / 1e6,
+             offset_step_ns_max / 1e3);
+}
+
+void realtime_reader_destroy(RealtimeReader *reader)
+{
+     uu_mutex_destroy(&reader->mutex);
+}
@@ -0,0 +1,157 @@
+// Replay: --replay path, recorded readings in place of the sensor
+//
+// With --replay, the readings of an output, tsv or binary, or of an archive
+// (see co2_compact.c), go to the targets, windows, alerts, history and
+// rollups in place of those of the sensor, to test dashboards, alerting and
+// collectors with a known session.
+//
+// Pacing, with --replay-speed: at 1x (the default) the readings come as
+// they were recorded, at Nx n times faster, at max as fast as the outputs
+// take them. A reading is due at the start of the replay plus the time from
+// the first reading, divided by the speed, on the monotonic clock: the
+// replay sleeps to that absolute deadline (clock_nanosleep with
+// TIMER_ABSTIME on Linux), so that a late wakeup does not delay the ones
+// after it and the replay does not drift.
+//
+// With --replay-wire, every reading is encrypted back into the 8 bytes
+// report of the sensor, and goes through the decoding of live reports:
+// decryption, terminator, checksum and opcode. Raw values are taken from
+// the values, as tsv outputs do not keep them.
+//
+// With --replay-restamp, readings are stamped with the wall clock when they
+// are replayed, like live ones, instead of keeping their recorded time.
+//
+// A replay line on standard error, every --stats interval and at the end,
+// gives the rate achieved and the one expected from the recording, and the
+// distribution of the lateness of the readings past their deadline.
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ReplayConfig
+{
+     char const *path; // NULL: no replay
+     double speed; // 0 for as fast as possible
+     int wire;
+     int restamp;
+} ReplayConfig;
+
+typedef struct ReplaySource
+{
+     ReplayConfig config;
+     sig_atomic_t const volatile *stop_requested;
+     MergeInput input;
+     int64_t start_ns; // monotonic time of the first reading
+     int64_t first_unix_ns; // recorded time of the first reading
+     int64_t last_unix_ns;
+     int64_t last_ns; // monotonic time of the last reading
+     uint64_t num_readings;
+     JitterHistogram lateness;
+} ReplaySource;
+
+// Parses 1x, 10x, 2.5, or max (0)
+int replay_parse_speed(char const *text, double *speed)
+{
+     if (0 == strcmp(text, "max")) {
+          *speed = 0;
+          return 0;
+     }
+     char *end;
+     *speed = strtod(text, &end);
+     if (*end == 'x') end++;
+     return end != text && !*end && *speed > 0 ? 0 : -1;
+}
+
+int replay_source_open(ReplaySource *source, ReplayConfig const *config, sig_atomic_t const volatile *stop_requested)
+{
+     memset(source, 0, sizeof *source);
+     source->config = *config;
+     source->stop_requested = stop_requested;
+     source->input.path = config->path;
+     source->input.fd = -1;
+     return merge_input_open_path(&source->input);
+}
+
+// Waits for the next reading to be due. Returns 1, 0 at the end, -1 on
+// errors, or 0 too when a stop was requested.
+int replay_source_next(ReplaySource *source, Reading *reading, int64_t *received_ns)
+{
+     int status = merge_input_advance(&source->input);
+     if (status <= 0) return status;
+     *reading = source->input.reading;
+     int64_t now_ns = uu_monotonic_ns();
+     if (!source->num_readings) {
+          source->start_ns = now_ns;
+          source->first_unix_ns = reading->time_unix_ns;
+     }
+     if (source->config.speed > 0) {
+          int64_t deadline_ns = source->start_ns + (int64_t)((reading->time_unix_ns - source->first_unix_ns) / source->config.speed);
+          while (now_ns < deadline_ns) {
+               if (*source->stop_requested) return 0;
+               uu_sleep_until_ns(deadline_ns);
+               now_ns = uu_monotonic_ns();
+          }
+          jitter_add(&source->lateness, now_ns - deadline_ns);
+     }
+     source->last_unix_ns = reading->time_unix_ns;
+     source->last_ns = now_ns;
+     source->num_readings++;
+     if (source->config.restamp) reading->time_unix_ns = uu_realtime_ns();
+     *received_ns = now_ns;
+     return 1;
+}
+
+// The plain report the sensor sends for reading
+void replay_encode_report(Reading const *reading, uint8_t data[8])
+{
+     uint8_t opcode = reading->opcode;
+     int64_t raw_value = reading->raw_value;
+     switch (reading->kind) {
+     case ReadingKind_CO2:
+          opcode = 'P';
+          raw_value = reading->co2_in_ppm;
+          break;
+     case ReadingKind_Temperature:
+          opcode = 'B';
+          raw_value = (int64_t)((reading->temperature_in_C + 273.15) * 16.0 + 0.5);
+          break;
+     case ReadingKind_ChecksumError:
+          opcode = 'S';
+          raw_value = 0;
+          break;
+     default:
+          break;
+     }
+     if (raw_value < 0) raw_value = 0;
+     if (raw_value > UINT16_MAX) raw_value = UINT16_MAX;
+     memset(data, 0, 8);
+     data[0] = opcode;
+     data[1] = (uint8_t)(raw_value >> 8);
+     data[2] = (uint8_t)raw_value;
+     data[3] = (uint8_t)(data[0] + data[1] + data[2]);
+     data[4] = 0x0d;
+}
+
+void replay_source_print_stats(ReplaySource const *source, FILE *out)
+{
+     double seconds = (source->last_ns - source->start_ns) / 1e9;
+     double recorded_seconds = (source->last_unix_ns - source->first_unix_ns) / 1e9;
+     double intervals = source->num_readings > 1 ? (double)(source->num_readings - 1) : 0;
+     double rate = seconds > 0 ? intervals / seconds : 0;
+     fprintf(out, "replay\treadings=%llu seconds=%.3f rate=%.1f/s", (unsigned long long)source->num_readings, seconds, rate);
+     if (source->config.speed > 0) {
+          JitterHistogram const *lateness = &source->lateness;
+          fprintf(out, " expected_rate=%.1f/s lateness_us p50=%.1f p99=%.1f max=%.1f",
+                  recorded_seconds > 0 ? intervals * source->config.speed / recorded_seconds : 0,
+                  jitter_percentile_ns(lateness, 0.5) / 1e3, jitter_percentile_ns(lateness, 0.99) / 1e3, lateness->max_ns / 1e3);
+     }
+     fprintf(out, "\n");
+}
+
+void replay_source_close(ReplaySource *source)
+{
+     merge_input_close(&source->input);
+}
@@ -0,0 +1,334 @@
+// Reports over outputs
+//
+// co2 report scans tsv or binary outputs or archives, e.g. a year of every
+// room, into:
+//
+// - heatmap: the count of CO2 readings per hour of the week (local time,
+//   Monday 00 first) and CO2 band, as a matrix with a row per hour
+// - histogram: the count of CO2 readings per bin of ppm, with the cumulative
+//   share of the readings up to the bin
+//
+// The inputs are memory mapped and cut into blocks of whole lines, records
+// or archive frames, which a pool of threads takes in turn. Every thread
+// counts into its own tables, added up once all blocks are done, so threads
+// share nothing but the index of the next block.
+//
+// Local hours are found with localtime once per quarter hour of readings,
+// as time zones only change their offset on quarter hours.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { REPORT_BLOCK_SIZE = 16 << 20 };
+enum { REPORT_MAX_THREADS = 64 };
+enum { REPORT_MAX_BANDS = 16 }; // edges, so one more band
+enum { REPORT_MAX_PPM = 10000 }; // the last bin of the histogram has the readings above
+enum { REPORT_MAX_BINS = REPORT_MAX_PPM + 1 };
+enum { REPORT_HOURS_PER_WEEK = 7 * 24 };
+
+typedef enum ReportKind
+{
+     ReportKind_Heatmap,
+     ReportKind_Histogram,
+     NumReportKinds,
+} ReportKind;
+
+static char const *REPORT_KIND_NAMES[NumReportKinds] = {
+     [ReportKind_Heatmap] = "heatmap",
+     [ReportKind_Histogram] = "histogram",
+};
+
+typedef struct ReportConfig
+{
+     ReportKind kind;
+     int num_edges;
+     int edges[REPORT_MAX_BANDS]; // ppm, increasing
+     int bin_ppm;
+     int num_threads; // 0 for one per processor
+} ReportConfig;
+
+typedef struct ReportBlock
+{
+     char const *begin; // whole lines or records
+     char const *end;
+     int is_binary;
+     int is_archive;
+} ReportBlock;
+
+typedef struct ReportCounts
+{
+     uint64_t heatmap[REPORT_HOURS_PER_WEEK][REPORT_MAX_BANDS + 1];
+     uint64_t histogram[REPORT_MAX_BINS];
+     uint64_t num_readings; // CO2 readings
+} ReportCounts;
+
+typedef struct ReportWorker
+{
+     struct Report *report;
+     ReportCounts counts;
+     int64_t quarter_unix_time; // of hour_of_week, INT64_MIN before the first
+     int hour_of_week;
+     TsvTimeCache time_cache;
+     Reading frame_readings[FORWARD_MAX_FRAME_READINGS]; // of an archive frame
+     UU_Thread thread;
+} ReportWorker;
+
+typedef struct Report
+{
+     ReportConfig config;
+     UU_FileMapping *mappings;
+     int num_mappings;
+     ReportBlock *blocks;
+     int num_blocks;
+     int next_block; // taken under mutex
+     UU_Mutex mutex;
+     uint8_t band_of_ppm[REPORT_MAX_BINS];
+} Report;
+
+static int report_hour_of_week(ReportWorker *worker, int64_t time_unix_ns)
+{
+     int64_t unix_time = time_unix_ns / NS_PER_SECOND;
+     int64_t quarter_unix_time = unix_time - (unix_time % 900 + 900) % 900;
+     if (quarter_unix_time != worker->quarter_unix_time) {
+          time_t t = (time_t)quarter_unix_time;
+          struct tm local_time;
+          localtime_r(&t, &local_time);
+          worker->hour_of_week = (local_time.tm_wday + 6) % 7 * 24 + local_time.tm_hour;
+          worker->quarter_unix_time = quarter_unix_time;
+     }
+     return worker->hour_of_week;
+}
+
+static void report_count(ReportWorker *worker, Reading const *reading)
+{
+     if (reading->kind != ReadingKind_CO2) return;
+     Report const *report = worker->report;
+     ReportCounts *counts = &worker->counts;
+     int ppm = reading->co2_in_ppm < 0 ? 0 : reading->co2_in_ppm > REPORT_MAX_PPM ? REPORT_MAX_PPM : reading->co2_in_ppm;
+     if (report->config.kind == ReportKind_Heatmap) {
+          counts->heatmap[report_hour_of_week(worker, reading->time_unix_ns)][report->band_of_ppm[ppm]]++;
+     } else {
+          counts->histogram[ppm]++;
+     }
+     counts->num_readings++;
+}
+
+static void report_count_block(ReportWorker *worker, ReportBlock const *block)
+{
+     Reading reading;
+     if (block->is_archive) {
+          // frames checked by archive_parse
+          for (char const *p = block->begin; p < block->end; p += forward_frame_size((uint8_t const *)p)) {
+               int n = forward_decode_frame((uint8_t const *)p, worker->frame_readings);
+               for (int i = 0; i < n; i++) report_count(worker, &worker->frame_readings[i]);
+          }
+          return;
+     }
+     if (block->is_binary) {
+          for (char const *p = block->begin; p + BINARY_RECORD_SIZE <= block->end; p += BINARY_RECORD_SIZE) {
+               binary_unpack_reading((uint8_t const *)p, &reading);
+               report_count(worker, &reading);
+          }
+          return;
+     }
+     for (char const *p = block->begin; p < block->end;) {
+          char const *next = tsv_parse_reading(p, block->end, &worker->time_cache, &reading);
+          if (!next) {
+               char const *newline = import_find_newline(p, block->end);
+               p = newline ? newline + 1 : block->end;
+               continue;
+          }
+          report_count(worker, &reading);
+          p = next;
+     }
+}
+
+static void report_run(void *arg)
+{
+     ReportWorker *worker = arg;
+     Report *report = worker->report;
+     for (;;) {
+          uu_mutex_lock(&report->mutex);
+          int i = report->next_block < report->num_blocks ? report->next_block++ : -1;
+          uu_mutex_unlock(&report->mutex);
+          if (i < 0) return;
+          report_count_block(worker, &report->blocks[i]);
+     }
+}
+
+// Maps the inputs and cuts them into blocks. Errors are reported on
+// standard error.
+static int report_add_inputs(Report *report, char const *const *paths, int num_paths)
+{
+     report->mappings = calloc(num_paths, sizeof *report->mappings);
+     if (!report->mappings) return -1;
+     int capacity = 0;
+     for (int i = 0; i < num_paths; i++) {
+          UU_FileMapping *mapping = &report->mappings[report->num_mappings];
+          if (uu_map_file_for_reading(mapping, paths[i]) != 0) {
+               fprintf(stderr, "ERROR: could not map %s (missing or empty?)\n", paths[i]);
+               return -1;
+          }
+          report->num_mappings++;
+          char const *p = mapping->data;
+          char const *end = p + mapping->size;
+          int is_binary = mapping->size >= (int64_t)sizeof BINARY_MAGIC && 0 == memcmp(p, BINARY_MAGIC, sizeof BINARY_MAGIC);
+          int is_archive = archive_is_archive(p, mapping->size);
+          Archive archive;
+          int block_index = 0;
+          if (is_archive) {
+               if (archive_parse(&archive, p, mapping->size, paths[i]) != 0) return -1;
+               p += sizeof ARCHIVE_MAGIC;
+               end = (char const *)archive.index;
+          }
+          if (is_binary) {
+               p += sizeof BINARY_MAGIC;
+               end -= (end - p) % BINARY_RECORD_SIZE; // torn last record
+          }
+          while (p < end) {
+               if (report->num_blocks == capacity) {
+                    capacity = capacity ? 2 * capacity : 256;
+                    ReportBlock *blocks = realloc(report->blocks, capacity * sizeof *blocks);
+                    if (!blocks) return -1;
+                    report->blocks = blocks;
+               }
+               ReportBlock *block = &report->blocks[report->num_blocks++];
+               block->begin = p;
+               block->is_binary = is_binary;
+               block->is_archive = is_archive;
+               if (end - p <= REPORT_BLOCK_SIZE) {
+                    block->end = end;
+               } else if (is_archive) {
+                    // whole frames, at least one
+                    ArchiveBlock frame;
+                    do {
+                         archive_get_block(&archive, block_index++, &frame);
+                    } while (block_index < archive.num_blocks && (char const *)archive.data + frame.offset + frame.size - p < REPORT_BLOCK_SIZE);
+                    block->end = (char const *)archive.data + frame.offset + frame.size;
+               } else if (is_binary) {
+                    block->end = p + REPORT_BLOCK_SIZE - REPORT_BLOCK_SIZE % BINARY_RECORD_SIZE;
+               } else {
+                    block->end = import_find_line_start(p + REPORT_BLOCK_SIZE - 1, end);
+               }
+               p = block->end;
+          }
+     }
+     return 0;
+}
+
+static void report_write(Report const *report, ReportCounts const *counts, FILE *out)
+{
+     ReportConfig const *config = &report->config;
+     if (config->kind == ReportKind_Heatmap) {
+          static char const *DAYS[7] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+          fprintf(out, "Hour\t<%d", config->edges[0]);
+          for (int band = 1; band < config->num_edges; band++) fprintf(out, "\t%d-%d", config->edges[band - 1], config->edges[band]);
+          fprintf(out, "\t>=%d\n", config->edges[config->num_edges - 1]);
+          for (int hour = 0; hour < REPORT_HOURS_PER_WEEK; hour++) {
+               fprintf(out, "%s %02d", DAYS[hour / 24], hour % 24);
+               for (int band = 0; band <= config->num_edges; band++) fprintf(out, "\t%llu", (unsigned long long)counts->heatmap[hour][band]);
+               fputc('\n', out);
+          }
+          return;
+     }
+     // bins of bin_ppm from the first to the last with readings
+     uint64_t bins[REPORT_MAX_BINS] = { 0 };
+     int num_bins = REPORT_MAX_PPM / config->bin_ppm + 1;
+     for (int ppm = 0; ppm < REPORT_MAX_BINS; ppm++) bins[ppm / config->bin_ppm] += counts->histogram[ppm];
+     int first = 0, last = num_bins - 1;
+     while (first < last && !bins[first]) first++;
+     while (last > first && !bins[last]) last--;
+     fprintf(out, "ppm\tcount\tcumulative\n");
+     uint64_t cumulative = 0;
+     for (int bin = first; bin <= last; bin++) {
+          cumulative += bins[bin];
+          fprintf(out, "%d\t%llu\t%.6f\n", bin * config->bin_ppm, (unsigned long long)bins[bin],
+                  counts->num_readings ? (double)cumulative / counts->num_readings : 0.0);
+     }
+}
+
+// Writes the report of the outputs at paths to target ("-" for standard
+// output). Statistics and errors are reported on standard error.
+int report_outputs(ReportConfig const *config, char const *const *paths, int num_paths, char const *target)
+{
+     static ReportWorker workers[REPORT_MAX_THREADS];
+     static ReportCounts total;
+     Report report = { .config = *config };
+     int num_threads = config->num_threads > 0 ? config->num_threads : uu_cpu_count();
+     if (num_threads > REPORT_MAX_THREADS) num_threads = REPORT_MAX_THREADS;
+     for (int ppm = 0, band = 0; ppm < REPORT_MAX_BINS; ppm++) {
+          while (band < config->num_edges && ppm >= config->edges[band]) band++;
+          report.band_of_ppm[ppm] = (uint8_t)band;
+     }
+     uu_mutex_init(&report.mutex);
+
+     int64_t start_ns = uu_monotonic_ns();
+     int rc = report_add_inputs(&report, paths, num_paths);
+     int num_started = 0;
+     for (; rc == 0 && num_started < num_threads; num_started++) {
+          ReportWorker *worker = &workers[num_started];
+          memset(worker, 0, sizeof *worker);
+          worker->report = &report;
+          worker->quarter_unix_time = INT64_MIN;
+          if (uu_thread_start(&worker->thread, report_run, worker) != 0) {
+               fprintf(stderr, "ERROR: could not start a report thread\n");
+               rc = -1;
+               break;
+          }
+     }
+     memset(&total, 0, sizeof total);
+     for (int i = 0; i < num_started; i++) {
+          ReportCounts const *counts = &workers[i].counts;
+          uu_thread_join(&workers[i].thread);
+          for (int hour = 0; hour < REPORT_HOURS_PER_WEEK; hour++) {
+               for (int band = 0; band <= REPORT_MAX_BANDS; band++) total.heatmap[hour][band] += counts->heatmap[hour][band];
+          }
+          for (int ppm = 0; ppm < REPORT_MAX_BINS; ppm++) total.histogram[ppm] += counts->histogram[ppm];
+          total.num_readings += counts->num_readings;
+     }
+     double seconds = (uu_monotonic_ns() - start_ns) / 1e9;
+     int64_t num_bytes = 0;
+     for (int i = 0; i < report.num_mappings; i++) num_bytes += report.mappings[i].size;
+
+     if (rc == 0) {
+          FILE *out = 0 == strcmp(target, "-") ? stdout : fopen(target, "w");
+          if (!out) {
+               fprintf(stderr, "ERROR: could not open %s for writing.\n", target);
+               rc = -1;
+          } else {
+               report_write(&report, &total, out);
+               if (ferror(out) || (out != stdout && fclose(out) != 0) || (out == stdout && fflush(out) != 0)) {
+                    fprintf(stderr, "ERROR: could not write %s\n", target);
+                    rc = -1;
+               }
+               fprintf(stderr, "report\t%lld bytes, %llu CO2 readings in %.3fs, %.0f MB/s, %d threads\n", (long long)num_bytes,
+                       (unsigned long long)total.num_readings, seconds, num_bytes / 1e6 / seconds, num_started);
+          }
+     }
+     for (int i = 0; i < report.num_mappings; i++) uu_unmap_file(&report.mappings[i]);
+     free(report.mappings);
+     free(report.blocks);
+     uu_mutex_destroy(&report.mutex);
+     return rc;
+}
+
+// Parses increasing ppm band edges, e.g. 600,800,1000. Returns -1 when invalid.
+int report_parse_bands(char const *text, ReportConfig *config)
+{
+     config->num_edges = 0;
+     for (char const *p = text; *p;) {
+          char *end;
+          long edge = strtol(p, &end, 10);
+          if (end == p || edge <= 0 || edge > REPORT_MAX_PPM || config->num_edges == REPORT_MAX_BANDS
+              || (config->num_edges && edge <= config->edges[config->num_edges - 1]) || (*end && *end != ',')) {
+               return -1;
+          }
+          config->edges[config->num_edges++] = (int)edge;
+          p = *end ? end + 1 : end;
+     }
+     return config->num_edges ? 0 : -1;
+}
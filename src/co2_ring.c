@@ -0,0 +1,422 @@
+// Flight recorder: a fixed size, memory mapped, circular file of readings
+//
+// The file is allocated once at its full size, and records are written by
+// plain stores into the mapping: appending a reading costs a memcpy, no
+// system call. A thread msyncs the mapping on a schedule. Once full, the
+// oldest records are overwritten, so the file always holds the latest
+// capacity readings.
+//
+// Layout, in the byte order of the machine (little-endian on every platform
+// we support), records in the binary format of co2_output.c:
+//
+// | offset | type   | field                                               |
+// +--------+--------+-----------------------------------------------------+
+// | 0      | u8[8]  | magic "CO2RING\n"                                   |
+// | 8      | u32    | version (1)                                         |
+// | 12     | u32    | record size (BINARY_RECORD_SIZE)                    |
+// | 16     | u64    | capacity, in records                                |
+// | 24     | u64    | head: sequence number of the next record            |
+// | 32     | u64    | tail: sequence number of the oldest record          |
+// | 4096   |        | records, sequence number s at index s % capacity    |
+//
+// The tail is moved before a record is overwritten, and the head after a
+// record is complete, so that a reader in another process can copy
+// [tail, head) and keep what is still at or after the tail afterwards.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct RingFileHeader
+{
+     char magic[8];
+     uint32_t version;
+     uint32_t record_size;
+     uint64_t capacity;
+     uint64_t volatile head;
+     uint64_t volatile tail;
+} RingFileHeader;
+
+static char const RING_FILE_MAGIC[8] = { 'C', 'O', '2', 'R', 'I', 'N', 'G', '\n' };
+enum { RING_FILE_VERSION = 1 };
+enum { RING_FILE_HEADER_SIZE = 4096 };
+enum { RING_FILE_DEFAULT_SYNC_INTERVAL_MS = 1000 };
+
+typedef struct RingFile
+{
+     char const *path;
+     UU_FileMapping mapping;
+     RingFileHeader *header;
+     uint8_t *records;
+     uint64_t capacity;
+     uint64_t head; // only the reader thread appends
+
+     int sync_interval_ms;
+     UU_Mutex mutex;
+     int stopping;
+     uint64_t syncs;
+     int64_t sync_ns_max;
+     int sync_errors;
+     UU_Thread sync_thread;
+} RingFile;
+
+static void ring_file_sync(RingFile *ring)
+{
+     // records before the header that points to them
+     int64_t start_ns = uu_monotonic_ns();
+     int failed = uu_flush_mapping(&ring->mapping, RING_FILE_HEADER_SIZE, ring->mapping.size - RING_FILE_HEADER_SIZE) != 0;
+     if (!failed) failed = uu_flush_mapping(&ring->mapping, 0, RING_FILE_HEADER_SIZE) != 0;
+     int64_t sync_ns = uu_monotonic_ns() - start_ns;
+     uu_mutex_lock(&ring->mutex);
+     ring->syncs++;
+     if (sync_ns > ring->sync_ns_max) ring->sync_ns_max = sync_ns;
+     if (failed) ring->sync_errors++;
+     uu_mutex_unlock(&ring->mutex);
+}
+
+static void ring_file_sync_run(void *arg)
+{
+     RingFile *ring = arg;
+     int64_t next_ns = uu_monotonic_ns() + (int64_t)ring->sync_interval_ms * 1000000;
+     for (;;) {
+          uu_mutex_lock(&ring->mutex);
+          int stopping = ring->stopping;
+          uu_mutex_unlock(&ring->mutex);
+          if (stopping) break;
+          int64_t now_ns = uu_monotonic_ns();
+          if (now_ns >= next_ns) {
+               ring_file_sync(ring);
+               next_ns = now_ns + (int64_t)ring->sync_interval_ms * 1000000;
+          }
+          int64_t sleep_ms = (next_ns - now_ns) / 1000000;
+          uu_sleep_ms(sleep_ms < 1 ? 1 : sleep_ms > 100 ? 100 : (int)sleep_ms);
+     }
+}
+
+// Opens the ring file at path, of size bytes in total, and resumes after the
+// records it holds if it has the same capacity. Errors are reported on
+// standard error.
+int ring_file_open(RingFile *ring, char const *path, int64_t size, int sync_interval_ms)
+{
+     memset(ring, 0, sizeof *ring);
+     ring->path = path;
+     ring->sync_interval_ms = sync_interval_ms;
+     if (size < RING_FILE_HEADER_SIZE + BINARY_RECORD_SIZE) {
+          fprintf(stderr, "ERROR: ring file size must be at least %d bytes\n", RING_FILE_HEADER_SIZE + BINARY_RECORD_SIZE);
+          return -1;
+     }
+     ring->capacity = (uint64_t)(size - RING_FILE_HEADER_SIZE) / BINARY_RECORD_SIZE;
+     size = RING_FILE_HEADER_SIZE + (int64_t)ring->capacity * BINARY_RECORD_SIZE;
+     if (uu_map_file_for_writing(&ring->mapping, path, size) != 0) {
+          fprintf(stderr, "ERROR: could not map ring file %s\n", path);
+          return -1;
+     }
+     ring->header = ring->mapping.data;
+     ring->records = (uint8_t *)ring->mapping.data + RING_FILE_HEADER_SIZE;
+
+     RingFileHeader *header = ring->header;
+     uint64_t head = header->head;
+     uint64_t tail = header->tail;
+     if (0 == memcmp(header->magic, RING_FILE_MAGIC, sizeof RING_FILE_MAGIC) &&
+         header->version == RING_FILE_VERSION && header->record_size == BINARY_RECORD_SIZE &&
+         header->capacity == ring->capacity && tail <= head && head - tail <= ring->capacity) {
+          ring->head = head;
+     } else {
+          if (header->magic[0]) fprintf(stderr, "%s: not a ring file of this size, starting it over\n", path);
+          memset(header, 0, sizeof *header);
+          header->version = RING_FILE_VERSION;
+          header->record_size = BINARY_RECORD_SIZE;
+          header->capacity = ring->capacity;
+          memcpy(header->magic, RING_FILE_MAGIC, sizeof RING_FILE_MAGIC);
+          ring->head = 0;
+     }
+
+     uu_mutex_init(&ring->mutex);
+     if (uu_thread_start(&ring->sync_thread, ring_file_sync_run, ring) != 0) {
+          fprintf(stderr, "ERROR: could not start the thread of ring file %s\n", path);
+          return -1;
+     }
+     return 0;
+}
+
+void ring_file_append(RingFile *ring, Reading const *reading)
+{
+     uint64_t seq = ring->head;
+     if (seq >= ring->capacity) {
+          // the record about to be overwritten must leave first
+          uu_atomic_store_u64(&ring->header->tail, seq + 1 - ring->capacity);
+          uu_atomic_fence();
+     }
+     binary_pack_reading(&ring->records[(seq % ring->capacity) * BINARY_RECORD_SIZE], reading);
+     ring->head = seq + 1;
+     uu_atomic_store_u64(&ring->header->head, ring->head);
+}
+
+void ring_file_print_stats(RingFile *ring, FILE *out)
+{
+     uu_mutex_lock(&ring->mutex);
+     uint64_t syncs = ring->syncs;
+     int64_t sync_ns_max = ring->sync_ns_max;
+     int sync_errors = ring->sync_errors;
+     uu_mutex_unlock(&ring->mutex);
+     uint64_t head = ring->head;
+     uint64_t tail = head > ring->capacity ? head - ring->capacity : 0;
+     fprintf(out, "ring %s\trecords=%llu capacity=%llu head=%llu syncs=%llu sync_max_us=%.0f sync_errors=%d\n",
+             ring->path, (unsigned long long)(head - tail), (unsigned long long)ring->capacity,
+             (unsigned long long)head, (unsigned long long)syncs, sync_ns_max / 1e3, sync_errors);
+}
+
+void ring_file_close(RingFile *ring)
+{
+     uu_mutex_lock(&ring->mutex);
+     ring->stopping = 1;
+     uu_mutex_unlock(&ring->mutex);
+     uu_thread_join(&ring->sync_thread);
+     ring_file_sync(ring);
+     uu_mutex_destroy(&ring->mutex);
+     uu_unmap_file(&ring->mapping);
+}
+
+// Writes the records of a ring file in time order, with the given
+// serializer, to fd, and the number of records overwritten while dumping, so
+// left out, to *lost_records. The file may be in use by a running reader.
+// after_copy, when given, is called after each chunk is copied: the
+// self-check overwrites records there.
+static int ring_file_dump_counting(char const *path, OutputSerializer const *serializer, int fd, uint64_t *lost_records,
+                                   void (*after_copy)(void *), void *after_copy_arg)
+{
+     UU_FileMapping mapping;
+     if (uu_map_file_for_reading(&mapping, path) != 0) {
+          fprintf(stderr, "ERROR: could not map ring file %s\n", path);
+          return -1;
+     }
+     RingFileHeader const *header = mapping.data;
+     uint8_t const *records = (uint8_t const *)mapping.data + RING_FILE_HEADER_SIZE;
+     if (mapping.size < RING_FILE_HEADER_SIZE ||
+         0 != memcmp(header->magic, RING_FILE_MAGIC, sizeof RING_FILE_MAGIC) ||
+         header->version != RING_FILE_VERSION || header->record_size != BINARY_RECORD_SIZE ||
+         RING_FILE_HEADER_SIZE + header->capacity * BINARY_RECORD_SIZE > (uint64_t)mapping.size) {
+          fprintf(stderr, "ERROR: %s is not a ring file\n", path);
+          uu_unmap_file(&mapping);
+          return -1;
+     }
+     uint64_t capacity = header->capacity;
+
+     OutputWriter writer;
+     if (output_writer_init(&writer, fd, serializer, OUTPUT_DEFAULT_BUFFER_SIZE) != 0) {
+          uu_unmap_file(&mapping);
+          return -1;
+     }
+     output_writer_header(&writer);
+
+     // copy in chunks, and keep of each chunk only what was not overwritten
+     // while copying it
+     enum { CHUNK_RECORDS = 4096 };
+     static uint8_t chunk[CHUNK_RECORDS * BINARY_RECORD_SIZE];
+     uint64_t seq = uu_atomic_load_u64(&header->tail);
+     uint64_t head = uu_atomic_load_u64(&header->head);
+     uint64_t lost = 0;
+     while (seq < head) {
+          uint64_t n = head - seq < CHUNK_RECORDS ? head - seq : CHUNK_RECORDS;
+          for (uint64_t i = 0; i < n; i++) {
+               memcpy(&chunk[i * BINARY_RECORD_SIZE], &records[((seq + i) % capacity) * BINARY_RECORD_SIZE], BINARY_RECORD_SIZE);
+          }
+          if (after_copy) after_copy(after_copy_arg);
+          uu_atomic_fence();
+          uint64_t tail = uu_atomic_load_u64(&header->tail);
+          uint64_t skip = tail > seq ? (tail - seq < n ? tail - seq : n) : 0;
+          lost += skip;
+          for (uint64_t i = skip; i < n; i++) {
+               Reading reading;
+               binary_unpack_reading(&chunk[i * BINARY_RECORD_SIZE], &reading);
+               output_writer_append(&writer, &reading);
+          }
+          seq += n;
+          if (seq < tail) {
+               lost += tail - seq;
+               seq = tail;
+          }
+     }
+     int rc = output_writer_flush(&writer);
+     output_writer_destroy(&writer);
+     uu_unmap_file(&mapping);
+     *lost_records = lost;
+     return rc;
+}
+
+int ring_file_dump(char const *path, OutputSerializer const *serializer, int fd)
+{
+     uint64_t lost = 0;
+     int rc = ring_file_dump_counting(path, serializer, fd, &lost, NULL, NULL);
+     if (lost) fprintf(stderr, "%s: %llu records were overwritten while dumping\n", path, (unsigned long long)lost);
+     return rc;
+}
+
+//
+// Self-check: the wrap-around, resuming, and dumping while the records being
+// dumped are overwritten
+//
+
+enum { RING_CHECK_CAPACITY = 1000 };
+enum { RING_CHECK_CONCURRENT_CAPACITY = 64 }; // small, so that the writer laps the dump
+enum { RING_CHECK_CONCURRENT_DUMPS = 1000 };
+static int64_t const RING_CHECK_FIRST_SECOND = 1700000000;
+
+typedef struct RingCheck
+{
+     char const *path;
+     char const *dump_path;
+     RingFile ring;
+     uint64_t appended;
+     uint64_t overwrite_after_copy; // readings appended after a chunk is copied, once
+     uint64_t volatile concurrent_appended; // by the writer thread
+     uint64_t volatile stopping;
+     uint64_t dumped;
+     uint64_t skipped;
+     uint64_t wrong;
+} RingCheck;
+
+// Reading number i: its time and value both tell i
+static void ring_check_reading(uint64_t i, Reading *reading)
+{
+     memset(reading, 0, sizeof *reading);
+     reading->time_unix_ns = (RING_CHECK_FIRST_SECOND + (int64_t)i) * NS_PER_SECOND;
+     reading->kind = ReadingKind_CO2;
+     reading->co2_in_ppm = (int32_t)(i % 100000);
+}
+
+static void ring_check_append(RingCheck *check, uint64_t n)
+{
+     for (uint64_t i = 0; i < n; i++) {
+          Reading reading;
+          ring_check_reading(check->appended++, &reading);
+          ring_file_append(&check->ring, &reading);
+     }
+}
+
+static void ring_check_overwrite(void *arg)
+{
+     RingCheck *check = arg;
+     ring_check_append(check, check->overwrite_after_copy);
+     check->overwrite_after_copy = 0;
+}
+
+static void ring_check_write_run(void *arg)
+{
+     RingCheck *check = arg;
+     while (!uu_atomic_load_u64(&check->stopping)) {
+          ring_check_append(check, 1);
+          uu_atomic_store_u64(&check->concurrent_appended, check->appended);
+     }
+}
+
+// Dumps the ring file and checks that it holds readings of
+// ring_check_reading, in order, none before oldest. With last >= 0, exactly
+// those from oldest to last, with lost_expected records overwritten while
+// dumping.
+static void ring_check_dump(RingCheck *check, uint64_t oldest, int64_t last, uint64_t lost_expected)
+{
+     OutputSerializer const *serializer = output_serializer_find("binary");
+     int fd = uu_open_for_writing(check->dump_path);
+     uint64_t lost = 0;
+     if (fd < 0 || ring_file_dump_counting(check->path, serializer, fd, &lost, ring_check_overwrite, check) != 0) {
+          fprintf(stderr, "ERROR: could not dump %s to %s\n", check->path, check->dump_path);
+          check->wrong++;
+          if (fd >= 0) uu_close(fd);
+          return;
+     }
+     uu_close(fd);
+     check->skipped += lost;
+     fd = uu_open_for_reading(check->dump_path);
+     int64_t size = fd >= 0 ? uu_file_size(fd) : -1;
+     uint8_t *data = size > 0 ? malloc(size) : NULL;
+     if (!data || uu_read_full(fd, data, size) != size) {
+          fprintf(stderr, "ERROR: could not read back %s\n", check->dump_path);
+          check->wrong++;
+          free(data);
+          if (fd >= 0) uu_close(fd);
+          return;
+     }
+     uu_close(fd);
+     uint64_t n = (uint64_t)(size - serializer->header_size) / BINARY_RECORD_SIZE;
+     uint64_t wrong = 0;
+     int64_t previous = (int64_t)oldest - 1;
+     for (uint64_t r = 0; r < n; r++) {
+          Reading reading, expected;
+          binary_unpack_reading(&data[serializer->header_size + r * BINARY_RECORD_SIZE], &reading);
+          int64_t i = reading.time_unix_ns / NS_PER_SECOND - RING_CHECK_FIRST_SECOND;
+          ring_check_reading(i > previous ? (uint64_t)i : 0, &expected);
+          int ok = i > previous && reading.time_unix_ns == expected.time_unix_ns && reading.kind == expected.kind
+                   && reading.co2_in_ppm == expected.co2_in_ppm && (last < 0 || i == (int64_t)(oldest + r));
+          if (!ok && !wrong) fprintf(stderr, "ERROR: record %llu of the dump of %s is reading %lld\n", (unsigned long long)r, check->path, (long long)i);
+          wrong += !ok;
+          previous = i;
+     }
+     if (last >= 0 && (n != (uint64_t)(last + 1 - (int64_t)oldest) || lost != lost_expected)) {
+          fprintf(stderr, "ERROR: the dump of %s has %llu records, %llu overwritten, expected %lld and %llu\n", check->path,
+                  (unsigned long long)n, (unsigned long long)lost, (long long)(last + 1 - (int64_t)oldest), (unsigned long long)lost_expected);
+          wrong++;
+     }
+     check->dumped += n;
+     check->wrong += wrong;
+     free(data);
+}
+
+// Runs the checks with files in dir. Returns 0 when all pass.
+int ring_file_check(char const *dir)
+{
+     char path[1024], dump_path[1024];
+     snprintf(path, sizeof path, "%s/co2_check.ring", dir);
+     snprintf(dump_path, sizeof dump_path, "%s/co2_check_ring.bin", dir);
+     static RingCheck check;
+     memset(&check, 0, sizeof check);
+     check.path = path;
+     check.dump_path = dump_path;
+     remove(path);
+
+     // wrap-around: 2.5 times the capacity, then resuming after a reopen
+     enum { C = RING_CHECK_CAPACITY };
+     int64_t size = RING_FILE_HEADER_SIZE + (int64_t)C * BINARY_RECORD_SIZE;
+     if (ring_file_open(&check.ring, path, size, RING_FILE_DEFAULT_SYNC_INTERVAL_MS) != 0) return -1;
+     ring_check_append(&check, C / 2);
+     ring_check_dump(&check, 0, C / 2 - 1, 0);
+     ring_check_append(&check, 2 * C);
+     ring_file_close(&check.ring);
+     ring_check_dump(&check, 3 * C / 2, 5 * C / 2 - 1, 0);
+     if (ring_file_open(&check.ring, path, size, RING_FILE_DEFAULT_SYNC_INTERVAL_MS) != 0) return -1;
+     ring_check_append(&check, 10);
+     ring_check_dump(&check, 3 * C / 2 + 10, 5 * C / 2 + 9, 0);
+
+     // records overwritten between copying them and checking the tail are
+     // left out: some, then all of them and those after
+     check.overwrite_after_copy = 300;
+     ring_check_dump(&check, 3 * C / 2 + 310, 5 * C / 2 + 9, 300);
+     check.overwrite_after_copy = 3 * C / 2;
+     ring_check_dump(&check, 3 * C + 310, 3 * C + 309, 3 * C / 2);
+     ring_check_dump(&check, 3 * C + 310, 4 * C + 309, 0);
+     ring_file_close(&check.ring);
+     remove(path);
+
+     // dumps while a thread writes as fast as it can
+     check.appended = 0;
+     size = RING_FILE_HEADER_SIZE + (int64_t)RING_CHECK_CONCURRENT_CAPACITY * BINARY_RECORD_SIZE;
+     if (ring_file_open(&check.ring, path, size, RING_FILE_DEFAULT_SYNC_INTERVAL_MS) != 0) return -1;
+     UU_Thread writer;
+     if (uu_thread_start(&writer, ring_check_write_run, &check) != 0) {
+          fprintf(stderr, "ERROR: could not start the writer thread\n");
+          return -1;
+     }
+     for (int i = 0; i < RING_CHECK_CONCURRENT_DUMPS; i++) {
+          uint64_t appended = uu_atomic_load_u64(&check.concurrent_appended);
+          ring_check_dump(&check, appended > RING_CHECK_CONCURRENT_CAPACITY ? appended - RING_CHECK_CONCURRENT_CAPACITY : 0, -1, 0);
+     }
+     uu_atomic_store_u64(&check.stopping, 1);
+     uu_thread_join(&writer);
+     ring_file_close(&check.ring);
+     remove(path);
+     remove(dump_path);
+
+     fprintf(stderr, "check\tring\t%llu records dumped, %llu skipped as overwritten while dumping, %llu wrong\n",
+             (unsigned long long)check.dumped, (unsigned long long)check.skipped, (unsigned long long)check.wrong);
+     return check.wrong ? -1 : 0;
+}
@@ -0,0 +1,625 @@
+// Rollup files
+//
+// Alongside the raw output, the reader appends per minute and per hour
+// aggregates of every channel (CO2 ppm, temperature) to two compact files,
+// <prefix>-1m.rollup and <prefix>-1h.rollup. A record is appended when its
+// bucket closes, that is when a report of a later bucket arrives, and on
+// exit. A year of hourly records of both channels is about 840KiB.
+//
+// Records combine exactly: count, sums, min and max add up, first and last
+// come from the earliest and latest record. A bucket cut in two by a restart
+// has two records, which the readers of the files merge.
+//
+// A file is a 16 bytes header, the magic CO2ROL1\n, the step in seconds and
+// the record size as u32, followed by fixed size little-endian records of
+// ROLLUP_RECORD_SIZE bytes:
+//
+// | offset | type      | field                                    |
+// +--------+-----------+------------------------------------------+
+// | 0      | i64       | start of the bucket, unix seconds        |
+// | 8      | u8        | channel (ReadingKind)                    |
+// | 9      | u8[3]     | zero                                     |
+// | 12     | u32       | count                                    |
+// | 16     | f32       | min                                      |
+// | 20     | f32       | max                                      |
+// | 24     | f32       | first                                    |
+// | 28     | f32       | last                                     |
+// | 32     | f64       | sum                                      |
+// | 40     | f64       | sum of squares                           |
+//
+// rollup-rebuild regenerates the files from raw tsv or binary outputs, and
+// rollup-dump writes a file as tsv.
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static char const ROLLUP_MAGIC[8] = { 'C', 'O', '2', 'R', 'O', 'L', '1', '\n' };
+enum { ROLLUP_HEADER_SIZE = 16 };
+enum { ROLLUP_RECORD_SIZE = 48 };
+enum { NumRollupLevels = 2 };
+
+static int64_t const ROLLUP_STEPS[NumRollupLevels] = { 60, 3600 };
+static char const *ROLLUP_SUFFIXES[NumRollupLevels] = { "-1m.rollup", "-1h.rollup" };
+
+typedef struct RollupRecord
+{
+     int64_t start_second;
+     uint8_t kind; // ReadingKind_CO2 or ReadingKind_Temperature
+     uint32_t count;
+     float min;
+     float max;
+     float first;
+     float last;
+     double sum;
+     double sum_sq;
+} RollupRecord;
+
+typedef struct RollupSet
+{
+     RollupRecord open[NumRollupLevels][2]; // per level and channel, count 0 when none
+     WindowStream streams[NumRollupLevels];
+} RollupSet;
+
+static void rollup_pack_record(uint8_t dst[ROLLUP_RECORD_SIZE], RollupRecord const *record)
+{
+     memset(dst, 0, ROLLUP_RECORD_SIZE);
+     binary_put_u64(&dst[0], (uint64_t)record->start_second);
+     dst[8] = record->kind;
+     binary_put_u32(&dst[12], record->count);
+     float const floats[4] = { record->min, record->max, record->first, record->last };
+     for (int i = 0; i < 4; i++) {
+          uint32_t bits;
+          memcpy(&bits, &floats[i], sizeof bits);
+          binary_put_u32(&dst[16 + 4 * i], bits);
+     }
+     double const doubles[2] = { record->sum, record->sum_sq };
+     for (int i = 0; i < 2; i++) {
+          uint64_t bits;
+          memcpy(&bits, &doubles[i], sizeof bits);
+          binary_put_u64(&dst[32 + 8 * i], bits);
+     }
+}
+
+static void rollup_unpack_record(uint8_t const src[ROLLUP_RECORD_SIZE], RollupRecord *record)
+{
+     record->start_second = (int64_t)binary_get_u64(&src[0]);
+     record->kind = src[8];
+     record->count = binary_get_u32(&src[12]);
+     float *floats[4] = { &record->min, &record->max, &record->first, &record->last };
+     for (int i = 0; i < 4; i++) {
+          uint32_t bits = binary_get_u32(&src[16 + 4 * i]);
+          memcpy(floats[i], &bits, sizeof bits);
+     }
+     double *doubles[2] = { &record->sum, &record->sum_sq };
+     for (int i = 0; i < 2; i++) {
+          uint64_t bits = binary_get_u64(&src[32 + 8 * i]);
+          memcpy(doubles[i], &bits, sizeof bits);
+     }
+}
+
+static void rollup_pack_header(uint8_t dst[ROLLUP_HEADER_SIZE], int64_t step_seconds)
+{
+     memcpy(dst, ROLLUP_MAGIC, sizeof ROLLUP_MAGIC);
+     binary_put_u32(&dst[8], (uint32_t)step_seconds);
+     binary_put_u32(&dst[12], ROLLUP_RECORD_SIZE);
+}
+
+// Adds later, a record of the same bucket and channel, into record
+static void rollup_combine(RollupRecord *record, RollupRecord const *later)
+{
+     if (!record->count) {
+          *record = *later;
+          return;
+     }
+     record->count += later->count;
+     if (later->min < record->min) record->min = later->min;
+     if (later->max > record->max) record->max = later->max;
+     record->last = later->last;
+     record->sum += later->sum;
+     record->sum_sq += later->sum_sq;
+}
+
+//
+// Building
+//
+
+// Adds a report to the open record of its bucket. When the report belongs to
+// a later bucket, the open record is moved to *closed and 1 returned.
+static int rollup_add(RollupRecord *open, int64_t step_seconds, ReadingKind kind, int64_t second, float value,
+                      RollupRecord *closed)
+{
+     int64_t start = second - second % step_seconds;
+     int has_closed = 0;
+     if (open->count && start > open->start_second) {
+          *closed = *open;
+          open->count = 0;
+          has_closed = 1;
+     }
+     if (!open->count) {
+          *open = (RollupRecord){ .start_second = start, .kind = kind, .min = value, .max = value, .first = value };
+     }
+     // a clock set back stays in the open bucket
+     open->count++;
+     if (value < open->min) open->min = value;
+     if (value > open->max) open->max = value;
+     open->last = value;
+     open->sum += value;
+     open->sum_sq += (double)value * value;
+     return has_closed;
+}
+
+static int rollup_channel_index(ReadingKind kind)
+{
+     return kind == ReadingKind_CO2 ? 0 : kind == ReadingKind_Temperature ? 1 : -1;
+}
+
+// Opens path for appending records of step_seconds: creates it with its
+// header, or after checking the header of an existing file, cuts off a torn
+// last record. Returns the fd or -1, errors reported on standard error.
+static int rollup_open_file(char const *path, int64_t step_seconds)
+{
+     int fd = uu_open_for_updating(path, 0);
+     if (fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for writing.\n", path);
+          return -1;
+     }
+     int64_t size = uu_file_size(fd);
+     uint8_t header[ROLLUP_HEADER_SIZE], expected[ROLLUP_HEADER_SIZE];
+     rollup_pack_header(expected, step_seconds);
+     if (size < ROLLUP_HEADER_SIZE) {
+          if (uu_truncate(fd, 0) != 0 || uu_seek(fd, 0) != 0 || uu_write_all(fd, expected, sizeof expected) != 0) {
+               fprintf(stderr, "ERROR: could not write %s\n", path);
+               uu_close(fd);
+               return -1;
+          }
+          return fd;
+     }
+     if (uu_seek(fd, 0) != 0 || uu_read_full(fd, header, sizeof header) != (int64_t)sizeof header
+         || memcmp(header, expected, sizeof header) != 0) {
+          fprintf(stderr, "ERROR: %s is not a rollup file of %llds records\n", path, (long long)step_seconds);
+          uu_close(fd);
+          return -1;
+     }
+     int64_t keep = size - (size - ROLLUP_HEADER_SIZE) % ROLLUP_RECORD_SIZE;
+     if ((keep != size && uu_truncate(fd, keep) != 0) || uu_seek(fd, keep) != 0) {
+          fprintf(stderr, "ERROR: could not recover %s\n", path);
+          uu_close(fd);
+          return -1;
+     }
+     return fd;
+}
+
+// Opens <prefix>-1m.rollup and <prefix>-1h.rollup for appending, written by
+// threads of their own. Errors are reported on standard error.
+int rollup_set_open(RollupSet *set, char const *prefix)
+{
+     memset(set, 0, sizeof *set);
+     for (int level = 0; level < NumRollupLevels; level++) {
+          char path[1024];
+          snprintf(path, sizeof path, "%s%s", prefix, ROLLUP_SUFFIXES[level]);
+          int fd = rollup_open_file(path, ROLLUP_STEPS[level]);
+          if (fd < 0 || window_stream_open(&set->streams[level], fd, "rollup") != 0) return -1;
+     }
+     return 0;
+}
+
+static void rollup_set_write(RollupSet *set, int level, RollupRecord const *record)
+{
+     uint8_t packed[ROLLUP_RECORD_SIZE];
+     rollup_pack_record(packed, record);
+     window_stream_write(&set->streams[level], (char const *)packed, sizeof packed);
+}
+
+// Called with every decoded report of a channel, whether or not it is output
+void rollup_set_add(RollupSet *set, Reading const *reading)
+{
+     int c = rollup_channel_index(reading->kind);
+     if (c < 0) return;
+     int64_t second = reading->time_unix_ns / NS_PER_SECOND;
+     float value = reading->kind == ReadingKind_CO2 ? (float)reading->co2_in_ppm : reading->temperature_in_C;
+     for (int level = 0; level < NumRollupLevels; level++) {
+          RollupRecord closed;
+          if (rollup_add(&set->open[level][c], ROLLUP_STEPS[level], reading->kind, second, value, &closed)) {
+               rollup_set_write(set, level, &closed);
+          }
+     }
+}
+
+// Writes the open buckets, then closes the files
+void rollup_set_close(RollupSet *set)
+{
+     for (int level = 0; level < NumRollupLevels; level++) {
+          for (int c = 0; c < 2; c++) {
+               if (set->open[level][c].count) rollup_set_write(set, level, &set->open[level][c]);
+          }
+          window_stream_close(&set->streams[level]);
+     }
+}
+
+//
+// Rebuild from raw outputs
+//
+
+typedef struct RollupRebuild
+{
+     RollupRecord open[NumRollupLevels][2];
+     FILE *files[NumRollupLevels];
+     uint64_t num_readings;
+     TsvTimeCache time_cache;
+} RollupRebuild;
+
+static int rollup_rebuild_write(RollupRebuild *rebuild, int level, RollupRecord const *record)
+{
+     uint8_t packed[ROLLUP_RECORD_SIZE];
+     rollup_pack_record(packed, record);
+     return fwrite(packed, sizeof packed, 1, rebuild->files[level]) == 1 ? 0 : -1;
+}
+
+static int rollup_rebuild_add(RollupRebuild *rebuild, Reading const *reading)
+{
+     int c = rollup_channel_index(reading->kind);
+     if (c < 0) return 0;
+     rebuild->num_readings++;
+     int64_t second = reading->time_unix_ns / NS_PER_SECOND;
+     float value = reading->kind == ReadingKind_CO2 ? (float)reading->co2_in_ppm : reading->temperature_in_C;
+     for (int level = 0; level < NumRollupLevels; level++) {
+          RollupRecord closed;
+          if (rollup_add(&rebuild->open[level][c], ROLLUP_STEPS[level], reading->kind, second, value, &closed)) {
+               if (rollup_rebuild_write(rebuild, level, &closed) != 0) return -1;
+          }
+     }
+     return 0;
+}
+
+static int rollup_rebuild_file(RollupRebuild *rebuild, char const *path)
+{
+     int fd = uu_open_for_reading(path);
+     if (fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for reading.\n", path);
+          return -1;
+     }
+     enum { CHUNK_SIZE = 1 << 20 };
+     static char buffer[CHUNK_SIZE + OUTPUT_MAX_RECORD_SIZE];
+     size_t used = 0; // bytes carried over from the previous chunk
+     int is_binary = -1;
+     int rc = 0;
+     for (;;) {
+          int64_t size = uu_read_full(fd, buffer + used, CHUNK_SIZE);
+          if (size < 0) {
+               fprintf(stderr, "ERROR: could not read %s\n", path);
+               rc = -1;
+               break;
+          }
+          size_t end = used + (size_t)size;
+          size_t start = 0;
+          if (is_binary < 0 && end >= sizeof BINARY_MAGIC) {
+               is_binary = 0 == memcmp(buffer, BINARY_MAGIC, sizeof BINARY_MAGIC);
+               if (is_binary) start = sizeof BINARY_MAGIC;
+          }
+          if (is_binary == 1) {
+               for (; start + BINARY_RECORD_SIZE <= end && rc == 0; start += BINARY_RECORD_SIZE) {
+                    Reading reading;
+                    binary_unpack_reading((uint8_t const *)buffer + start, &reading);
+                    rc = rollup_rebuild_add(rebuild, &reading);
+               }
+          } else {
+               while (start < end && rc == 0) {
+                    Reading reading;
+                    char const *next = tsv_parse_reading(buffer + start, buffer + end, &rebuild->time_cache, &reading);
+                    if (next) {
+                         rc = rollup_rebuild_add(rebuild, &reading);
+                    } else {
+                         // not a reading, or cut by the end of the chunk
+                         next = memchr(buffer + start, '\n', end - start);
+                         if (!next && size > 0) break;
+                         next = next ? next + 1 : buffer + end;
+                    }
+                    start = next - buffer;
+               }
+          }
+          if (rc != 0 || size == 0) break;
+          used = end - start;
+          if (used > OUTPUT_MAX_RECORD_SIZE) {
+               fprintf(stderr, "ERROR: %s is neither tsv nor binary output\n", path);
+               rc = -1;
+               break;
+          }
+          memmove(buffer, buffer + start, used);
+     }
+     uu_close(fd);
+     return rc;
+}
+
+// Regenerates <prefix>-1m.rollup and <prefix>-1h.rollup from raw outputs, in
+// time order, replacing them once complete.
+int rollup_rebuild(char const *prefix, char const *const *paths, int num_paths)
+{
+     static RollupRebuild rebuild;
+     char paths_tmp[NumRollupLevels][1024];
+     int rc = 0;
+     for (int level = 0; level < NumRollupLevels; level++) {
+          snprintf(paths_tmp[level], sizeof paths_tmp[level], "%s%s.tmp", prefix, ROLLUP_SUFFIXES[level]);
+          rebuild.files[level] = fopen(paths_tmp[level], "wb");
+          if (!rebuild.files[level]) {
+               fprintf(stderr, "ERROR: could not open %s for writing.\n", paths_tmp[level]);
+               return -1;
+          }
+          uint8_t header[ROLLUP_HEADER_SIZE];
+          rollup_pack_header(header, ROLLUP_STEPS[level]);
+          if (fwrite(header, sizeof header, 1, rebuild.files[level]) != 1) rc = -1;
+     }
+     for (int i = 0; rc == 0 && i < num_paths; i++) rc = rollup_rebuild_file(&rebuild, paths[i]);
+     for (int level = 0; level < NumRollupLevels; level++) {
+          for (int c = 0; c < 2; c++) {
+               if (rc == 0 && rebuild.open[level][c].count) rc = rollup_rebuild_write(&rebuild, level, &rebuild.open[level][c]);
+          }
+          if (fclose(rebuild.files[level]) != 0) rc = -1;
+     }
+     for (int level = 0; level < NumRollupLevels; level++) {
+          char path[1024];
+          snprintf(path, sizeof path, "%s%s", prefix, ROLLUP_SUFFIXES[level]);
+          if (rc != 0) {
+               remove(paths_tmp[level]);
+               continue;
+          }
+#if defined(WIN32)
+          remove(path);
+#endif
+          if (rename(paths_tmp[level], path) != 0) {
+               fprintf(stderr, "ERROR: could not replace %s\n", path);
+               rc = -1;
+          }
+     }
+     if (rc == 0) fprintf(stderr, "rollup: %llu readings\n", (unsigned long long)rebuild.num_readings);
+     return rc;
+}
+
+//
+// Dump
+//
+
+static void rollup_dump_record(FILE *out, OutputTimeCache *time_cache, int64_t step_seconds, RollupRecord const *record)
+{
+     char line[OUTPUT_MAX_RECORD_SIZE];
+     Reading reading = { .time_unix_ns = record->start_second * NS_PER_SECOND };
+     char *dst = output_append_time(line, time_cache, &reading);
+     *dst++ = '\t';
+     dst = output_append_string(dst, record->kind == ReadingKind_CO2 ? "CO2" : "Temperature");
+     double mean = record->sum / record->count;
+     double variance = record->sum_sq / record->count - mean * mean;
+     dst += snprintf(dst, line + sizeof line - dst, "\t%lld\t%u\t%f\t%f\t%f\t%f\t%f\t%f\n", (long long)step_seconds,
+                     record->count, mean, variance > 0 ? sqrt(variance) : 0.0, record->min, record->max,
+                     record->first, record->last);
+     fwrite(line, 1, dst - line, out);
+}
+
+// Writes the records of a rollup file as tsv, the ones of the same bucket
+// and channel merged.
+int rollup_dump(char const *path, FILE *out)
+{
+     int fd = uu_open_for_reading(path);
+     if (fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for reading.\n", path);
+          return -1;
+     }
+     uint8_t header[ROLLUP_HEADER_SIZE];
+     if (uu_read_full(fd, header, sizeof header) != (int64_t)sizeof header || memcmp(header, ROLLUP_MAGIC, sizeof ROLLUP_MAGIC) != 0
+         || binary_get_u32(&header[12]) != ROLLUP_RECORD_SIZE) {
+          fprintf(stderr, "ERROR: %s is not a rollup file\n", path);
+          uu_close(fd);
+          return -1;
+     }
+     int64_t step_seconds = binary_get_u32(&header[8]);
+     fputs("Time\tChannel\tStep\tCount\tMean\tStddev\tMin\tMax\tFirst\tLast\n", out);
+     OutputTimeCache time_cache = {0};
+     RollupRecord pending[2] = {0}; // per channel
+     static uint8_t records[ROLLUP_RECORD_SIZE * 4096];
+     int64_t size;
+     while ((size = uu_read_full(fd, records, sizeof records)) > 0) {
+          for (int64_t offset = 0; offset + ROLLUP_RECORD_SIZE <= size; offset += ROLLUP_RECORD_SIZE) {
+               RollupRecord record;
+               rollup_unpack_record(records + offset, &record);
+               int c = rollup_channel_index((ReadingKind)record.kind);
+               if (c < 0 || !record.count) continue;
+               if (pending[c].count && pending[c].start_second != record.start_second) {
+                    rollup_dump_record(out, &time_cache, step_seconds, &pending[c]);
+                    pending[c].count = 0;
+               }
+               rollup_combine(&pending[c], &record);
+          }
+     }
+     for (int c = 0; c < 2; c++) {
+          if (pending[c].count) rollup_dump_record(out, &time_cache, step_seconds, &pending[c]);
+     }
+     uu_close(fd);
+     return size < 0 ? -1 : 0;
+}
+
+//
+// Self-check, a rebuild against the incremental files
+//
+
+enum { ROLLUP_CHECK_READINGS = 200000 };
+
+static int rollup_check_compare_records(void const *a, void const *b)
+{
+     RollupRecord const *x = a, *y = b;
+     if (x->start_second != y->start_second) return x->start_second < y->start_second ? -1 : 1;
+     return (int)x->kind - (int)y->kind;
+}
+
+// Loads the records of a rollup file, the ones of the same bucket and channel
+// merged as rollup_dump does, sorted by bucket then channel: around a restart,
+// the channels can come in another order. Returns their number, or -1.
+static int rollup_check_load(char const *path, RollupRecord **records)
+{
+     int fd = uu_open_for_reading(path);
+     int64_t size = fd < 0 ? -1 : uu_file_size(fd);
+     uint8_t *data = size >= ROLLUP_HEADER_SIZE ? malloc(size) : NULL;
+     *records = size >= ROLLUP_HEADER_SIZE ? malloc((size / ROLLUP_RECORD_SIZE + 1) * sizeof **records) : NULL;
+     if (!data || !*records || uu_read_full(fd, data, size) != size) {
+          fprintf(stderr, "ERROR: could not read %s\n", path);
+          if (fd >= 0) uu_close(fd);
+          free(data);
+          free(*records);
+          *records = NULL;
+          return -1;
+     }
+     uu_close(fd);
+     RollupRecord pending[2] = {0}; // per channel
+     int n = 0;
+     for (int64_t offset = ROLLUP_HEADER_SIZE; offset + ROLLUP_RECORD_SIZE <= size; offset += ROLLUP_RECORD_SIZE) {
+          RollupRecord record;
+          rollup_unpack_record(data + offset, &record);
+          int c = rollup_channel_index((ReadingKind)record.kind);
+          if (c < 0 || !record.count) continue;
+          if (pending[c].count && pending[c].start_second != record.start_second) {
+               (*records)[n++] = pending[c];
+               pending[c].count = 0;
+          }
+          rollup_combine(&pending[c], &record);
+     }
+     for (int c = 0; c < 2; c++) {
+          if (pending[c].count) (*records)[n++] = pending[c];
+     }
+     free(data);
+     qsort(*records, n, sizeof **records, rollup_check_compare_records);
+     return n;
+}
+
+static int rollup_check_same_sum(double actual, double expected)
+{
+     return fabs(actual - expected) <= 1e-9 * (fabs(expected) + 1);
+}
+
+// Compares the records of two rollup files. Returns the number of records
+// that differ, or -1 when a file cannot be read.
+static int64_t rollup_check_compare(char const *path, char const *rebuilt_path, int *num_records)
+{
+     RollupRecord *expected, *actual;
+     int n = rollup_check_load(path, &expected);
+     if (n < 0) return -1;
+     int m = rollup_check_load(rebuilt_path, &actual);
+     if (m < 0) {
+          free(expected);
+          return -1;
+     }
+     int64_t wrong = n > m ? n - m : m - n;
+     for (int i = 0; i < n && i < m; i++) {
+          RollupRecord const *a = &actual[i], *e = &expected[i];
+          int ok = a->start_second == e->start_second && a->kind == e->kind && a->count == e->count && a->min == e->min
+                   && a->max == e->max && a->first == e->first && a->last == e->last
+                   && rollup_check_same_sum(a->sum, e->sum) && rollup_check_same_sum(a->sum_sq, e->sum_sq);
+          if (!ok && !wrong) {
+               fprintf(stderr, "ERROR: %s record %d: %lld %s count %u min %f max %f first %f last %f sum %f, "
+                       "rebuilt %lld %s count %u min %f max %f first %f last %f sum %f\n", path, i,
+                       (long long)e->start_second, e->kind == ReadingKind_CO2 ? "CO2" : "Temperature", e->count, e->min,
+                       e->max, e->first, e->last, e->sum, (long long)a->start_second,
+                       a->kind == ReadingKind_CO2 ? "CO2" : "Temperature", a->count, a->min, a->max, a->first, a->last,
+                       a->sum);
+          }
+          wrong += !ok;
+     }
+     *num_records = n;
+     free(expected);
+     free(actual);
+     return wrong;
+}
+
+// Builds the rollup files of a stream of readings incrementally, with a
+// restart in the middle, and writes the same readings as raw outputs, tsv
+// then binary. A rebuild from the outputs must give the same records, once
+// those of a bucket cut by the restart are merged. The stream has gaps of
+// hours and a clock set back now and then. Files go to dir. Returns 0 when
+// it passes.
+int rollup_check(char const *dir)
+{
+     char prefix[1024], rebuilt_prefix[1024], raw_paths[2][1024];
+     snprintf(prefix, sizeof prefix, "%s/co2_check", dir);
+     snprintf(rebuilt_prefix, sizeof rebuilt_prefix, "%s/co2_check_rebuilt", dir);
+     snprintf(raw_paths[0], sizeof raw_paths[0], "%s/co2_check_rollup.tsv", dir);
+     snprintf(raw_paths[1], sizeof raw_paths[1], "%s/co2_check_rollup.bin", dir);
+     char const *serializers[2] = { "tsv", "binary" };
+     char paths[NumRollupLevels][1024], rebuilt_paths[NumRollupLevels][1024];
+     for (int level = 0; level < NumRollupLevels; level++) {
+          snprintf(paths[level], sizeof paths[level], "%s/co2_check%s", dir, ROLLUP_SUFFIXES[level]);
+          snprintf(rebuilt_paths[level], sizeof rebuilt_paths[level], "%s/co2_check_rebuilt%s", dir, ROLLUP_SUFFIXES[level]);
+          remove(paths[level]);
+     }
+
+     static RollupSet set;
+     SyntheticSource source;
+     synthetic_source_init(&source, 0, 1);
+     uint32_t random = 1;
+     int64_t time_ns = (int64_t)1700000000 * NS_PER_SECOND;
+     int rc = 0;
+     for (int part = 0; part < 2 && rc == 0; part++) {
+          // the restart and the change of output do not fall together
+          int first = part * ROLLUP_CHECK_READINGS / 2, last = (part + 1) * ROLLUP_CHECK_READINGS / 2;
+          int restart = first + ROLLUP_CHECK_READINGS / 6;
+          OutputWriter writer;
+          int fd = uu_open_for_writing(raw_paths[part]);
+          if (fd < 0) {
+               fprintf(stderr, "ERROR: could not open %s for writing.\n", raw_paths[part]);
+               return -1;
+          }
+          if (output_writer_init(&writer, fd, output_serializer_find(serializers[part]), OUTPUT_DEFAULT_BUFFER_SIZE) != 0) {
+               uu_close(fd);
+               return -1;
+          }
+          output_writer_header(&writer);
+          if (part == 0 && rollup_set_open(&set, prefix) != 0) rc = -1;
+          for (int i = first; i < last && rc == 0; i++) {
+               random = random * 1664525 + 1013904223;
+               uint32_t r = random >> 8;
+               if (i == restart) {
+                    rollup_set_close(&set);
+                    if (rollup_set_open(&set, prefix) != 0) rc = -1;
+                    time_ns += NS_PER_SECOND; // a clock set back across a restart opens an earlier bucket
+               } else if (r % 2000 == 0) {
+                    time_ns += (int64_t)(1 + r / 2000 % 30) * 3600 * NS_PER_SECOND; // a gap
+               } else if (r % 500 == 1) {
+                    time_ns -= (int64_t)(1 + r / 500 % 90) * NS_PER_SECOND; // the clock set back
+               } else if (r % 2) {
+                    time_ns += NS_PER_SECOND + (int64_t)(r / 2 % 1000) * 1000;
+               }
+               Reading reading;
+               synthetic_source_next(&source, &reading);
+               reading.time_unix_ns = time_ns;
+               rollup_set_add(&set, &reading);
+               output_writer_append(&writer, &reading);
+          }
+          if (output_writer_flush(&writer) != 0) {
+               fprintf(stderr, "ERROR: could not write %s\n", raw_paths[part]);
+               rc = -1;
+          }
+          output_writer_destroy(&writer);
+          uu_close(fd);
+     }
+     rollup_set_close(&set);
+
+     char const *const raw[2] = { raw_paths[0], raw_paths[1] };
+     int64_t wrong = 0;
+     int num_records[NumRollupLevels] = {0};
+     if (rc == 0) rc = rollup_rebuild(rebuilt_prefix, raw, 2);
+     for (int level = 0; level < NumRollupLevels && rc == 0; level++) {
+          int64_t level_wrong = rollup_check_compare(paths[level], rebuilt_paths[level], &num_records[level]);
+          if (level_wrong < 0) rc = -1;
+          wrong += level_wrong;
+     }
+     for (int level = 0; level < NumRollupLevels; level++) {
+          remove(paths[level]);
+          remove(rebuilt_paths[level]);
+     }
+     remove(raw_paths[0]);
+     remove(raw_paths[1]);
+     if (rc != 0) return -1;
+     fprintf(stderr, "check\trollup\t%d minute and %d hour records rebuilt, %lld wrong\n", num_records[0],
+             num_records[1], (long long)wrong);
+     return wrong ? -1 : 0;
+}
@@ -0,0 +1,1023 @@
+// Sinks: decode once, write to many destinations
+//
+// The reader pushes every Reading to all sinks. Each sink has its own bounded
+// queue and thread that serializes and writes, so a slow or failing sink
+// never delays the reader nor the other sinks. What happens when a queue is
+// full is decided per sink:
+//
+// - drop-oldest (the default): the oldest queued reading is discarded
+// - spill: readings go to a spill file, in the binary record format, which
+//   the sink thread reads back once it caught up with its queue. The reader
+//   only copies them to a second buffer that a spill thread writes out: the
+//   reader never writes to a file. Readings are dropped when that buffer is
+//   full too, when the disk is slower than the readings.
+// - block, only when asked for: the reader waits for the sink. Nothing is
+//   lost, but this gives up the guarantee above: the reader falls behind
+//   the device, and every other sink waits with it.
+//
+// Targets:
+//
+// - "-": standard output
+// - "|command": standard input of a shell command, e.g. "|gzip -c > co2.tsv.gz"
+// - "tcp:host:port": a TCP connection (not on Windows)
+// - "fwd:host:port": a collector, in compressed frames, spooled while it is
+//   unreachable (see Forwarder, not on Windows)
+// - "mqtt:host:port": an MQTT broker, a topic per channel (see MqttClient,
+//   not on Windows)
+// - "sqlite:path": a SQLite database, in batched transactions (see
+//   SqliteTarget, when built with CO2_SQLITE)
+// - anything else: a file path
+//
+// Commits: by default a sink writes whenever the second of the readings
+// changes, like the original program. With a commit interval and/or a commit
+// size, it instead groups readings into large writes, ending on
+// OUTPUT_ALIGNMENT boundaries when committing by size. Files with a sync
+// policy are made durable at every commit, and are appended to, after
+// cutting off a record torn by a crash, rather than truncated.
+//
+// Files can be indexed, see OutputIndex.
+//
+// With --format arrow, a sink writes an Arrow IPC stream instead (see
+// ArrowBatch): a record batch when --arrow-batch rows are pending, at a
+// commit size, and every commit interval, by default every minute.
+
+#include <assert.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(WIN32)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#endif
+
+typedef enum SinkOverflow
+{
+     SinkOverflow_Block,
+     SinkOverflow_DropOldest,
+     SinkOverflow_Spill,
+     NumSinkOverflows,
+} SinkOverflow;
+
+static char const *SINK_OVERFLOW_NAMES[NumSinkOverflows] = {
+     [SinkOverflow_Block] = "block",
+     [SinkOverflow_DropOldest] = "drop-oldest",
+     [SinkOverflow_Spill] = "spill",
+};
+
+typedef enum SinkKind
+{
+     SinkKind_File,
+     SinkKind_StandardOutput,
+     SinkKind_Command,
+     SinkKind_Tcp,
+     SinkKind_Forward,
+     SinkKind_Mqtt,
+     SinkKind_Sqlite,
+} SinkKind;
+
+typedef struct SinkConfig
+{
+     char const *target;
+     OutputSerializer const *serializer;
+     SinkOverflow overflow;
+     int queue_capacity;
+     int commit_interval_ms; // 0 for none
+     int commit_bytes; // 0 for none
+     int commit_rows; // 0 for the default of the sqlite sink
+     OutputSync sync;
+     int64_t index_every_ns; // 0 for no index
+     int64_t index_every_bytes;
+     int mqtt_qos;
+     int arrow; // --format arrow, instead of serializer
+     int arrow_batch_rows;
+} SinkConfig;
+
+enum { SINK_DEFAULT_QUEUE_CAPACITY = 4096 };
+enum { SINK_MAX_QUEUE_CAPACITY = 1 << 24 }; // 16M readings, the queue is allocated up front
+enum { SINK_BATCH_SIZE = 256 };
+enum { SINK_SPILL_BUFFER_CAPACITY = 65536 }; // readings on their way to the spill file
+enum { SINK_MAX_COUNT = 16 };
+enum { SINK_FORWARD_POLL_MS = 200 };
+enum { SINK_ARROW_COMMIT_INTERVAL_MS = 60000 };
+enum { SINK_CLOSE_TIMEOUT_MS = 5000 }; // to write out the queues at exit
+
+// Counters, protected by the sink's mutex
+typedef struct SinkStats
+{
+     uint64_t enqueued;
+     uint64_t written;
+     uint64_t dropped;
+     uint64_t spilled;
+     uint64_t write_errors;
+     uint64_t max_lag; // in readings
+     OutputCommitStats commit;
+     ForwardStats forward;
+     MqttStats mqtt;
+     SqliteStats sqlite;
+} SinkStats;
+
+// The counters of the metrics (see co2_metrics.c), loaded without the mutex
+typedef struct SinkMetrics
+{
+     uint64_t dropped;
+     uint64_t up; // fwd: and mqtt: connections
+     uint64_t reconnects;
+} SinkMetrics;
+
+typedef struct Sink
+{
+     SinkConfig config;
+     SinkKind kind;
+     int index;
+     int fd;
+     FILE *command_pipe;
+     OutputWriter writer;
+     Forwarder forwarder;
+     MqttClient *mqtt;
+     ArrowBatch arrow;
+     SqliteTarget sqlite;
+
+     UU_Mutex mutex;
+     UU_CondVar not_empty;
+     UU_CondVar not_full;
+     Reading *queue;
+     int queue_head;
+     int queue_count;
+
+     // spill file, written at spill_written by the spill thread and read back
+     // at spill_read by the sink thread, through their own descriptors. The
+     // reader appends to spill_pending, which the spill thread swaps with
+     // spill_writing and writes out.
+     char spill_path[1024];
+     int spill_write_fd;
+     int spill_read_fd;
+     int64_t spill_written;
+     int64_t spill_read;
+     Reading *spill_pending;
+     int spill_pending_count;
+     Reading *spill_writing;
+     int spill_writing_count; // being written, not in spill_written yet
+     UU_CondVar spill_not_empty;
+     UU_Thread spill_thread;
+     int spill_failed; // could not be read back: the sink failed
+
+     int write_header;
+     int closing;
+     int stopped; // the sink thread is done, signaled on not_full
+     int interrupted; // at close, still writing after SINK_CLOSE_TIMEOUT_MS
+     int failed;
+     SinkStats stats;
+     // copies of the counters of SinkMetrics, stored with the mutex held by
+     // whoever updates them, so that the metrics thread never takes it
+     uint64_t volatile metrics_dropped;
+     uint64_t volatile metrics_up;
+     uint64_t volatile metrics_reconnects;
+     uint64_t stats_previous_writes; // for the rates, owned by the stats thread
+     uint64_t stats_previous_rows;
+
+     UU_Thread thread;
+} Sink;
+
+typedef struct SinkSet
+{
+     Sink sinks[SINK_MAX_COUNT];
+     int num_sinks;
+
+     int stats_interval_seconds; // 0 for no stats
+     int stats_stop;
+     int64_t stats_previous_ns;
+     UU_Mutex stats_mutex;
+     UU_Thread stats_thread;
+} SinkSet;
+
+int sink_overflow_from_name(char const *name, SinkOverflow *result)
+{
+     for (int i = 0; i < NumSinkOverflows; i++) {
+          if (0 == strcmp(SINK_OVERFLOW_NAMES[i], name)) {
+               *result = i;
+               return 0;
+          }
+     }
+     return -1;
+}
+
+#if !defined(WIN32)
+static int sink_connect_tcp(char const *host_and_port)
+{
+     char host[256];
+     char const *colon = strrchr(host_and_port, ':');
+     if (!colon || colon == host_and_port || (size_t)(colon - host_and_port) >= sizeof host) return -1;
+     memcpy(host, host_and_port, colon - host_and_port);
+     host[colon - host_and_port] = 0;
+
+     struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+     struct addrinfo *addresses;
+     if (getaddrinfo(host, colon + 1, &hints, &addresses) != 0) return -1;
+     int fd = -1;
+     for (struct addrinfo *address = addresses; address && fd < 0; address = address->ai_next) {
+          fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+          if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+               close(fd);
+               fd = -1;
+          }
+     }
+     freeaddrinfo(addresses);
+     return fd;
+}
+#endif
+
+static int sink_open_target(Sink *sink, char const *spill_dir)
+{
+     char const *target = sink->config.target;
+     if (0 == strcmp(target, "-")) {
+          sink->kind = SinkKind_StandardOutput;
+          sink->fd = 1;
+#if defined(WIN32)
+          _setmode(sink->fd, _O_BINARY);
+#endif
+     } else if (target[0] == '|') {
+          sink->kind = SinkKind_Command;
+#if defined(WIN32)
+          sink->command_pipe = _popen(target + 1, "wb");
+#else
+          sink->command_pipe = popen(target + 1, "w");
+#endif
+          sink->fd = sink->command_pipe ? fileno(sink->command_pipe) : -1;
+     } else if (0 == strncmp(target, "tcp:", 4)) {
+          sink->kind = SinkKind_Tcp;
+#if defined(WIN32)
+          fprintf(stderr, "ERROR: tcp sinks are not supported on Windows\n");
+          sink->fd = -1;
+#else
+          sink->fd = sink_connect_tcp(target + 4);
+#endif
+     } else if (0 == strncmp(target, "fwd:", 4)) {
+          sink->kind = SinkKind_Forward;
+          return forwarder_open(&sink->forwarder, target + 4, spill_dir);
+     } else if (0 == strncmp(target, "mqtt:", 5)) {
+          sink->kind = SinkKind_Mqtt;
+          sink->mqtt = memory_alloc(sizeof *sink->mqtt);
+          if (!sink->mqtt) return -1;
+          return mqtt_client_open(sink->mqtt, target + 5, sink->config.mqtt_qos);
+     } else if (0 == strncmp(target, "sqlite:", 7)) {
+          sink->kind = SinkKind_Sqlite;
+          return sqlite_target_open(&sink->sqlite, target + 7);
+     } else {
+          sink->kind = SinkKind_File;
+          OutputSync sync = sink->config.sync;
+          if (sync == OutputSync_None) {
+               sink->fd = uu_open_for_writing(target);
+          } else {
+               if (sync == OutputSync_OpenDataSync && !uu_has_open_data_sync()) sync = OutputSync_DataSync;
+               sink->fd = uu_open_for_updating(target, sync == OutputSync_OpenDataSync);
+               if (sink->fd < 0) return -1;
+               int64_t size = uu_file_size(sink->fd);
+               int64_t kept = sink->config.arrow ? arrow_recover_tail(sink->fd) : output_recover_tail(sink->fd, sink->config.serializer);
+               if (kept < 0) {
+                    fprintf(stderr, "ERROR: could not recover %s\n", target);
+                    return -1;
+               }
+               // an arrow stream loses its 8 bytes end of stream marker
+               if (kept != size && !(sink->config.arrow && size - kept == 8)) {
+                    fprintf(stderr, "%s: cut off %lld bytes of a torn record\n", target, (long long)(size - kept));
+               }
+               sink->config.sync = sync;
+               sink->write_header = kept == 0;
+               output_writer_set_sync(&sink->writer, sync, kept);
+          }
+          if (sink->fd >= 0 && sink->config.index_every_ns) {
+               char index_path[1024];
+               snprintf(index_path, sizeof index_path, "%s.idx", target);
+               if (output_writer_set_index(&sink->writer, index_path, sink->config.index_every_ns, sink->config.index_every_bytes) != 0) {
+                    fprintf(stderr, "ERROR: could not open the index %s\n", index_path);
+                    return -1;
+               }
+          }
+     }
+     return sink->fd < 0 ? -1 : 0;
+}
+
+static void sink_close_target(Sink *sink)
+{
+     switch (sink->kind) {
+     case SinkKind_StandardOutput:
+          break;
+     case SinkKind_Command:
+#if defined(WIN32)
+          _pclose(sink->command_pipe);
+#else
+          pclose(sink->command_pipe);
+#endif
+          break;
+     case SinkKind_File:
+     case SinkKind_Tcp:
+          uu_close(sink->fd);
+          break;
+     case SinkKind_Forward:
+          break;
+     case SinkKind_Mqtt:
+          memory_free(sink->mqtt);
+          break;
+     case SinkKind_Sqlite:
+          sqlite_target_close(&sink->sqlite);
+          break;
+     }
+}
+
+static int sink_open_spill(Sink *sink, char const *spill_dir)
+{
+     snprintf(sink->spill_path, sizeof sink->spill_path, "%s/co2_sink_%d.spill", spill_dir, sink->index);
+#if defined(WIN32)
+     sink->spill_write_fd = _open(sink->spill_path, _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+     sink->spill_write_fd = open(sink->spill_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+#endif
+     if (sink->spill_write_fd < 0) return -1;
+     sink->spill_read_fd = uu_open_for_reading(sink->spill_path);
+     if (sink->spill_read_fd < 0) return -1;
+     return 0;
+}
+
+static void sink_drop_locked(Sink *sink, uint64_t n)
+{
+     sink->stats.dropped += n;
+     uu_atomic_store_u64(&sink->metrics_dropped, sink->stats.dropped);
+}
+
+// The reader's side, called with the mutex held: only a copy, the spill
+// thread writes it out
+static void sink_spill_locked(Sink *sink, Reading const *reading)
+{
+     if (sink->spill_pending_count == SINK_SPILL_BUFFER_CAPACITY) {
+          sink_drop_locked(sink, 1);
+          return;
+     }
+     sink->spill_pending[sink->spill_pending_count++] = *reading;
+     sink->stats.spilled++;
+     uu_condvar_signal(&sink->spill_not_empty);
+}
+
+// Whether readings are in the spill file or on their way there
+static int sink_spilling_locked(Sink const *sink)
+{
+     return sink->spill_written > sink->spill_read || sink->spill_pending_count || sink->spill_writing_count;
+}
+
+static uint64_t sink_lag_locked(Sink const *sink)
+{
+     return sink->queue_count + (sink->spill_written - sink->spill_read) / BINARY_RECORD_SIZE + sink->spill_pending_count
+          + sink->spill_writing_count;
+}
+
+// Writes the spilled readings to the spill file, until the sink closes
+static void sink_spill_run(void *arg)
+{
+     Sink *sink = arg;
+     uint8_t records[SINK_BATCH_SIZE * BINARY_RECORD_SIZE];
+     uu_mutex_lock(&sink->mutex);
+     for (;;) {
+          while (!sink->spill_pending_count && !sink->closing) uu_condvar_wait(&sink->spill_not_empty, &sink->mutex);
+          if (!sink->spill_pending_count) break;
+          if (sink->spill_failed) {
+               sink->stats.spilled -= sink->spill_pending_count;
+               sink_drop_locked(sink, sink->spill_pending_count);
+               sink->spill_pending_count = 0;
+               uu_condvar_signal(&sink->not_empty);
+               continue;
+          }
+          Reading *readings = sink->spill_pending;
+          int n = sink->spill_pending_count;
+          sink->spill_pending = sink->spill_writing;
+          sink->spill_pending_count = 0;
+          sink->spill_writing = readings;
+          sink->spill_writing_count = n;
+          uu_mutex_unlock(&sink->mutex);
+
+          // the sink thread does not start the file over while readings are
+          // being written
+          int written = 0;
+          int failed = 0;
+          while (written < n && !failed) {
+               int m = n - written < SINK_BATCH_SIZE ? n - written : SINK_BATCH_SIZE;
+               for (int i = 0; i < m; i++) binary_pack_reading(&records[i * BINARY_RECORD_SIZE], &readings[written + i]);
+               failed = uu_write_all(sink->spill_write_fd, records, (size_t)m * BINARY_RECORD_SIZE) != 0;
+               if (!failed) written += m;
+          }
+
+          uu_mutex_lock(&sink->mutex);
+          sink->spill_written += (int64_t)written * BINARY_RECORD_SIZE;
+          if (failed) {
+               // cut off a torn record
+               uu_truncate(sink->spill_write_fd, sink->spill_written);
+               uu_seek(sink->spill_write_fd, sink->spill_written);
+               sink->stats.spilled -= n - written;
+               sink_drop_locked(sink, n - written);
+          }
+          sink->spill_writing_count = 0;
+          uu_condvar_signal(&sink->not_empty);
+     }
+     uu_mutex_unlock(&sink->mutex);
+}
+
+void sink_push(Sink *sink, Reading const *reading)
+{
+     uu_mutex_lock(&sink->mutex);
+     sink->stats.enqueued++;
+     int capacity = sink->config.queue_capacity;
+     if (sink_spilling_locked(sink) && !sink->spill_failed) {
+          // keep the order: once spilling, everything goes through the spill
+          // file until the sink thread caught up
+          sink_spill_locked(sink, reading);
+     } else {
+          if (sink->queue_count == capacity) {
+               switch (sink->config.overflow) {
+               case SinkOverflow_Block:
+                    while (sink->queue_count == capacity) uu_condvar_wait(&sink->not_full, &sink->mutex);
+                    break;
+               case SinkOverflow_Spill:
+                    if (!sink->spill_failed) break;
+                    // without a spill file, like drop-oldest
+                    // fall through
+               case SinkOverflow_DropOldest:
+                    sink->queue_head = (sink->queue_head + 1) % capacity;
+                    sink->queue_count--;
+                    sink_drop_locked(sink, 1);
+                    break;
+               case NumSinkOverflows:
+                    assert(0);
+               }
+          }
+          if (sink->queue_count < capacity) {
+               sink->queue[(sink->queue_head + sink->queue_count) % capacity] = *reading;
+               sink->queue_count++;
+          } else {
+               sink_spill_locked(sink, reading);
+          }
+     }
+     uint64_t lag = sink_lag_locked(sink);
+     if (lag > sink->stats.max_lag) sink->stats.max_lag = lag;
+     uu_condvar_signal(&sink->not_empty);
+     uu_mutex_unlock(&sink->mutex);
+}
+
+void sink_set_push(SinkSet *set, Reading const *reading)
+{
+     for (int i = 0; i < set->num_sinks; i++) sink_push(&set->sinks[i], reading);
+}
+
+// Takes the next readings, from the queue first and then from the spill file,
+// waiting for them until deadline_ns (uu_monotonic_ns, 0 for no deadline).
+// Sets closed when the sink is closing and everything was taken.
+static int sink_take(Sink *sink, Reading batch[SINK_BATCH_SIZE], int *spill_records, int64_t deadline_ns, int *closed)
+{
+     int n = 0;
+     int64_t spill_begin = 0;
+     int64_t spill_end = 0;
+     *spill_records = 0;
+     uu_mutex_lock(&sink->mutex);
+     // when closing, the spilled readings are waited for too
+     while (!sink->queue_count && sink->spill_written == sink->spill_read && !(sink->closing && !sink_spilling_locked(sink))) {
+          if (!deadline_ns) {
+               uu_condvar_wait(&sink->not_empty, &sink->mutex);
+               continue;
+          }
+          int64_t now_ns = uu_monotonic_ns();
+          if (now_ns >= deadline_ns) break;
+          uu_condvar_wait_timeout(&sink->not_empty, &sink->mutex, deadline_ns - now_ns);
+     }
+     *closed = sink->closing && !sink->queue_count && !sink_spilling_locked(sink);
+     if (sink->spill_failed) {
+          // a failed sink drains its queue and spill file without writing them
+          sink_drop_locked(sink, sink->queue_count + (sink->spill_written - sink->spill_read) / BINARY_RECORD_SIZE);
+          sink->queue_count = 0;
+          sink->spill_read = sink->spill_written;
+          uu_condvar_broadcast(&sink->not_full);
+          uu_mutex_unlock(&sink->mutex);
+          return 0;
+     }
+     int capacity = sink->config.queue_capacity;
+     while (n < SINK_BATCH_SIZE && sink->queue_count) {
+          batch[n++] = sink->queue[sink->queue_head];
+          sink->queue_head = (sink->queue_head + 1) % capacity;
+          sink->queue_count--;
+     }
+     if (n) {
+          uu_condvar_broadcast(&sink->not_full);
+     } else if (sink->spill_written > sink->spill_read) {
+          spill_begin = sink->spill_read;
+          spill_end = spill_begin + SINK_BATCH_SIZE * BINARY_RECORD_SIZE;
+          if (spill_end > sink->spill_written) spill_end = sink->spill_written;
+     }
+     uu_mutex_unlock(&sink->mutex);
+
+     if (spill_end > spill_begin) {
+          // the spill thread only appends after spill_written, so this range
+          // is stable without the lock
+          uint8_t records[SINK_BATCH_SIZE * BINARY_RECORD_SIZE];
+          int64_t size = spill_end - spill_begin;
+          if (uu_read_full(sink->spill_read_fd, records, size) != size) {
+               // like a failed write: this sink fails, the reader and the
+               // other sinks go on
+               fprintf(stderr, "ERROR: could not read back %s, %s failed\n", sink->spill_path, sink->config.target);
+               uu_mutex_lock(&sink->mutex);
+               sink->spill_failed = 1;
+               sink_drop_locked(sink, (sink->spill_written - sink->spill_read) / BINARY_RECORD_SIZE);
+               sink->spill_read = sink->spill_written;
+               uu_mutex_unlock(&sink->mutex);
+               return 0;
+          }
+          n = (int)(size / BINARY_RECORD_SIZE);
+          for (int i = 0; i < n; i++) binary_unpack_reading(&records[i * BINARY_RECORD_SIZE], &batch[i]);
+          *spill_records = n;
+     }
+     return n;
+}
+
+static void sink_written(Sink *sink, int n, int spill_records, int failed)
+{
+     uu_mutex_lock(&sink->mutex);
+     sink->stats.commit = sink->writer.buffer.stats;
+     if (sink->kind == SinkKind_Forward) {
+          // a frame is a write
+          sink->stats.forward = sink->forwarder.stats;
+          sink->stats.forward.spool_bytes = forwarder_spool_depth(&sink->forwarder);
+          sink->stats.commit.writes = sink->stats.forward.frames;
+          sink->stats.commit.bytes = sink->stats.forward.frame_bytes;
+          uu_atomic_store_u64(&sink->metrics_up, (uint64_t)sink->stats.forward.connected);
+          uu_atomic_store_u64(&sink->metrics_reconnects, sink->stats.forward.reconnects);
+     }
+     if (sink->kind == SinkKind_Mqtt) {
+          // a batch of publishes is a write
+          mqtt_client_stats(sink->mqtt, &sink->stats.mqtt);
+          sink->stats.commit.writes = sink->stats.mqtt.writes;
+          uu_atomic_store_u64(&sink->metrics_up, (uint64_t)sink->stats.mqtt.connected);
+          uu_atomic_store_u64(&sink->metrics_reconnects, sink->stats.mqtt.reconnects);
+     }
+     if (sink->kind == SinkKind_Sqlite) {
+          // a transaction is a write
+          sink->stats.sqlite = sink->sqlite.stats;
+          sink->stats.commit.writes = sink->stats.sqlite.transactions;
+     }
+     failed = failed || sink->spill_failed;
+     if (failed) {
+          sink_drop_locked(sink, n);
+     } else {
+          sink->stats.written += n;
+     }
+     if (failed && !sink->failed) sink->stats.write_errors++;
+     // a target that recovers, like sqlite:, counts every failure
+     sink->failed = failed;
+     if (!sink->spill_failed) sink->spill_read += (int64_t)spill_records * BINARY_RECORD_SIZE;
+     if (spill_records && sink->spill_read == sink->spill_written && !sink->spill_writing_count) {
+          // caught up: start the spill file over
+          uu_truncate(sink->spill_write_fd, 0);
+          uu_seek(sink->spill_write_fd, 0);
+          uu_seek(sink->spill_read_fd, 0);
+          sink->spill_read = sink->spill_written = 0;
+     }
+     uu_mutex_unlock(&sink->mutex);
+}
+
+// Frames every commit interval, by default every second, or commit size
+static void sink_run_forward(Sink *sink)
+{
+     Forwarder *forwarder = &sink->forwarder;
+     Reading batch[SINK_BATCH_SIZE];
+     int64_t frame_interval_ns = (int64_t)(sink->config.commit_interval_ms ? sink->config.commit_interval_ms : 1000) * 1000000;
+     size_t frame_bytes = sink->config.commit_bytes;
+     for (;;) {
+          // wakes up for acknowledgements and reconnections, too
+          int64_t deadline_ns = uu_monotonic_ns() + SINK_FORWARD_POLL_MS * 1000000;
+          if (forwarder->frame_readings && forwarder->frame_started_ns + frame_interval_ns < deadline_ns) {
+               deadline_ns = forwarder->frame_started_ns + frame_interval_ns;
+          }
+          int spill_records;
+          int closed;
+          int n = sink_take(sink, batch, &spill_records, deadline_ns, &closed);
+          if (closed) break;
+          for (int i = 0; i < n && !forwarder->failed; i++) {
+               forwarder_add(forwarder, &batch[i]);
+               if (frame_bytes && forwarder->frame_size >= frame_bytes) forwarder_commit(forwarder);
+          }
+          if (forwarder->frame_readings && uu_monotonic_ns() - forwarder->frame_started_ns >= frame_interval_ns) {
+               forwarder_commit(forwarder);
+          }
+          // a failed forwarder keeps draining the queue, like a failed file
+          int failed = forwarder_poll(forwarder) != 0;
+          sink_written(sink, n, spill_records, failed);
+     }
+     forwarder_close(forwarder);
+     sink_written(sink, 0, 0, forwarder->failed);
+}
+
+static void sink_run_mqtt(Sink *sink)
+{
+     MqttClient *client = sink->mqtt;
+     Reading batch[SINK_BATCH_SIZE];
+     for (;;) {
+          // with a full window, waits for acknowledgements rather than readings
+          int busy = mqtt_client_is_busy(client);
+          if (busy) mqtt_client_wait(client, SINK_FORWARD_POLL_MS);
+          int64_t deadline_ns = uu_monotonic_ns() + (busy ? 0 : SINK_FORWARD_POLL_MS * 1000000);
+          int spill_records;
+          int closed;
+          int n = sink_take(sink, batch, &spill_records, deadline_ns, &closed);
+          if (closed) break;
+          for (int i = 0; i < n; i++) mqtt_client_add(client, &batch[i]);
+          mqtt_client_poll(client);
+          sink_written(sink, n, spill_records, 0);
+     }
+     mqtt_client_close(client);
+     sink_written(sink, 0, 0, 0);
+}
+
+// A transaction every commit rows or commit interval
+static void sink_run_sqlite(Sink *sink)
+{
+     SqliteTarget *target = &sink->sqlite;
+     Reading batch[SINK_BATCH_SIZE];
+     int commit_rows = sink->config.commit_rows ? sink->config.commit_rows : SQLITE_TARGET_COMMIT_ROWS;
+     int commit_interval_ms = sink->config.commit_interval_ms ? sink->config.commit_interval_ms : SQLITE_TARGET_COMMIT_INTERVAL_MS;
+     int64_t commit_interval_ns = (int64_t)commit_interval_ms * 1000000;
+     for (;;) {
+          int64_t deadline_ns = target->transaction_rows ? target->transaction_started_ns + commit_interval_ns : 0;
+          int spill_records;
+          int closed;
+          int n = sink_take(sink, batch, &spill_records, deadline_ns, &closed);
+          if (closed) break;
+          // a failed batch is dropped, the target backs off and starts over
+          int failed = 0;
+          for (int i = 0; i < n && !failed; i++) {
+               failed = sqlite_target_add(target, &batch[i]) != 0;
+               if (!failed && target->transaction_rows >= commit_rows) failed = sqlite_target_commit(target) != 0;
+          }
+          if (!failed && target->transaction_rows && uu_monotonic_ns() - target->transaction_started_ns >= commit_interval_ns) {
+               failed = sqlite_target_commit(target) != 0;
+          }
+          sink_written(sink, n, spill_records, failed);
+     }
+     sink_written(sink, 0, 0, sqlite_target_commit(target) != 0);
+}
+
+static int sink_write_arrow(Sink *sink)
+{
+     OutputBuffer *buffer = &sink->writer.buffer;
+     buffer->used = arrow_write_batch(buffer->data + buffer->used, &sink->arrow) - buffer->data;
+     return output_writer_flush(&sink->writer);
+}
+
+// A record batch when the batch is full, at the commit size, and every
+// commit interval
+static void sink_run_arrow(Sink *sink)
+{
+     OutputWriter *writer = &sink->writer;
+     ArrowBatch *arrow = &sink->arrow;
+     Reading batch[SINK_BATCH_SIZE];
+     int commit_interval_ms = sink->config.commit_interval_ms ? sink->config.commit_interval_ms : SINK_ARROW_COMMIT_INTERVAL_MS;
+     int64_t commit_interval_ns = (int64_t)commit_interval_ms * 1000000;
+     size_t commit_bytes = sink->config.commit_bytes;
+     int failed = 0;
+     if (sink->write_header) writer->buffer.used = arrow_write_schema(writer->buffer.data) - writer->buffer.data;
+     for (;;) {
+          int64_t deadline_ns = arrow->num_rows ? arrow->first_row_ns + commit_interval_ns : 0;
+          int spill_records;
+          int closed;
+          int n = sink_take(sink, batch, &spill_records, deadline_ns, &closed);
+          if (closed) break;
+          for (int i = 0; i < n && !failed; i++) {
+               arrow_batch_append(arrow, &batch[i], 0);
+               if (arrow->num_rows == arrow->capacity || (commit_bytes && arrow_batch_size(arrow) >= commit_bytes)) {
+                    failed = sink_write_arrow(sink) != 0;
+               }
+          }
+          if (!failed && arrow->num_rows && uu_monotonic_ns() - arrow->first_row_ns >= commit_interval_ns) {
+               failed = sink_write_arrow(sink) != 0;
+          }
+          sink_written(sink, n, spill_records, failed);
+          if (n) memory_thread_set_steady(1);
+     }
+     memory_thread_set_steady(0);
+     if (!failed && arrow->num_rows) failed = sink_write_arrow(sink) != 0;
+     if (!failed) {
+          writer->buffer.used = arrow_write_end(writer->buffer.data + writer->buffer.used) - writer->buffer.data;
+          failed = output_writer_flush(writer) != 0;
+     }
+     sink_written(sink, 0, 0, failed);
+}
+
+static void sink_run_file(Sink *sink)
+{
+     OutputWriter *writer = &sink->writer;
+     Reading batch[SINK_BATCH_SIZE];
+     int64_t commit_interval_ns = (int64_t)sink->config.commit_interval_ms * 1000000;
+     size_t commit_bytes = sink->config.commit_bytes;
+     int commit_every_second = !commit_interval_ns && !commit_bytes;
+     int failed = 0;
+     if (sink->write_header) output_writer_header(writer);
+     int64_t prev_time_unix = -1;
+     for (;;) {
+          int64_t deadline_ns = 0;
+          if (commit_interval_ns && writer->buffer.used) deadline_ns = writer->buffer.first_pending_ns + commit_interval_ns;
+          int spill_records;
+          int closed;
+          int n = sink_take(sink, batch, &spill_records, deadline_ns, &closed);
+          if (closed) break;
+          for (int i = 0; i < n && !failed; i++) {
+               output_writer_append(writer, &batch[i]);
+               if (commit_every_second) {
+                    // like the original output: flush when the second changes
+                    int64_t now_unix = batch[i].time_unix_ns / NS_PER_SECOND;
+                    if (now_unix != prev_time_unix) failed = output_writer_flush(writer) != 0;
+                    prev_time_unix = now_unix;
+               }
+          }
+          if (!failed && commit_bytes && writer->buffer.used >= commit_bytes) {
+               failed = output_writer_flush_aligned(writer) != 0;
+          }
+          if (!failed && commit_interval_ns && writer->buffer.used &&
+              uu_monotonic_ns() - writer->buffer.first_pending_ns >= commit_interval_ns) {
+               failed = output_writer_flush(writer) != 0;
+          }
+          // a failed sink keeps draining its queue, so the reader never
+          // waits for it
+          sink_written(sink, n, spill_records, failed);
+          if (n) memory_thread_set_steady(1);
+     }
+     memory_thread_set_steady(0);
+     if (!failed) failed = output_writer_flush(writer) != 0;
+     sink_written(sink, 0, 0, failed);
+}
+
+static void sink_run(void *arg)
+{
+     Sink *sink = arg;
+     if (sink->kind == SinkKind_Forward) {
+          sink_run_forward(sink);
+     } else if (sink->kind == SinkKind_Mqtt) {
+          sink_run_mqtt(sink);
+     } else if (sink->kind == SinkKind_Sqlite) {
+          sink_run_sqlite(sink);
+     } else if (sink->config.arrow) {
+          sink_run_arrow(sink);
+     } else {
+          sink_run_file(sink);
+     }
+     uu_mutex_lock(&sink->mutex);
+     sink->stopped = 1;
+     uu_condvar_broadcast(&sink->not_full);
+     uu_mutex_unlock(&sink->mutex);
+}
+
+//
+// Stats
+//
+
+// The counters of the metrics of the sink at index. Loads only: the reader
+// never waits on the metrics thread for the mutex.
+void sink_set_load_metrics(SinkSet *set, int index, SinkMetrics *metrics)
+{
+     Sink *sink = &set->sinks[index];
+     metrics->dropped = uu_atomic_load_u64(&sink->metrics_dropped);
+     metrics->up = uu_atomic_load_u64(&sink->metrics_up);
+     metrics->reconnects = uu_atomic_load_u64(&sink->metrics_reconnects);
+}
+
+// elapsed_seconds since the previous call, for the rates
+void sink_set_print_stats(SinkSet *set, FILE *out, double elapsed_seconds)
+{
+     for (int i = 0; i < set->num_sinks; i++) {
+          Sink *sink = &set->sinks[i];
+          uu_mutex_lock(&sink->mutex);
+          SinkStats stats = sink->stats;
+          uint64_t lag = sink_lag_locked(sink);
+          int failed = sink->failed;
+          uu_mutex_unlock(&sink->mutex);
+          double writes_per_second = elapsed_seconds > 0 ? (stats.commit.writes - sink->stats_previous_writes) / elapsed_seconds : 0;
+          sink->stats_previous_writes = stats.commit.writes;
+          fprintf(out, "sink %d %s\t%s\t%s\tenqueued=%llu written=%llu dropped=%llu spilled=%llu lag=%llu max_lag=%llu errors=%llu"
+                  "\twrites=%llu writes/s=%.2f bytes=%llu sync=%s syncs=%llu sync_avg_us=%.0f sync_max_us=%.0f\n",
+                  sink->index, sink->config.target, failed ? "failed" : "ok",
+                  SINK_OVERFLOW_NAMES[sink->config.overflow],
+                  (unsigned long long)stats.enqueued, (unsigned long long)stats.written,
+                  (unsigned long long)stats.dropped, (unsigned long long)stats.spilled,
+                  (unsigned long long)lag, (unsigned long long)stats.max_lag,
+                  (unsigned long long)stats.write_errors,
+                  (unsigned long long)stats.commit.writes, writes_per_second,
+                  (unsigned long long)stats.commit.bytes, OUTPUT_SYNC_NAMES[sink->config.sync],
+                  (unsigned long long)stats.commit.syncs,
+                  stats.commit.syncs ? stats.commit.sync_ns_total / 1e3 / stats.commit.syncs : 0.0,
+                  stats.commit.sync_ns_max / 1e3);
+          if (sink->kind == SinkKind_Forward) {
+               fprintf(out, "sink %d %s\tlink=%s reconnects=%llu frames=%llu readings=%llu bytes/report=%.2f spooled_frames=%llu spool_bytes=%lld\n",
+                       sink->index, sink->config.target, stats.forward.connected ? "up" : "down",
+                       (unsigned long long)stats.forward.reconnects, (unsigned long long)stats.forward.frames,
+                       (unsigned long long)stats.forward.readings,
+                       stats.forward.readings ? (double)stats.forward.frame_bytes / stats.forward.readings : 0.0,
+                       (unsigned long long)stats.forward.spooled_frames, (long long)stats.forward.spool_bytes);
+          }
+          if (sink->kind == SinkKind_Mqtt) {
+               fprintf(out, "sink %d %s\tlink=%s reconnects=%llu qos=%d published=%llu acknowledged=%llu resent=%llu dropped=%llu inflight=%d pending=%d\n",
+                       sink->index, sink->config.target, stats.mqtt.connected ? "up" : "down",
+                       (unsigned long long)stats.mqtt.reconnects, sink->config.mqtt_qos,
+                       (unsigned long long)stats.mqtt.published, (unsigned long long)stats.mqtt.acknowledged,
+                       (unsigned long long)stats.mqtt.resent, (unsigned long long)stats.mqtt.dropped,
+                       stats.mqtt.inflight, stats.mqtt.pending);
+          }
+          if (sink->kind == SinkKind_Sqlite) {
+               double rows_per_second = elapsed_seconds > 0 ? (stats.sqlite.rows - sink->stats_previous_rows) / elapsed_seconds : 0;
+               sink->stats_previous_rows = stats.sqlite.rows;
+               fprintf(out, "sink %d %s\trows=%llu rows/s=%.0f transactions=%llu rows/transaction=%.1f commit_avg_us=%.0f commit_max_us=%.0f\n",
+                       sink->index, sink->config.target, (unsigned long long)stats.sqlite.rows, rows_per_second,
+                       (unsigned long long)stats.sqlite.transactions,
+                       stats.sqlite.transactions ? (double)stats.sqlite.rows / stats.sqlite.transactions : 0.0,
+                       stats.sqlite.transactions ? stats.sqlite.commit_ns_total / 1e3 / stats.sqlite.transactions : 0.0,
+                       stats.sqlite.commit_ns_max / 1e3);
+          }
+     }
+     fflush(out);
+}
+
+static void sink_set_stats_run(void *arg)
+{
+     SinkSet *set = arg;
+     int64_t previous_ns = uu_monotonic_ns();
+     int64_t next_ns = previous_ns + set->stats_interval_seconds * NS_PER_SECOND;
+     for (;;) {
+          uu_mutex_lock(&set->stats_mutex);
+          int stop = set->stats_stop;
+          uu_mutex_unlock(&set->stats_mutex);
+          if (stop) break;
+          int64_t now_ns = uu_monotonic_ns();
+          if (now_ns >= next_ns) {
+               sink_set_print_stats(set, stderr, (now_ns - previous_ns) / 1e9);
+               memory_print_stats(stderr);
+               previous_ns = now_ns;
+               next_ns += set->stats_interval_seconds * NS_PER_SECOND;
+          }
+          uu_sleep_ms(100);
+     }
+     set->stats_previous_ns = previous_ns;
+}
+
+//
+// Set up and tear down
+//
+
+// Opens every target and starts the sink threads. Errors are reported on
+// standard error.
+int sink_set_open(SinkSet *set, SinkConfig const *configs, int num_configs, char const *spill_dir, int stats_interval_seconds)
+{
+     assert(num_configs <= SINK_MAX_COUNT);
+     memset(set, 0, sizeof *set);
+#if !defined(WIN32)
+     // a closed socket or pipe must fail the sink, not kill the program
+     signal(SIGPIPE, SIG_IGN);
+#endif
+     for (int i = 0; i < num_configs; i++) {
+          Sink *sink = &set->sinks[i];
+          sink->config = configs[i];
+          sink->index = i;
+          sink->spill_write_fd = sink->spill_read_fd = -1;
+          sink->write_header = 1;
+          size_t buffer_size = OUTPUT_DEFAULT_BUFFER_SIZE;
+          if ((size_t)sink->config.commit_bytes + OUTPUT_ALIGNMENT + OUTPUT_MAX_RECORD_SIZE > buffer_size) {
+               buffer_size = (size_t)sink->config.commit_bytes + OUTPUT_ALIGNMENT + OUTPUT_MAX_RECORD_SIZE;
+          }
+          if (sink->config.arrow) {
+               char sensor[ARROW_MAX_SENSOR];
+               arrow_default_sensor(sensor, sizeof sensor);
+               if (arrow_batch_init(&sink->arrow, sink->config.arrow_batch_rows) != 0
+                   || arrow_batch_add_sensor(&sink->arrow, sensor, (int)strlen(sensor)) != 0) {
+                    fprintf(stderr, "ERROR: could not allocate the batch of %s.\n", sink->config.target);
+                    return -1;
+               }
+               // the schema, a batch and the end of the stream
+               size_t arrow_size = 2 * (8 + ARROW_MAX_METADATA_SIZE) + arrow_max_message_size(sink->arrow.capacity, (int)strlen(sensor));
+               if (arrow_size > buffer_size) buffer_size = arrow_size;
+          }
+          sink->queue = memory_calloc(sink->config.queue_capacity, sizeof *sink->queue);
+          if (!sink->queue || output_writer_init(&sink->writer, -1, sink->config.serializer, buffer_size) != 0) {
+               fprintf(stderr, "ERROR: could not allocate the queue of %s.\n", sink->config.target);
+               return -1;
+          }
+          if (sink_open_target(sink, spill_dir) != 0) {
+               fprintf(stderr, "ERROR: could not open %s for writing.\n", sink->config.target);
+               return -1;
+          }
+          sink->writer.buffer.fd = sink->fd;
+          if (sink->config.sync != OutputSync_None && sink->kind != SinkKind_File) {
+               fprintf(stderr, "ERROR: --sync only applies to files, not to %s.\n", sink->config.target);
+               return -1;
+          }
+          if (sink->config.arrow && sink->config.index_every_ns) {
+               fprintf(stderr, "ERROR: --index does not apply to the arrow format of %s.\n", sink->config.target);
+               return -1;
+          }
+          if (sink->config.overflow == SinkOverflow_Spill) {
+               if (sink_open_spill(sink, spill_dir) != 0) {
+                    fprintf(stderr, "ERROR: could not create spill file %s.\n", sink->spill_path);
+                    return -1;
+               }
+               sink->spill_pending = memory_calloc(SINK_SPILL_BUFFER_CAPACITY, sizeof *sink->spill_pending);
+               sink->spill_writing = memory_calloc(SINK_SPILL_BUFFER_CAPACITY, sizeof *sink->spill_writing);
+               if (!sink->spill_pending || !sink->spill_writing) {
+                    fprintf(stderr, "ERROR: could not allocate the spill buffers of %s.\n", sink->config.target);
+                    return -1;
+               }
+          }
+          uu_mutex_init(&sink->mutex);
+          uu_condvar_init(&sink->not_empty);
+          uu_condvar_init(&sink->not_full);
+          uu_condvar_init(&sink->spill_not_empty);
+          if (uu_thread_start(&sink->thread, sink_run, sink) != 0
+              || (sink->spill_pending && uu_thread_start(&sink->spill_thread, sink_spill_run, sink) != 0)) {
+               fprintf(stderr, "ERROR: could not start the thread of %s.\n", sink->config.target);
+               return -1;
+          }
+          set->num_sinks++;
+     }
+     set->stats_interval_seconds = stats_interval_seconds;
+     set->stats_previous_ns = uu_monotonic_ns();
+     uu_mutex_init(&set->stats_mutex);
+     if (stats_interval_seconds > 0 && uu_thread_start(&set->stats_thread, sink_set_stats_run, set) != 0) {
+          fprintf(stderr, "ERROR: could not start the stats thread.\n");
+          return -1;
+     }
+     return 0;
+}
+
+// Makes the threads of a sink stuck in a write give up, e.g. on a peer or a
+// pipe that no longer reads: the write fails, and the sink drops the rest
+static void sink_interrupt_locked(Sink *sink)
+{
+#if !defined(WIN32)
+     if (sink->kind == SinkKind_Tcp) shutdown(sink->fd, SHUT_RDWR);
+#endif
+     uu_thread_interrupt(&sink->thread);
+     if (sink->spill_pending) uu_thread_interrupt(&sink->spill_thread);
+}
+
+// Writes out what is still queued, then stops the threads. A sink still
+// writing after SINK_CLOSE_TIMEOUT_MS is interrupted.
+void sink_set_close(SinkSet *set)
+{
+     for (int i = 0; i < set->num_sinks; i++) {
+          Sink *sink = &set->sinks[i];
+          uu_mutex_lock(&sink->mutex);
+          sink->closing = 1;
+          uu_condvar_signal(&sink->not_empty);
+          uu_condvar_signal(&sink->spill_not_empty);
+          uu_mutex_unlock(&sink->mutex);
+     }
+     int64_t deadline_ns = uu_monotonic_ns() + (int64_t)SINK_CLOSE_TIMEOUT_MS * 1000000;
+     for (int i = 0; i < set->num_sinks; i++) {
+          Sink *sink = &set->sinks[i];
+          uu_mutex_lock(&sink->mutex);
+          while (!sink->stopped) {
+               int64_t now_ns = uu_monotonic_ns();
+               if (now_ns < deadline_ns) {
+                    uu_condvar_wait_timeout(&sink->not_full, &sink->mutex, deadline_ns - now_ns);
+                    continue;
+               }
+               if (!sink->interrupted) fprintf(stderr, "WARNING: %s is still writing, interrupted\n", sink->config.target);
+               sink->interrupted = 1;
+               // until it gave up: a write it did not start yet is not interrupted
+               sink_interrupt_locked(sink);
+               uu_condvar_wait_timeout(&sink->not_full, &sink->mutex, 100 * 1000000);
+          }
+          uu_mutex_unlock(&sink->mutex);
+          uu_thread_join(&sink->thread);
+          if (sink->spill_pending) uu_thread_join(&sink->spill_thread);
+          sink_close_target(sink);
+          if (sink->spill_write_fd >= 0) {
+               uu_close(sink->spill_write_fd);
+               uu_close(sink->spill_read_fd);
+               remove(sink->spill_path);
+          }
+     }
+     if (set->stats_interval_seconds > 0) {
+          uu_mutex_lock(&set->stats_mutex);
+          set->stats_stop = 1;
+          uu_mutex_unlock(&set->stats_mutex);
+          uu_thread_join(&set->stats_thread);
+          sink_set_print_stats(set, stderr, (uu_monotonic_ns() - set->stats_previous_ns) / 1e9);
+     }
+     for (int i = 0; i < set->num_sinks; i++) {
+          Sink *sink = &set->sinks[i];
+          output_writer_destroy(&sink->writer);
+          arrow_batch_destroy(&sink->arrow);
+          memory_free(sink->queue);
+          memory_free(sink->spill_pending);
+          memory_free(sink->spill_writing);
+          uu_condvar_destroy(&sink->spill_not_empty);
+          uu_condvar_destroy(&sink->not_full);
+          uu_condvar_destroy(&sink->not_empty);
+          uu_mutex_destroy(&sink->mutex);
+     }
+     uu_mutex_destroy(&set->stats_mutex);
+     set->num_sinks = 0;
+}
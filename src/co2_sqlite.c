@@ -0,0 +1,193 @@
+// SQLite sink: readings inserted into a database
+//
+// A sink with a sqlite:path target inserts every reading into the readings
+// table of the database at path, created if need be:
+//
+//   CREATE TABLE readings (time_ns INTEGER NOT NULL, sensor TEXT NOT NULL,
+//                          channel TEXT NOT NULL, value REAL)
+//   CREATE INDEX readings_sensor_time ON readings (sensor, time_ns)
+//
+// with the columns of the arrow format: the sensor is the host name, the
+// channel CO2, Temperature, ChecksumError or UnexpectedOpcode, and the value
+// null for a checksum error.
+//
+// Rows go through a single prepared statement, inside transactions of
+// --commit-rows rows or --commit-interval ms, whichever comes first (by
+// default 10000 rows or a second), rather than a transaction per row. The
+// database is in WAL mode with synchronous=NORMAL, so that a commit is an
+// append to the log without a sync, and readers never block the sink. Like
+// every sink it runs on its own thread behind its queue, so a stalled
+// database never delays the reader.
+//
+// A failed insert or commit rolls the transaction back, and its readings are
+// lost. The target then drops the readings for a backoff of 1s doubling up
+// to 30s, like the reconnections of the network targets, before it begins
+// a new transaction.
+//
+// SQLite is optional: the program is built with it when CO2_SQLITE is
+// defined, and linked with -lsqlite3 (see co2_build_linux.sh).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(CO2_SQLITE)
+#include <sqlite3.h>
+#endif
+
+enum { SQLITE_TARGET_COMMIT_ROWS = 10000 };
+enum { SQLITE_TARGET_COMMIT_INTERVAL_MS = 1000 };
+enum { SQLITE_TARGET_BUSY_TIMEOUT_MS = 10000 };
+enum { SQLITE_TARGET_MAX_BACKOFF_MS = 30000 };
+
+typedef struct SqliteStats
+{
+     uint64_t rows; // committed
+     uint64_t transactions;
+     int64_t commit_ns_total;
+     int64_t commit_ns_max;
+} SqliteStats;
+
+typedef struct SqliteTarget
+{
+     char path[1024];
+     char sensor[ARROW_MAX_SENSOR];
+     int sensor_length;
+#if defined(CO2_SQLITE)
+     sqlite3 *db;
+     sqlite3_stmt *insert;
+     sqlite3_stmt *begin;
+     sqlite3_stmt *commit;
+#endif
+     int transaction_rows; // 0 outside of a transaction
+     int64_t transaction_started_ns;
+     int backoff_ms;
+     int64_t retry_ns; // after a failure, no transaction before then
+     SqliteStats stats;
+} SqliteTarget;
+
+#if defined(CO2_SQLITE)
+
+static char const *SQLITE_TARGET_SCHEMA = "PRAGMA journal_mode = WAL;"
+                                          "PRAGMA synchronous = NORMAL;"
+                                          "CREATE TABLE IF NOT EXISTS readings (time_ns INTEGER NOT NULL, sensor TEXT NOT NULL,"
+                                          " channel TEXT NOT NULL, value REAL);"
+                                          "CREATE INDEX IF NOT EXISTS readings_sensor_time ON readings (sensor, time_ns);";
+
+static int sqlite_target_error(SqliteTarget *target, char const *what)
+{
+     fprintf(stderr, "ERROR: %s: could not %s: %s\n", target->path, what, target->db ? sqlite3_errmsg(target->db) : "out of memory");
+     return -1;
+}
+
+// Runs a prepared statement without results
+static int sqlite_target_step(SqliteTarget *target, sqlite3_stmt *statement, char const *what)
+{
+     int rc = sqlite3_step(statement);
+     sqlite3_reset(statement);
+     return rc == SQLITE_DONE ? 0 : sqlite_target_error(target, what);
+}
+
+// Rolls the transaction back, and backs off before the next one
+static int sqlite_target_fail(SqliteTarget *target)
+{
+     if (target->transaction_rows) sqlite3_exec(target->db, "ROLLBACK", NULL, NULL, NULL);
+     target->transaction_rows = 0;
+     target->retry_ns = uu_monotonic_ns() + (int64_t)target->backoff_ms * 1000000;
+     target->backoff_ms = target->backoff_ms * 2 < SQLITE_TARGET_MAX_BACKOFF_MS ? target->backoff_ms * 2 : SQLITE_TARGET_MAX_BACKOFF_MS;
+     return -1;
+}
+
+int sqlite_target_open(SqliteTarget *target, char const *path)
+{
+     memset(target, 0, sizeof *target);
+     snprintf(target->path, sizeof target->path, "%s", path);
+     arrow_default_sensor(target->sensor, sizeof target->sensor);
+     target->sensor_length = (int)strlen(target->sensor);
+     target->backoff_ms = 1000;
+     if (sqlite3_open(path, &target->db) != SQLITE_OK) return sqlite_target_error(target, "open the database");
+     sqlite3_busy_timeout(target->db, SQLITE_TARGET_BUSY_TIMEOUT_MS);
+     if (sqlite3_exec(target->db, SQLITE_TARGET_SCHEMA, NULL, NULL, NULL) != SQLITE_OK) return sqlite_target_error(target, "create the schema");
+     if (sqlite3_prepare_v2(target->db, "INSERT INTO readings (time_ns, sensor, channel, value) VALUES (?, ?, ?, ?)", -1,
+                            &target->insert, NULL) != SQLITE_OK
+         || sqlite3_prepare_v2(target->db, "BEGIN", -1, &target->begin, NULL) != SQLITE_OK
+         || sqlite3_prepare_v2(target->db, "COMMIT", -1, &target->commit, NULL) != SQLITE_OK) {
+          return sqlite_target_error(target, "prepare the statements");
+     }
+     return 0;
+}
+
+int sqlite_target_add(SqliteTarget *target, Reading const *reading)
+{
+     if (!target->transaction_rows) {
+          int64_t now_ns = uu_monotonic_ns();
+          if (now_ns < target->retry_ns) return -1;
+          if (sqlite_target_step(target, target->begin, "begin a transaction") != 0) return sqlite_target_fail(target);
+          target->transaction_started_ns = now_ns;
+     }
+     target->transaction_rows++;
+     sqlite3_stmt *insert = target->insert;
+     sqlite3_bind_int64(insert, 1, reading->time_unix_ns);
+     sqlite3_bind_text(insert, 2, target->sensor, target->sensor_length, SQLITE_STATIC);
+     sqlite3_bind_text(insert, 3, READING_KIND_NAMES[reading->kind], -1, SQLITE_STATIC);
+     double value;
+     if (arrow_reading_value(reading, &value)) {
+          sqlite3_bind_double(insert, 4, value);
+     } else {
+          sqlite3_bind_null(insert, 4);
+     }
+     if (sqlite_target_step(target, insert, "insert a reading") != 0) return sqlite_target_fail(target);
+     return 0;
+}
+
+int sqlite_target_commit(SqliteTarget *target)
+{
+     if (!target->transaction_rows) return 0;
+     int64_t start_ns = uu_monotonic_ns();
+     if (sqlite_target_step(target, target->commit, "commit") != 0) return sqlite_target_fail(target);
+     int64_t commit_ns = uu_monotonic_ns() - start_ns;
+     target->stats.rows += target->transaction_rows;
+     target->stats.transactions++;
+     target->stats.commit_ns_total += commit_ns;
+     if (commit_ns > target->stats.commit_ns_max) target->stats.commit_ns_max = commit_ns;
+     target->transaction_rows = 0;
+     target->backoff_ms = 1000;
+     return 0;
+}
+
+void sqlite_target_close(SqliteTarget *target)
+{
+     sqlite3_finalize(target->insert);
+     sqlite3_finalize(target->begin);
+     sqlite3_finalize(target->commit);
+     sqlite3_close(target->db);
+     target->db = NULL;
+}
+
+#else
+
+int sqlite_target_open(SqliteTarget *target, char const *path)
+{
+     memset(target, 0, sizeof *target);
+     fprintf(stderr, "ERROR: %s: this program was built without SQLite, see CO2_SQLITE\n", path);
+     return -1;
+}
+
+int sqlite_target_add(SqliteTarget *target, Reading const *reading)
+{
+     (void)target, (void)reading;
+     return -1;
+}
+
+int sqlite_target_commit(SqliteTarget *target)
+{
+     (void)target;
+     return -1;
+}
+
+void sqlite_target_close(SqliteTarget *target)
+{
+     (void)target;
+}
+
+#endif
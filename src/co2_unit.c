@@ -1 +1,24 @@
+#include "co2_platform.c"
+#include "co2_memory.c"
+#include "co2_output.c"
+#include "co2_arrow.c"
+#include "co2_forward.c"
+#include "co2_collectd.c"
+#include "co2_mqtt.c"
+#include "co2_sqlite.c"
+#include "co2_sink.c"
+#include "co2_ring.c"
+#include "co2_window.c"
+#include "co2_alert.c"
+#include "co2_history.c"
+#include "co2_rollup.c"
+#include "co2_import.c"
+#include "co2_archive.c"
+#include "co2_index.c"
+#include "co2_merge.c"
+#include "co2_report.c"
+#include "co2_compact.c"
+#include "co2_realtime.c"
+#include "co2_replay.c"
+#include "co2_metrics.c"
 #include "co2_main.c"
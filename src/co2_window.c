@@ -0,0 +1,503 @@
+// Rolling window statistics
+//
+// For every configured window duration and channel (CO2 ppm, temperature),
+// the reader maintains the count, mean, standard deviation, minimum and
+// maximum of the reports of the last window seconds, in O(1) per report and
+// fixed memory per window:
+//
+// - time is bucketed by second, the resolution of the readings' timestamps.
+//   A window of W seconds has W buckets holding the count, sum and sum of
+//   squares of their second, which are added to running totals when a
+//   report arrives and subtracted when their second leaves the window.
+// - minimum and maximum come from monotonic deques of (second, value),
+//   holding at most one entry per second.
+// - values are summed relative to the first one, and the running totals are
+//   recomputed from the buckets once per window, so that rounding errors do
+//   not accumulate.
+//
+// At a configurable cadence, the statistics are written as a separate TSV
+// stream by a thread of their own, so that the reader never waits for it:
+//
+// Time	Channel	Window	Count	Mean	Stddev	Min	Max
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { WINDOW_MAX_COUNT = 8 }; // durations, each for every channel
+enum { WINDOW_MAX_SECONDS = 7 * 24 * 3600 };
+enum { WINDOW_STREAM_CAPACITY = 1 << 16 };
+
+typedef struct WindowSample
+{
+     int64_t second;
+     float value;
+} WindowSample;
+
+// Circular deque of samples, monotonic in value
+typedef struct WindowDeque
+{
+     WindowSample *entries;
+     int64_t capacity;
+     int64_t head;
+     int64_t count;
+} WindowDeque;
+
+typedef struct WindowBucket
+{
+     uint32_t count;
+     double sum;
+     double sum_sq;
+} WindowBucket;
+
+typedef struct Window
+{
+     ReadingKind channel;
+     int64_t seconds;
+     char const *label;
+     WindowBucket *buckets; // seconds of them, second s at index s % seconds
+     int64_t latest_second;
+     int64_t resync_second;
+     int has_offset;
+     double offset;
+     uint64_t count;
+     double sum;
+     double sum_sq;
+     WindowDeque min; // increasing values
+     WindowDeque max; // decreasing values
+} Window;
+
+// Bytes written by the reader, and to the target by the stream's thread
+typedef struct WindowStream
+{
+     int fd;
+     char const *name; // for messages
+     UU_Mutex mutex;
+     UU_CondVar not_empty;
+     char *pending;
+     size_t pending_used;
+     char *writing;
+     int closing;
+     uint64_t dropped_lines;
+     UU_Thread thread;
+} WindowStream;
+
+typedef struct WindowSet
+{
+     Window windows[2 * WINDOW_MAX_COUNT];
+     int num_windows;
+     int64_t every_seconds;
+     int64_t next_emit_second;
+     WindowStream stream;
+} WindowSet;
+
+// Accepts 90, 90s, 5m, 1h, 1d, 2w, 5y (365 days). Returns -1 when invalid.
+int64_t window_parse_duration(char const *text)
+{
+     char *end;
+     long long value = strtoll(text, &end, 10);
+     if (end == text || value <= 0) return -1;
+     switch (*end) {
+     case 0: break;
+     case 's': end++; break;
+     case 'm': value *= 60; end++; break;
+     case 'h': value *= 3600; end++; break;
+     case 'd': value *= 24 * 3600; end++; break;
+     case 'w': value *= 7 * 24 * 3600; end++; break;
+     case 'y': value *= 365 * 24 * 3600; end++; break;
+     default: return -1;
+     }
+     return *end ? -1 : value;
+}
+
+static void window_deque_push(WindowDeque *deque, int64_t second, float value, int keep_smaller)
+{
+     // drop what the new sample makes irrelevant: for a minimum, the larger
+     // or equal values, which leave the window before it
+     while (deque->count) {
+          WindowSample *back = &deque->entries[(deque->head + deque->count - 1) % deque->capacity];
+          int dominated = keep_smaller ? back->value >= value : back->value <= value;
+          if (!dominated) {
+               // one entry per second at most: an earlier sample of the same
+               // second that is better stays and covers this one
+               if (back->second == second) return;
+               break;
+          }
+          deque->count--;
+     }
+     assert(deque->count < deque->capacity);
+     deque->entries[(deque->head + deque->count) % deque->capacity] = (WindowSample){ second, value };
+     deque->count++;
+}
+
+static void window_deque_expire(WindowDeque *deque, int64_t oldest_second)
+{
+     while (deque->count && deque->entries[deque->head].second < oldest_second) {
+          deque->head = (deque->head + 1) % deque->capacity;
+          deque->count--;
+     }
+}
+
+static void window_resync(Window *window)
+{
+     window->count = 0;
+     window->sum = window->sum_sq = 0;
+     for (int64_t i = 0; i < window->seconds; i++) {
+          WindowBucket const *bucket = &window->buckets[i];
+          window->count += bucket->count;
+          window->sum += bucket->sum;
+          window->sum_sq += bucket->sum_sq;
+     }
+}
+
+// Moves the window so that it ends at second
+static void window_advance(Window *window, int64_t second)
+{
+     if (second <= window->latest_second) return;
+     int64_t first = window->latest_second + 1;
+     if (second - first >= window->seconds) first = second - window->seconds + 1;
+     for (int64_t s = first; s <= second; s++) {
+          WindowBucket *bucket = &window->buckets[s % window->seconds];
+          window->count -= bucket->count;
+          window->sum -= bucket->sum;
+          window->sum_sq -= bucket->sum_sq;
+          *bucket = (WindowBucket){0};
+     }
+     window->latest_second = second;
+     int64_t oldest_second = second - window->seconds + 1;
+     window_deque_expire(&window->min, oldest_second);
+     window_deque_expire(&window->max, oldest_second);
+     if (second >= window->resync_second) {
+          window_resync(window);
+          window->resync_second = second + window->seconds;
+     }
+}
+
+static void window_add(Window *window, int64_t second, float value)
+{
+     // the wall clock can step back, count such reports in the latest second
+     if (second < window->latest_second) second = window->latest_second;
+     window_advance(window, second);
+     if (!window->has_offset) {
+          window->offset = value;
+          window->has_offset = 1;
+     }
+     double x = value - window->offset;
+     WindowBucket *bucket = &window->buckets[second % window->seconds];
+     bucket->count++;
+     bucket->sum += x;
+     bucket->sum_sq += x * x;
+     window->count++;
+     window->sum += x;
+     window->sum_sq += x * x;
+     window_deque_push(&window->min, second, value, 1);
+     window_deque_push(&window->max, second, value, 0);
+}
+
+typedef struct WindowStats
+{
+     uint64_t count;
+     double mean;
+     double stddev;
+     float min;
+     float max;
+} WindowStats;
+
+// The statistics of the window as it is, the last three only with a count
+static void window_get_stats(Window const *window, WindowStats *stats)
+{
+     memset(stats, 0, sizeof *stats);
+     stats->count = window->count;
+     if (!window->count) return;
+     double mean = window->sum / window->count;
+     double variance = window->sum_sq / window->count - mean * mean;
+     stats->mean = window->offset + mean;
+     stats->stddev = variance > 0 ? sqrt(variance) : 0.0;
+     stats->min = window->min.entries[window->min.head].value;
+     stats->max = window->max.entries[window->max.head].value;
+}
+
+static int window_init(Window *window, ReadingKind channel, int64_t seconds, char const *label)
+{
+     memset(window, 0, sizeof *window);
+     window->channel = channel;
+     window->seconds = seconds;
+     window->label = label;
+     window->latest_second = INT64_MIN / 2;
+     window->buckets = memory_calloc(seconds, sizeof *window->buckets);
+     window->min.entries = memory_calloc(seconds, sizeof *window->min.entries);
+     window->max.entries = memory_calloc(seconds, sizeof *window->max.entries);
+     window->min.capacity = window->max.capacity = seconds;
+     return window->buckets && window->min.entries && window->max.entries ? 0 : -1;
+}
+
+//
+// Stream
+//
+
+static void window_stream_run(void *arg)
+{
+     WindowStream *stream = arg;
+     int failed = 0;
+     for (;;) {
+          uu_mutex_lock(&stream->mutex);
+          while (!stream->pending_used && !stream->closing) uu_condvar_wait(&stream->not_empty, &stream->mutex);
+          size_t size = stream->pending_used;
+          char *data = stream->pending;
+          stream->pending = stream->writing;
+          stream->writing = data;
+          stream->pending_used = 0;
+          int closing = stream->closing;
+          uu_mutex_unlock(&stream->mutex);
+          if (size && !failed && uu_write_all(stream->fd, data, size) != 0) {
+               fprintf(stderr, "ERROR: could not write the %s\n", stream->name);
+               failed = 1;
+          }
+          if (closing && !size) break;
+     }
+}
+
+// Adds one line to the stream, or drops it if the stream's thread is that
+// far behind.
+static void window_stream_write(WindowStream *stream, char const *line, size_t size)
+{
+     uu_mutex_lock(&stream->mutex);
+     if (stream->pending_used + size <= WINDOW_STREAM_CAPACITY) {
+          memcpy(stream->pending + stream->pending_used, line, size);
+          stream->pending_used += size;
+          uu_condvar_signal(&stream->not_empty);
+     } else {
+          stream->dropped_lines++;
+     }
+     uu_mutex_unlock(&stream->mutex);
+}
+
+// Starts the thread writing to fd, which the stream then owns
+static int window_stream_open(WindowStream *stream, int fd, char const *name)
+{
+     memset(stream, 0, sizeof *stream);
+     stream->fd = fd;
+     stream->name = name;
+     stream->pending = memory_alloc(WINDOW_STREAM_CAPACITY);
+     stream->writing = memory_alloc(WINDOW_STREAM_CAPACITY);
+     if (!stream->pending || !stream->writing) return -1;
+     uu_mutex_init(&stream->mutex);
+     uu_condvar_init(&stream->not_empty);
+     if (uu_thread_start(&stream->thread, window_stream_run, stream) != 0) {
+          fprintf(stderr, "ERROR: could not start the %s thread\n", name);
+          return -1;
+     }
+     return 0;
+}
+
+// Writes what is pending and closes the target
+static void window_stream_close(WindowStream *stream)
+{
+     uu_mutex_lock(&stream->mutex);
+     stream->closing = 1;
+     uu_condvar_signal(&stream->not_empty);
+     uu_mutex_unlock(&stream->mutex);
+     uu_thread_join(&stream->thread);
+     if (stream->dropped_lines) {
+          fprintf(stderr, "%s: %llu lines dropped\n", stream->name, (unsigned long long)stream->dropped_lines);
+     }
+     if (stream->fd != 1) uu_close(stream->fd);
+     memory_free(stream->pending);
+     memory_free(stream->writing);
+     uu_condvar_destroy(&stream->not_empty);
+     uu_mutex_destroy(&stream->mutex);
+}
+
+//
+// Set
+//
+
+// Opens the stream to target ("-" for standard output, or a file) and sets
+// up a window per duration and channel. Errors are reported on standard
+// error.
+int window_set_open(WindowSet *set, int64_t const *durations, char const *const *labels, int num_durations,
+                    int64_t every_seconds, char const *target)
+{
+     assert(num_durations <= WINDOW_MAX_COUNT);
+     memset(set, 0, sizeof *set);
+     set->every_seconds = every_seconds;
+     ReadingKind const channels[] = { ReadingKind_CO2, ReadingKind_Temperature };
+     for (int i = 0; i < num_durations; i++) {
+          for (int c = 0; c < 2; c++) {
+               if (window_init(&set->windows[set->num_windows++], channels[c], durations[i], labels[i]) != 0) {
+                    fprintf(stderr, "ERROR: could not allocate the %s window\n", labels[i]);
+                    return -1;
+               }
+          }
+     }
+
+     int fd = 0 == strcmp(target, "-") ? 1 : uu_open_for_writing(target);
+     if (fd < 0) {
+          fprintf(stderr, "ERROR: could not open %s for writing.\n", target);
+          return -1;
+     }
+     if (window_stream_open(&set->stream, fd, "window statistics") != 0) return -1;
+     char const header[] = "Time\tChannel\tWindow\tCount\tMean\tStddev\tMin\tMax\n";
+     window_stream_write(&set->stream, header, sizeof header - 1);
+     return 0;
+}
+
+static void window_set_emit(WindowSet *set, Reading const *reading)
+{
+     OutputTimeCache time_cache = {0};
+     for (int i = 0; i < set->num_windows; i++) {
+          Window *window = &set->windows[i];
+          window_advance(window, reading->time_unix_ns / NS_PER_SECOND);
+          char line[OUTPUT_MAX_RECORD_SIZE];
+          char *dst = output_append_time(line, &time_cache, reading);
+          dst = output_append_string(dst, window->channel == ReadingKind_CO2 ? "\tCO2\t" : "\tTemperature\t");
+          dst = output_append_string(dst, window->label);
+          *dst++ = '\t';
+          WindowStats stats;
+          window_get_stats(window, &stats);
+          dst = output_append_uint(dst, stats.count);
+          if (stats.count) {
+               dst += snprintf(dst, line + sizeof line - dst, "\t%f\t%f\t%f\t%f\n", stats.mean, stats.stddev, stats.min, stats.max);
+          } else {
+               dst = output_append_string(dst, "\t\t\t\t\n");
+          }
+          window_stream_write(&set->stream, line, dst - line);
+     }
+}
+
+// Called with every decoded report of a channel, whether or not it is output
+void window_set_add(WindowSet *set, Reading const *reading)
+{
+     if (reading->kind != ReadingKind_CO2 && reading->kind != ReadingKind_Temperature) return;
+     int64_t second = reading->time_unix_ns / NS_PER_SECOND;
+     float value = reading->kind == ReadingKind_CO2 ? (float)reading->co2_in_ppm : reading->temperature_in_C;
+     for (int i = 0; i < set->num_windows; i++) {
+          if (set->windows[i].channel == reading->kind) window_add(&set->windows[i], second, value);
+     }
+     if (!set->next_emit_second) {
+          // aligned on the cadence, like a clock
+          set->next_emit_second = second - second % set->every_seconds + set->every_seconds;
+     } else if (second >= set->next_emit_second) {
+          window_set_emit(set, reading);
+          set->next_emit_second = second - second % set->every_seconds + set->every_seconds;
+     }
+}
+
+void window_set_close(WindowSet *set)
+{
+     window_stream_close(&set->stream);
+     for (int i = 0; i < set->num_windows; i++) {
+          Window *window = &set->windows[i];
+          memory_free(window->buckets);
+          memory_free(window->min.entries);
+          memory_free(window->max.entries);
+     }
+     set->num_windows = 0;
+}
+
+//
+// Self-check, against a brute-force recomputation over every sample
+//
+
+enum { WINDOW_CHECK_STEPS = 20000 };
+
+typedef struct WindowCheckSample
+{
+     int64_t second; // as counted: a report from a clock set back is in the latest second
+     float value;
+} WindowCheckSample;
+
+// Feeds a window reports at random: several per second, gaps longer than the
+// window, the clock set back, jumps of the values. After each step, its
+// statistics must match those recomputed from the samples in the window.
+static uint64_t window_check_duration(int64_t seconds, float base, uint32_t seed, uint64_t *comparisons)
+{
+     Window window;
+     WindowCheckSample *samples = malloc(WINDOW_CHECK_STEPS * sizeof *samples);
+     if (!samples || window_init(&window, ReadingKind_Temperature, seconds, "check") != 0) {
+          fprintf(stderr, "ERROR: out of memory\n");
+          free(samples);
+          return 1;
+     }
+     uint32_t random = seed;
+     int64_t second = 1700000000, latest = INT64_MIN;
+     float value = base;
+     int num_samples = 0;
+     uint64_t wrong = 0;
+     for (int step = 0; step < WINDOW_CHECK_STEPS; step++) {
+          random = random * 1664525 + 1013904223;
+          uint32_t r = random >> 8;
+          int add = 1;
+          switch (r % 20) {
+          case 0: second += 1 + (int64_t)(r / 20 % (2 * seconds)); break; // a gap
+          case 1: second -= (int64_t)(r / 20 % seconds) + 1; break; // the clock set back
+          case 2: add = 0; second += 1 + (int64_t)(r / 20 % seconds); break; // time passes, no report
+          case 3: value = base + (float)(r / 20 % 2000) / 8; break; // a jump
+          default:
+               if (r % 3 == 0) second++;
+               value += (float)((int)(r / 20 % 17) - 8) / 4;
+          }
+          if (add) {
+               window_add(&window, second, value);
+               if (second > latest) latest = second;
+               samples[num_samples++] = (WindowCheckSample){ latest, value };
+          } else {
+               window_advance(&window, second);
+               if (second > latest) latest = second;
+          }
+
+          WindowStats expected = {0}, actual;
+          double sum = 0, sum_sq = 0;
+          for (int i = num_samples - 1; i >= 0 && samples[i].second > latest - seconds; i--) {
+               float x = samples[i].value;
+               if (!expected.count || x < expected.min) expected.min = x;
+               if (!expected.count || x > expected.max) expected.max = x;
+               expected.count++;
+               sum += x;
+          }
+          if (expected.count) {
+               expected.mean = sum / expected.count;
+               for (int i = num_samples - 1; i >= 0 && samples[i].second > latest - seconds; i--) {
+                    sum_sq += (samples[i].value - expected.mean) * (samples[i].value - expected.mean);
+               }
+               expected.stddev = sqrt(sum_sq / expected.count);
+          }
+          window_get_stats(&window, &actual);
+          (*comparisons)++;
+          double tolerance = 1e-6 * (fabs(base) + 1000);
+          int ok = actual.count == expected.count && actual.min == expected.min && actual.max == expected.max
+                   && fabs(actual.mean - expected.mean) <= tolerance && fabs(actual.stddev - expected.stddev) <= tolerance;
+          if (!ok && !wrong) {
+               fprintf(stderr, "ERROR: %llds window at step %d: count %llu mean %f stddev %f min %f max %f, "
+                       "expected %llu %f %f %f %f\n", (long long)seconds, step,
+                       (unsigned long long)actual.count, actual.mean, actual.stddev, actual.min, actual.max,
+                       (unsigned long long)expected.count, expected.mean, expected.stddev, expected.min, expected.max);
+          }
+          wrong += !ok;
+     }
+     memory_free(window.buckets);
+     memory_free(window.min.entries);
+     memory_free(window.max.entries);
+     free(samples);
+     return wrong;
+}
+
+// Runs the checks, dir is not used. Returns 0 when all pass.
+int window_check(char const *dir)
+{
+     (void)dir;
+     int64_t const durations[] = { 1, 2, 7, 60, 600 };
+     float const bases[] = { 400, -20, 100000 }; // ppm, degrees, far from 0
+     uint64_t comparisons = 0, wrong = 0;
+     for (size_t d = 0; d < sizeof durations / sizeof durations[0]; d++) {
+          for (size_t b = 0; b < sizeof bases / sizeof bases[0]; b++) {
+               wrong += window_check_duration(durations[d], bases[b], (uint32_t)(1 + d * 7 + b), &comparisons);
+          }
+     }
+     fprintf(stderr, "check\twindow\t%llu comparisons against a brute-force recomputation, %llu wrong\n",
+             (unsigned long long)comparisons, (unsigned long long)wrong);
+     return wrong ? -1 : 0;
+}